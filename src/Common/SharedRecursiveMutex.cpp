@@ -0,0 +1,128 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// it will be useful, but WITHOUT ANY WARRANTY; without even an
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "SharedRecursiveMutex.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Tools {
+
+SharedRecursiveMutex::SharedRecursiveMutex() :
+  m_upgradeDepth(0),
+  m_exclusiveDepth(0),
+  m_ownerSharedDepth(0),
+  m_readers(0),
+  m_exclusivePending(false) {
+}
+
+void SharedRecursiveMutex::lock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_owner != std::this_thread::get_id()) {
+    acquireOwnership(lock);
+  }
+
+  if (m_exclusiveDepth == 0) {
+    m_exclusivePending = true;
+    m_changed.wait(lock, [this] { return m_readers == 0; });
+    m_exclusivePending = false;
+  }
+
+  ++m_exclusiveDepth;
+}
+
+void SharedRecursiveMutex::unlock() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  assert(m_owner == std::this_thread::get_id() && m_exclusiveDepth > 0);
+  if (--m_exclusiveDepth == 0) {
+    m_changed.notify_all();
+  }
+
+  releaseOwnershipIfIdle();
+}
+
+void SharedRecursiveMutex::lock_shared() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_owner == std::this_thread::get_id()) {
+    ++m_ownerSharedDepth;
+    return;
+  }
+
+  size_t& depth = threadSharedDepth();
+  if (depth == 0) {
+    // a re-entering reader must not wait for a pending writer, the writer is waiting for it
+    m_changed.wait(lock, [this] { return m_exclusiveDepth == 0 && !m_exclusivePending; });
+    ++m_readers;
+  }
+
+  ++depth;
+}
+
+void SharedRecursiveMutex::unlock_shared() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_owner == std::this_thread::get_id() && m_ownerSharedDepth > 0) {
+    --m_ownerSharedDepth;
+    return;
+  }
+
+  size_t& depth = threadSharedDepth();
+  assert(depth > 0);
+  if (--depth == 0 && --m_readers == 0) {
+    m_changed.notify_all();
+  }
+}
+
+void SharedRecursiveMutex::lock_upgrade() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_owner != std::this_thread::get_id()) {
+    acquireOwnership(lock);
+  }
+
+  ++m_upgradeDepth;
+}
+
+void SharedRecursiveMutex::unlock_upgrade() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  assert(m_owner == std::this_thread::get_id() && m_upgradeDepth > 0);
+  --m_upgradeDepth;
+  releaseOwnershipIfIdle();
+}
+
+size_t& SharedRecursiveMutex::threadSharedDepth() {
+  thread_local std::unordered_map<const SharedRecursiveMutex*, size_t> depths;
+  return depths[this];
+}
+
+void SharedRecursiveMutex::acquireOwnership(std::unique_lock<std::mutex>& lock) {
+  if (threadSharedDepth() != 0) {
+    throw std::logic_error("SharedRecursiveMutex: shared owner can't acquire exclusive ownership");
+  }
+
+  m_changed.wait(lock, [this] { return m_owner == std::thread::id(); });
+  m_owner = std::this_thread::get_id();
+}
+
+void SharedRecursiveMutex::releaseOwnershipIfIdle() {
+  if (m_upgradeDepth == 0 && m_exclusiveDepth == 0) {
+    assert(m_ownerSharedDepth == 0);
+    m_owner = std::thread::id();
+    m_changed.notify_all();
+  }
+}
+
+}
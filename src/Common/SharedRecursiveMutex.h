@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// it will be useful, but WITHOUT ANY WARRANTY; without even an
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace Tools {
+
+// Reader/writer mutex with three modes, all of them recursive:
+//  - shared:    any number of threads, blocked only by exclusive ownership (and by a pending upgrade to it);
+//  - upgrade:   one owner at a time, coexists with shared holders;
+//  - exclusive: taken by the owner (acquiring ownership first if needed) once all shared holders are gone.
+// The owner thread may re-enter any mode. A thread holding only a shared lock must not ask for
+// upgrade or exclusive ownership: it would wait for itself, so std::logic_error is thrown instead.
+// Satisfies Lockable (std::lock_guard) and SharedLockable (std::shared_lock).
+class SharedRecursiveMutex {
+public:
+  SharedRecursiveMutex();
+  SharedRecursiveMutex(const SharedRecursiveMutex&) = delete;
+  SharedRecursiveMutex& operator=(const SharedRecursiveMutex&) = delete;
+
+  void lock();
+  void unlock();
+
+  void lock_shared();
+  void unlock_shared();
+
+  void lock_upgrade();
+  void unlock_upgrade();
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+  std::thread::id m_owner;
+  size_t m_upgradeDepth;
+  size_t m_exclusiveDepth;
+  size_t m_ownerSharedDepth;
+  size_t m_readers;
+  bool m_exclusivePending;
+
+  size_t& threadSharedDepth();
+  void acquireOwnership(std::unique_lock<std::mutex>& lock);
+  void releaseOwnershipIfIdle();
+};
+
+}
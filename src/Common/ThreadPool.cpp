@@ -0,0 +1,115 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// it will be useful, but WITHOUT ANY WARRANTY; without even an
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "ThreadPool.h"
+
+namespace Tools {
+
+ThreadPool::ThreadPool(size_t threadCount) :
+  m_stopped(false),
+  m_jobId(0),
+  m_jobCount(0),
+  m_job(nullptr),
+  m_nextIndex(0),
+  m_busyThreads(0) {
+  for (size_t i = 1; i < threadCount; ++i) {
+    m_threads.emplace_back(&ThreadPool::threadProcedure, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+
+  m_jobReady.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+size_t ThreadPool::threadCount() const {
+  return m_threads.size() + 1;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t index, size_t thread)>& task) {
+  if (count == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> callLock(m_callMutex);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_job = &task;
+    m_jobCount = count;
+    m_nextIndex = 0;
+    m_exception = nullptr;
+    m_busyThreads = m_threads.size();
+    ++m_jobId;
+  }
+
+  m_jobReady.notify_all();
+  runJob(0);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_jobDone.wait(lock, [this] { return m_busyThreads == 0; });
+  m_job = nullptr;
+
+  if (m_exception) {
+    std::rethrow_exception(m_exception);
+  }
+}
+
+void ThreadPool::threadProcedure(size_t thread) {
+  uint64_t lastJobId = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_jobReady.wait(lock, [&] { return m_stopped || m_jobId != lastJobId; });
+      if (m_stopped) {
+        return;
+      }
+
+      lastJobId = m_jobId;
+    }
+
+    runJob(thread);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_busyThreads == 0) {
+      m_jobDone.notify_one();
+    }
+  }
+}
+
+void ThreadPool::runJob(size_t thread) {
+  for (size_t index = m_nextIndex++; index < m_jobCount; index = m_nextIndex++) {
+    try {
+      (*m_job)(index, thread);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_exception) {
+        m_exception = std::current_exception();
+      }
+
+      m_nextIndex = m_jobCount;
+    }
+  }
+}
+
+}
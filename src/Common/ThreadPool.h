@@ -0,0 +1,68 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// it will be useful, but WITHOUT ANY WARRANTY; without even an
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tools {
+
+// Fixed set of threads that run data-parallel loops. The thread calling parallelFor takes part in the
+// loop, so a pool of N threads starts N - 1 of its own and a pool of one thread runs everything inline.
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t threadCount);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  size_t threadCount() const;
+
+  // Calls task(index, thread) for every index in [0, count) and returns when all calls have finished.
+  // thread is in [0, threadCount()) and identifies the executing thread, so tasks may use per-thread state.
+  // The first exception thrown by a task is rethrown here, remaining indexes are skipped.
+  // Calls from different threads run one after another. Not reentrant: a task must not call parallelFor of the same pool.
+  void parallelFor(size_t count, const std::function<void(size_t index, size_t thread)>& task);
+
+private:
+  std::vector<std::thread> m_threads;
+  std::mutex m_callMutex;
+  std::mutex m_mutex;
+  std::condition_variable m_jobReady;
+  std::condition_variable m_jobDone;
+  bool m_stopped;
+
+  uint64_t m_jobId;
+  size_t m_jobCount;
+  const std::function<void(size_t, size_t)>* m_job;
+  std::atomic<size_t> m_nextIndex;
+  size_t m_busyThreads;
+  std::exception_ptr m_exception;
+
+  void threadProcedure(size_t thread);
+  void runJob(size_t thread);
+};
+
+}
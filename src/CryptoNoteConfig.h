@@ -127,6 +127,7 @@ namespace CryptoNote
 		const char CRYPTONOTE_BLOCKS_FILENAME[] = "blocks.dat";
  		const char CRYPTONOTE_BLOCKINDEXES_FILENAME[] = "blockindexes.dat";
  		const char CRYPTONOTE_BLOCKSCACHE_FILENAME[] = "blockscache.dat";
+ 		const char CRYPTONOTE_OUTPUTS_FILENAME[] = "outputs.dat";
  		const char CRYPTONOTE_POOLDATA_FILENAME[] = "poolstate.bin";
  		const char P2P_NET_DATA_FILENAME[] = "p2pstate.bin";
  		const char CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME[] = "blockchainindices.dat";
@@ -154,6 +155,7 @@ namespace CryptoNote
 	const size_t BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT = 10000; // by default, blocks ids count in synchronizing
 	const size_t BLOCKS_SYNCHRONIZING_DEFAULT_COUNT = 128;		 // by default, blocks count in blocks downloading
 	const size_t COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT = 1000;
+	const size_t COMMAND_RPC_GET_BLOCK_SUMMARIES_MAX_COUNT = 1000;
 
 	const int P2P_DEFAULT_PORT = 10808;
  	const int RPC_DEFAULT_PORT = 18180;
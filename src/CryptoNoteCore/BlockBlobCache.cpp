@@ -0,0 +1,80 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "BlockBlobCache.h"
+
+namespace CryptoNote {
+
+  size_t SerializedBlock::memorySize() const {
+    size_t size = sizeof(*this) + block.size();
+    for (const auto& transaction : transactions) {
+      // a prefix decodes to roughly the size of its blob
+      size += sizeof(transaction) + sizeof(TransactionPrefixInfo) + 2 * transaction.size();
+    }
+
+    return size;
+  }
+
+  BlockBlobCache::BlockBlobCache(size_t maxMemorySize) : m_maxMemorySize(maxMemorySize), m_memorySize(0), m_hits(0), m_misses(0) {
+  }
+
+  std::shared_ptr<const SerializedBlock> BlockBlobCache::find(const Crypto::Hash& blockId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(blockId);
+    if (it == m_index.end()) {
+      ++m_misses;
+      return nullptr;
+    }
+
+    m_entries.splice(m_entries.end(), m_entries, it->second);
+    ++m_hits;
+    return *it->second;
+  }
+
+  void BlockBlobCache::insert(const std::shared_ptr<const SerializedBlock>& block) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_index.count(block->id) != 0) {
+      return;
+    }
+
+    m_index[block->id] = m_entries.insert(m_entries.end(), block);
+    m_memorySize += block->memorySize();
+    while (m_memorySize > m_maxMemorySize && m_entries.size() > 1) {
+      m_memorySize -= m_entries.front()->memorySize();
+      m_index.erase(m_entries.front()->id);
+      m_entries.pop_front();
+    }
+  }
+
+  void BlockBlobCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    m_memorySize = 0;
+  }
+
+  uint64_t BlockBlobCache::hits() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+  }
+
+  uint64_t BlockBlobCache::misses() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+  }
+
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+  // A main chain block in the form wallets download it: the block and transaction blobs are copied from
+  // storage, not serialized again, and the prefixes and hashes for the lite queries are computed once.
+  struct SerializedBlock {
+    Crypto::Hash id;
+    uint64_t timestamp;
+    std::string block;
+    // without the base transaction
+    std::vector<std::string> transactions;
+    std::vector<TransactionPrefixInfo> transactionPrefixes;
+
+    size_t memorySize() const;
+  };
+
+  // LRU of serialized blocks keyed by block hash, so entries never go stale on reorganization.
+  class BlockBlobCache {
+  public:
+    explicit BlockBlobCache(size_t maxMemorySize);
+
+    std::shared_ptr<const SerializedBlock> find(const Crypto::Hash& blockId);
+    void insert(const std::shared_ptr<const SerializedBlock>& block);
+    void clear();
+
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+  private:
+    typedef std::list<std::shared_ptr<const SerializedBlock>> Entries;
+
+    mutable std::mutex m_mutex;
+    size_t m_maxMemorySize;
+    size_t m_memorySize;
+    Entries m_entries;
+    std::unordered_map<Crypto::Hash, Entries::iterator> m_index;
+    uint64_t m_hits;
+    uint64_t m_misses;
+  };
+
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "BlockHashingBatch.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "CryptoNoteFormatUtils.h"
+
+namespace CryptoNote {
+
+  BlockHashingBatch::BlockHashingBatch() : m_blobSize(0), m_nonceOffset(0), m_light(0), m_variant(0) {
+  }
+
+  bool BlockHashingBatch::setBlock(const Block& block) {
+    BinaryArray blob;
+    if (!get_block_longhash_blob(block, blob, m_nonceOffset)) {
+      m_blobSize = 0;
+      return false;
+    }
+
+    get_block_longhash_variant(block.majorVersion, m_light, m_variant);
+    m_blobSize = blob.size();
+    m_blobs.resize(m_blobSize * SIZE);
+    for (size_t i = 0; i < SIZE; ++i) {
+      std::copy(blob.begin(), blob.end(), m_blobs.begin() + i * m_blobSize);
+    }
+
+    return true;
+  }
+
+  void BlockHashingBatch::hash(Crypto::cn_context& context, uint32_t nonce, uint32_t step, Crypto::Hash* hashes) {
+    assert(m_blobSize != 0);
+    for (size_t i = 0; i < SIZE; ++i) {
+      uint32_t blobNonce = nonce + static_cast<uint32_t>(i) * step;
+      memcpy(m_blobs.data() + i * m_blobSize + m_nonceOffset, &blobNonce, sizeof(blobNonce));
+    }
+
+    Crypto::cn_slow_hash_batch(context, m_blobs.data(), m_blobSize, SIZE, hashes, m_light, m_variant);
+  }
+
+}
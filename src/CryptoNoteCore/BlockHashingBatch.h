@@ -0,0 +1,48 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CryptoNoteBasic.h"
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+  // Long hashes of a block for runs of nonces. The hashing blob is built once per template and each nonce is written
+  // into a copy of it, so trying a nonce doesn't serialize the block or hash its transactions again.
+  class BlockHashingBatch {
+  public:
+    static const size_t SIZE = 4;
+
+    BlockHashingBatch();
+
+    bool setBlock(const Block& block);
+    // Hashes nonce, nonce + step, ... SIZE nonces in all
+    void hash(Crypto::cn_context& context, uint32_t nonce, uint32_t step, Crypto::Hash* hashes);
+
+  private:
+    BinaryArray m_blobs;
+    size_t m_blobSize;
+    size_t m_nonceOffset;
+    int m_light;
+    int m_variant;
+  };
+
+}
@@ -21,19 +21,27 @@
 
 #include <algorithm>
 #include <numeric>
+#include <set>
+#include <unordered_set>
 #include <cstdio>
 #include <cmath>
+#include <functional>
+#include <thread>
 #include <boost/foreach.hpp>
 #include "Common/Math.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/ScopeExit.h"
 #include "Common/int-util.h"
 #include "Common/ShuffleGenerator.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
+#include "Common/VectorOutputStream.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
 #include "Serialization/BinarySerializationTools.h"
 #include "CryptoNoteTools.h"
 #include "TransactionExtra.h"
 #include "CryptoNoteConfig.h"
+#include "SnapshotFile.h"
 #include "parallel_hashmap/phmap_dump.h"
 
 using namespace Logging;
@@ -41,6 +49,11 @@ using namespace Common;
 
 namespace {
 
+// proof of work of the foundational blocks below this height isn't validated
+const uint32_t POW_VALIDATION_START_HEIGHT = 800000;
+// memory for serialized blocks served to wallets
+const size_t BLOCK_BLOB_CACHE_SIZE = 64 * 1024 * 1024;
+
 std::string appendPath(const std::string& path, const std::string& fileName) {
   std::string result = path;
   if (!result.empty()) {
@@ -51,6 +64,29 @@ std::string appendPath(const std::string& path, const std::string& fileName) {
   return result;
 }
 
+// Crypto::rand takes the global random lock for every value, mixin sampling draws them in batches instead.
+class RandomBatch {
+public:
+  RandomBatch() : m_next(VALUE_COUNT) {
+  }
+
+  uint64_t next() {
+    if (m_next == VALUE_COUNT) {
+      std::lock_guard<std::mutex> lock(Crypto::random_lock);
+      Crypto::generate_random_bytes(sizeof(m_values), m_values);
+      m_next = 0;
+    }
+
+    return m_values[m_next++];
+  }
+
+private:
+  static const size_t VALUE_COUNT = 64;
+
+  uint64_t m_values[VALUE_COUNT];
+  size_t m_next;
+};
+
 }
 
 namespace std {
@@ -63,12 +99,10 @@ bool operator<(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyIma
 }
 }
 
-#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 4
-#define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 1
+#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 6
 
 namespace CryptoNote {
 class BlockCacheSerializer;
-class BlockchainIndicesSerializer;
 } // namespace CryptoNote
 
 namespace CryptoNote {
@@ -131,210 +165,186 @@ void serialize(Blockchain::TransactionIndex& value, ISerializer& s) {
   s(value.transaction, "tx");
 }
 
-class BlockCacheSerializer {
+namespace {
 
+// phmap dump/load archives over memory buffers, so that hash maps go into snapshot chunks as raw copies
+class MemoryDumpArchive {
 public:
-  BlockCacheSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
-    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockCacheSerializer") {
+  explicit MemoryDumpArchive(BinaryArray& buffer) : m_buffer(buffer) {
   }
 
-  void load(const std::string& filename) {
-    try {
-      std::ifstream stdStream(filename, std::ios::binary);
-      if (!stdStream) {
-        return;
-      }
+  bool dump(const char* data, size_t size) {
+    m_buffer.insert(m_buffer.end(), data, data + size);
+    return true;
+  }
 
-      StdInputStream stream(stdStream);
-      BinaryInputStreamSerializer s(stream);
-      CryptoNote::serialize(*this, s);
-    } catch (std::exception& e) {
-      logger(WARNING) << "loading failed: " << e.what();
-    }
+  template<class V> bool dump(const V& value) {
+    return dump(reinterpret_cast<const char*>(&value), sizeof(V));
   }
 
-  bool save(const std::string& filename) {
-    try {
-      std::ofstream file(filename, std::ios::binary);
-      if (!file) {
-        return false;
-      }
+private:
+  BinaryArray& m_buffer;
+};
+
+class MemoryLoadArchive {
+public:
+  explicit MemoryLoadArchive(const BinaryArray& buffer) : m_buffer(buffer), m_offset(0) {
+  }
 
-      StdOutputStream stream(file);
-      BinaryOutputStreamSerializer s(stream);
-      CryptoNote::serialize(*this, s);
-    } catch (std::exception&) {
+  bool load(char* data, size_t size) {
+    if (size > m_buffer.size() - m_offset) {
       return false;
     }
 
+    memcpy(data, m_buffer.data() + m_offset, size);
+    m_offset += size;
     return true;
   }
 
-  void serialize(ISerializer& s) {
-    auto start = std::chrono::steady_clock::now();
-
-    uint8_t version = CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER;
-    s(version, "version");
-
-    // ignore old versions, do rebuild
-    if (version < CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER) {
-      return;
-    }
-
-    std::string operation;
-    if (s.type() == ISerializer::INPUT) {
-      operation = "- loading ";
-      Crypto::Hash blockHash;
-      s(blockHash, "last_block");
-
-      if (blockHash != m_lastBlockHash) {
-        return;
-      }
-
-    } else {
-      operation = "- saving ";
-      s(m_lastBlockHash, "last_block");
-    }
-
-    logger(INFO) << operation << "block index...";
-    s(m_bs.m_blockIndex, "block_index");
-
-      logger(INFO) << operation << "transaction map";
-      if (s.type() == ISerializer::INPUT)
-      {
-        phmap::BinaryInputArchive ar_in(appendPath(m_bs.m_config_folder, "transactionsmap.dat").c_str());
-        m_bs.m_transactionMap.load(ar_in);
-      }
-      else
-      {
-        phmap::BinaryOutputArchive ar_out(appendPath(m_bs.m_config_folder, "transactionsmap.dat").c_str());
-        m_bs.m_transactionMap.dump(ar_out);
-      }
-
-      logger(INFO) << operation << "spent keys";
-      if (s.type() == ISerializer::INPUT)
-      {
-        phmap::BinaryInputArchive ar_in(appendPath(m_bs.m_config_folder, "spentkeys.dat").c_str());
-        m_bs.m_spent_keys.load(ar_in);
-      }
-      else
-      {
-        phmap::BinaryOutputArchive ar_out(appendPath(m_bs.m_config_folder, "spentkeys.dat").c_str());
-        m_bs.m_spent_keys.dump(ar_out);
-      }
-
-      logger(INFO) << operation << "outputs";
-      s(m_bs.m_outputs, "outputs");
-
-      logger(INFO) << operation << "multi-signature outputs";
-      s(m_bs.m_multisignatureOutputs, "multisig_outputs");
-
-      logger(INFO) << operation << "deposit index";
-      s(m_bs.m_depositIndex, "deposit_index");
-
-    auto dur = std::chrono::steady_clock::now() - start;
-
-    logger(INFO) << "Serialization time: " << std::chrono::duration_cast<std::chrono::milliseconds>(dur).count() << "ms";
-
-    m_loaded = true;
+  template<class V> bool load(V* value) {
+    return load(reinterpret_cast<char*>(value), sizeof(V));
   }
 
-  bool loaded() const {
-    return m_loaded;
+  bool atEnd() const {
+    return m_offset == m_buffer.size();
   }
 
 private:
-
-  LoggerRef logger;
-  bool m_loaded;
-  Blockchain& m_bs;
-  Crypto::Hash m_lastBlockHash;
+  const BinaryArray& m_buffer;
+  size_t m_offset;
 };
 
-class BlockchainIndicesSerializer {
+template<class T> BinaryArray dumpChunk(const T& map) {
+  BinaryArray chunk;
+  MemoryDumpArchive archive(chunk);
+  map.dump(archive);
+  return chunk;
+}
 
-public:
-  BlockchainIndicesSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
-    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockchainIndicesSerializer") {
+template<class T> void loadChunk(T& map, const BinaryArray& chunk) {
+  MemoryLoadArchive archive(chunk);
+  if (!map.load(archive) || !archive.atEnd()) {
+    throw std::runtime_error("invalid hash map chunk");
   }
+}
 
-  void serialize(ISerializer& s) {
-
-    uint8_t version = CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER;
-
-    KV_MEMBER(version);
+template<class T> BinaryArray serializeChunk(T& value, Common::StringView name) {
+  BinaryArray chunk;
+  Common::VectorOutputStream stream(chunk);
+  BinaryOutputStreamSerializer serializer(stream);
+  ISerializer& s = serializer;
+  s(value, name);
+  return chunk;
+}
 
-    // ignore old versions, do rebuild
-    if (version != CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER) {
-      return;
-    }
+template<class T> void deserializeChunk(T& value, const BinaryArray& chunk, Common::StringView name) {
+  Common::MemoryInputStream stream(chunk.data(), chunk.size());
+  BinaryInputStreamSerializer serializer(stream);
+  ISerializer& s = serializer;
+  s(value, name);
+  if (!stream.endOfStream()) {
+    throw std::runtime_error("unexpected data at the end of chunk");
+  }
+}
 
-    std::string operation;
+// Runs the chunk loaders in parallel, the first exception is rethrown.
+void loadChunks(const std::vector<std::function<void()>>& loaders) {
+  Tools::ThreadPool pool(std::min<size_t>(loaders.size(), std::max(1u, std::thread::hardware_concurrency())));
+  pool.parallelFor(loaders.size(), [&](size_t index, size_t) { loaders[index](); });
+}
 
-      if (s.type() == ISerializer::INPUT)
-      {
-        operation = "loading ";
+// parallel_flat_hash_map keeps its elements in independent submaps, keys of different submaps can be inserted from
+// different threads.
+template<class Map> struct Submaps : Map {
+  using Map::subcnt;
 
-        Crypto::Hash blockHash;
-        s(blockHash, "blockHash");
+  static size_t index(const Map& map, const typename Map::key_type& key) {
+    return Map::subidx(phmap::phmap_mix<sizeof(size_t)>()(map.hash_function()(key)));
+  }
+};
 
-        if (blockHash != m_lastBlockHash)
-        {
-          return;
-        }
-      }
-      else
-      {
-        operation = "- saving ";
-        s(m_lastBlockHash, "blockHash");
-      }
+}
 
-      logger(INFO) << operation << "paymentID index";
-      s(m_bs.m_paymentIdIndex, "paymentIdIndex");
+class BlockCacheSerializer {
 
-      logger(INFO) << operation << "timestamp index";
-      s(m_bs.m_timestampIndex, "timestampIndex");
+public:
+  BlockCacheSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
+    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockCacheSerializer") {
+  }
 
-      logger(INFO) << operation << "generated transactions index";
-      s(m_bs.m_generatedTransactionsIndex, "generatedTransactionsIndex");
+  void load(const std::string& filename) {
+    auto start = std::chrono::steady_clock::now();
+    try {
+      std::vector<BinaryArray> chunks = loadSnapshot(filename);
+      if (chunks.size() != CHUNK_COUNT) {
+        return;
+      }
 
-    m_loaded = true;
-  }
+      uint8_t version;
+      Crypto::Hash blockHash;
+      uint64_t outputCount;
+      Common::MemoryInputStream stream(chunks[0].data(), chunks[0].size());
+      BinaryInputStreamSerializer serializer(stream);
+      ISerializer& s = serializer;
+      s(version, "version");
+      // ignore old versions, do rebuild
+      if (version != CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER) {
+        return;
+      }
 
-  template<class Archive> void serialize(Archive& ar, unsigned int version) {
+      s(blockHash, "last_block");
+      if (blockHash != m_lastBlockHash) {
+        return;
+      }
 
-    // ignore old versions, do rebuild
-    if (version < CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER)
-      return;
+      s(outputCount, "output_count");
 
-      std::string operation;
-      if (Archive::is_loading::value)
-      {
-        operation = "loading ";
-        Crypto::Hash blockHash;
-        ar &blockHash;
+      logger(INFO) << "- loading block index, transaction map, spent keys, multi-signature outputs and deposit index";
+      loadChunks({
+        [&] { deserializeChunk(m_bs.m_blockIndex, chunks[1], "block_index"); },
+        [&] { loadChunk(m_bs.m_transactionMap, chunks[2]); },
+        [&] { loadChunk(m_bs.m_spent_keys, chunks[3]); },
+        [&] { deserializeChunk(m_bs.m_multisignatureOutputs, chunks[4], "multisig_outputs"); },
+        [&] { deserializeChunk(m_bs.m_depositIndex, chunks[5], "deposit_index"); }
+      });
 
-        if (blockHash != m_lastBlockHash)
-        {
-          return;
-        }
-      }
-      else
-      {
-        operation = "- saving ";
-        ar &m_lastBlockHash;
+      logger(INFO) << "- loading outputs";
+      if (!m_bs.m_outputIndex.load(outputCount)) {
+        return;
       }
+    } catch (std::exception& e) {
+      logger(WARNING) << "loading failed: " << e.what();
+      return;
+    }
 
-      logger(INFO) << operation << "paymentID index";
-      ar &m_bs.m_paymentIdIndex;
+    auto dur = std::chrono::steady_clock::now() - start;
+    logger(INFO) << "Serialization time: " << std::chrono::duration_cast<std::chrono::milliseconds>(dur).count() << "ms";
+    m_loaded = true;
+  }
 
-      logger(INFO) << operation << "timestamp index";
-      ar &m_bs.m_timestampIndex;
+  // Copies the cache into snapshot chunks. The caller holds the blockchain lock; compressing and writing the chunks
+  // can be left to another thread.
+  std::vector<BinaryArray> save() {
+    std::vector<BinaryArray> chunks;
+    chunks.reserve(CHUNK_COUNT);
 
-      logger(INFO) << operation << "generated transactions index";
-      ar &m_bs.m_generatedTransactionsIndex;
+    uint8_t version = CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER;
+    uint64_t outputCount = m_bs.m_outputIndex.size();
+    BinaryArray header;
+    Common::VectorOutputStream stream(header);
+    BinaryOutputStreamSerializer serializer(stream);
+    ISerializer& s = serializer;
+    s(version, "version");
+    s(m_lastBlockHash, "last_block");
+    s(outputCount, "output_count");
+    chunks.push_back(std::move(header));
 
-    m_loaded = true;
+    chunks.push_back(serializeChunk(m_bs.m_blockIndex, "block_index"));
+    chunks.push_back(dumpChunk(m_bs.m_transactionMap));
+    chunks.push_back(dumpChunk(m_bs.m_spent_keys));
+    chunks.push_back(serializeChunk(m_bs.m_multisignatureOutputs, "multisig_outputs"));
+    chunks.push_back(serializeChunk(m_bs.m_depositIndex, "deposit_index"));
+    return chunks;
   }
 
   bool loaded() const {
@@ -342,6 +352,7 @@ public:
   }
 
 private:
+  static const size_t CHUNK_COUNT = 6;
 
   LoggerRef logger;
   bool m_loaded;
@@ -357,6 +368,7 @@ private:
 			 m_checkpoints(logger),
 			 m_blockchainIndexesEnabled(blockchainIndexesEnabled),
 			 m_blockchainAutosaveEnabled(blockchainAutosaveEnabled),
+                         m_pushingBlock(nullptr),
                          m_upgradeDetectorV2(currency, m_blocks, BLOCK_MAJOR_VERSION_2, logger),
                          m_upgradeDetectorV3(currency, m_blocks, BLOCK_MAJOR_VERSION_3, logger),
                          m_upgradeDetectorV4(currency, m_blocks, BLOCK_MAJOR_VERSION_4, logger), 
@@ -364,7 +376,10 @@ private:
                          m_upgradeDetectorV6(currency, m_blocks, BLOCK_MAJOR_VERSION_6, logger), 
 			 m_upgradeDetectorV7(currency, m_blocks, BLOCK_MAJOR_VERSION_7, logger),
 			 m_upgradeDetectorV8(currency, m_blocks, BLOCK_MAJOR_VERSION_8, logger),
-        		 m_upgradeDetectorV9(currency, m_blocks, BLOCK_MAJOR_VERSION_9, logger) {
+        		 m_upgradeDetectorV9(currency, m_blocks, BLOCK_MAJOR_VERSION_9, logger),
+                         m_validationPool(nullptr),
+                         m_blockBlobCache(BLOCK_BLOB_CACHE_SIZE),
+                         m_difficultyWindow(std::max({currency.difficultyBlocksCount(), currency.difficultyBlocksCount2(), currency.difficultyBlocksCount3() + 1})) {
 }
 
 bool Blockchain::addObserver(IBlockchainStorageObserver* observer) {
@@ -376,6 +391,10 @@ bool Blockchain::removeObserver(IBlockchainStorageObserver* observer) {
 }
 
 bool Blockchain::checkTransactionInputs(const CryptoNote::Transaction& tx, BlockInfo& maxUsedBlock) {
+  if (findPrevalidatedInputs(getObjectHash(tx), maxUsedBlock)) {
+    return !haveTransactionKeyImagesAsSpent(tx) && check_tx_outputs(tx, maxUsedBlock.height);
+  }
+
   return checkTransactionInputs(tx, maxUsedBlock.height, maxUsedBlock.id) && check_tx_outputs(tx, maxUsedBlock.height);
 }
 
@@ -425,6 +444,164 @@ bool Blockchain::haveSpentKeyImages(const CryptoNote::Transaction& tx) {
   return this->haveTransactionKeyImagesAsSpent(tx);
 }
 
+void Blockchain::prevalidateTransactionInputs(const std::vector<std::pair<const Transaction*, Crypto::Hash>>& transactions) {
+  Crypto::RingSignatureBatch ringSignatures;
+  std::vector<size_t> ringSignatureTransactions;
+  std::vector<BlockInfo> maxUsedBlocks(transactions.size());
+  std::vector<bool> valid(transactions.size(), false);
+
+  {
+    SharedLock lk(*this);
+    // ring signatures aren't checked in the checkpoint zone, the batch may reach past it
+    if (m_is_in_checkpoint_zone) {
+      return;
+    }
+
+    for (size_t i = 0; i < transactions.size(); ++i) {
+      const Transaction& tx = *transactions[i].first;
+      // multisignature inputs depend on the usage flags of their outputs, they are always checked on import
+      bool keyInputsOnly = std::all_of(tx.inputs.begin(), tx.inputs.end(), [](const TransactionInput& input) {
+        return input.type() == typeid(KeyInput);
+      });
+
+      if (keyInputsOnly) {
+        Crypto::Hash prefixHash = getObjectHash(*static_cast<const TransactionPrefix*>(&tx));
+        valid[i] = checkTransactionInputs(tx, prefixHash, &maxUsedBlocks[i].height, &ringSignatures) &&
+          maxUsedBlocks[i].height < m_blocks.size();
+        if (valid[i]) {
+          maxUsedBlocks[i].id = get_block_hash(m_blocks[maxUsedBlocks[i].height].bl);
+        }
+      }
+
+      ringSignatureTransactions.resize(ringSignatures.size(), i);
+    }
+  }
+
+  verifyRingSignatures(ringSignatures);
+  for (size_t id = 0; id < ringSignatures.size(); ++id) {
+    if (!ringSignatures.isValid(id)) {
+      valid[ringSignatureTransactions[id]] = false;
+    }
+  }
+
+  std::lock_guard<std::mutex> lk(m_prevalidatedLock);
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    if (valid[i]) {
+      m_prevalidatedInputs[transactions[i].second] = maxUsedBlocks[i];
+    }
+  }
+}
+
+void Blockchain::prevalidateProofsOfWork(Crypto::cn_context& context, const std::vector<const Block*>& blocks) {
+  std::vector<const Block*> hashedBlocks;
+  for (const Block* block : blocks) {
+    uint32_t height = get_block_height(*block);
+    if (height >= POW_VALIDATION_START_HEIGHT && !m_checkpoints.is_in_checkpoint_zone(height)) {
+      hashedBlocks.push_back(block);
+    }
+  }
+
+  if (hashedBlocks.empty()) {
+    return;
+  }
+
+  std::vector<Crypto::Hash> proofsOfWork(hashedBlocks.size());
+  if (!get_block_longhashes(context, hashedBlocks.data(), hashedBlocks.size(), proofsOfWork.data())) {
+    return;
+  }
+
+  std::vector<Crypto::Hash> blockHashes;
+  for (const Block* block : hashedBlocks) {
+    blockHashes.push_back(get_block_hash(*block));
+  }
+
+  std::lock_guard<std::mutex> lk(m_prevalidatedLock);
+  for (size_t i = 0; i < hashedBlocks.size(); ++i) {
+    m_prevalidatedProofsOfWork[blockHashes[i]] = proofsOfWork[i];
+  }
+}
+
+void Blockchain::setValidationThreadPool(Tools::ThreadPool* pool) {
+  m_validationPool = pool;
+}
+
+void Blockchain::clearPrevalidatedData() {
+  std::lock_guard<std::mutex> lk(m_prevalidatedLock);
+  m_prevalidatedInputs.clear();
+  m_prevalidatedProofsOfWork.clear();
+}
+
+bool Blockchain::referencesBlockOutputs(const std::vector<Transaction>& transactions) const {
+  for (const auto& transaction : transactions) {
+    for (const auto& input : transaction.inputs) {
+      if (input.type() == typeid(KeyInput)) {
+        const KeyInput& keyInput = boost::get<KeyInput>(input);
+        uint64_t lastIndex = 0;
+        for (uint32_t offset : keyInput.outputIndexes) {
+          lastIndex += offset;
+        }
+
+        if (!keyInput.outputIndexes.empty() && lastIndex >= m_outputIndex.outputCount(keyInput.amount)) {
+          return true;
+        }
+      } else if (input.type() == typeid(MultisignatureInput)) {
+        const MultisignatureInput& multisignatureInput = boost::get<MultisignatureInput>(input);
+        auto amountOutputs = m_multisignatureOutputs.find(multisignatureInput.amount);
+        if (amountOutputs == m_multisignatureOutputs.end() || multisignatureInput.outputIndex >= amountOutputs->second.size()) {
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+bool Blockchain::findPrevalidatedInputs(const Crypto::Hash& txHash, BlockInfo& maxUsedBlock) {
+  {
+    std::lock_guard<std::mutex> lk(m_prevalidatedLock);
+    auto it = m_prevalidatedInputs.find(txHash);
+    if (it == m_prevalidatedInputs.end()) {
+      return false;
+    }
+
+    maxUsedBlock = it->second;
+  }
+
+  // the ring members are unchanged as long as the block of the newest one is still in the main chain
+  SharedLock lk(*this);
+  return maxUsedBlock.height < m_blocks.size() && get_block_hash(m_blocks[maxUsedBlock.height].bl) == maxUsedBlock.id;
+}
+
+bool Blockchain::checkProofOfWork(const Block& block, const Crypto::Hash& blockHash, difficulty_type currentDifficulty, Crypto::Hash& proofOfWork) {
+  bool prevalidated = false;
+  {
+    std::lock_guard<std::mutex> lk(m_prevalidatedLock);
+    auto it = m_prevalidatedProofsOfWork.find(blockHash);
+    if (it != m_prevalidatedProofsOfWork.end()) {
+      proofOfWork = it->second;
+      prevalidated = true;
+    }
+  }
+
+  if (prevalidated) {
+    return m_currency.checkProofOfWork(block, currentDifficulty, proofOfWork);
+  }
+
+  return m_currency.checkProofOfWork(m_cn_context, block, currentDifficulty, proofOfWork);
+}
+
+bool Blockchain::verifyRingSignatures(Crypto::RingSignatureBatch& batch) {
+  Tools::ThreadPool* pool = m_validationPool;
+  if (pool == nullptr || pool->threadCount() == 1) {
+    return batch.verify();
+  }
+
+  return batch.verify([pool](size_t count, const std::function<void(size_t)>& task) {
+    pool->parallelFor(count, [&task](size_t index, size_t) { task(index); });
+  });
+}
+
 // pre m_blockchain_lock is locked
 
 bool Blockchain::checkTransactionSize(size_t blobSize) {
@@ -437,18 +614,38 @@ bool Blockchain::checkTransactionSize(size_t blobSize) {
   return true;
 }
 
+Blockchain::SharedLock::SharedLock(const Blockchain& bc) : m_bc(const_cast<Blockchain&>(bc)) {
+  m_bc.m_blockchain_lock.lock_shared();
+  m_epoch = m_bc.m_blocks.enterReader();
+}
+
+Blockchain::SharedLock::~SharedLock() {
+  m_bc.m_blocks.leaveReader(m_epoch);
+  m_bc.m_blockchain_lock.unlock_shared();
+}
+
+Blockchain::UpgradeLock::UpgradeLock(const Blockchain& bc) : m_bc(const_cast<Blockchain&>(bc)) {
+  m_bc.m_blockchain_lock.lock_upgrade();
+  m_epoch = m_bc.m_blocks.enterReader();
+}
+
+Blockchain::UpgradeLock::~UpgradeLock() {
+  m_bc.m_blocks.leaveReader(m_epoch);
+  m_bc.m_blockchain_lock.unlock_upgrade();
+}
+
 bool Blockchain::haveTransaction(const Crypto::Hash &id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return m_transactionMap.find(id) != m_transactionMap.end();
 }
 
 bool Blockchain::have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return  m_spent_keys.find(key_im) != m_spent_keys.end();
 }
 
 uint32_t Blockchain::getCurrentBlockchainHeight() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return static_cast<uint32_t>(m_blocks.size());
 }
 
@@ -465,6 +662,35 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     return false;
   }
 
+  try {
+    m_outputIndex.open(appendPath(config_folder, m_currency.outputsFileName()));
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open output index: " << e.what();
+    return false;
+  }
+
+  std::string indicesPath = appendPath(config_folder, m_currency.blockchinIndicesFileName());
+  try {
+    m_blockSummaries.open(indicesPath + ".summaries");
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open block summaries: " << e.what();
+    return false;
+  }
+
+  if (m_blockchainIndexesEnabled) {
+    try {
+      m_paymentIdIndex.open(indicesPath + ".paymentids");
+      m_timestampIndex.open(indicesPath + ".timestamps");
+      m_generatedTransactionsIndex.open(indicesPath + ".generated");
+    } catch (std::exception& e) {
+      logger(ERROR, BRIGHT_RED) << "Failed to open blockchain indices: " << e.what();
+      return false;
+    }
+
+    // written by versions that saved the indices as a whole
+    std::remove(indicesPath.c_str());
+  }
+
   if (load_existing && !m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
     BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
@@ -475,6 +701,8 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
       rebuildCache();
     }
 
+    loadBlockSummaries();
+
       /* Load (or generate) the indices only if Explorer mode is enabled */
       if (m_blockchainIndexesEnabled)
       {
@@ -489,8 +717,18 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     else
     {
       m_blocks.clear();
+      m_blockSummaries.clear();
+      if (m_blockchainIndexesEnabled)
+      {
+        m_paymentIdIndex.clear();
+        m_timestampIndex.clear();
+        m_generatedTransactionsIndex.clear();
+      }
     }
 
+  fillDifficultyWindow();
+  updateUnlockedOutputs();
+
   if (m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE)
       << "Blockchain not loaded, generating genesis block.";
@@ -614,85 +852,251 @@ if (!m_upgradeDetectorV2.init() || !m_upgradeDetectorV3.init() || !m_upgradeDete
     return true;
   }
 
+  // Results of one range of blocks, the hash maps are filled submap by submap.
+  struct Blockchain::RebuildBatch {
+    struct MultisignatureChange {
+      uint64_t amount;
+      uint32_t spentIndex;
+      bool spent;
+      MultisignatureOutputUsage output;
+    };
+
+    std::vector<Crypto::Hash> blockHashes;
+    std::vector<std::pair<int64_t, uint64_t>> deposits;
+    std::vector<std::vector<std::pair<Crypto::Hash, TransactionIndex>>> transactions;
+    std::vector<std::vector<std::pair<Crypto::KeyImage, uint32_t>>> keyImages;
+    std::vector<OutputIndex::Entry> keyOutputs;
+    // in chain order, an input may spend an output of an earlier transaction of the same batch
+    std::vector<MultisignatureChange> multisignatureChanges;
+  };
+
   void Blockchain::rebuildCache()
   {
     logger(INFO, BRIGHT_WHITE) << "Rebuilding cache";
 
+    // Blocks are hashed and scanned in parallel, in batches of consecutive blocks. The batches of a window are then
+    // merged in chain order, so the result doesn't depend on the number of threads.
+    const uint32_t batchSize = 256;
+    Tools::ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    const uint32_t windowSize = batchSize * static_cast<uint32_t>(pool.threadCount()) * 4;
+
     std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+    uint32_t blockCount = static_cast<uint32_t>(m_blocks.size());
     m_blockIndex.clear();
     m_transactionMap.clear();
     m_spent_keys.clear();
-    m_outputs.clear();
+    m_outputIndex.clear();
     m_multisignatureOutputs.clear();
-    for (uint32_t b = 0; b < m_blocks.size(); ++b)
+    m_depositIndex = DepositIndex(blockCount);
+
+    for (uint32_t windowBegin = 0; windowBegin < blockCount; windowBegin += windowSize)
     {
-      if (b % 1000 == 0)
-      {
-        logger(INFO, BRIGHT_WHITE) << "Rebuilding Cache for Height " << b << " of " << m_blocks.size();
-      }
+      uint32_t windowEnd = std::min(blockCount, windowBegin + windowSize);
+      std::vector<RebuildBatch> batches((windowEnd - windowBegin + batchSize - 1) / batchSize);
+      pool.parallelFor(batches.size(), [&](size_t index, size_t) {
+        uint32_t begin = windowBegin + static_cast<uint32_t>(index) * batchSize;
+        collectRebuildBatch(begin, std::min(windowEnd, begin + batchSize), batches[index]);
+      });
+
+      mergeRebuildBatches(batches, pool);
 
-      const BlockEntry &block = m_blocks[b];
-      Crypto::Hash blockHash = get_block_hash(block.bl);
-      m_blockIndex.push(blockHash);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - timePoint;
+      logger(INFO, BRIGHT_WHITE) << "Rebuilding Cache for Height " << windowEnd << " of " << blockCount << " (" <<
+        windowEnd * 100ull / blockCount << "%), about " << static_cast<uint64_t>(elapsed.count() * (blockCount - windowEnd) / windowEnd) <<
+        " s left";
+    }
+
+    updateUnlockedOutputs();
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+    logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
+  }
+
+  void Blockchain::collectRebuildBatch(uint32_t begin, uint32_t end, RebuildBatch& batch)
+  {
+    batch.transactions.resize(Submaps<TransactionMap>::subcnt());
+    batch.keyImages.resize(Submaps<key_images_container>::subcnt());
+    for (uint32_t b = begin; b < end; ++b)
+    {
+      // deserialized here rather than through the block cache, which would serialize the threads
+      BlockEntry block;
+      Common::ArrayView<uint8_t> blob = m_blocks.blob(b);
+      Common::MemoryInputStream stream(blob.getData(), blob.getSize());
+      BinaryInputStreamSerializer archive(stream);
+      block.serialize(archive);
+
+      batch.blockHashes.push_back(get_block_hash(block.bl));
       uint64_t interest = 0;
       for (uint16_t t = 0; t < block.transactions.size(); ++t)
       {
         const TransactionEntry &transaction = block.transactions[t];
         Crypto::Hash transactionHash = getObjectHash(transaction.tx);
         TransactionIndex transactionIndex = {b, t};
-        m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
+        batch.transactions[Submaps<TransactionMap>::index(m_transactionMap, transactionHash)].emplace_back(transactionHash, transactionIndex);
 
-        // process inputs
         for (auto &i : transaction.tx.inputs)
         {
           if (i.type() == typeid(KeyInput))
           {
-            m_spent_keys.insert(std::make_pair(::boost::get<KeyInput>(i).keyImage, b));
+            const Crypto::KeyImage &keyImage = ::boost::get<KeyInput>(i).keyImage;
+            batch.keyImages[Submaps<key_images_container>::index(m_spent_keys, keyImage)].emplace_back(keyImage, b);
           }
           else if (i.type() == typeid(MultisignatureInput))
           {
-            auto out = ::boost::get<MultisignatureInput>(i);
-            m_multisignatureOutputs[out.amount][out.outputIndex].isUsed = true;
+            const auto &in = ::boost::get<MultisignatureInput>(i);
+            batch.multisignatureChanges.push_back({ in.amount, in.outputIndex, true, {} });
           }
         }
 
-      // process outputs
-      for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
-        const auto& out = transaction.tx.outputs[o];
-        if (out.target.type() == typeid(KeyOutput)) {
-          m_outputs[out.amount].push_back(std::make_pair<>(transactionIndex, o));
-        } else if (out.target.type() == typeid(MultisignatureOutput)) {
-          MultisignatureOutputUsage usage = { transactionIndex, o, false };
-          m_multisignatureOutputs[out.amount].push_back(usage);
+        for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
+          const auto& out = transaction.tx.outputs[o];
+          if (out.target.type() == typeid(KeyOutput)) {
+            batch.keyOutputs.push_back({ ::boost::get<KeyOutput>(out.target).key, out.amount, transaction.tx.unlockTime, b, t, o });
+          } else if (out.target.type() == typeid(MultisignatureOutput)) {
+            MultisignatureOutputUsage usage = { transactionIndex, o, false };
+            batch.multisignatureChanges.push_back({ out.amount, 0, false, usage });
+          }
         }
-      }
+
         interest += m_currency.calculateTotalTransactionInterest(transaction.tx, b); //block.height); //block.height shows 0 wrongly sometimes apparently
       }
-      pushToDepositIndex(block, interest);
+
+      batch.deposits.emplace_back(getDepositChange(block), interest);
     }
+  }
 
-  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
-  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
-}
+  void Blockchain::mergeRebuildBatches(std::vector<RebuildBatch>& batches, Tools::ThreadPool& pool)
+  {
+    size_t transactionCount = 0;
+    size_t keyImageCount = 0;
+    for (const RebuildBatch& batch : batches)
+    {
+      for (const auto& submap : batch.transactions)
+      {
+        transactionCount += submap.size();
+      }
+
+      for (const auto& submap : batch.keyImages)
+      {
+        keyImageCount += submap.size();
+      }
+    }
+
+    m_transactionMap.reserve(m_transactionMap.size() + transactionCount);
+    m_spent_keys.reserve(m_spent_keys.size() + keyImageCount);
+
+    // every thread fills its own submaps, in chain order within each of them
+    size_t submapCount = Submaps<TransactionMap>::subcnt() + Submaps<key_images_container>::subcnt();
+    pool.parallelFor(submapCount, [&](size_t index, size_t) {
+      for (RebuildBatch& batch : batches)
+      {
+        if (index < batch.transactions.size())
+        {
+          m_transactionMap.insert(batch.transactions[index].begin(), batch.transactions[index].end());
+        }
+        else
+        {
+          const auto& keyImages = batch.keyImages[index - batch.transactions.size()];
+          m_spent_keys.insert(keyImages.begin(), keyImages.end());
+        }
+      }
+    });
+
+    for (RebuildBatch& batch : batches)
+    {
+      for (const Crypto::Hash& blockHash : batch.blockHashes)
+      {
+        m_blockIndex.push(blockHash);
+      }
+
+      for (const auto& change : batch.multisignatureChanges)
+      {
+        if (change.spent)
+        {
+          m_multisignatureOutputs[change.amount][change.spentIndex].isUsed = true;
+        }
+        else
+        {
+          m_multisignatureOutputs[change.amount].push_back(change.output);
+        }
+      }
+
+      for (const OutputIndex::Entry& output : batch.keyOutputs)
+      {
+        m_outputIndex.push(output);
+      }
+
+      for (const auto& deposit : batch.deposits)
+      {
+        m_depositIndex.pushBlock(deposit.first, deposit.second);
+      }
+    }
+  }
 
 bool Blockchain::storeCache() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::vector<BinaryArray> chunks;
+  {
+    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
-  logger(INFO, BRIGHT_WHITE) << "Saving blockchain...";
-  BlockCacheSerializer ser(*this, getTailId(), logger.getLogger());
-  if (!ser.save(appendPath(m_config_folder, m_currency.blocksCacheFileName()))) {
-    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache";
-    return false;
+    logger(INFO, BRIGHT_WHITE) << "Saving blockchain...";
+    auto start = std::chrono::steady_clock::now();
+    try {
+      // the cache records how many outputs are stored, they must be on disk first
+      m_outputIndex.flush();
+      BlockCacheSerializer ser(*this, getTailId(), logger.getLogger());
+      chunks = ser.save();
+    } catch (std::exception& e) {
+      logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache: " << e.what();
+      return false;
+    }
+
+    logger(INFO) << "Blockchain cache copied in " <<
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms";
   }
-    logger(INFO, BRIGHT_GREEN) << "Fuego blockchain was successfully saved.";
+
+  writeSnapshotAsync(appendPath(m_config_folder, m_currency.blocksCacheFileName()), std::move(chunks), [this](bool success) {
+    if (success) {
+      // left behind by versions that kept these maps outside of the cache file
+      std::remove(appendPath(m_config_folder, "transactionsmap.dat").c_str());
+      std::remove(appendPath(m_config_folder, "spentkeys.dat").c_str());
+      logger(INFO, BRIGHT_GREEN) << "Fuego blockchain was successfully saved.";
+    } else {
+      logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache";
+    }
+  });
+
   return true;
 }
 
-bool Blockchain::deinit() {
-  storeCache();
-  if (m_blockchainIndexesEnabled) {
-    storeBlockchainIndices();
+void Blockchain::writeSnapshotAsync(const std::string& path, std::vector<BinaryArray>&& chunks, std::function<void(bool)>&& done) {
+  std::lock_guard<std::mutex> lock(m_snapshotWriterMutex);
+  if (m_snapshotWriter.valid()) {
+    m_snapshotWriter.get();
+  }
+
+  m_snapshotWriter = std::async(std::launch::async, [this, path, chunks = std::move(chunks), done = std::move(done)] {
+    try {
+      storeSnapshot(path, chunks, true);
+    } catch (std::exception& e) {
+      logger(ERROR, BRIGHT_RED) << "Failed to write " << path << ": " << e.what();
+      done(false);
+      return;
+    }
+
+    done(true);
+  });
+}
+
+void Blockchain::waitForSnapshotWriter() {
+  std::lock_guard<std::mutex> lock(m_snapshotWriterMutex);
+  if (m_snapshotWriter.valid()) {
+    m_snapshotWriter.get();
   }
+}
+
+bool Blockchain::deinit() {
+  storeCache();
+  storeBlockchainIndices();
+  waitForSnapshotWriter();
   assert(m_messageQueueList.empty());
   return true;
 }
@@ -700,16 +1104,21 @@ bool Blockchain::deinit() {
 bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   m_blocks.clear();
+  m_difficultyWindow.clear();
   m_blockIndex.clear();
   m_transactionMap.clear();
 
   m_spent_keys.clear();
   m_alternative_chains.clear();
-  m_outputs.clear();
+  m_outputIndex.clear();
+  m_blockSummaries.clear();
+
+  if (m_blockchainIndexesEnabled) {
+    m_paymentIdIndex.clear();
+    m_timestampIndex.clear();
+    m_generatedTransactionsIndex.clear();
+  }
 
-  m_paymentIdIndex.clear();
-  m_timestampIndex.clear();
-  m_generatedTransactionsIndex.clear();
   m_orthanBlocksIndex.clear();
 
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
@@ -719,24 +1128,24 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
 
 Crypto::Hash Blockchain::getTailId(uint32_t& height) {
   assert(!m_blocks.empty());
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   height = getCurrentBlockchainHeight() - 1;
   return getTailId();
 }
 
 Crypto::Hash Blockchain::getTailId() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId();
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   assert(m_blockIndex.size() != 0);
   return doBuildSparseChain(m_blockIndex.getTailId());
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain(const Crypto::Hash& startBlockId) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   assert(haveBlock(startBlockId));
   return doBuildSparseChain(startBlockId);
 }
@@ -773,13 +1182,13 @@ std::vector<Crypto::Hash> Blockchain::doBuildSparseChain(const Crypto::Hash& sta
 }
 
 Crypto::Hash Blockchain::getBlockIdByHeight(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   assert(height < m_blockIndex.size());
   return m_blockIndex.getBlockId(height);
 }
 
 bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
 
   uint32_t height = 0;
 
@@ -800,14 +1209,12 @@ bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
 }
 
 bool Blockchain::getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
+  SharedLock lock(*this);
   return m_blockIndex.getBlockHeight(blockId, blockHeight);
 }
 
 difficulty_type Blockchain::getDifficultyForNextBlock() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> cumulative_difficulties;
+  SharedLock lk(*this);
   uint8_t BlockMajorVersion = getBlockMajorVersionForHeight(static_cast<uint32_t>(m_blocks.size()));
   size_t offset;
   offset = m_blocks.size() - std::min(m_blocks.size(), static_cast<uint64_t>(m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion)));
@@ -815,11 +1222,21 @@ difficulty_type Blockchain::getDifficultyForNextBlock() {
   if (offset == 0) {
     ++offset;
   }
+
+  uint32_t endHeight = static_cast<uint32_t>(m_blocks.size());
+  if (m_difficultyWindow.covers(static_cast<uint32_t>(offset), endHeight)) {
+    return m_currency.nextDifficulty(endHeight, BlockMajorVersion, m_difficultyWindow.timestamps(static_cast<uint32_t>(offset), endHeight),
+      m_difficultyWindow.cumulativeDifficulties(static_cast<uint32_t>(offset), endHeight));
+  }
+
+  std::vector<uint64_t> timestamps;
+  std::vector<difficulty_type> cumulative_difficulties;
   for (; offset < m_blocks.size(); offset++) {
     timestamps.push_back(m_blocks[offset].bl.timestamp);
     cumulative_difficulties.push_back(m_blocks[offset].cumulative_difficulty);
   }
-  return m_currency.nextDifficulty(static_cast<uint32_t>(m_blocks.size()), BlockMajorVersion, timestamps, cumulative_difficulties);
+  return m_currency.nextDifficulty(endHeight, BlockMajorVersion, Common::ArrayView<uint64_t>(timestamps.data(), timestamps.size()),
+    Common::ArrayView<difficulty_type>(cumulative_difficulties.data(), cumulative_difficulties.size()));
 }
 
 uint64_t Blockchain::getBlockTimestamp(uint32_t height) {
@@ -828,7 +1245,7 @@ uint64_t Blockchain::getBlockTimestamp(uint32_t height) {
 }
 
 uint64_t Blockchain::getCoinsInCirculation() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   if (m_blocks.empty()) {
     return 0;
   } else {
@@ -837,14 +1254,14 @@ uint64_t Blockchain::getCoinsInCirculation() {
 }
     
 uint64_t Blockchain::coinsEmittedAtHeight(uint64_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   const auto& block = m_blocks[height];
   return block.already_generated_coins;
 }
   
   difficulty_type Blockchain::difficultyAtHeight(uint64_t height)
   {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    SharedLock lk(*this);
     const auto &current = m_blocks[height];
     if (height < 1)
     {
@@ -1087,7 +1504,7 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
   // if the alt chain isn't long enough to calculate the difficulty target
   // based on its blocks alone, need to get more blocks from the main chain
   if (alt_chain.size() < m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion)) {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    SharedLock lk(*this);
     size_t main_chain_stop_offset = alt_chain.size() ? alt_chain.front()->second.height : bei.height;
     size_t main_chain_count = m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion) - std::min(m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion), alt_chain.size());
     main_chain_count = std::min(main_chain_count, main_chain_stop_offset);
@@ -1097,9 +1514,16 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
       ++main_chain_start_offset; //skip genesis block
     
     // get difficulties and timestamps from relevant main chain blocks
-    for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
-      timestamps.push_back(m_blocks[main_chain_start_offset].bl.timestamp);
-      cumulative_difficulties.push_back(m_blocks[main_chain_start_offset].cumulative_difficulty);
+    if (m_difficultyWindow.covers(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset))) {
+      auto windowTimestamps = m_difficultyWindow.timestamps(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset));
+      auto windowDifficulties = m_difficultyWindow.cumulativeDifficulties(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset));
+      timestamps.assign(windowTimestamps.begin(), windowTimestamps.end());
+      cumulative_difficulties.assign(windowDifficulties.begin(), windowDifficulties.end());
+    } else {
+      for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
+        timestamps.push_back(m_blocks[main_chain_start_offset].bl.timestamp);
+        cumulative_difficulties.push_back(m_blocks[main_chain_start_offset].cumulative_difficulty);
+      }
     }
 
     // make sure we haven't accidentally grabbed too many blocks... ???
@@ -1129,7 +1553,8 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
     }
   }
 
-  return m_currency.nextDifficulty(static_cast<uint32_t>(m_blocks.size()), BlockMajorVersion, timestamps, cumulative_difficulties);
+  return m_currency.nextDifficulty(static_cast<uint32_t>(m_blocks.size()), BlockMajorVersion, Common::ArrayView<uint64_t>(timestamps.data(), timestamps.size()),
+    Common::ArrayView<difficulty_type>(cumulative_difficulties.data(), cumulative_difficulties.size()));
 }
 
 bool Blockchain::prevalidate_miner_transaction(const Block& b, uint32_t height) {
@@ -1205,7 +1630,7 @@ bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, siz
 }
 
 bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   if (!(from_height < m_blocks.size())) {
     logger(ERROR, BRIGHT_RED)
       << "Internal error: get_backward_blocks_sizes called with from_height="
@@ -1221,7 +1646,7 @@ bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>&
 }
 
 bool Blockchain::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   if (!m_blocks.size()) {
     return true;
   }
@@ -1237,7 +1662,7 @@ uint64_t Blockchain::getCurrentCumulativeBlocksizeLimit() {
    if (timestamps.size() >= m_currency.timestampCheckWindow(blockMajorVersion)) 
     return true;
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   size_t need_elements = m_currency.timestampCheckWindow(blockMajorVersion) - timestamps.size(); 
   if (!(start_top_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: passed start_height = " << start_top_height << " not less then m_blocks.size()=" << m_blocks.size(); return false; }
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
@@ -1433,7 +1858,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   if (start_offset >= m_blocks.size())
     return false;
   for (size_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
@@ -1447,7 +1872,7 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   if (start_offset >= m_blocks.size()) {
     return false;
   }
@@ -1460,7 +1885,7 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with CryptoNoteProtocolHandler.
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
   std::list<Block> blocks;
   getBlocks(arg.blocks, blocks, rsp.missed_ids);
@@ -1492,7 +1917,7 @@ bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTI
 }
 
 bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   for (auto& alt_bl : m_alternative_chains) {
     blocks.push_back(alt_bl.second.bl);
   }
@@ -1501,78 +1926,64 @@ bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
 }
 
 uint32_t Blockchain::getAlternativeBlocksCount() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return static_cast<uint32_t>(m_alternative_chains.size());
 }
 
-bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  const Transaction& tx = transactionByIndex(amount_outs[i].first).tx;
-  if (!(tx.outputs.size() > amount_outs[i].second)) {
-    logger(ERROR, BRIGHT_RED) << "internal error: in global outs index, transaction out index="
-      << amount_outs[i].second << " more than transaction outputs = " << tx.outputs.size() << ", for tx id = " << getObjectHash(tx); return false;
-  }
-  if (!(tx.outputs[amount_outs[i].second].target.type() == typeid(KeyOutput))) { logger(ERROR, BRIGHT_RED) << "unknown tx out type"; return false; }
+bool Blockchain::add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
+  const OutputIndex::Entry& output = m_outputIndex.get(amount, i);
 
   //check if transaction is unlocked
-  if (!is_tx_spendtime_unlocked(tx.unlockTime))
+  if (!is_tx_spendtime_unlocked(output.unlockTime))
     return false;
 
   COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry& oen = *result_outs.outs.insert(result_outs.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry());
   oen.global_amount_index = static_cast<uint32_t>(i);
-  oen.out_key = boost::get<KeyOutput>(tx.outputs[amount_outs[i].second].target).key;
+  oen.out_key = output.key;
   return true;
 }
 
-size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  if (amount_outs.empty()) {
-    return 0;
-  }
-
-  size_t i = amount_outs.size();
-  do {
-    --i;
-    if (amount_outs[i].first.block + m_currency.minedMoneyUnlockWindow() <= getCurrentBlockchainHeight()) {
-      return i + 1;
-    }
-  } while (i != 0);
-
-  return 0;
+void Blockchain::updateUnlockedOutputs() {
+  // outputs of block i can be used as mixins once i + minedMoneyUnlockWindow <= height
+  size_t height = m_blocks.size();
+  size_t window = m_currency.minedMoneyUnlockWindow();
+  m_outputIndex.setUnlockedBlockCount(height < window ? 0 : static_cast<uint32_t>(height - window + 1));
 }
 
 bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
 
+  RandomBatch random;
+  phmap::flat_hash_set<size_t> used;
+  res.outs.reserve(res.outs.size() + req.amounts.size());
   for (uint64_t amount : req.amounts) {
     COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs = *res.outs.insert(res.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount());
     result_outs.amount = amount;
-    auto it = m_outputs.find(amount);
-    if (it == m_outputs.end()) {
+    size_t outputCount = m_outputIndex.outputCount(amount);
+    if (outputCount == 0) {
       logger(ERROR, BRIGHT_RED) <<
         "COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS: not outs for amount " << amount << ", wallet should use some real outs when it looks for mixins, so at least one out for this amount should exist";
       continue;//actually this is strange situation, wallet should use some real outs when it lookup for some mix, so, at least one out for this amount should exist
     }
 
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs = it->second;
     //it is not good idea to use top fresh outs, because it increases possibility of transaction canceling on split
-    //lets find upper bound of not fresh outs
-    size_t up_index_limit = find_end_of_allowed_index(amount_outs);
-    if (!(up_index_limit <= amount_outs.size())) { logger(ERROR, BRIGHT_RED) << "internal error: find_end_of_allowed_index returned wrong index=" << up_index_limit << ", with amount_outs.size = " << amount_outs.size(); return false; }
+    //the output index keeps the upper bound of not fresh outs
+    size_t up_index_limit = m_outputIndex.unlockedOutputCount(amount);
+    result_outs.outs.reserve(std::min<size_t>(req.outs_count, up_index_limit));
 
-    	if(amount_outs.size() > req.outs_count)
+    	if(outputCount > req.outs_count)
     {
-      std::set<size_t> used;
+      used.clear();
       size_t try_count = 0;
       for(uint64_t j = 0; j != req.outs_count && try_count < up_index_limit;)
       {
 	    // triangular distribution over [a,b) with a=0, mode c=b=up_index_limit
-        uint64_t r = Crypto::rand<uint64_t>() % ((uint64_t)1 << 53);
+        uint64_t r = random.next() % ((uint64_t)1 << 53);
         double frac = std::sqrt((double)r / ((uint64_t)1 << 53));
         size_t i = (size_t)(frac*up_index_limit);
         if(used.count(i))
           continue;
-        bool added = add_out_to_get_random_outs(amount_outs, result_outs, amount, i);
+        bool added = add_out_to_get_random_outs(result_outs, amount, i);
         used.insert(i);
         if(added)
           ++j;
@@ -1581,7 +1992,7 @@ bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_
     } 
      else {
       for(size_t i = 0; i != up_index_limit; i++)
-        add_out_to_get_random_outs(amount_outs, result_outs, amount, i);
+        add_out_to_get_random_outs(result_outs, amount, i);
     }
   }
   return true;
@@ -1591,7 +2002,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
   assert(!qblock_ids.empty());
   assert(qblock_ids.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   uint32_t blockIndex;
   // assert above guarantees that method returns true
   m_blockIndex.findSupplement(qblock_ids, blockIndex);
@@ -1599,7 +2010,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
 }
 
 uint64_t Blockchain::blockDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
   if (i == 0)
     return m_blocks[i].cumulative_difficulty;
@@ -1609,7 +2020,7 @@ uint64_t Blockchain::blockDifficulty(size_t i) {
 
 void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   if (start_index >= m_blocks.size()) {
     logger(INFO, BRIGHT_WHITE) <<
       "Wrong starter index set: " << start_index << ", expected max index " << m_blocks.size() - 1;
@@ -1629,7 +2040,7 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
 
 void Blockchain::print_blockchain_index() {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
 
   std::vector<Crypto::Hash> blockIds = m_blockIndex.getBlockIds(0, std::numeric_limits<uint32_t>::max());
   logger(INFO, BRIGHT_WHITE) << "Current blockchain index:";
@@ -1643,14 +2054,12 @@ void Blockchain::print_blockchain_index() {
 
 void Blockchain::print_blockchain_outs(const std::string& file) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  for (const outputs_container::value_type& v : m_outputs) {
-    const std::vector<std::pair<TransactionIndex, uint16_t>>& vals = v.second;
-    if (!vals.empty()) {
-      ss << "amount: " << v.first << ENDL;
-      for (size_t i = 0; i != vals.size(); i++) {
-        ss << "\t" << getObjectHash(transactionByIndex(vals[i].first).tx) << ": " << vals[i].second << ENDL;
-      }
+  SharedLock lk(*this);
+  for (uint64_t amount : m_outputIndex.amounts()) {
+    ss << "amount: " << amount << ENDL;
+    for (size_t i = 0; i != m_outputIndex.outputCount(amount); i++) {
+      const OutputIndex::Entry& output = m_outputIndex.get(amount, i);
+      ss << "\t" << getObjectHash(transactionByIndex({ output.block, output.transaction }).tx) << ": " << output.output << ENDL;
     }
   }
 
@@ -1669,7 +2078,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
   assert(!remoteBlockIds.empty());
   assert(remoteBlockIds.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   totalBlockCount = getCurrentBlockchainHeight();
   startBlockIndex = findBlockchainSupplement(remoteBlockIds);
 
@@ -1677,7 +2086,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
 }
 
 bool Blockchain::haveBlock(const Crypto::Hash& id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   if (m_blockIndex.hasBlock(id))
     return true;
 
@@ -1688,12 +2097,96 @@ bool Blockchain::haveBlock(const Crypto::Hash& id) {
 }
 
 size_t Blockchain::getTotalTransactions() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return m_transactionMap.size();
 }
 
+BlobCacheStatistics Blockchain::getBlockCacheStatistics() {
+  return m_blocks.getCacheStatistics();
+}
+
+std::shared_ptr<const SerializedBlock> Blockchain::getSerializedBlock(uint32_t height) {
+  SharedLock lk(*this);
+  if (height >= m_blocks.size()) {
+    return nullptr;
+  }
+
+  Crypto::Hash blockId = m_blockIndex.getBlockId(height);
+  std::shared_ptr<const SerializedBlock> cached = m_blockBlobCache.find(blockId);
+  if (cached) {
+    return cached;
+  }
+
+  // Walks the stored BlockEntry field by field, see BlockEntry::serialize. The block and the transactions
+  // are stored in their canonical binary form, so their blobs are plain slices of the entry.
+  std::shared_ptr<SerializedBlock> result = std::make_shared<SerializedBlock>();
+  result->id = blockId;
+
+  Common::ArrayView<uint8_t> entryBlob = m_blocks.blob(height);
+  const char* entryData = reinterpret_cast<const char*>(entryBlob.getData());
+  Common::MemoryInputStream stream(entryBlob.getData(), entryBlob.getSize());
+  BinaryInputStreamSerializer serializer(stream);
+
+  Block block;
+  serializer(block, "block");
+  result->timestamp = block.timestamp;
+  result->block.assign(entryData, stream.getPosition());
+
+  uint32_t entryHeight;
+  uint64_t cumulativeSize;
+  difficulty_type cumulativeDifficulty;
+  uint64_t generatedCoins;
+  serializer(entryHeight, "height");
+  serializer(cumulativeSize, "block_cumulative_size");
+  serializer(cumulativeDifficulty, "cumulative_difficulty");
+  serializer(generatedCoins, "already_generated_coins");
+
+  size_t transactionCount;
+  serializer.beginArray(transactionCount, "transactions");
+  if (transactionCount != block.transactionHashes.size() + 1) {
+    logger(ERROR, BRIGHT_RED) << "Stored block " << height << " has " << transactionCount << " transactions, expected " <<
+      block.transactionHashes.size() + 1;
+    return nullptr;
+  }
+
+  result->transactions.reserve(block.transactionHashes.size());
+  result->transactionPrefixes.reserve(block.transactionHashes.size());
+  for (size_t i = 0; i < transactionCount; ++i) {
+    serializer.beginObject("");
+    size_t transactionStart = stream.getPosition();
+    Transaction transaction;
+    serializer(transaction, "tx");
+    if (i != 0) {
+      result->transactions.emplace_back(entryData + transactionStart, stream.getPosition() - transactionStart);
+      TransactionPrefixInfo prefixInfo;
+      prefixInfo.txHash = block.transactionHashes[i - 1];
+      prefixInfo.txPrefix = std::move(static_cast<TransactionPrefix&>(transaction));
+      result->transactionPrefixes.push_back(std::move(prefixInfo));
+    }
+
+    std::vector<uint32_t> globalIndexes;
+    serializer(globalIndexes, "indexes");
+    serializer.endObject();
+  }
+
+  serializer.endArray();
+
+  m_blockBlobCache.insert(result);
+  return result;
+}
+
+std::shared_ptr<const SerializedBlock> Blockchain::getSerializedBlock(const Crypto::Hash& blockId) {
+  SharedLock lk(*this);
+  uint32_t height;
+  if (!m_blockIndex.getBlockHeight(blockId, height)) {
+    return nullptr;
+  }
+
+  return getSerializedBlock(height);
+}
+
 bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   auto it = m_transactionMap.find(tx_id);
   if (it == m_transactionMap.end()) {
     logger(WARNING, YELLOW) << "warning: get_tx_outputs_gindexs failed to find transaction with id = " << tx_id;
@@ -1711,7 +2204,7 @@ bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, st
 }
 
 bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   auto it = m_multisignatureOutputs.find(amount);
   if (it == m_multisignatureOutputs.end()) {
     return false;
@@ -1734,7 +2227,7 @@ bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, Multis
 
 
 bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
 
   if (tail)
     tail->id = getTailId(tail->height);
@@ -1763,7 +2256,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_us
   return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height, Crypto::RingSignatureBatch* batch) {
   size_t inputIndex = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
@@ -1783,21 +2276,12 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
         return false;
       }
 
-      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height)) {
+      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height, batch)) {
         logger(DEBUGGING, BRIGHT_WHITE) <<
           "Failed to check ring signature for tx " << transactionHash;
         return false;
       }
 
-        if (!isInCheckpointZone(getCurrentBlockchainHeight()))
-        {
-          if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height))
-          {
-            logger(INFO, BRIGHT_WHITE) << "Failed to check input in transaction " << transactionHash;
-            return false;
-          }
-        }
-
         ++inputIndex;
       }
       else if (txin.type() == typeid(MultisignatureInput))
@@ -1841,8 +2325,8 @@ bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
   return false;
 }
 
-bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height, Crypto::RingSignatureBatch* batch) {
+  SharedLock lk(*this);
 
   struct outputs_visitor {
     std::vector<const Crypto::PublicKey *>& m_results_collector;
@@ -1851,21 +2335,15 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     outputs_visitor(std::vector<const Crypto::PublicKey *>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
     }
 
-    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex) {
+    bool handle_output(const OutputIndex::Entry& output) {
       //check tx unlock time
-      if (!m_bch.is_tx_spendtime_unlocked(tx.unlockTime)) {
-        logger(INFO, BRIGHT_WHITE) <<
-          "One of outputs for one of inputs have wrong tx.unlockTime = " << tx.unlockTime;
-        return false;
-      }
-
-      if (out.target.type() != typeid(KeyOutput)) {
+      if (!m_bch.is_tx_spendtime_unlocked(output.unlockTime)) {
         logger(INFO, BRIGHT_WHITE) <<
-          "Output has wrong type id, which=" << out.target.which();
+          "One of outputs for one of inputs have wrong tx.unlockTime = " << output.unlockTime;
         return false;
       }
 
-      m_results_collector.push_back(&boost::get<KeyOutput>(out.target).key);
+      m_results_collector.push_back(&output.key);
       return true;
     }
   };
@@ -1899,6 +2377,11 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     return true;
   }
 
+  if (batch != nullptr) {
+    batch->add(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
+    return true;
+  }
+
   bool check_tx_ring_signature = Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
   if (!check_tx_ring_signature) {
     logger(DEBUGGING) << "Failed to check ring signature for keyImage: " << txin.keyImage;
@@ -2073,7 +2556,7 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
 
   { //to avoid deadlock lets lock tx_pool for whole add/reorganize process
     std::lock_guard<decltype(m_tx_pool)> poolLock(m_tx_pool);
-    std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+    UpgradeLock bcLock(*this);
 
     if (haveBlock(id)) {
       logger(TRACE) << "block with id = " << id << " already exists";
@@ -2102,6 +2585,7 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
             if (height % 720 == 0)
             {
               storeCache();
+              storeBlockchainIndices();
             }
           }
 
@@ -2117,6 +2601,10 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
 }
 
 const Blockchain::TransactionEntry& Blockchain::transactionByIndex(TransactionIndex index) {
+  if (m_pushingBlock != nullptr && index.block == m_pushingBlock->height) {
+    return m_pushingBlock->transactions[index.transaction];
+  }
+
   return m_blocks[index.block].transactions[index.transaction];
 }
 
@@ -2136,7 +2624,7 @@ bool Blockchain::pushBlock(const Block &blockData, const Crypto::Hash &id, block
 }
 
 bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction> &transactions, const Crypto::Hash &id, block_verification_context &bvc) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  UpgradeLock lk(*this);
 
   auto blockProcessingStart = std::chrono::steady_clock::now();
 
@@ -2198,11 +2686,11 @@ auto longhashTimeStart = std::chrono::steady_clock::now();
   } else {
     // Skip difficulty validation only for FOUNDATIONAL blocks, ie anything < 800k
     // Fixes daemon's backwards compatibility issues syncing with early blocks
-    if (getCurrentBlockchainHeight() < 800000) {
+    if (getCurrentBlockchainHeight() < POW_VALIDATION_START_HEIGHT) {
       logger(INFO, BRIGHT_WHITE) <<
         "Skipping difficulty validation for historical block " << blockHash << " at height " << getCurrentBlockchainHeight();
     } else {
-      if (!m_currency.checkProofOfWork(m_cn_context, blockData, currentDifficulty, proof_of_work)) {
+      if (!checkProofOfWork(blockData, blockHash, currentDifficulty, proof_of_work)) {
         logger(INFO, BRIGHT_WHITE) <<
           "Block " << blockHash << ", has too weak proof of work: " << proof_of_work << ", expected difficulty: " << currentDifficulty;
         bvc.m_verification_failed = true;
@@ -2220,44 +2708,89 @@ auto longhashTimeStart = std::chrono::steady_clock::now();
     return false;
   }
 
+  uint32_t blockHeight = static_cast<uint32_t>(m_blocks.size());
+  size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
+  size_t cumulative_block_size = coinbase_blob_size;
+  uint64_t fee_summary = 0;
+  uint64_t interestSummary = 0;
+
   Crypto::Hash minerTransactionHash = getObjectHash(blockData.baseTransaction);
 
   BlockEntry block;
   block.bl = blockData;
-  block.height = static_cast<uint32_t>(m_blocks.size());
+  block.height = blockHeight;
   block.transactions.resize(1);
   block.transactions[0].tx = blockData.baseTransaction;
   TransactionIndex transactionIndex = { block.height, static_cast<uint16_t>(0) };
-  pushTransaction(block, minerTransactionHash, transactionIndex);
 
-  size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
-  size_t cumulative_block_size = coinbase_blob_size;
-  uint64_t fee_summary = 0;
-    uint64_t interestSummary = 0;
+  // Transactions are validated against the chain without the block, so spends that earlier
+  // transactions of the same block make are tracked here instead of in m_spent_keys/m_multisignatureOutputs.
+  std::unordered_set<Crypto::KeyImage> blockKeyImages;
+  std::set<std::pair<uint64_t, uint32_t>> blockMultisignatureSpends;
+  Crypto::RingSignatureBatch ringSignatures;
+  std::vector<size_t> ringSignatureTransactions;
+
+  // A transaction may use outputs of earlier transactions of its block as ring members or spend their multisignature
+  // outputs. Such a block is applied while it is validated: every transaction is pushed before the next one is
+  // checked, and readers are held off for the whole block.
+  std::unique_lock<decltype(m_blockchain_lock)> commitLock(m_blockchain_lock, std::defer_lock);
+  bool pushWhileValidating = referencesBlockOutputs(transactions);
+  Tools::ScopeExit pushingBlockReset([this] { m_pushingBlock = nullptr; });
+  if (pushWhileValidating) {
+    commitLock.lock();
+    m_pushingBlock = &block;
+    pushTransaction(block, minerTransactionHash, transactionIndex);
+  }
 
-    for (size_t i = 0; i < transactions.size(); ++i)
-    {
-      const Crypto::Hash &tx_id = blockData.transactionHashes[i];
-      block.transactions.resize(block.transactions.size() + 1);
-      block.transactions.back().tx = transactions[i];
-      size_t blob_size = toBinaryArray(transactions[i]).size();
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    const Crypto::Hash &tx_id = blockData.transactionHashes[i];
+    size_t blob_size = toBinaryArray(transactions[i]).size();
 
-    uint64_t in_amount = m_currency.getTransactionAllInputsAmount(transactions[i], block.height);
-	  uint64_t out_amount = getOutputAmount(transactions[i]);
+    uint64_t in_amount = m_currency.getTransactionAllInputsAmount(transactions[i], blockHeight);
+    uint64_t out_amount = getOutputAmount(transactions[i]);
     uint64_t fee = in_amount < out_amount ? CryptoNote::parameters::MINIMUM_FEE : in_amount - out_amount;
 
     bool isTransactionValid = true;
-    if (block.bl.majorVersion < BLOCK_MAJOR_VERSION_8 && transactions[i].version > TRANSACTION_VERSION_1) {
+    if (blockData.majorVersion < BLOCK_MAJOR_VERSION_8 && transactions[i].version > TRANSACTION_VERSION_1) {
       isTransactionValid = false;
       logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " can't contain transaction " << tx_id << " because it has invalid version " << transactions[i].version;
     }
 
-    if (!checkTransactionInputs(transactions[i])) {
+    BlockInfo maxUsedBlock;
+    bool inputsValid;
+    if (pushWhileValidating) {
+      inputsValid = checkTransactionInputs(transactions[i]);
+    } else if (findPrevalidatedInputs(tx_id, maxUsedBlock)) {
+      inputsValid = !haveTransactionKeyImagesAsSpent(transactions[i]);
+    } else {
+      // ring signatures of the whole block are verified together after this loop
+      Crypto::Hash prefixHash = getObjectHash(*static_cast<const TransactionPrefix*>(&transactions[i]));
+      inputsValid = checkTransactionInputs(transactions[i], prefixHash, nullptr, &ringSignatures);
+      ringSignatureTransactions.resize(ringSignatures.size(), i);
+    }
+
+    if (!inputsValid) {
       isTransactionValid = false;
       logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
     }
 
-    if (!check_tx_outputs(transactions[i], block.height)) {
+    for (const auto& txin : transactions[i].inputs) {
+      bool isDoubleSpend = false;
+      if (txin.type() == typeid(KeyInput)) {
+        isDoubleSpend = !blockKeyImages.insert(::boost::get<KeyInput>(txin).keyImage).second;
+      } else if (txin.type() == typeid(MultisignatureInput)) {
+        const MultisignatureInput& input = ::boost::get<MultisignatureInput>(txin);
+        isDoubleSpend = !blockMultisignatureSpends.emplace(input.amount, input.outputIndex).second;
+      }
+
+      if (isDoubleSpend) {
+        isTransactionValid = false;
+        logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " spends the same input twice in transaction " << tx_id;
+        break;
+      }
+    }
+
+    if (!check_tx_outputs(transactions[i], blockHeight)) {
       isTransactionValid = false;
       logger(INFO, BRIGHT_WHITE) << "Transaction " << tx_id << " has at least one invalid output";
     }
@@ -2265,36 +2798,75 @@ auto longhashTimeStart = std::chrono::steady_clock::now();
     if (!isTransactionValid) {
       logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has at least one invalid transaction: " << tx_id;
       bvc.m_verification_failed = true;
+      if (pushWhileValidating) {
+        popTransactions(block, minerTransactionHash);
+      }
 
-      block.transactions.pop_back();
-      popTransactions(block, minerTransactionHash);
       return false;
     }
 
-    ++transactionIndex.transaction;
-    pushTransaction(block, tx_id, transactionIndex);
+    if (pushWhileValidating) {
+      block.transactions.resize(block.transactions.size() + 1);
+      block.transactions.back().tx = transactions[i];
+
+      ++transactionIndex.transaction;
+      pushTransaction(block, tx_id, transactionIndex);
+    }
 
     cumulative_block_size += blob_size;
     fee_summary += fee;
-      interestSummary += m_currency.calculateTotalTransactionInterest(transactions[i], block.height);
+    interestSummary += m_currency.calculateTotalTransactionInterest(transactions[i], blockHeight);
+  }
+
+  if (!verifyRingSignatures(ringSignatures)) {
+    for (size_t id = 0; id < ringSignatures.size(); ++id) {
+      if (!ringSignatures.isValid(id)) {
+        logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has at least one transaction with wrong inputs: " <<
+          blockData.transactionHashes[ringSignatureTransactions[id]];
+        break;
+      }
+    }
+
+    bvc.m_verification_failed = true;
+    return false;
   }
 
-  if (!checkCumulativeBlockSize(blockHash, cumulative_block_size, m_blocks.size())) {
+  if (!checkCumulativeBlockSize(blockHash, cumulative_block_size, blockHeight)) {
     bvc.m_verification_failed = true;
+    if (pushWhileValidating) {
+      popTransactions(block, minerTransactionHash);
+    }
+
     return false;
   }
 
   int64_t emissionChange = 0;
   uint64_t reward = 0;
   uint64_t already_generated_coins = m_blocks.empty() ? 0 : m_blocks.back().already_generated_coins;
-  if (!validate_miner_transaction(blockData, static_cast<uint32_t>(m_blocks.size()), cumulative_block_size, already_generated_coins, fee_summary, reward, emissionChange)) {
+  if (!validate_miner_transaction(blockData, blockHeight, cumulative_block_size, already_generated_coins, fee_summary, reward, emissionChange)) {
     logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has invalid miner transaction";
     bvc.m_verification_failed = true;
-    popTransactions(block, minerTransactionHash);
+    if (pushWhileValidating) {
+      popTransactions(block, minerTransactionHash);
+    }
+
     return false;
   }
 
-  block.height = static_cast<uint32_t>(m_blocks.size());
+  if (!pushWhileValidating) {
+    // the block is valid, readers are held off only while it is being applied
+    commitLock.lock();
+    pushTransaction(block, minerTransactionHash, transactionIndex);
+
+    for (size_t i = 0; i < transactions.size(); ++i) {
+      block.transactions.resize(block.transactions.size() + 1);
+      block.transactions.back().tx = transactions[i];
+
+      ++transactionIndex.transaction;
+      pushTransaction(block, blockData.transactionHashes[i], transactionIndex);
+    }
+  }
+
   block.block_cumulative_size = cumulative_block_size;
   block.cumulative_difficulty = currentDifficulty;
   block.already_generated_coins = already_generated_coins + emissionChange;
@@ -2302,8 +2874,17 @@ auto longhashTimeStart = std::chrono::steady_clock::now();
     block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
   }
 
+  m_pushingBlock = nullptr;
   pushBlock(block);
-    pushToDepositIndex(block, interestSummary);
+  pushToDepositIndex(block, interestSummary);
+
+  {
+    std::lock_guard<std::mutex> prevalidatedLock(m_prevalidatedLock);
+    m_prevalidatedProofsOfWork.erase(blockHash);
+    for (const auto& transactionHash : blockData.transactionHashes) {
+      m_prevalidatedInputs.erase(transactionHash);
+    }
+  }
 
   auto block_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - blockProcessingStart).count();
 
@@ -2332,22 +2913,27 @@ auto longhashTimeStart = std::chrono::steady_clock::now();
 }
 
 uint64_t Blockchain::fullDepositAmount() const {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return m_depositIndex.fullDepositAmount();
 }
 
 uint64_t Blockchain::depositAmountAtHeight(size_t height) const {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return m_depositIndex.depositAmountAtHeight(static_cast<DepositIndex::DepositHeight>(height));
 }
 
   uint64_t Blockchain::depositInterestAtHeight(size_t height) const
   {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    SharedLock lk(*this);
     return m_depositIndex.depositInterestAtHeight(static_cast<DepositIndex::DepositHeight>(height));
   }
 
   void Blockchain::pushToDepositIndex(const BlockEntry &block, uint64_t interest)
+  {
+    m_depositIndex.pushBlock(getDepositChange(block), interest);
+  }
+
+  int64_t Blockchain::getDepositChange(const BlockEntry &block)
   {
     int64_t deposit = 0;
     for (const auto &tx : block.transactions)
@@ -2375,19 +2961,28 @@ uint64_t Blockchain::depositAmountAtHeight(size_t height) const {
         }
       }
     }
-    m_depositIndex.pushBlock(deposit, interest);
+    return deposit;
   }
 
 bool Blockchain::pushBlock(BlockEntry &block) {
   Crypto::Hash blockHash = get_block_hash(block.bl);
 
   m_blocks.push_back(block);
+  updateUnlockedOutputs();
   m_blockIndex.push(blockHash);
+  m_difficultyWindow.push(block.bl.timestamp, block.cumulative_difficulty);
+  if (m_blockSummaries.size() == block.height) {
+    BlockSummary summary = makeBlockSummary(block, blockHash);
+    pushBlockSummary(summary);
+  }
 
-  m_timestampIndex.add(block.bl.timestamp, blockHash);
-  m_generatedTransactionsIndex.add(block.bl);
+  if (m_blockchainIndexesEnabled) {
+    m_timestampIndex.add(block.bl.timestamp, blockHash, block.height);
+    m_generatedTransactionsIndex.add(block.bl);
+  }
 
   assert(m_blockIndex.size() == m_blocks.size());
+  m_tx_pool.on_blockchain_inc(m_blocks.size(), blockHash);
 
   return true;
 }
@@ -2409,14 +3004,24 @@ void Blockchain::popBlock(const Crypto::Hash& blockHash) {
 
   popTransactions(m_blocks.back(), getObjectHash(m_blocks.back().bl.baseTransaction));
 
-  m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
-  m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  if (m_blockchainIndexesEnabled) {
+    m_paymentIdIndex.popBlock(m_blocks.back().height);
+    m_timestampIndex.popBlock(m_blocks.back().height);
+    m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  }
+
+  if (m_blockSummaries.size() == m_blocks.size()) {
+    m_blockSummaries.pop();
+  }
 
   m_depositIndex.popBlock();
   m_blocks.pop_back();
+  updateUnlockedOutputs();
   m_blockIndex.pop();
+  popDifficultyWindow();
 
   assert(m_blockIndex.size() == m_blocks.size());
+  m_tx_pool.on_blockchain_dec(m_blocks.size(), m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId());
 /*--------------------------------------------------------------------------------------------------------------*/
   removeLastBlock();
 /*--------------------------------------------------------------------------------------------------------------*/
@@ -2480,9 +3085,9 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
   transaction.m_global_output_indexes.resize(transaction.tx.outputs.size());
   for (uint16_t output = 0; output < transaction.tx.outputs.size(); ++output) {
     if (transaction.tx.outputs[output].target.type() == typeid(KeyOutput)) {
-      auto& amountOutputs = m_outputs[transaction.tx.outputs[output].amount];
-      transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
-      amountOutputs.push_back(std::make_pair<>(transactionIndex, output));
+      const TransactionOutput& out = transaction.tx.outputs[output];
+      transaction.m_global_output_indexes[output] = m_outputIndex.push({ ::boost::get<KeyOutput>(out.target).key, out.amount,
+        transaction.tx.unlockTime, transactionIndex.block, transactionIndex.transaction, output });
     } else if (transaction.tx.outputs[output].target.type() == typeid(MultisignatureOutput)) {
       auto& amountOutputs = m_multisignatureOutputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
@@ -2491,7 +3096,9 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
     }
   }
 
-  m_paymentIdIndex.add(transaction.tx);
+  if (m_blockchainIndexesEnabled) {
+    m_paymentIdIndex.add(transaction.tx, transactionIndex.block);
+  }
 
   return true;
 }
@@ -2501,35 +3108,32 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
   for (size_t outputIndex = 0; outputIndex < transaction.outputs.size(); ++outputIndex) {
     const TransactionOutput& output = transaction.outputs[transaction.outputs.size() - 1 - outputIndex];
     if (output.target.type() == typeid(KeyOutput)) {
-      auto amountOutputs = m_outputs.find(output.amount);
-      if (amountOutputs == m_outputs.end()) {
+      const OutputIndex::Entry* lastOutput = m_outputIndex.back();
+      if (lastOutput == nullptr) {
         logger(ERROR, BRIGHT_RED) <<
-          "Blockchain consistency broken - cannot find specific amount in outputs map.";
+          "Blockchain consistency broken - output index is empty.";
         continue;
       }
 
-      if (amountOutputs->second.empty()) {
+      if (lastOutput->amount != output.amount) {
         logger(ERROR, BRIGHT_RED) <<
-          "Blockchain consistency broken - output array for specific amount is empty.";
+          "Blockchain consistency broken - cannot find specific amount in outputs map.";
         continue;
       }
 
-      if (amountOutputs->second.back().first.block != transactionIndex.block || amountOutputs->second.back().first.transaction != transactionIndex.transaction) {
+      if (lastOutput->block != transactionIndex.block || lastOutput->transaction != transactionIndex.transaction) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid transaction index.";
         continue;
       }
 
-      if (amountOutputs->second.back().second != transaction.outputs.size() - 1 - outputIndex) {
+      if (lastOutput->output != transaction.outputs.size() - 1 - outputIndex) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid output index.";
         continue;
       }
 
-      amountOutputs->second.pop_back();
-      if (amountOutputs->second.empty()) {
-        m_outputs.erase(amountOutputs);
-      }
+      m_outputIndex.pop();
     } else if (output.target.type() == typeid(MultisignatureOutput)) {
       auto amountOutputs = m_multisignatureOutputs.find(output.amount);
       if (amountOutputs == m_multisignatureOutputs.end()) {
@@ -2588,8 +3192,6 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
     }
   }
 
-  m_paymentIdIndex.remove(transaction);
-
   size_t count = m_transactionMap.erase(transactionHash);
   if (count != 1) {
     logger(ERROR, BRIGHT_RED) <<
@@ -2627,7 +3229,7 @@ bool Blockchain::validateInput(const MultisignatureInput& input, const Crypto::H
     return false;
   }
 
-  const Transaction& outputTransaction = m_blocks[outputIndex.transactionIndex.block].transactions[outputIndex.transactionIndex.transaction].tx;
+  const Transaction& outputTransaction = transactionByIndex(outputIndex.transactionIndex).tx;
   if (!is_tx_spendtime_unlocked(outputTransaction.unlockTime)) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains multisignature input which points to a locked transaction.";
@@ -2694,14 +3296,41 @@ bool Blockchain::validateInput(const MultisignatureInput& input, const Crypto::H
   logger(DEBUGGING) << "Removing last block with height " << m_blocks.back().height;
   popTransactions(m_blocks.back(), getObjectHash(m_blocks.back().bl.baseTransaction));
 
-  Crypto::Hash blockHash = getBlockIdByHeight(m_blocks.back().height);
-  m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
-  m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  if (m_blockchainIndexesEnabled) {
+    m_paymentIdIndex.popBlock(m_blocks.back().height);
+    m_timestampIndex.popBlock(m_blocks.back().height);
+    m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  }
+
+  if (m_blockSummaries.size() == m_blocks.size()) {
+    m_blockSummaries.pop();
+  }
 
   m_blocks.pop_back();
+  updateUnlockedOutputs();
   m_blockIndex.pop();
+  popDifficultyWindow();
 
   assert(m_blockIndex.size() == m_blocks.size());
+  m_tx_pool.on_blockchain_dec(m_blocks.size(), m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId());
+  return true;
+}
+
+void Blockchain::fillDifficultyWindow() {
+  uint32_t height = static_cast<uint32_t>(m_blocks.size() - std::min<uint64_t>(m_blocks.size(), m_difficultyWindow.capacity()));
+  m_difficultyWindow.clear(height);
+  for (; height < m_blocks.size(); ++height) {
+    m_difficultyWindow.push(m_blocks[height].bl.timestamp, m_blocks[height].cumulative_difficulty);
+  }
+}
+
+void Blockchain::popDifficultyWindow() {
+  m_difficultyWindow.pop();
+  // refill from the front so that a long rollback keeps the window full
+  if (m_difficultyWindow.size() < m_difficultyWindow.capacity() && m_difficultyWindow.beginHeight() > 0) {
+    const BlockEntry& block = m_blocks[m_difficultyWindow.beginHeight() - 1];
+    m_difficultyWindow.pushFront(block.bl.timestamp, block.cumulative_difficulty);
+  }
 }
 
 bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
@@ -2717,7 +3346,7 @@ bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
 }
 
 bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
 
   assert(startOffset < m_blocks.size());
 
@@ -2733,12 +3362,12 @@ bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_
 }
 
 std::vector<Crypto::Hash> Blockchain::getBlockIds(uint32_t startHeight, uint32_t maxCount) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return m_blockIndex.getBlockIds(startHeight, maxCount);
 }
 
 bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   auto it = m_transactionMap.find(txId);
   if (it == m_transactionMap.end()) {
     return false;
@@ -2750,7 +3379,7 @@ bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto:
 }
 
 bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
 
   // try to find block in main chain
   uint32_t height = 0;
@@ -2771,7 +3400,7 @@ bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& ge
 }
 
 bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
 
   // try to find block in main chain
   uint32_t height = 0;
@@ -2792,7 +3421,7 @@ bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
 }
 
 bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   MultisignatureOutputsContainer::const_iterator amountIter = m_multisignatureOutputs.find(txInMultisig.amount);
   if (amountIter == m_multisignatureOutputs.end()) {
     logger(DEBUGGING) << "Transaction contains multisignature input with invalid amount.";
@@ -2809,14 +3438,26 @@ bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMulti
   return true;
 }
 
+Crypto::Hash Blockchain::getTransactionHash(uint32_t block, uint16_t transaction) {
+  SharedLock lk(*this);
+  return getObjectHash(transactionByIndex({ block, transaction }).tx);
+}
+
 bool Blockchain::storeBlockchainIndices() {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   logger(INFO, BRIGHT_WHITE) << "Saving blockchain indices...";
-  BlockchainIndicesSerializer ser(*this, getTailId(), logger.getLogger());
-
-  if (!storeToBinaryFile(ser, appendPath(m_config_folder, m_currency.blockchinIndicesFileName()))) {
-    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain indices";
+  try {
+    uint32_t blockCount = static_cast<uint32_t>(m_blocks.size());
+    Crypto::Hash lastBlock = getTailId();
+    m_blockSummaries.flush(blockCount, lastBlock);
+    if (m_blockchainIndexesEnabled) {
+      m_paymentIdIndex.flush(blockCount, lastBlock);
+      m_timestampIndex.flush(blockCount, lastBlock);
+      m_generatedTransactionsIndex.flush(blockCount, lastBlock);
+    }
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain indices: " << e.what();
     return false;
   }
 
@@ -2827,54 +3468,165 @@ bool Blockchain::loadBlockchainIndices() {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   logger(INFO, BRIGHT_WHITE) << "Loading blockchain indices for BlockchainExplorer...";
-  BlockchainIndicesSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
 
-  loadFromBinaryFile(loader, appendPath(m_config_folder, m_currency.blockchinIndicesFileName()));
+  // the indices are stored as of their last flush, those that don't match the chain start over
+  uint32_t blockCount = static_cast<uint32_t>(m_blocks.size());
+  auto storedBlockCount = [&](auto& index) {
+    uint32_t count = index.storedBlockCount();
+    if (count > blockCount || (count != 0 && m_blockIndex.getBlockId(count - 1) != index.storedLastBlock())) {
+      index.clear();
+      return 0u;
+    }
 
-  if (!loader.loaded()) {
-    logger(WARNING, BRIGHT_MAGENTA) << "No actual blockchain indices for BlockchainExplorer found, rebuilding...";
-    std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+    return count;
+  };
 
-    m_paymentIdIndex.clear();
-    m_timestampIndex.clear();
-    m_generatedTransactionsIndex.clear();
+  uint32_t paymentIdHeight = storedBlockCount(m_paymentIdIndex);
+  uint32_t timestampHeight = storedBlockCount(m_timestampIndex);
+  uint32_t generatedTransactionsHeight = storedBlockCount(m_generatedTransactionsIndex);
+  uint32_t startHeight = std::min({ paymentIdHeight, timestampHeight, generatedTransactionsHeight });
+  if (startHeight == blockCount) {
+    return true;
+  }
 
-    for (uint32_t b = 0; b < m_blocks.size(); ++b) {
-      if (b % 1000 == 0) {
-        logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
-      }
-      const BlockEntry& block = m_blocks[b];
-      m_timestampIndex.add(block.bl.timestamp, get_block_hash(block.bl));
+  logger(WARNING, BRIGHT_MAGENTA) << "Blockchain indices for BlockchainExplorer end at height " << startHeight << ", updating...";
+  std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+  for (uint32_t b = startHeight; b < blockCount; ++b) {
+    if (b % 1000 == 0) {
+      logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << blockCount;
+    }
+
+    const BlockEntry& block = m_blocks[b];
+    if (b >= timestampHeight) {
+      m_timestampIndex.add(block.bl.timestamp, m_blockIndex.getBlockId(b), b);
+    }
+
+    if (b >= generatedTransactionsHeight) {
       m_generatedTransactionsIndex.add(block.bl);
+    }
+
+    if (b >= paymentIdHeight) {
       for (uint16_t t = 0; t < block.transactions.size(); ++t) {
-        const TransactionEntry& transaction = block.transactions[t];
-        m_paymentIdIndex.add(transaction.tx);
+        m_paymentIdIndex.add(block.transactions[t].tx, b);
       }
     }
+  }
 
-    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
-    logger(INFO, BRIGHT_WHITE) << "Rebuilding blockchain indices took: " << duration.count();
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+  logger(INFO, BRIGHT_WHITE) << "Updating blockchain indices took: " << duration.count();
+  return true;
+}
+
+bool Blockchain::loadBlockSummaries() {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+
+  uint32_t blockCount = static_cast<uint32_t>(m_blocks.size());
+  uint32_t startHeight = m_blockSummaries.storedBlockCount();
+  if (startHeight > blockCount || (startHeight != 0 && m_blockIndex.getBlockId(startHeight - 1) != m_blockSummaries.storedLastBlock())) {
+    m_blockSummaries.clear();
+    startHeight = 0;
+  }
+
+  if (startHeight == blockCount) {
+    return true;
+  }
+
+  logger(WARNING, BRIGHT_MAGENTA) << "Block summaries end at height " << startHeight << ", updating...";
+
+  // blocks are deserialized on all cores, window by window, and their summaries appended in chain order
+  const uint32_t windowSize = 4096;
+  Tools::ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+  std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+  std::vector<BlockSummary> summaries;
+  for (uint32_t windowBegin = startHeight; windowBegin < blockCount; windowBegin += windowSize) {
+    uint32_t windowEnd = std::min(blockCount, windowBegin + windowSize);
+    summaries.resize(windowEnd - windowBegin);
+    pool.parallelFor(summaries.size(), [&](size_t index, size_t) {
+      uint32_t height = windowBegin + static_cast<uint32_t>(index);
+      BlockEntry block;
+      Common::ArrayView<uint8_t> blob = m_blocks.blob(height);
+      Common::MemoryInputStream stream(blob.getData(), blob.getSize());
+      BinaryInputStreamSerializer archive(stream);
+      block.serialize(archive);
+      summaries[index] = makeBlockSummary(block, m_blockIndex.getBlockId(height));
+    });
+
+    for (BlockSummary& summary : summaries) {
+      pushBlockSummary(summary);
+    }
+
+    logger(INFO, BRIGHT_WHITE) << "Height " << windowEnd << " of " << blockCount;
+  }
+
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+  logger(INFO, BRIGHT_WHITE) << "Updating block summaries took: " << duration.count();
+  return true;
+}
+
+BlockSummary Blockchain::makeBlockSummary(const BlockEntry& block, const Crypto::Hash& blockHash) {
+  BlockSummary summary;
+  summary.hash = blockHash;
+  summary.timestamp = block.bl.timestamp;
+  summary.difficulty = 0;
+  summary.cumulativeDifficulty = block.cumulative_difficulty;
+  summary.size = getObjectBinarySize(block.bl) + block.block_cumulative_size - getObjectBinarySize(block.bl.baseTransaction);
+  summary.reward = 0;
+  for (const TransactionOutput& out : block.bl.baseTransaction.outputs) {
+    summary.reward += out.amount;
+  }
+
+  summary.alreadyGeneratedCoins = block.already_generated_coins;
+  summary.transactionCount = static_cast<uint32_t>(block.bl.transactionHashes.size() + 1);
+  summary.majorVersion = block.bl.majorVersion;
+  summary.minorVersion = block.bl.minorVersion;
+  return summary;
+}
+
+void Blockchain::pushBlockSummary(BlockSummary& summary) {
+  uint32_t height = m_blockSummaries.size();
+  summary.difficulty = summary.cumulativeDifficulty - (height == 0 ? 0 : m_blockSummaries[height - 1].cumulativeDifficulty);
+  m_blockSummaries.push(summary);
+}
+
+bool Blockchain::getBlockSummaries(uint32_t startHeight, uint32_t maxCount, std::vector<BlockSummary>& summaries) {
+  SharedLock lk(*this);
+  if (startHeight >= m_blockSummaries.size()) {
+    return false;
   }
+
+  m_blockSummaries.get(startHeight, maxCount, summaries);
   return true;
 }
 
 bool Blockchain::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (!m_blockchainIndexesEnabled) {
+    return false;
+  }
+
+  SharedLock lk(*this);
   return m_generatedTransactionsIndex.find(height, generatedTransactions);
 }
 
 bool Blockchain::getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedLock lk(*this);
   return m_orthanBlocksIndex.find(height, blockHashes);
 }
 
 bool Blockchain::getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (!m_blockchainIndexesEnabled) {
+    return false;
+  }
+
+  SharedLock lk(*this);
   return m_timestampIndex.find(timestampBegin, timestampEnd, blocksNumberLimit, hashes, blocksNumberWithinTimestamps);
 }
 
 bool Blockchain::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (!m_blockchainIndexesEnabled) {
+    return false;
+  }
+
+  SharedLock lk(*this);
   return m_paymentIdIndex.find(paymentId, transactionHashes);
 }
 
@@ -19,20 +19,29 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
 
 #include "google/sparse_hash_set"
 #include "google/sparse_hash_map"
 #include <parallel_hashmap/phmap.h>
 
 #include "Common/ObserverManager.h"
+#include "Common/SharedRecursiveMutex.h"
+#include "Common/ThreadPool.h"
 #include "Common/Util.h"
+#include "CryptoNoteCore/BlockBlobCache.h"
 #include "CryptoNoteCore/BlockIndex.h"
 #include "CryptoNoteCore/Checkpoints.h"
 #include "CryptoNoteCore/Currency.h"
 #include "CryptoNoteCore/DepositIndex.h"
+#include "CryptoNoteCore/Difficulty.h"
 #include "CryptoNoteCore/IBlockchainStorageObserver.h"
 #include "CryptoNoteCore/ITransactionValidator.h"
-#include "CryptoNoteCore/SwappedVector.h"
+#include "CryptoNoteCore/MappedBlobVector.h"
+#include "CryptoNoteCore/OutputIndex.h"
+#include "CryptoNoteCore/PersistentBlockchainIndices.h"
 #include "CryptoNoteCore/UpgradeDetector.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/TransactionPool.h"
@@ -41,6 +50,7 @@
 #include "CryptoNoteCore/MessageQueue.h"
 #include "CryptoNoteCore/BlockchainMessages.h"
 #include "CryptoNoteCore/IntrusiveLinkedList.h"
+#include "crypto/ring-signature-batch.h"
 
 #include <Logging/LoggerRef.h>
 
@@ -61,6 +71,7 @@ namespace CryptoNote {
     bool addObserver(IBlockchainStorageObserver* observer);
     bool removeObserver(IBlockchainStorageObserver* observer);
     void rebuildCache();
+    // Copies the cache under the lock and writes it in the background, deinit waits for the write to finish.
     bool storeCache();
 
     // ITransactionValidator
@@ -103,6 +114,11 @@ namespace CryptoNote {
     bool resetAndSetGenesisBlock(const Block& b);
     bool haveBlock(const Crypto::Hash& id);
     size_t getTotalTransactions();
+    BlobCacheStatistics getBlockCacheStatistics();
+    // Main chain block with its blobs, as returned to wallets. Null if there is no such block.
+    std::shared_ptr<const SerializedBlock> getSerializedBlock(uint32_t height);
+    std::shared_ptr<const SerializedBlock> getSerializedBlock(const Crypto::Hash& blockId);
+    BlockBlobCache& getBlockBlobCache() { return m_blockBlobCache; }
     std::vector<Crypto::Hash> buildSparseChain();
     std::vector<Crypto::Hash> buildSparseChain(const Crypto::Hash& startBlockId);
     uint32_t findBlockchainSupplement(const std::vector<Crypto::Hash>& qblock_ids); // !!!!
@@ -120,8 +136,11 @@ namespace CryptoNote {
     bool getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins);
     bool getBlockSize(const Crypto::Hash& hash, size_t& size);
     bool getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference);
+    Crypto::Hash getTransactionHash(uint32_t block, uint16_t transaction);
     bool getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions);
     bool getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes);
+    // Summaries of main chain blocks [startHeight, startHeight + maxCount), false if startHeight is past the chain.
+    bool getBlockSummaries(uint32_t startHeight, uint32_t maxCount, std::vector<BlockSummary>& summaries);
     bool getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps);
     bool getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes);
     bool isBlockInMainChain(const Crypto::Hash& blockId);
@@ -140,7 +159,7 @@ namespace CryptoNote {
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
     bool getBlocks(const t_ids_container& block_ids, t_blocks_container& blocks, t_missed_container& missed_bs) {
-      std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+      SharedLock lk(*this);
 
       for (const auto& bl_id : block_ids) {
         uint32_t height = 0;
@@ -158,7 +177,7 @@ namespace CryptoNote {
 
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     void getBlockchainTransactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) {
-      std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+      SharedLock bcLock(*this);
 
       for (const auto& tx_id : txs_ids) {
         auto it = m_transactionMap.find(tx_id);
@@ -204,6 +223,16 @@ namespace CryptoNote {
     bool rollbackBlockchainTo(uint32_t height);
     bool have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im);
 
+    // Checks run ahead of block import, from any number of threads (see core::prevalidateBlocks).
+    // Their results are used by pushBlock and checkTransactionInputs while still valid for the main chain.
+    void prevalidateTransactionInputs(const std::vector<std::pair<const Transaction*, Crypto::Hash>>& transactions);
+    // Blocks of a variant with a multi-way kernel are hashed together, see get_block_longhashes.
+    void prevalidateProofsOfWork(Crypto::cn_context& context, const std::vector<const Block*>& blocks);
+    void clearPrevalidatedData();
+
+    // Ring signatures of a block or a prevalidated batch are verified on this pool, null means the calling thread.
+    void setValidationThreadPool(Tools::ThreadPool* pool);
+
   private:
 
     struct MultisignatureOutputUsage {
@@ -248,37 +277,37 @@ namespace CryptoNote {
 
     typedef parallel_flat_hash_map<Crypto::KeyImage, uint32_t> key_images_container;
     typedef parallel_flat_hash_map<Crypto::Hash, BlockEntry> blocks_ext_by_hash;
-    typedef parallel_flat_hash_map<uint64_t, std::vector<std::pair<TransactionIndex, uint16_t>>> outputs_container; //Crypto::Hash - tx hash, size_t - index of out in transaction
     typedef parallel_flat_hash_map<uint64_t, std::vector<MultisignatureOutputUsage>> MultisignatureOutputsContainer;
 
     const Currency& m_currency;
     tx_memory_pool& m_tx_pool;
-    mutable std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
+    mutable Tools::SharedRecursiveMutex m_blockchain_lock;
     Crypto::cn_context m_cn_context;
     Tools::ObserverManager<IBlockchainStorageObserver> m_observerManager;
 
     key_images_container m_spent_keys;
     size_t m_current_block_cumul_sz_limit;
     blocks_ext_by_hash m_alternative_chains; // Crypto::Hash -> block_extended_info
-    outputs_container m_outputs;
+    OutputIndex m_outputIndex;
 
     std::string m_config_folder;
     Checkpoints m_checkpoints;
     std::atomic<bool> m_is_in_checkpoint_zone;
 
-    typedef SwappedVector<BlockEntry> Blocks;
+    typedef MappedBlobVector<BlockEntry> Blocks;
     typedef parallel_flat_hash_map<Crypto::Hash, uint32_t> BlockMap;
     typedef parallel_flat_hash_map<Crypto::Hash, TransactionIndex> TransactionMap;
     typedef BasicUpgradeDetector<Blocks> UpgradeDetector;
 
     friend class BlockCacheSerializer;
-    friend class BlockchainIndicesSerializer;
 
     Blocks m_blocks;
     CryptoNote::BlockIndex m_blockIndex;
     CryptoNote::DepositIndex m_depositIndex;
     TransactionMap m_transactionMap;
     MultisignatureOutputsContainer m_multisignatureOutputs;
+    // The block pushBlock applies transaction by transaction, its transactions are found before it is in m_blocks.
+    const BlockEntry* m_pushingBlock;
     UpgradeDetector m_upgradeDetectorV2;
     UpgradeDetector m_upgradeDetectorV3;
     UpgradeDetector m_upgradeDetectorV4;
@@ -291,27 +320,45 @@ namespace CryptoNote {
 
     bool m_blockchainIndexesEnabled;
     bool m_blockchainAutosaveEnabled;
-    PaymentIdIndex m_paymentIdIndex;
-    TimestampBlocksIndex m_timestampIndex;
-    GeneratedTransactionsIndex m_generatedTransactionsIndex;
+    // kept in files of the data directory when blockchain indexes are enabled
+    PersistentPaymentIdIndex m_paymentIdIndex;
+    PersistentTimestampBlocksIndex m_timestampIndex;
+    PersistentGeneratedTransactionsIndex m_generatedTransactionsIndex;
+    PersistentBlockSummaries m_blockSummaries;
     OrphanBlocksIndex m_orthanBlocksIndex;
 
     IntrusiveLinkedList<MessageQueue<BlockchainMessage>> m_messageQueueList;
 
+    std::mutex m_prevalidatedLock;
+    parallel_flat_hash_map<Crypto::Hash, BlockInfo> m_prevalidatedInputs;
+    parallel_flat_hash_map<Crypto::Hash, Crypto::Hash> m_prevalidatedProofsOfWork;
+    std::atomic<Tools::ThreadPool*> m_validationPool;
+    BlockBlobCache m_blockBlobCache;
+    DifficultyWindow m_difficultyWindow;
+
     Logging::LoggerRef logger;
 
+    // Cache and index snapshots are written by one background task at a time. Declared last, so that destruction
+    // waits for a running write before the members it uses go away.
+    std::mutex m_snapshotWriterMutex;
+    std::future<void> m_snapshotWriter;
+
 
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator> &alt_chain, bool discard_disconnected_chain);
     bool handle_alternative_block(const Block &b, const Crypto::Hash &id, block_verification_context &bvc, bool sendNewAlternativeBlockMessage = true);
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator> &alt_chain, BlockEntry &bei);
     void pushToDepositIndex(const BlockEntry &block, uint64_t interest);
+    static int64_t getDepositChange(const BlockEntry &block);
+    struct RebuildBatch;
+    void collectRebuildBatch(uint32_t begin, uint32_t end, RebuildBatch& batch);
+    void mergeRebuildBatches(std::vector<RebuildBatch>& batches, Tools::ThreadPool& pool);
     bool prevalidate_miner_transaction(const Block &b, uint32_t height);
     bool validate_miner_transaction(const Block &b, uint32_t height, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t &reward, int64_t &emissionChange);
     bool rollback_blockchain_switching(std::list<Block> &original_chain, size_t rollback_height);
     bool get_last_n_blocks_sizes(std::vector<size_t> &sz, size_t count);
-    bool add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>> &amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount &result_outs, uint64_t amount, size_t i);
+    bool add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount &result_outs, uint64_t amount, size_t i);
     bool is_tx_spendtime_unlocked(uint64_t unlock_time);
-    size_t find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>> &amount_outs);
+    void updateUnlockedOutputs();
     bool check_block_timestamp_main(const Block &b);
     bool check_block_timestamp(std::vector<uint64_t> timestamps, const Block &b);
     uint64_t get_adjusted_time();
@@ -322,10 +369,16 @@ namespace CryptoNote {
     std::vector<Crypto::Hash> doBuildSparseChain(const Crypto::Hash& startBlockId) const;
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_comulative_size_limit();
-    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
+    // With a batch the ring signatures are added to it instead of being checked.
+    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL, Crypto::RingSignatureBatch* batch = NULL);
+    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL, Crypto::RingSignatureBatch* batch = NULL);
     bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
     bool check_tx_outputs(const Transaction& tx, uint32_t height) const;
+    bool findPrevalidatedInputs(const Crypto::Hash& txHash, BlockInfo& maxUsedBlock);
+    // Whether an input refers to an output the chain doesn't have yet, which only the block itself can create.
+    bool referencesBlockOutputs(const std::vector<Transaction>& transactions) const;
+    bool checkProofOfWork(const Block& block, const Crypto::Hash& blockHash, difficulty_type currentDifficulty, Crypto::Hash& proofOfWork);
+    bool verifyRingSignatures(Crypto::RingSignatureBatch& batch);
     const TransactionEntry& transactionByIndex(TransactionIndex index);
     bool pushBlock(const Block &blockData, const Crypto::Hash &id, block_verification_context &bvc, uint32_t height);
     bool pushBlock(const Block &blockData, const std::vector<Transaction> &transactions, const Crypto::Hash &id, block_verification_context &bvc);
@@ -336,17 +389,49 @@ namespace CryptoNote {
     void popTransactions(const BlockEntry &block, const Crypto::Hash &minerTransactionHash);
     bool validateInput(const MultisignatureInput &input, const Crypto::Hash &transactionHash, const Crypto::Hash &transactionPrefixHash, const std::vector<Crypto::Signature> &transactionSignatures);
     bool removeLastBlock();
+    void fillDifficultyWindow();
+    void popDifficultyWindow();
     bool checkCheckpoints(uint32_t &lastValidCheckpointHeight);
     bool checkUpgradeHeight(const UpgradeDetector& upgradeDetector);
 
+    // Block summaries are stored along with the indices, whether or not those are enabled.
     bool storeBlockchainIndices();
     bool loadBlockchainIndices();
+    bool loadBlockSummaries();
+    static BlockSummary makeBlockSummary(const BlockEntry& block, const Crypto::Hash& blockHash);
+    void pushBlockSummary(BlockSummary& summary);
+    // Writes the chunks in the background after any earlier snapshot, done is called on that thread.
+    void writeSnapshotAsync(const std::string& path, std::vector<BinaryArray>&& chunks, std::function<void(bool)>&& done);
+    void waitForSnapshotWriter();
 
     bool loadTransactions(const Block& block, std::vector<Transaction>& transactions, uint32_t height);
     void saveTransactions(const std::vector<Transaction>& transactions, uint32_t height);
 
     void sendMessage(const BlockchainMessage& message);
 
+    // Queries take m_blockchain_lock shared and pin m_blocks, so that cache entries they reference
+    // survive evictions caused by concurrent readers. Block import validates under the upgrade lock
+    // (other readers keep running) and takes the exclusive lock only to commit.
+    class SharedLock : boost::noncopyable {
+    public:
+      SharedLock(const Blockchain& bc);
+      ~SharedLock();
+
+    private:
+      Blockchain& m_bc;
+      uint64_t m_epoch;
+    };
+
+    class UpgradeLock : boost::noncopyable {
+    public:
+      UpgradeLock(const Blockchain& bc);
+      ~UpgradeLock();
+
+    private:
+      Blockchain& m_bc;
+      uint64_t m_epoch;
+    };
+
     friend class LockedBlockchainStorage;
   };
 
@@ -354,7 +439,7 @@ namespace CryptoNote {
   public:
 
     LockedBlockchainStorage(Blockchain& bc)
-      : m_bc(bc), m_lock(bc.m_blockchain_lock) {}
+      : m_bc(bc), m_lock(bc) {}
 
     Blockchain* operator -> () {
       return &m_bc;
@@ -363,45 +448,32 @@ namespace CryptoNote {
   private:
 
     Blockchain& m_bc;
-    std::lock_guard<std::recursive_mutex> m_lock;
+    Blockchain::SharedLock m_lock;
   };
 
   template<class visitor_t> bool Blockchain::scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height) {
-    std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
-    auto it = m_outputs.find(tx_in_to_key.amount);
-    if (it == m_outputs.end() || !tx_in_to_key.outputIndexes.size())
+    SharedLock lk(*this);
+    size_t outputCount = m_outputIndex.outputCount(tx_in_to_key.amount);
+    if (outputCount == 0 || !tx_in_to_key.outputIndexes.size())
       return false;
 
     std::vector<uint32_t> absolute_offsets = relative_output_offsets_to_absolute(tx_in_to_key.outputIndexes);
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs_vec = it->second;
     size_t count = 0;
     for (uint64_t i : absolute_offsets) {
-      if(i >= amount_outs_vec.size() ) {
-        logger(Logging::INFO) << "Wrong index in transaction inputs: " << i << ", expected maximum " << amount_outs_vec.size() - 1;
-        return false;
-      }
-
-      //auto tx_it = m_transactionMap.find(amount_outs_vec[i].first);
-      //if (!(tx_it != m_transactionMap.end())) { logger(ERROR, BRIGHT_RED) << "Wrong transaction id in output indexes: " << Common::podToHex(amount_outs_vec[i].first); return false; }
-
-      const TransactionEntry& tx = transactionByIndex(amount_outs_vec[i].first);
-
-      if (!(amount_outs_vec[i].second < tx.tx.outputs.size())) {
-        logger(Logging::ERROR, Logging::BRIGHT_RED)
-            << "Wrong index in transaction outputs: "
-            << amount_outs_vec[i].second << ", expected less then "
-            << tx.tx.outputs.size();
+      if(i >= outputCount) {
+        logger(Logging::INFO) << "Wrong index in transaction inputs: " << i << ", expected maximum " << outputCount - 1;
         return false;
       }
 
-      if (!vis.handle_output(tx.tx, tx.tx.outputs[amount_outs_vec[i].second], amount_outs_vec[i].second)) {
+      const OutputIndex::Entry& output = m_outputIndex.get(tx_in_to_key.amount, i);
+      if (!vis.handle_output(output)) {
         logger(Logging::INFO) << "Failed to handle_output for output no = " << count << ", with absolute offset " << i;
         return false;
       }
 
       if(count++ == absolute_offsets.size()-1 && pmax_related_block_height) {
-        if (*pmax_related_block_height < amount_outs_vec[i].first.block) {
-          *pmax_related_block_height = amount_outs_vec[i].first.block;
+        if (*pmax_related_block_height < output.block) {
+          *pmax_related_block_height = output.block;
         }
       }
     }
@@ -17,13 +17,16 @@
 
 #include "Core.h"
 
+#include <algorithm>
 #include <sstream>
+#include <thread>
 #include <unordered_set>
 #include "../CryptoNoteConfig.h"
 #include "../Common/CommandLine.h"
 #include "../Common/Util.h"
 #include "../Common/Math.h"
 #include "../Common/StringTools.h"
+#include "../Common/Varint.h"
 #include "../crypto/crypto.h"
 #include "../CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
 #include "../Logging/LoggerRef.h"
@@ -73,12 +76,16 @@ core::core(const Currency &currency, i_cryptonote_protocol *pprotocol, Logging::
                                                                                                                                                                   m_mempool(currency, m_blockchain, m_timeProvider, logger),
                                                                                                                                                                   m_blockchain(currency, m_mempool, logger, blockchainIndexesEnabled, blockchainAutosaveEnabled),
                                                                                                                                                                   m_miner(new miner(currency, *this, logger)),
-                                                                                                                                                                  m_starter_message_showed(false)
+                                                                                                                                                                  m_starter_message_showed(false),
+                                                                                                                                                                  m_blockTemplateTailId(NULL_HASH),
+                                                                                                                                                                  m_blockTemplatePoolVersion(0),
+                                                                                                                                                                  m_blockTemplateCreated(0)
 {
 
   set_cryptonote_protocol(pprotocol);
   m_blockchain.addObserver(this);
   m_mempool.addObserver(this);
+  createSyncPool(std::thread::hardware_concurrency());
 }
   //-----------------------------------------------------------------------------------------------
   core::~core() {
@@ -159,12 +166,21 @@ size_t core::get_alternative_blocks_count() {
   return m_blockchain.getAlternativeBlocksCount();
 }
 
+BlobCacheStatistics core::getBlockCacheStatistics() {
+  return m_blockchain.getBlockCacheStatistics();
+}
+
+std::shared_ptr<const SerializedBlock> core::getSerializedBlock(const Crypto::Hash& blockId) {
+  return m_blockchain.getSerializedBlock(blockId);
+}
+
 std::time_t core::getStartTime() const {
   return start_time;
 }
   //-----------------------------------------------------------------------------------------------
 bool core::init(const CoreConfig& config, const MinerConfig& minerConfig, bool load_existing) {
   m_config_folder = config.configFolder;
+  createSyncPool(config.syncThreads != 0 ? config.syncThreads : std::thread::hardware_concurrency());
   bool r = m_mempool.init(m_config_folder);
 
   if (!(r)) {
@@ -264,11 +280,98 @@ bool core::handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_contex
   }
   //std::cout << "!"<< tx.inputs.size() << std::endl;
 
+  return handle_incoming_tx(tx, tx_hash, tx_blob.size(), tvc, keeped_by_block);
+}
+
+bool core::handle_incoming_tx(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keeped_by_block) {
+  tvc = boost::value_initialized<tx_verification_context>();
+
   Crypto::Hash blockId;
   uint32_t blockHeight;
-  bool ok = getBlockContainingTx(tx_hash, blockId, blockHeight);
+  bool ok = getBlockContainingTx(txHash, blockId, blockHeight);
   if (!ok) blockHeight = this->get_current_blockchain_height(); //this assumption fails for withdrawals
-  return handleIncomingTransaction(tx, tx_hash, tx_blob.size(), tvc, keeped_by_block, blockHeight);
+  return handleIncomingTransaction(tx, txHash, blobSize, tvc, keeped_by_block, blockHeight);
+}
+
+bool core::prevalidateBlocks(std::vector<PrevalidatedBlock>& blocks) {
+  // stage 1: size checks, parsing and hashing of every transaction blob in the batch
+  std::vector<std::pair<size_t, size_t>> transactions;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    if (blocks[i].transactionBlobs.size() != blocks[i].block.transactionHashes.size()) {
+      logger(INFO) << "Block " << get_block_hash(blocks[i].block) << " has wrong transactions count, rejected";
+      return false;
+    }
+
+    blocks[i].transactions.resize(blocks[i].transactionBlobs.size());
+    for (size_t j = 0; j < blocks[i].transactionBlobs.size(); ++j) {
+      transactions.emplace_back(i, j);
+    }
+  }
+
+  std::atomic<bool> failed(false);
+  m_syncPool->parallelFor(transactions.size(), [&](size_t index, size_t) {
+    PrevalidatedBlock& block = blocks[transactions[index].first];
+    size_t txIndex = transactions[index].second;
+    const Common::StringView& blob = block.transactionBlobs[txIndex];
+
+    Crypto::Hash txHash;
+    Crypto::Hash txPrefixHash;
+    if (blob.getSize() > m_currency.maxTxSize() ||
+        !parseAndValidateTransactionFromBinaryArray(blob.getData(), blob.getSize(), block.transactions[txIndex], txHash, txPrefixHash) ||
+        txHash != block.block.transactionHashes[txIndex]) {
+      failed = true;
+    }
+  });
+
+  if (failed) {
+    logger(INFO) << "WRONG TRANSACTION BLOB in downloaded blocks, rejected";
+    return false;
+  }
+
+  // stage 2: signatures and proofs of work, the results are picked up by Blockchain::pushBlock
+  std::vector<std::pair<const Transaction*, Crypto::Hash>> prevalidatedTransactions;
+  for (const auto& transaction : transactions) {
+    const PrevalidatedBlock& block = blocks[transaction.first];
+    prevalidatedTransactions.emplace_back(&block.transactions[transaction.second], block.block.transactionHashes[transaction.second]);
+  }
+
+  m_blockchain.clearPrevalidatedData();
+  m_blockchain.prevalidateTransactionInputs(prevalidatedTransactions);
+
+  // groups of consecutive blocks are hashed together by the multi-way kernel, as long as every thread gets a group
+  size_t groupSize = 1;
+  if (!blocks.empty()) {
+    int light;
+    int variant;
+    get_block_longhash_variant(blocks.back().block.majorVersion, light, variant);
+    groupSize = std::max<size_t>(1, std::min(Crypto::cn_slow_hash_ways(light, variant), blocks.size() / m_syncPool->threadCount()));
+  }
+
+  m_syncPool->parallelFor((blocks.size() + groupSize - 1) / groupSize, [&](size_t index, size_t thread) {
+    std::vector<const Block*> group;
+    for (size_t i = index * groupSize; i < std::min(blocks.size(), (index + 1) * groupSize); ++i) {
+      group.push_back(&blocks[i].block);
+    }
+
+    m_blockchain.prevalidateProofsOfWork(*m_syncHashContexts[thread], group);
+  });
+
+  return true;
+}
+
+void core::createSyncPool(size_t threadCount) {
+  threadCount = std::max<size_t>(threadCount, 1);
+  if (m_syncPool && m_syncPool->threadCount() == threadCount) {
+    return;
+  }
+
+  m_blockchain.setValidationThreadPool(nullptr);
+  m_syncPool.reset(new Tools::ThreadPool(threadCount));
+  m_blockchain.setValidationThreadPool(m_syncPool.get());
+  m_syncHashContexts.clear();
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_syncHashContexts.emplace_back(new Crypto::cn_context());
+  }
 }
 
 bool core::get_stat_info(core_stat_info& st_inf) {
@@ -441,8 +544,23 @@ bool core::add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t
 }
 
 bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) {
-  size_t median_size;
-  uint64_t already_generated_coins;
+  BlockTemplateBase base;
+  if (!prepareBlockTemplate(base)) {
+    return false;
+  }
+
+  diffic = base.difficulty;
+  height = base.height;
+  size_t cumulativeSize = 0;
+  return constructBlockTemplate(base, adr, ex_nonce, b, cumulativeSize);
+}
+
+bool core::prepareBlockTemplate(BlockTemplateBase& base) {
+  Block& b = base.block;
+  difficulty_type& diffic = base.difficulty;
+  uint32_t& height = base.height;
+  size_t& median_size = base.medianSize;
+  uint64_t& already_generated_coins = base.alreadyGeneratedCoins;
 
   {
     LockedBlockchainStorage blockchainLock(m_blockchain);
@@ -525,24 +643,34 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
     already_generated_coins = m_blockchain.getCoinsInCirculation();
   }
 
-  size_t txs_size;
-  uint64_t fee;
-  if (!m_mempool.fill_block_template(b, median_size, m_currency.maxBlockCumulativeSize(height), already_generated_coins, txs_size, fee, height)) {
-    return false;
-  }
+  return m_mempool.fill_block_template(b, median_size, m_currency.maxBlockCumulativeSize(height), already_generated_coins, base.transactionsSize, base.fee, height);
+}
+
+bool core::constructBlockTemplate(const BlockTemplateBase& base, const AccountPublicAddress& adr, const BinaryArray& ex_nonce, Block& b, size_t& cumulativeSize) {
+  b = base.block;
+  uint32_t height = base.height;
+  size_t median_size = base.medianSize;
+  uint64_t already_generated_coins = base.alreadyGeneratedCoins;
+  size_t txs_size = base.transactionsSize;
+  uint64_t fee = base.fee;
 
   /*
      two-phase miner transaction generation: we don't know exact block size until we prepare block, but we don't know reward until we know
      block size, so first miner transaction generated with fake amount of money, and with phase we know think we know expected block size
      */
-  //make blocks coin-base tx looks close to real coinbase tx to get truthful blob size
-  bool r = m_currency.constructMinerTx(b.majorVersion, height, median_size, already_generated_coins, txs_size, fee, adr, b.baseTransaction, ex_nonce, 11);
-  if (!r) { 
-    logger(ERROR, BRIGHT_RED) << "Failed to construct miner tx, first chance"; 
-    return false; 
+  bool r;
+  size_t cumulative_size = cumulativeSize;
+  if (cumulative_size == 0) {
+    //make blocks coin-base tx looks close to real coinbase tx to get truthful blob size
+    r = m_currency.constructMinerTx(b.majorVersion, height, median_size, already_generated_coins, txs_size, fee, adr, b.baseTransaction, ex_nonce, 11);
+    if (!r) { 
+      logger(ERROR, BRIGHT_RED) << "Failed to construct miner tx, first chance"; 
+      return false; 
+    }
+
+    cumulative_size = txs_size + getObjectBinarySize(b.baseTransaction);
   }
 
-  size_t cumulative_size = txs_size + getObjectBinarySize(b.baseTransaction);
   for (size_t try_count = 0; try_count != 10; ++try_count) {
     r = m_currency.constructMinerTx(b.majorVersion, height, median_size, already_generated_coins, cumulative_size, fee, adr, b.baseTransaction, ex_nonce, 11);
 
@@ -578,6 +706,7 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
       return false;
     }
 
+    cumulativeSize = cumulative_size;
     return true;
   }
 
@@ -587,6 +716,95 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
   return false;
 }
 
+namespace {
+  // A prepared template is used again for at most this many seconds, which bounds the age of its timestamp
+  const time_t BLOCK_TEMPLATE_CACHE_LIFETIME = 10;
+
+  // The miner transaction extra ends its prefix, only the signatures and the transaction hashes follow it in the blob
+  bool getReservedOffset(const Block& b, const BinaryArray& blob, uint64_t& offset) {
+    size_t nonceOffset;
+    if (!getExtraNonceOffset(b.baseTransaction.extra, nonceOffset)) {
+      return false;
+    }
+
+    size_t tailSize = Tools::get_varint_data(b.transactionHashes.size()).size() + b.transactionHashes.size() * sizeof(Crypto::Hash);
+    for (const auto& signatures : b.baseTransaction.signatures) {
+      tailSize += signatures.size() * sizeof(Crypto::Signature);
+    }
+
+    tailSize += b.baseTransaction.extra.size();
+    if (tailSize > blob.size()) {
+      return false;
+    }
+
+    offset = blob.size() - tailSize + nonceOffset;
+    return true;
+  }
+}
+
+bool core::getBlockTemplateBlob(const AccountPublicAddress& adr, size_t reserveSize, difficulty_type& diffic, uint32_t& height, BinaryArray& blob, uint64_t& reservedOffset) {
+  Crypto::Hash tailId = get_tail_id();
+  uint64_t poolVersion = m_mempool.getVersion();
+  time_t now = time(nullptr);
+  BlockTemplateBase base;
+  size_t cumulativeSize = 0;
+  bool cached = false;
+
+  {
+    std::lock_guard<std::mutex> lock(m_blockTemplateLock);
+    if (m_blockTemplateTailId == tailId && m_blockTemplatePoolVersion == poolVersion && now - m_blockTemplateCreated < BLOCK_TEMPLATE_CACHE_LIFETIME) {
+      base = m_blockTemplate;
+      auto it = m_blockTemplateCumulativeSizes.find(reserveSize);
+      if (it != m_blockTemplateCumulativeSizes.end()) {
+        cumulativeSize = it->second;
+      }
+
+      cached = true;
+    }
+  }
+
+  if (!cached) {
+    if (!prepareBlockTemplate(base)) {
+      return false;
+    }
+
+    // stored under the tail and pool version read before it was prepared, a newer template is then just prepared once more
+    std::lock_guard<std::mutex> lock(m_blockTemplateLock);
+    m_blockTemplate = base;
+    m_blockTemplateCumulativeSizes.clear();
+    m_blockTemplateTailId = tailId;
+    m_blockTemplatePoolVersion = poolVersion;
+    m_blockTemplateCreated = now;
+  }
+
+  // Every request gets its own miner transaction key, so that miners of one address don't search the same nonces. The
+  // size of the miner transaction doesn't depend on the key or the address, so the block size found for a reserve size
+  // is where the next miner transaction for it starts from.
+  Block b;
+  bool sized = cumulativeSize != 0;
+  if (!constructBlockTemplate(base, adr, BinaryArray(reserveSize, 0), b, cumulativeSize)) {
+    return false;
+  }
+
+  if (!sized) {
+    std::lock_guard<std::mutex> lock(m_blockTemplateLock);
+    if (m_blockTemplateTailId == tailId && m_blockTemplatePoolVersion == poolVersion) {
+      m_blockTemplateCumulativeSizes[reserveSize] = cumulativeSize;
+    }
+  }
+
+  diffic = base.difficulty;
+  height = base.height;
+  blob = toBinaryArray(b);
+  reservedOffset = 0;
+  if (reserveSize > 0 && (!getReservedOffset(b, blob, reservedOffset) || reservedOffset + reserveSize > blob.size())) {
+    logger(ERROR, BRIGHT_RED) << "Failed to calculate offset for reserved bytes";
+    return false;
+  }
+
+  return true;
+}
+
 std::vector<Crypto::Hash> core::findBlockchainSupplement(const std::vector<Crypto::Hash>& remoteBlockIds, size_t maxCount,
   uint32_t& totalBlockCount, uint32_t& startBlockIndex) {
 
@@ -750,6 +968,10 @@ size_t core::get_pool_transactions_count() {
   return m_mempool.get_transactions_count();
 }
 
+uint64_t core::getPoolVersion() const {
+  return m_mempool.getVersion();
+}
+
 bool core::have_block(const Crypto::Hash& id) {
   return m_blockchain.haveBlock(id);
 }
@@ -814,6 +1036,10 @@ uint64_t core::difficultyAtHeight(uint64_t height) {
   return m_blockchain.difficultyAtHeight(height);
 }
 
+bool core::getBlockSummaries(uint32_t startHeight, uint32_t maxCount, std::vector<BlockSummary>& summaries) {
+  return m_blockchain.getBlockSummaries(startHeight, maxCount, summaries);
+}
+
 //void core::get_all_known_block_ids(std::list<Crypto::Hash> &main, std::list<Crypto::Hash> &alt, std::list<Crypto::Hash> &invalid) {
 //  m_blockchain.get_all_known_block_ids(main, alt, invalid);
 //}
@@ -899,26 +1125,19 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(startFullOffset, blocksLeft, blocks);
+  for (uint32_t height = startFullOffset; height < startFullOffset + blocksLeft && height < currentHeight; ++height) {
+    std::shared_ptr<const SerializedBlock> block = lbs->getSerializedBlock(height);
+    if (!block) {
+      return false;
+    }
 
-  for (auto& b : blocks) {
     BlockFullInfo item;
+    item.block_id = block->id;
 
-    item.block_id = get_block_hash(b);
-
-    if (b.timestamp >= timestamp) {
-      // query transactions
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
-
-      // fill data
+    if (block->timestamp >= timestamp) {
       block_complete_entry& completeEntry = item;
-      completeEntry.block = asString(toBinaryArray(b));
-      for (auto& tx : txs) {
-        completeEntry.txs.push_back(asString(toBinaryArray(tx)));
-      }
+      completeEntry.block = block->block;
+      completeEntry.txs = block->transactions;
     }
 
     entries.push_back(std::move(item));
@@ -987,28 +1206,18 @@ bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(resFullOffset, blocksLeft, blocks);
+  for (uint32_t height = resFullOffset; height < resFullOffset + blocksLeft && height < resCurrentHeight; ++height) {
+    std::shared_ptr<const SerializedBlock> block = lbs->getSerializedBlock(height);
+    if (!block) {
+      return false;
+    }
 
-  for (auto& b : blocks) {
     BlockShortInfo item;
+    item.blockId = block->id;
 
-    item.blockId = get_block_hash(b);
-
-    if (b.timestamp >= timestamp) {
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
-
-      item.block = asString(toBinaryArray(b));
-
-      for (const auto& tx: txs) {
-        TransactionPrefixInfo info;
-        info.txPrefix = tx;
-        info.txHash = getObjectHash(tx);
-
-        item.txPrefixes.push_back(std::move(info));
-      }
+    if (block->timestamp >= timestamp) {
+      item.block = block->block;
+      item.txPrefixes = block->transactionPrefixes;
     }
 
     entries.push_back(std::move(item));
@@ -1048,15 +1257,16 @@ bool core::scanOutputkeysForIndices(const KeyInput& txInToKey, std::list<std::pa
   struct outputs_visitor
   {
     std::list<std::pair<Crypto::Hash, size_t>>& m_resultsCollector;
-    outputs_visitor(std::list<std::pair<Crypto::Hash, size_t>>& resultsCollector):m_resultsCollector(resultsCollector){}
-    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex)
+    Blockchain& m_blockchain;
+    outputs_visitor(std::list<std::pair<Crypto::Hash, size_t>>& resultsCollector, Blockchain& blockchain):m_resultsCollector(resultsCollector), m_blockchain(blockchain){}
+    bool handle_output(const OutputIndex::Entry& output)
     {
-      m_resultsCollector.push_back(std::make_pair(getObjectHash(tx), transactionOutputIndex));
+      m_resultsCollector.push_back(std::make_pair(m_blockchain.getTransactionHash(output.block, output.transaction), output.output));
       return true;
     }
   };
 
-  outputs_visitor vi(outputReferences);
+  outputs_visitor vi(outputReferences, m_blockchain);
 
   return m_blockchain.scanOutputKeysForIndexes(txInToKey, vi);
 }
@@ -18,6 +18,9 @@
 #pragma once
 
 #include <ctime>
+#include <map>
+#include <mutex>
+#include <vector>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 
@@ -31,6 +34,7 @@
 #include "ICore.h"
 #include "ICoreObserver.h"
 #include "Common/ObserverManager.h"
+#include "Common/ThreadPool.h"
 
 #include "System/Dispatcher.h"
 #include "CryptoNoteCore/MessageQueue.h"
@@ -51,6 +55,8 @@ namespace CryptoNote {
 
      bool on_idle() override;
      virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) override; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
+     virtual bool handle_incoming_tx(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keeped_by_block) override;
+     virtual bool prevalidateBlocks(std::vector<PrevalidatedBlock>& blocks) override;
      bool handle_incoming_block_blob(const BinaryArray& block_blob, block_verification_context& bvc, bool control_miner, bool relay_block) override;
      virtual i_cryptonote_protocol* get_protocol() override {return m_pprotocol;}
      virtual const Currency& currency() const override { return m_currency; }
@@ -58,6 +64,10 @@ namespace CryptoNote {
      //-------------------- IMinerHandler -----------------------
      virtual bool handle_block_found(Block& b) override;
      virtual bool get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) override;
+     // Serialized template with reserveSize zero bytes in the miner transaction extra at reservedOffset (0 without reserved bytes).
+     // The header and pool transactions of a template are reused until the tail or the pool change, the miner
+     // transaction is built for every request.
+     bool getBlockTemplateBlob(const AccountPublicAddress& adr, size_t reserveSize, difficulty_type& diffic, uint32_t& height, BinaryArray& blob, uint64_t& reservedOffset);
 
      bool addObserver(ICoreObserver* observer) override;
      bool removeObserver(ICoreObserver* observer) override;
@@ -124,8 +134,11 @@ namespace CryptoNote {
 
     bool get_alternative_blocks(std::list<Block> &blocks);
     size_t get_alternative_blocks_count();
+    BlobCacheStatistics getBlockCacheStatistics();
+    std::shared_ptr<const SerializedBlock> getSerializedBlock(const Crypto::Hash& blockId);
     uint64_t coinsEmittedAtHeight(uint64_t height);
     uint64_t difficultyAtHeight(uint64_t height);
+    bool getBlockSummaries(uint32_t startHeight, uint32_t maxCount, std::vector<BlockSummary>& summaries);
 
     void set_cryptonote_protocol(i_cryptonote_protocol *pprotocol);
     void set_checkpoints(Checkpoints &&chk_pts);
@@ -133,6 +146,7 @@ namespace CryptoNote {
     std::vector<Transaction> getPoolTransactions() override;
     bool getPoolTransaction(const Crypto::Hash &tx_hash, Transaction &transaction) override;
     size_t get_pool_transactions_count();
+    uint64_t getPoolVersion() const;
     size_t get_blockchain_total_transactions();
     //bool get_outs(uint64_t amount, std::list<Crypto::PublicKey>& pkeys);
     virtual std::vector<Crypto::Hash> findBlockchainSupplement(const std::vector<Crypto::Hash> &remoteBlockIds, size_t maxCount,
@@ -203,5 +217,32 @@ namespace CryptoNote {
     std::atomic<bool> m_starter_message_showed;
     Tools::ObserverManager<ICoreObserver> m_observerManager;
      time_t start_time;
+    std::unique_ptr<Tools::ThreadPool> m_syncPool;
+    std::vector<std::unique_ptr<Crypto::cn_context>> m_syncHashContexts;
+
+    void createSyncPool(size_t threadCount);
+
+    // The part of a block template that doesn't depend on the miner: the block without its miner transaction and what
+    // the miner transaction is built from.
+    struct BlockTemplateBase {
+      Block block;
+      difficulty_type difficulty;
+      uint32_t height;
+      size_t medianSize;
+      uint64_t alreadyGeneratedCoins;
+      size_t transactionsSize;
+      uint64_t fee;
+    };
+
+    bool prepareBlockTemplate(BlockTemplateBase& base);
+    // cumulativeSize is the block size to size the miner transaction for, 0 to find it, and is set to the size found
+    bool constructBlockTemplate(const BlockTemplateBase& base, const AccountPublicAddress& adr, const BinaryArray& ex_nonce, Block& b, size_t& cumulativeSize);
+
+    std::mutex m_blockTemplateLock;
+    Crypto::Hash m_blockTemplateTailId;
+    uint64_t m_blockTemplatePoolVersion;
+    time_t m_blockTemplateCreated;
+    BlockTemplateBase m_blockTemplate;
+    std::map<size_t, size_t> m_blockTemplateCumulativeSizes;
    };
 }
@@ -22,8 +22,13 @@
 
 namespace CryptoNote {
 
+namespace {
+const command_line::arg_descriptor<uint32_t> arg_sync_threads = {"sync-threads", "Specify count of threads verifying blocks during synchronization, 0 - one per CPU core", 0, true};
+}
+
 CoreConfig::CoreConfig() {
   configFolder = Tools::getDefaultDataDirectory();
+  syncThreads = 0;
 }
 
 void CoreConfig::init(const boost::program_options::variables_map& options) {
@@ -31,8 +36,13 @@ void CoreConfig::init(const boost::program_options::variables_map& options) {
     configFolder = command_line::get_arg(options, command_line::arg_data_dir);
     configFolderDefaulted = options[command_line::arg_data_dir.name].defaulted();
   }
+
+  if (command_line::has_arg(options, arg_sync_threads)) {
+    syncThreads = command_line::get_arg(options, arg_sync_threads);
+  }
 }
 
 void CoreConfig::initOptions(boost::program_options::options_description& desc) {
+  command_line::add_arg(desc, arg_sync_threads);
 }
 } //namespace CryptoNote
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include <boost/program_options.hpp>
@@ -32,6 +33,7 @@ public:
 
   std::string configFolder;
   bool configFolderDefaulted = true;
+  uint32_t syncThreads;
 };
 
 } //namespace CryptoNote
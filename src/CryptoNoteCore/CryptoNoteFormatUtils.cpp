@@ -17,6 +17,7 @@
 
 #include "CryptoNoteFormatUtils.h"
 
+#include <cstring>
 #include <set>
 #include <Logging/LoggerRef.h>
 #include <Common/BinaryArray.hpp>
@@ -43,12 +44,16 @@ using namespace Common;
 namespace CryptoNote {
 
 bool parseAndValidateTransactionFromBinaryArray(const BinaryArray& tx_blob, Transaction& tx, Hash& tx_hash, Hash& tx_prefix_hash) {
-  if (!fromBinaryArray(tx, tx_blob)) {
+  return parseAndValidateTransactionFromBinaryArray(tx_blob.data(), tx_blob.size(), tx, tx_hash, tx_prefix_hash);
+}
+
+bool parseAndValidateTransactionFromBinaryArray(const void* data, size_t size, Transaction& tx, Hash& tx_hash, Hash& tx_prefix_hash) {
+  if (!fromBinaryArray(tx, data, size)) {
     return false;
   }
 
   //TODO: validate tx
-  cn_fast_hash(tx_blob.data(), tx_blob.size(), tx_hash);
+  cn_fast_hash(data, size, tx_hash);
   getObjectHash(*static_cast<TransactionPrefix*>(&tx), tx_prefix_hash);
   return true;
 }
@@ -518,25 +523,95 @@ bool get_aux_block_header_hash(const Block& b, Hash& res) {
   return getObjectHash(blob, res);
 }
 
-bool get_block_longhash(cn_context &context, const Block& b, Hash& res) {
-  BinaryArray bd;
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob, size_t& nonceOffset) {
+  // the nonce follows the version, the timestamp and the previous block hash of the block or of its parent block
+  uint8_t majorVersion;
+  uint8_t minorVersion;
   if (b.majorVersion == BLOCK_MAJOR_VERSION_1) {
-    if (!get_block_hashing_blob(b, bd)) {
+    if (!get_block_hashing_blob(b, blob)) {
       return false;
     }
+
+    majorVersion = b.majorVersion;
+    minorVersion = b.minorVersion;
   } else if (b.majorVersion >= BLOCK_MAJOR_VERSION_2) {
-    if (!get_parent_block_hashing_blob(b, bd)) {
+    if (!get_parent_block_hashing_blob(b, blob)) {
       return false;
     }
+
+    majorVersion = b.parentBlock.majorVersion;
+    minorVersion = b.parentBlock.minorVersion;
   } else {
     return false;
-  }     // original CryptoNight (0) until v5, anti-ASIC CNv7 var(1), CNv8(2) from v6 thru CNupx/2
-  const int cn_variant = b.majorVersion < 5 ? 0 : b.majorVersion >= BLOCK_MAJOR_VERSION_6 ? 2 : 1;
-  const int light = ( b.majorVersion >= BLOCK_MAJOR_VERSION_9) ? 1 : 0;
+  }
+
+  nonceOffset = Tools::get_varint_data(majorVersion).size() + Tools::get_varint_data(minorVersion).size() +
+    Tools::get_varint_data(b.timestamp).size() + sizeof(Hash);
+  if (blob.size() < nonceOffset + sizeof(b.nonce) || memcmp(blob.data() + nonceOffset, &b.nonce, sizeof(b.nonce)) != 0) {
+    return false;
+  }
+
+  return true;
+}
+
+void get_block_longhash_variant(uint8_t majorVersion, int& light, int& variant) {
+  // original CryptoNight (0) until v5, anti-ASIC CNv7 var(1), CNv8(2) from v6 thru CNupx/2
+  variant = majorVersion < 5 ? 0 : majorVersion >= BLOCK_MAJOR_VERSION_6 ? 2 : 1;
+  light = majorVersion >= BLOCK_MAJOR_VERSION_9 ? 1 : 0;
+}
+
+bool get_block_longhash(cn_context &context, const Block& b, Hash& res) {
+  BinaryArray bd;
+  size_t nonceOffset;
+  if (!get_block_longhash_blob(b, bd, nonceOffset)) {
+    return false;
+  }
+
+  int light;
+  int cn_variant;
+  get_block_longhash_variant(b.majorVersion, light, cn_variant);
   cn_slow_hash(context, bd.data(), bd.size(), res, light, cn_variant);
   return true;
 }
 
+bool get_block_longhashes(cn_context &context, const Block* const* blocks, size_t count, Hash* res) {
+  std::vector<BinaryArray> blobs(count);
+  std::vector<const void*> data(count);
+  std::vector<size_t> lengths(count);
+  for (size_t i = 0; i < count; ++i) {
+    size_t nonceOffset;
+    if (!get_block_longhash_blob(*blocks[i], blobs[i], nonceOffset)) {
+      return false;
+    }
+
+    data[i] = blobs[i].data();
+    lengths[i] = blobs[i].size();
+  }
+
+  // runs of blocks hashed with the same variant
+  for (size_t i = 0; i < count;) {
+    int light;
+    int cn_variant;
+    get_block_longhash_variant(blocks[i]->majorVersion, light, cn_variant);
+    size_t end = i + 1;
+    while (end < count) {
+      int nextLight;
+      int nextVariant;
+      get_block_longhash_variant(blocks[end]->majorVersion, nextLight, nextVariant);
+      if (nextLight != light || nextVariant != cn_variant) {
+        break;
+      }
+
+      ++end;
+    }
+
+    cn_slow_hash_multi(context, data.data() + i, lengths.data() + i, end - i, res + i, light, cn_variant);
+    i = end;
+  }
+
+  return true;
+}
+
 std::vector<uint32_t> relative_output_offsets_to_absolute(const std::vector<uint32_t>& off) {
   std::vector<uint32_t> res = off;
   for (size_t i = 1; i < res.size(); i++)
@@ -32,6 +32,7 @@ class ILogger;
 namespace CryptoNote {
 
 bool parseAndValidateTransactionFromBinaryArray(const BinaryArray& transactionBinaryArray, Transaction& transaction, Crypto::Hash& transactionHash, Crypto::Hash& transactionPrefixHash);
+bool parseAndValidateTransactionFromBinaryArray(const void* data, size_t size, Transaction& transaction, Crypto::Hash& transactionHash, Crypto::Hash& transactionPrefixHash);
 
 struct TransactionSourceEntry {
   typedef std::pair<uint32_t, Crypto::PublicKey> OutputEntry;
@@ -90,6 +91,12 @@ bool get_aux_block_header_hash(const Block& b, Crypto::Hash& res);
 bool get_block_hash(const Block& b, Crypto::Hash& res);
 Crypto::Hash get_block_hash(const Block& b);
 bool get_block_longhash(Crypto::cn_context &context, const Block& b, Crypto::Hash& res);
+// Input of the long hash and the offset of the nonce in it, so that other nonces can be hashed without serializing b again.
+// Fails if the nonce of b is not found at the computed offset.
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob, size_t& nonceOffset);
+void get_block_longhash_variant(uint8_t majorVersion, int& light, int& variant);
+// Long hashes of count blocks into res, the blocks of a variant with a multi-way kernel are hashed several at once
+bool get_block_longhashes(Crypto::cn_context &context, const Block* const* blocks, size_t count, Crypto::Hash* res);
 bool get_inputs_money_amount(const Transaction& tx, uint64_t& money);
 uint64_t get_outs_money_amount(const Transaction& tx);
 bool check_inputs_types_supported(const TransactionPrefix& tx);
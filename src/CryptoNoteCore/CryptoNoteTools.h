@@ -54,10 +54,10 @@ BinaryArray toBinaryArray(const T& object) {
 }
 
 template<class T>
-bool fromBinaryArray(T& object, const BinaryArray& binaryArray) {
+bool fromBinaryArray(T& object, const void* data, size_t size) {
   bool result = false;
   try {
-    Common::MemoryInputStream stream(binaryArray.data(), binaryArray.size());
+    Common::MemoryInputStream stream(data, size);
     BinaryInputStreamSerializer serializer(stream);
     serialize(object, serializer);
     result = stream.endOfStream(); // check that all data was consumed
@@ -68,6 +68,11 @@ bool fromBinaryArray(T& object, const BinaryArray& binaryArray) {
   return result;
 }
 
+template<class T>
+bool fromBinaryArray(T& object, const BinaryArray& binaryArray) {
+  return fromBinaryArray(object, binaryArray.data(), binaryArray.size());
+}
+
 template<class T>
 bool getObjectBinarySize(const T& object, size_t& size) {
   BinaryArray ba;
@@ -16,6 +16,7 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
 #include "Currency.h"
+#include <algorithm>
 #include <cctype>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/math/special_functions/round.hpp>
@@ -88,6 +89,7 @@ namespace CryptoNote
       m_blocksFileName = "testnet_" + m_blocksFileName;
       m_blocksCacheFileName = "testnet_" + m_blocksCacheFileName;
       m_blockIndexesFileName = "testnet_" + m_blockIndexesFileName;
+      m_outputsFileName = "testnet_" + m_outputsFileName;
       m_txPoolFileName = "testnet_" + m_txPoolFileName;
       m_blockchinIndicesFileName = "testnet_" + m_blockchinIndicesFileName;
     }
@@ -795,8 +797,8 @@ namespace CryptoNote
     return Common::fromString(strAmount, amount);
   }
 
-	difficulty_type Currency::nextDifficulty(uint32_t height, uint8_t blockMajorVersion, std::vector<uint64_t> timestamps,
-		std::vector<difficulty_type> cumulativeDifficulties) const {
+	difficulty_type Currency::nextDifficulty(uint32_t height, uint8_t blockMajorVersion, Common::ArrayView<uint64_t> timestamps,
+		Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 
 		if (blockMajorVersion >= BLOCK_MAJOR_VERSION_7) {
 			return nextDifficultyV5(height, blockMajorVersion, timestamps, cumulativeDifficulties);
@@ -816,24 +818,25 @@ namespace CryptoNote
 	}
 
 
-	difficulty_type Currency::nextDifficultyV1(std::vector<uint64_t> timestamps,
-				std::vector<difficulty_type> cumulativeDifficulties) const {
+	difficulty_type Currency::nextDifficultyV1(Common::ArrayView<uint64_t> timestampsView,
+				Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 		assert(m_difficultyWindow >= 2);
 
-    if (timestamps.size() > m_difficultyWindow)
+    if (timestampsView.getSize() > m_difficultyWindow)
     {
-      timestamps.resize(m_difficultyWindow);
-      cumulativeDifficulties.resize(m_difficultyWindow);
+      timestampsView = timestampsView.head(m_difficultyWindow);
+      cumulativeDifficulties = cumulativeDifficulties.head(m_difficultyWindow);
     }
 
-    size_t length = timestamps.size();
-    assert(length == cumulativeDifficulties.size());
+    size_t length = timestampsView.getSize();
+    assert(length == cumulativeDifficulties.getSize());
     assert(length <= m_difficultyWindow);
     if (length <= 1)
     {
       return 1;
     }
 
+    std::vector<uint64_t> timestamps(timestampsView.begin(), timestampsView.end());
     sort(timestamps.begin(), timestamps.end());
 
     size_t cutBegin, cutEnd;
@@ -869,8 +872,8 @@ namespace CryptoNote
     return (low + timeSpan - 1) / timeSpan;
   }
 
-	difficulty_type Currency::nextDifficultyV2(std::vector<uint64_t> timestamps,
-		std::vector<difficulty_type> cumulativeDifficulties) const {
+	difficulty_type Currency::nextDifficultyV2(Common::ArrayView<uint64_t> timestamps,
+		Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 
 		// Difficulty calculation v. 2
 		// based on Zawy difficulty algorithm v1.0
@@ -881,26 +884,25 @@ namespace CryptoNote
 		size_t m_difficultyWindow_2 = CryptoNote::parameters::DIFFICULTY_WINDOW_V2;
 		assert(m_difficultyWindow_2 >= 2);
 
-		if (timestamps.size() > m_difficultyWindow_2) {
-			timestamps.resize(m_difficultyWindow_2);
-			cumulativeDifficulties.resize(m_difficultyWindow_2);
+		if (timestamps.getSize() > m_difficultyWindow_2) {
+			timestamps = timestamps.head(m_difficultyWindow_2);
+			cumulativeDifficulties = cumulativeDifficulties.head(m_difficultyWindow_2);
 		}
 
-		size_t length = timestamps.size();
-		assert(length == cumulativeDifficulties.size());
+		size_t length = timestamps.getSize();
+		assert(length == cumulativeDifficulties.getSize());
 		assert(length <= m_difficultyWindow_2);
 		if (length <= 1) {
 			return 1;
 		}
 
-		sort(timestamps.begin(), timestamps.end());
-
-		uint64_t timeSpan = timestamps.back() - timestamps.front();
+		auto timestampRange = std::minmax_element(timestamps.begin(), timestamps.end());
+		uint64_t timeSpan = *timestampRange.second - *timestampRange.first;
 		if (timeSpan == 0) {
 			timeSpan = 1;
 		}
 
-		difficulty_type totalWork = cumulativeDifficulties.back() - cumulativeDifficulties.front();
+		difficulty_type totalWork = cumulativeDifficulties.last() - cumulativeDifficulties.first();
 		assert(totalWork > 0);
 
 		// uint64_t nextDiffZ = totalWork * m_difficultyTarget / timeSpan; 
@@ -922,8 +924,8 @@ namespace CryptoNote
 		return nextDiffZ;
 	}
 
-	difficulty_type Currency::nextDifficultyV3(std::vector<uint64_t> timestamps,
-		std::vector<difficulty_type> cumulativeDifficulties) const {
+	difficulty_type Currency::nextDifficultyV3(Common::ArrayView<uint64_t> timestamps,
+		Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 
 		// LWMA difficulty algorithm
 		// Copyright (c) 2017-2018 Zawy
@@ -939,16 +941,16 @@ namespace CryptoNote
 		size_t N = CryptoNote::parameters::DIFFICULTY_WINDOW_V3;
 
 		// return a difficulty of 1 for first 3 blocks if it's the start of the chain
-		if (timestamps.size() < 4) {
+		if (timestamps.getSize() < 4) {
 			return 1;
 		}
 		// otherwise, use a smaller N if the start of the chain is less than N+1
-		else if (timestamps.size() < N + 1) {
-			N = timestamps.size() - 1;
+		else if (timestamps.getSize() < N + 1) {
+			N = timestamps.getSize() - 1;
 		}
-		else if (timestamps.size() > N + 1) {
-			timestamps.resize(N + 1);
-			cumulativeDifficulties.resize(N + 1);
+		else if (timestamps.getSize() > N + 1) {
+			timestamps = timestamps.head(N + 1);
+			cumulativeDifficulties = cumulativeDifficulties.head(N + 1);
 		}
 
 		// To get an average solvetime to within +/- ~0.1%, use an adjustment factor.
@@ -988,7 +990,7 @@ namespace CryptoNote
 	
 
 	difficulty_type Currency::nextDifficultyV4(uint32_t height, uint8_t blockMajorVersion,
-		std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulativeDifficulties) const {
+		Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 			
 			// LWMA-1 difficulty algorithm 
 			// Copyright (c) 2017-2018 Zawy, MIT License
@@ -1002,7 +1004,7 @@ namespace CryptoNote
 	   		   uint64_t difficulty_plate = 10000;
 	   		   
 
-			   assert(timestamps.size() == cumulativeDifficulties.size() && timestamps.size() <= static_cast<uint64_t>(N + 1));
+			   assert(timestamps.getSize() == cumulativeDifficulties.getSize() && timestamps.getSize() <= static_cast<uint64_t>(N + 1));
 
 			   // If it's a new coin, do startup code. Do not remove in case other coins copy your code.
 			   // uint64_t difficulty_guess = 10000;
@@ -1055,7 +1057,7 @@ namespace CryptoNote
 	}
 
 		difficulty_type Currency::nextDifficultyV5(uint32_t height, uint8_t blockMajorVersion,
-		std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulativeDifficulties) const {
+		Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 			
 			// LWMA-1 difficulty algorithm 
 			// Copyright (c) 2017-2018 Zawy, MIT License
@@ -1069,7 +1071,7 @@ namespace CryptoNote
 	   		   uint64_t difficulty_plate = 100000;
 	   		   
 
-			   assert(timestamps.size() == cumulativeDifficulties.size() && timestamps.size() <= static_cast<uint64_t>(N + 1));
+			   assert(timestamps.getSize() == cumulativeDifficulties.getSize() && timestamps.getSize() <= static_cast<uint64_t>(N + 1));
 
 			   // If it's a new coin, do startup code. Do not remove in case other coins copy your code.
 			   // uint64_t difficulty_guess = 10000;
@@ -1149,6 +1151,10 @@ namespace CryptoNote
 			return false;
 		}
 
+		return checkMergeMiningTag(block);
+	}
+
+	bool Currency::checkMergeMiningTag(const Block& block) const {
 		TransactionExtraMergeMiningTag mmTag;
 		if (!getMergeMiningTagFromExtra(block.parentBlock.baseTransaction.extra, mmTag)) {
 			logger(ERROR) << "merge mining tag wasn't found in extra of the parent block miner transaction";
@@ -1197,6 +1203,26 @@ namespace CryptoNote
 		logger(ERROR, BRIGHT_RED) << "Unknown block major version: " << block.majorVersion << "." << block.minorVersion;
 		return false;
 	}
+
+	bool Currency::checkProofOfWork(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const {
+		switch (block.majorVersion) {
+		case BLOCK_MAJOR_VERSION_1:
+			return check_hash(proofOfWork, currentDiffic);
+
+		case BLOCK_MAJOR_VERSION_2:
+		case BLOCK_MAJOR_VERSION_3:
+		case BLOCK_MAJOR_VERSION_4:
+		case BLOCK_MAJOR_VERSION_5:
+		case BLOCK_MAJOR_VERSION_6:
+		case BLOCK_MAJOR_VERSION_7:
+		case BLOCK_MAJOR_VERSION_8:
+		case BLOCK_MAJOR_VERSION_9:
+			return check_hash(proofOfWork, currentDiffic) && checkMergeMiningTag(block);
+		}
+
+		logger(ERROR, BRIGHT_RED) << "Unknown block major version: " << block.majorVersion << "." << block.minorVersion;
+		return false;
+	}
     size_t Currency::getApproximateMaximumInputCount(size_t transactionSize, size_t outputCount, size_t mixinCount) const {
     const size_t KEY_IMAGE_SIZE = sizeof(Crypto::KeyImage);
     const size_t OUTPUT_KEY_SIZE = sizeof(decltype(KeyOutput::key));
@@ -1302,6 +1328,7 @@ namespace CryptoNote
     blocksFileName(parameters::CRYPTONOTE_BLOCKS_FILENAME);
     blocksCacheFileName(parameters::CRYPTONOTE_BLOCKSCACHE_FILENAME);
     blockIndexesFileName(parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME);
+    outputsFileName(parameters::CRYPTONOTE_OUTPUTS_FILENAME);
     txPoolFileName(parameters::CRYPTONOTE_POOLDATA_FILENAME);
     blockchinIndicesFileName(parameters::CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME);
 
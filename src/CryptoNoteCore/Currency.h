@@ -22,6 +22,7 @@
 #include <vector>
 #include <boost/utility.hpp>
 #include "../CryptoNoteConfig.h"
+#include "../Common/ArrayView.h"
 #include "../crypto/hash.h"
 #include "../Logging/LoggerRef.h"
 #include "CryptoNoteBasic.h"
@@ -174,6 +175,7 @@ public:
   const std::string &blocksFileName() const { return m_blocksFileName; }
   const std::string &blocksCacheFileName() const { return m_blocksCacheFileName; }
   const std::string &blockIndexesFileName() const { return m_blockIndexesFileName; }
+  const std::string &outputsFileName() const { return m_outputsFileName; }
   const std::string &txPoolFileName() const { return m_txPoolFileName; }
   const std::string &blockchinIndicesFileName() const { return m_blockchinIndicesFileName; }
 
@@ -210,16 +212,19 @@ public:
   std::string formatAmount(int64_t amount) const;
   bool parseAmount(const std::string &str, uint64_t &amount) const;
 
-  difficulty_type nextDifficulty(uint32_t height, uint8_t blockMajorVersion, std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV1(std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV2(std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV3(std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV4(uint32_t height, uint8_t blockMajorVersion, std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV5(uint32_t height, uint8_t blockMajorVersion, std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
+  // timestamps and cumulativeDifficulties of the blocks preceding the new one, oldest first
+  difficulty_type nextDifficulty(uint32_t height, uint8_t blockMajorVersion, Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const;
+  difficulty_type nextDifficultyV1(Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const;
+  difficulty_type nextDifficultyV2(Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const;
+  difficulty_type nextDifficultyV3(Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const;
+  difficulty_type nextDifficultyV4(uint32_t height, uint8_t blockMajorVersion, Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const;
+  difficulty_type nextDifficultyV5(uint32_t height, uint8_t blockMajorVersion, Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const;
 
   bool checkProofOfWorkV1(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
   bool checkProofOfWorkV2(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
   bool checkProofOfWork(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
+  // Same checks for a proof of work (block long hash) computed beforehand.
+  bool checkProofOfWork(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
   size_t getApproximateMaximumInputCount(size_t transactionSize, size_t outputCount, size_t mixinCount) const;
 
 private:
@@ -227,6 +232,7 @@ private:
   }
 
   bool init();
+  bool checkMergeMiningTag(const Block& block) const;
 
   bool generateGenesisBlock();
 
@@ -308,6 +314,7 @@ private:
   std::string m_blocksFileName;
   std::string m_blocksCacheFileName;
   std::string m_blockIndexesFileName;
+  std::string m_outputsFileName;
   std::string m_txPoolFileName;
   std::string m_blockchinIndicesFileName;
 
@@ -418,6 +425,7 @@ public:
   CurrencyBuilder& blocksFileName(const std::string& val) { m_currency.m_blocksFileName = val; return *this; }
   CurrencyBuilder& blocksCacheFileName(const std::string& val) { m_currency.m_blocksCacheFileName = val; return *this; }
   CurrencyBuilder& blockIndexesFileName(const std::string& val) { m_currency.m_blockIndexesFileName = val; return *this; }
+  CurrencyBuilder& outputsFileName(const std::string& val) { m_currency.m_outputsFileName = val; return *this; }
   CurrencyBuilder& txPoolFileName(const std::string& val) { m_currency.m_txPoolFileName = val; return *this; }
   CurrencyBuilder& blockchinIndicesFileName(const std::string& val) { m_currency.m_blockchinIndicesFileName = val; return *this; }
   
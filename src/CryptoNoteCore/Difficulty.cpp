@@ -72,4 +72,49 @@ namespace CryptoNote {
     carry = cadc(high, top, carry);
     return !carry;
   }
+
+  DifficultyWindow::DifficultyWindow(size_t capacity) : m_capacity(capacity), m_beginHeight(0) {
+    assert(capacity > 0);
+  }
+
+  void DifficultyWindow::clear(uint32_t beginHeight) {
+    m_beginHeight = beginHeight;
+    m_timestamps.clear();
+    m_cumulativeDifficulties.clear();
+  }
+
+  void DifficultyWindow::push(uint64_t timestamp, difficulty_type cumulativeDifficulty) {
+    if (m_timestamps.size() >= 2 * m_capacity) {
+      size_t excess = m_timestamps.size() - m_capacity;
+      m_timestamps.erase(m_timestamps.begin(), m_timestamps.begin() + excess);
+      m_cumulativeDifficulties.erase(m_cumulativeDifficulties.begin(), m_cumulativeDifficulties.begin() + excess);
+      m_beginHeight += static_cast<uint32_t>(excess);
+    }
+
+    m_timestamps.push_back(timestamp);
+    m_cumulativeDifficulties.push_back(cumulativeDifficulty);
+  }
+
+  void DifficultyWindow::pushFront(uint64_t timestamp, difficulty_type cumulativeDifficulty) {
+    assert(m_beginHeight > 0);
+    m_timestamps.insert(m_timestamps.begin(), timestamp);
+    m_cumulativeDifficulties.insert(m_cumulativeDifficulties.begin(), cumulativeDifficulty);
+    --m_beginHeight;
+  }
+
+  void DifficultyWindow::pop() {
+    assert(!m_timestamps.empty());
+    m_timestamps.pop_back();
+    m_cumulativeDifficulties.pop_back();
+  }
+
+  Common::ArrayView<uint64_t> DifficultyWindow::timestamps(uint32_t beginHeight, uint32_t endHeight) const {
+    assert(covers(beginHeight, endHeight));
+    return Common::ArrayView<uint64_t>(m_timestamps.data() + (beginHeight - m_beginHeight), endHeight - beginHeight);
+  }
+
+  Common::ArrayView<difficulty_type> DifficultyWindow::cumulativeDifficulties(uint32_t beginHeight, uint32_t endHeight) const {
+    assert(covers(beginHeight, endHeight));
+    return Common::ArrayView<difficulty_type>(m_cumulativeDifficulties.data() + (beginHeight - m_beginHeight), endHeight - beginHeight);
+  }
 }
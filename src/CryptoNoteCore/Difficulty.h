@@ -17,9 +17,11 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
+#include "Common/ArrayView.h"
 #include "crypto/hash.h"
 
 namespace CryptoNote
@@ -27,4 +29,37 @@ namespace CryptoNote
     typedef std::uint64_t difficulty_type;
 
     bool check_hash(const Crypto::Hash &hash, difficulty_type difficulty);
+
+    // Timestamps and cumulative difficulties of the last blocks of the main chain, kept in contiguous
+    // arrays so the difficulty algorithms read them in place instead of decoding stored blocks.
+    // Holds at least capacity blocks (fewer only near genesis), trimmed once twice as many are stored.
+    class DifficultyWindow {
+    public:
+      explicit DifficultyWindow(size_t capacity);
+
+      size_t capacity() const { return m_capacity; }
+      size_t size() const { return m_timestamps.size(); }
+      uint32_t beginHeight() const { return m_beginHeight; }
+      uint32_t endHeight() const { return m_beginHeight + static_cast<uint32_t>(m_timestamps.size()); }
+      bool covers(uint32_t beginHeight, uint32_t endHeight) const {
+        return beginHeight >= m_beginHeight && beginHeight <= endHeight && endHeight <= this->endHeight();
+      }
+
+      void clear(uint32_t beginHeight = 0);
+      // Adds the block at endHeight().
+      void push(uint64_t timestamp, difficulty_type cumulativeDifficulty);
+      // Adds the block at beginHeight() - 1.
+      void pushFront(uint64_t timestamp, difficulty_type cumulativeDifficulty);
+      void pop();
+
+      // Values of blocks [beginHeight, endHeight), which must be covered.
+      Common::ArrayView<uint64_t> timestamps(uint32_t beginHeight, uint32_t endHeight) const;
+      Common::ArrayView<difficulty_type> cumulativeDifficulties(uint32_t beginHeight, uint32_t endHeight) const;
+
+    private:
+      size_t m_capacity;
+      uint32_t m_beginHeight;
+      std::vector<uint64_t> m_timestamps;
+      std::vector<difficulty_type> m_cumulativeDifficulties;
+    };
 }
@@ -25,6 +25,7 @@
 #include <vector>
 
 #include <CryptoNote.h>
+#include <Common/StringView.h>
 #include "CryptoNoteCore/Difficulty.h"
 
 #include "CryptoNoteCore/MessageQueue.h"
@@ -52,6 +53,14 @@ struct KeyInput;
 struct TransactionPrefixInfo;
 struct tx_verification_context;
 
+// Block received during synchronization, see ICore::prevalidateBlocks.
+// The transaction blobs point into the received message, which has to outlive the batch.
+struct PrevalidatedBlock {
+  Block block;
+  std::vector<Common::StringView> transactionBlobs;
+  std::vector<Transaction> transactions;
+};
+
 class ICore {
 public:
   virtual ~ICore() {}
@@ -83,6 +92,11 @@ public:
   virtual bool getOutByMSigGIndex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) = 0;
   virtual i_cryptonote_protocol* get_protocol() = 0;
   virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) = 0; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
+  virtual bool handle_incoming_tx(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keeped_by_block) = 0;
+  // Parses the transactions of a batch of blocks into PrevalidatedBlock::transactions and runs the checks that don't
+  // depend on the blocks before them (transaction hashes, ring signatures over outputs already in the chain, proofs
+  // of work) on the sync threads. The blocks still have to be added in order. Returns false on a malformed transaction.
+  virtual bool prevalidateBlocks(std::vector<PrevalidatedBlock>& blocks) = 0;
   virtual std::vector<Transaction> getPoolTransactions() = 0;
   virtual bool getPoolTransaction(const Crypto::Hash &tx_hash, Transaction &transaction) = 0;
   virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
@@ -0,0 +1,555 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/ArrayView.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/VectorOutputStream.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+#include "System/MemoryMappedFile.h"
+
+struct BlobCacheStatistics {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t cachedItems;
+  uint64_t storedBytes;
+};
+
+// Append-only vector of serialized items. The items file is memory mapped, so the stored blob of an item is
+// available without a copy, and items are deserialized only when requested, into an LRU cache of poolSize items.
+//
+// The files keep the layout of the former SwappedVector: the items file holds the blobs back to back, the index
+// file holds the item count followed by the size of every item. The items file is grown in steps ahead of the
+// data and trimmed back on close, space past the last item is never read.
+//
+// New items are written to the index in batches, after their blobs have been flushed to disk, so that the index
+// never counts an item whose blob may still be zeros after a crash. The items of an unwritten batch are lost then.
+template<class T> class MappedBlobVector {
+public:
+  typedef T value_type;
+
+  class const_iterator {
+  public:
+    typedef ptrdiff_t difference_type;
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef const T* pointer;
+    typedef const T& reference;
+    typedef T value_type;
+
+    const_iterator() {
+    }
+
+    const_iterator(MappedBlobVector* vector, size_t index) : m_vector(vector), m_index(index) {
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return m_index != other.m_index;
+    }
+
+    bool operator<(const const_iterator& other) const {
+      return m_index < other.m_index;
+    }
+
+    bool operator<=(const const_iterator& other) const {
+      return m_index <= other.m_index;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return m_index == other.m_index;
+    }
+
+    bool operator>(const const_iterator& other) const {
+      return m_index > other.m_index;
+    }
+
+    bool operator>=(const const_iterator& other) const {
+      return m_index >= other.m_index;
+    }
+
+    const_iterator& operator++() {
+      ++m_index;
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator i = *this;
+      ++m_index;
+      return i;
+    }
+
+    const_iterator& operator--() {
+      --m_index;
+      return *this;
+    }
+
+    const_iterator operator--(int) {
+      const_iterator i = *this;
+      --m_index;
+      return i;
+    }
+
+    const_iterator& operator+=(difference_type n) {
+      m_index += n;
+      return *this;
+    }
+
+    const_iterator& operator-=(difference_type n) {
+      m_index -= n;
+      return *this;
+    }
+
+    const_iterator operator+(difference_type n) const {
+      return const_iterator(m_vector, m_index + n);
+    }
+
+    friend const_iterator operator+(difference_type n, const const_iterator& i) {
+      return const_iterator(i.m_vector, n + i.m_index);
+    }
+
+    difference_type operator-(const const_iterator& other) const {
+      return m_index - other.m_index;
+    }
+
+    const_iterator operator-(difference_type n) const {
+      return const_iterator(m_vector, m_index - n);
+    }
+
+    const T& operator*() const {
+      return (*m_vector)[m_index];
+    }
+
+    const T* operator->() const {
+      return &(*m_vector)[m_index];
+    }
+
+    const T& operator[](difference_type offset) const {
+      return (*m_vector)[m_index + offset];
+    }
+
+    size_t index() const {
+      return m_index;
+    }
+
+  private:
+    MappedBlobVector* m_vector;
+    size_t m_index;
+  };
+
+  MappedBlobVector();
+  MappedBlobVector(const MappedBlobVector&) = delete;
+  ~MappedBlobVector();
+  MappedBlobVector& operator=(const MappedBlobVector&) = delete;
+
+  bool open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize);
+  void close();
+
+  bool empty() const;
+  uint64_t size() const;
+  const_iterator begin();
+  const_iterator end();
+  const T& operator[](uint64_t index);
+  const T& front();
+  const T& back();
+  void clear();
+  void pop_back();
+  void push_back(const T& item);
+
+  // Serialized item as stored, valid until the vector is modified.
+  Common::ArrayView<uint8_t> blob(uint64_t index);
+  BlobCacheStatistics getCacheStatistics();
+
+  // Item access is serialized internally, but references returned by operator[] stay valid only
+  // until the item is evicted. Threads that read concurrently register themselves as readers:
+  // items evicted while a reader is registered are kept until every reader that might reference
+  // them has left.
+  uint64_t enterReader();
+  void leaveReader(uint64_t epoch);
+
+private:
+  struct ItemEntry;
+  struct CacheEntry;
+
+  struct ItemEntry {
+  public:
+    std::unique_ptr<T> item;
+    typename std::list<CacheEntry>::iterator cacheIter;
+  };
+
+  struct CacheEntry {
+  public:
+    uint64_t index;
+  };
+
+  static const uint64_t MINIMUM_GROWTH = 16 * 1024 * 1024;
+  static const uint64_t STORE_INTERVAL = 64;
+
+  System::MemoryMappedFile m_itemsFile;
+  std::fstream m_indexesFile;
+  size_t m_poolSize;
+  std::vector<uint64_t> m_offsets;
+  // items counted by the index file
+  uint64_t m_storedCount;
+  uint64_t m_itemsFileSize;
+  std::vector<uint8_t> m_buffer;
+  std::unordered_map<uint64_t, ItemEntry> m_items;
+  std::list<CacheEntry> m_cache;
+  uint64_t m_cacheHits;
+  uint64_t m_cacheMisses;
+
+  std::recursive_mutex m_mutex;
+  uint64_t m_epoch;
+  std::multiset<uint64_t> m_readers;
+  std::deque<std::pair<uint64_t, std::unique_ptr<T>>> m_retired;
+
+  uint64_t itemSize(uint64_t index) const;
+  void writeCount(uint64_t count, const char* operation);
+  void store(const char* operation);
+  T* prepare(uint64_t index);
+  void releaseRetired();
+};
+
+template<class T> const uint64_t MappedBlobVector<T>::MINIMUM_GROWTH;
+template<class T> const uint64_t MappedBlobVector<T>::STORE_INTERVAL;
+
+template<class T> MappedBlobVector<T>::MappedBlobVector() : m_poolSize(0), m_storedCount(0), m_itemsFileSize(0), m_cacheHits(0), m_cacheMisses(0), m_epoch(0) {
+}
+
+template<class T> MappedBlobVector<T>::~MappedBlobVector() {
+  close();
+}
+
+template<class T> bool MappedBlobVector<T>::open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize) {
+  if (poolSize == 0) {
+    return false;
+  }
+
+  boost::system::error_code fileError;
+  uint64_t fileSize = boost::filesystem::file_size(itemFileName, fileError);
+  m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
+  std::vector<uint64_t> offsets;
+  uint64_t itemsFileSize = 0;
+  if (!fileError && m_indexesFile) {
+    uint64_t count;
+    m_indexesFile.read(reinterpret_cast<char*>(&count), sizeof count);
+    if (!m_indexesFile) {
+      return false;
+    }
+
+    for (uint64_t i = 0; i < count; ++i) {
+      uint32_t itemSize;
+      m_indexesFile.read(reinterpret_cast<char*>(&itemSize), sizeof itemSize);
+      if (!m_indexesFile) {
+        return false;
+      }
+
+      // items cut off by a trimmed or damaged items file are dropped
+      if (itemsFileSize + itemSize > fileSize) {
+        break;
+      }
+
+      offsets.emplace_back(itemsFileSize);
+      itemsFileSize += itemSize;
+    }
+
+    if (fileSize < itemsFileSize + MINIMUM_GROWTH) {
+      boost::filesystem::resize_file(itemFileName, itemsFileSize + MINIMUM_GROWTH, fileError);
+      if (fileError) {
+        return false;
+      }
+    }
+
+    std::error_code ec;
+    m_itemsFile.open(itemFileName, ec);
+    if (ec) {
+      return false;
+    }
+  } else {
+    std::error_code ec;
+    m_itemsFile.create(itemFileName, MINIMUM_GROWTH, true, ec);
+    if (ec) {
+      return false;
+    }
+
+    m_indexesFile.close();
+    m_indexesFile.clear();
+    m_indexesFile.open(indexFileName, std::ios::out | std::ios::binary);
+    m_indexesFile.close();
+    m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
+  }
+
+  m_offsets.swap(offsets);
+  m_itemsFileSize = itemsFileSize;
+  try {
+    writeCount(m_offsets.size(), "MappedBlobVector::open");
+  } catch (std::exception&) {
+    return false;
+  }
+
+  m_storedCount = m_offsets.size();
+
+  m_poolSize = poolSize;
+  m_items.clear();
+  m_cache.clear();
+  m_cacheHits = 0;
+  m_cacheMisses = 0;
+  return true;
+}
+
+template<class T> void MappedBlobVector<T>::close() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  if (!m_itemsFile.isOpened()) {
+    return;
+  }
+
+  try {
+    store("MappedBlobVector::close");
+  } catch (std::exception&) {
+  }
+
+  std::string itemFileName = m_itemsFile.path();
+  std::error_code ignore;
+  m_itemsFile.close(ignore);
+  m_indexesFile.close();
+
+  boost::system::error_code ignoreBoost;
+  boost::filesystem::resize_file(itemFileName, m_itemsFileSize, ignoreBoost);
+}
+
+template<class T> bool MappedBlobVector<T>::empty() const {
+  return m_offsets.empty();
+}
+
+template<class T> uint64_t MappedBlobVector<T>::size() const {
+  return m_offsets.size();
+}
+
+template<class T> typename MappedBlobVector<T>::const_iterator MappedBlobVector<T>::begin() {
+  return const_iterator(this, 0);
+}
+
+template<class T> typename MappedBlobVector<T>::const_iterator MappedBlobVector<T>::end() {
+  return const_iterator(this, m_offsets.size());
+}
+
+template<class T> const T& MappedBlobVector<T>::operator[](uint64_t index) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  auto itemIter = m_items.find(index);
+  if (itemIter != m_items.end()) {
+    if (itemIter->second.cacheIter != --m_cache.end()) {
+      m_cache.splice(m_cache.end(), m_cache, itemIter->second.cacheIter);
+    }
+
+    ++m_cacheHits;
+    return *itemIter->second.item;
+  }
+
+  if (index >= m_offsets.size()) {
+    throw std::runtime_error("MappedBlobVector::operator[]");
+  }
+
+  T tempItem;
+  Common::MemoryInputStream stream(m_itemsFile.data() + m_offsets[index], itemSize(index));
+  CryptoNote::BinaryInputStreamSerializer archive(stream);
+  serialize(tempItem, archive);
+
+  T* item = prepare(index);
+  std::swap(tempItem, *item);
+  ++m_cacheMisses;
+  return *item;
+}
+
+template<class T> const T& MappedBlobVector<T>::front() {
+  return operator[](0);
+}
+
+template<class T> const T& MappedBlobVector<T>::back() {
+  return operator[](m_offsets.size() - 1);
+}
+
+template<class T> void MappedBlobVector<T>::clear() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  writeCount(0, "MappedBlobVector::clear");
+  m_storedCount = 0;
+  m_offsets.clear();
+  m_itemsFileSize = 0;
+  m_items.clear();
+  m_cache.clear();
+}
+
+template<class T> void MappedBlobVector<T>::pop_back() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  if (m_storedCount == m_offsets.size()) {
+    writeCount(m_offsets.size() - 1, "MappedBlobVector::pop_back");
+    --m_storedCount;
+  }
+
+  m_itemsFileSize = m_offsets.back();
+  m_offsets.pop_back();
+  auto itemIter = m_items.find(m_offsets.size());
+  if (itemIter != m_items.end()) {
+    m_cache.erase(itemIter->second.cacheIter);
+    m_items.erase(itemIter);
+  }
+}
+
+template<class T> void MappedBlobVector<T>::push_back(const T& item) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  if (!m_itemsFile.isOpened()) {
+    throw std::runtime_error("MappedBlobVector::push_back");
+  }
+
+  m_buffer.clear();
+  {
+    Common::VectorOutputStream stream(m_buffer);
+    CryptoNote::BinaryOutputStreamSerializer archive(stream);
+    serialize(const_cast<T&>(item), archive);
+  }
+
+  uint64_t itemsFileSize = m_itemsFileSize + m_buffer.size();
+  if (itemsFileSize > m_itemsFile.size()) {
+    m_itemsFile.resize(std::max(itemsFileSize, m_itemsFile.size() + std::max(m_itemsFile.size() / 8, MINIMUM_GROWTH)));
+  }
+
+  memcpy(m_itemsFile.data() + m_itemsFileSize, m_buffer.data(), m_buffer.size());
+  m_offsets.push_back(m_itemsFileSize);
+  m_itemsFileSize = itemsFileSize;
+  if (m_offsets.size() - m_storedCount >= STORE_INTERVAL) {
+    store("MappedBlobVector::push_back");
+  }
+
+  T* newItem = prepare(m_offsets.size() - 1);
+  *newItem = item;
+}
+
+template<class T> Common::ArrayView<uint8_t> MappedBlobVector<T>::blob(uint64_t index) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  if (index >= m_offsets.size()) {
+    throw std::runtime_error("MappedBlobVector::blob");
+  }
+
+  return Common::ArrayView<uint8_t>(m_itemsFile.data() + m_offsets[index], itemSize(index));
+}
+
+template<class T> BlobCacheStatistics MappedBlobVector<T>::getCacheStatistics() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  BlobCacheStatistics statistics;
+  statistics.hits = m_cacheHits;
+  statistics.misses = m_cacheMisses;
+  statistics.cachedItems = m_items.size();
+  statistics.storedBytes = m_itemsFileSize;
+  return statistics;
+}
+
+template<class T> uint64_t MappedBlobVector<T>::enterReader() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  m_readers.insert(m_epoch);
+  return m_epoch;
+}
+
+template<class T> void MappedBlobVector<T>::leaveReader(uint64_t epoch) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  auto readerIter = m_readers.find(epoch);
+  if (readerIter != m_readers.end()) {
+    m_readers.erase(readerIter);
+  }
+
+  releaseRetired();
+}
+
+template<class T> uint64_t MappedBlobVector<T>::itemSize(uint64_t index) const {
+  return (index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_itemsFileSize) - m_offsets[index];
+}
+
+template<class T> void MappedBlobVector<T>::writeCount(uint64_t count, const char* operation) {
+  if (!m_indexesFile) {
+    throw std::runtime_error(operation);
+  }
+
+  m_indexesFile.seekp(0);
+  m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+  if (!m_indexesFile) {
+    throw std::runtime_error(operation);
+  }
+}
+
+template<class T> void MappedBlobVector<T>::store(const char* operation) {
+  if (m_storedCount == m_offsets.size()) {
+    return;
+  }
+
+  uint64_t storedSize = m_offsets[m_storedCount];
+  m_itemsFile.flush(m_itemsFile.data() + storedSize, m_itemsFileSize - storedSize);
+
+  m_indexesFile.seekp(sizeof(uint64_t) + sizeof(uint32_t) * m_storedCount);
+  for (uint64_t i = m_storedCount; i < m_offsets.size(); ++i) {
+    uint32_t size = static_cast<uint32_t>(itemSize(i));
+    m_indexesFile.write(reinterpret_cast<char*>(&size), sizeof size);
+  }
+
+  if (!m_indexesFile) {
+    throw std::runtime_error(operation);
+  }
+
+  writeCount(m_offsets.size(), operation);
+  m_indexesFile.flush();
+  m_storedCount = m_offsets.size();
+}
+
+template<class T> void MappedBlobVector<T>::releaseRetired() {
+  // an item retired at epoch E may only be referenced by readers that entered at E or before
+  while (!m_retired.empty() && (m_readers.empty() || m_retired.front().first < *m_readers.begin())) {
+    m_retired.pop_front();
+  }
+}
+
+template<class T> T* MappedBlobVector<T>::prepare(uint64_t index) {
+  if (m_items.size() == m_poolSize) {
+    auto cacheIter = m_cache.begin();
+    if (!m_readers.empty()) {
+      m_retired.emplace_back(m_epoch++, std::move(m_items[cacheIter->index].item));
+    }
+
+    m_items.erase(cacheIter->index);
+    m_cache.erase(cacheIter);
+  }
+
+  auto itemIter = m_items.insert(std::make_pair(index, ItemEntry()));
+  CacheEntry cacheEntry = { index };
+  auto cacheIter = m_cache.insert(m_cache.end(), cacheEntry);
+  itemIter.first->second.cacheIter = cacheIter;
+  itemIter.first->second.item.reset(new T());
+  return itemIter.first->second.item.get();
+}
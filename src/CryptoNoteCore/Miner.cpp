@@ -34,6 +34,7 @@
 #include "Common/StringTools.h"
 #include "Serialization/SerializationTools.h"
 
+#include "BlockHashingBatch.h"
 #include "CryptoNoteFormatUtils.h"
 #include "TransactionExtra.h"
 
@@ -289,21 +290,20 @@ namespace CryptoNote
       for (unsigned i = 0; i < nthreads; ++i) {
         threads[i] = std::async(std::launch::async, [&, i]() {
           Crypto::cn_context localctx;
-          Crypto::Hash h;
-
-          Block lb(bl); // copy to local block
-
-          for (uint32_t nonce = startNonce + i; !found; nonce += nthreads) {
-            lb.nonce = nonce;
-
-            if (!get_block_longhash(localctx, lb, h)) {
-              return;
-            }
+          Crypto::Hash h[BlockHashingBatch::SIZE];
+          BlockHashingBatch batch;
+          if (!batch.setBlock(bl)) {
+            return;
+          }
 
-            if (check_hash(h, diffic)) {
-              foundNonce = nonce;
-              found = true;
-              return;
+          for (uint32_t nonce = startNonce + i; !found; nonce += nthreads * BlockHashingBatch::SIZE) {
+            batch.hash(localctx, nonce, nthreads, h);
+            for (size_t j = 0; j < BlockHashingBatch::SIZE; ++j) {
+              if (check_hash(h[j], diffic)) {
+                foundNonce = nonce + static_cast<uint32_t>(j) * nthreads;
+                found = true;
+                return;
+              }
             }
           }
         });
@@ -319,14 +319,19 @@ namespace CryptoNote
 
       return found;
     } else {
-      for (; bl.nonce != std::numeric_limits<uint32_t>::max(); bl.nonce++) {
-        Crypto::Hash h;
-        if (!get_block_longhash(context, bl, h)) {
-          return false;
-        }
+      Crypto::Hash h[BlockHashingBatch::SIZE];
+      BlockHashingBatch batch;
+      if (!batch.setBlock(bl)) {
+        return false;
+      }
 
-        if (check_hash(h, diffic)) {
-          return true;
+      for (; std::numeric_limits<uint32_t>::max() - bl.nonce >= BlockHashingBatch::SIZE; bl.nonce += BlockHashingBatch::SIZE) {
+        batch.hash(context, bl.nonce, 1, h);
+        for (size_t j = 0; j < BlockHashingBatch::SIZE; ++j) {
+          if (check_hash(h[j], diffic)) {
+            bl.nonce += static_cast<uint32_t>(j);
+            return true;
+          }
         }
       }
     }
@@ -370,6 +375,7 @@ namespace CryptoNote
     uint32_t local_template_ver = 0;
     Crypto::cn_context context;
     Block b;
+    BlockHashingBatch batch;
 
     while(!m_stop)
     {
@@ -387,6 +393,11 @@ namespace CryptoNote
 
         local_template_ver = m_template_no;
         nonce = m_starter_nonce + th_local_index;
+        if (local_template_ver && !batch.setBlock(b)) {
+          logger(ERROR) << "Failed to get block hashing blob";
+          m_stop = true;
+          break;
+        }
       }
 
       if(!local_template_ver)//no any set_block_template call
@@ -396,30 +407,29 @@ namespace CryptoNote
         continue;
       }
 
-      b.nonce = nonce;
-      Crypto::Hash h;
-      if (!m_stop && !get_block_longhash(context, b, h)) {
-        logger(ERROR) << "Failed to get block long hash";
-        m_stop = true;
-      }
-
-      if (!m_stop && check_hash(h, local_diff))
-      {
-        //we lucky!
-        ++m_config.current_extra_message_index;
-
-        logger(INFO, BRIGHT_YELLOW) << "Fuego block found at difficulty of: " << local_diff;  // add block height to message
-
-        if(!m_handler.handle_block_found(b)) {
-          --m_config.current_extra_message_index;
-        } else {
-          //success update, lets update config
-          Common::saveStringToFile(m_config_folder_path + "/" + CryptoNote::parameters::MINER_CONFIG_FILE_NAME, storeToJson(m_config));
+      uint32_t step = m_threads_total;
+      Crypto::Hash h[BlockHashingBatch::SIZE];
+      batch.hash(context, nonce, step, h);
+      for (size_t i = 0; i < BlockHashingBatch::SIZE && !m_stop; ++i) {
+        if (check_hash(h[i], local_diff))
+        {
+          //we lucky!
+          ++m_config.current_extra_message_index;
+
+          logger(INFO, BRIGHT_YELLOW) << "Fuego block found at difficulty of: " << local_diff;  // add block height to message
+
+          b.nonce = nonce + static_cast<uint32_t>(i) * step;
+          if(!m_handler.handle_block_found(b)) {
+            --m_config.current_extra_message_index;
+          } else {
+            //success update, lets update config
+            Common::saveStringToFile(m_config_folder_path + "/" + CryptoNote::parameters::MINER_CONFIG_FILE_NAME, storeToJson(m_config));
+          }
         }
       }
 
-      nonce += m_threads_total;
-      ++m_hashes;
+      nonce += step * BlockHashingBatch::SIZE;
+      m_hashes += BlockHashingBatch::SIZE;
     }
     logger(INFO) << "Miner thread stopped ["<< th_local_index << "]";
     return true;
@@ -0,0 +1,152 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "OutputIndex.h"
+
+#include <cassert>
+
+#include <boost/filesystem.hpp>
+
+namespace CryptoNote {
+
+OutputIndex::OutputIndex() : m_unlockedEnd(0), m_unlockedBlockCount(0) {
+}
+
+void OutputIndex::open(const std::string& path) {
+  try {
+    m_entries.open(path, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE);
+  } catch (std::exception&) {
+    boost::system::error_code ignore;
+    boost::filesystem::remove(path, ignore);
+    m_entries.open(path, Common::FileMappedVectorOpenMode::CREATE);
+  }
+
+  // entries are written back by flush(), a stale tail is cut off on load
+  m_entries.setAutoFlush(false);
+  m_amounts.clear();
+  m_unlockedEnd = 0;
+  m_unlockedBlockCount = 0;
+}
+
+void OutputIndex::flush() {
+  m_entries.flush();
+}
+
+void OutputIndex::clear() {
+  m_entries.clear();
+  m_amounts.clear();
+  m_unlockedEnd = 0;
+  m_unlockedBlockCount = 0;
+}
+
+bool OutputIndex::load(uint64_t count) {
+  m_amounts.clear();
+  m_unlockedEnd = 0;
+  m_unlockedBlockCount = 0;
+  if (m_entries.size() < count) {
+    m_entries.clear();
+    return false;
+  }
+
+  while (m_entries.size() > count) {
+    m_entries.pop_back();
+  }
+
+  for (uint64_t i = 0; i < count; ++i) {
+    m_amounts[m_entries[i].amount].positions.push_back(static_cast<uint32_t>(i));
+  }
+
+  return true;
+}
+
+uint64_t OutputIndex::size() const {
+  return m_entries.size();
+}
+
+uint32_t OutputIndex::push(const Entry& entry) {
+  auto& amountOutputs = m_amounts[entry.amount];
+  amountOutputs.positions.push_back(static_cast<uint32_t>(m_entries.size()));
+  if (m_unlockedEnd == m_entries.size() && entry.block < m_unlockedBlockCount) {
+    ++m_unlockedEnd;
+    ++amountOutputs.unlockedCount;
+  }
+
+  m_entries.push_back(entry);
+  return static_cast<uint32_t>(amountOutputs.positions.size() - 1);
+}
+
+void OutputIndex::pop() {
+  assert(!m_entries.empty());
+  auto it = m_amounts.find(m_entries.back().amount);
+  assert(it != m_amounts.end() && it->second.positions.back() == m_entries.size() - 1);
+  if (m_unlockedEnd == m_entries.size()) {
+    --m_unlockedEnd;
+    --it->second.unlockedCount;
+  }
+
+  it->second.positions.pop_back();
+  if (it->second.positions.empty()) {
+    m_amounts.erase(it);
+  }
+
+  m_entries.pop_back();
+}
+
+const OutputIndex::Entry* OutputIndex::back() const {
+  return m_entries.empty() ? nullptr : &m_entries.back();
+}
+
+void OutputIndex::setUnlockedBlockCount(uint32_t blockCount) {
+  m_unlockedBlockCount = blockCount;
+  while (m_unlockedEnd < m_entries.size() && m_entries[m_unlockedEnd].block < blockCount) {
+    ++m_amounts[m_entries[m_unlockedEnd].amount].unlockedCount;
+    ++m_unlockedEnd;
+  }
+
+  while (m_unlockedEnd > 0 && m_entries[m_unlockedEnd - 1].block >= blockCount) {
+    --m_unlockedEnd;
+    --m_amounts[m_entries[m_unlockedEnd].amount].unlockedCount;
+  }
+}
+
+size_t OutputIndex::outputCount(uint64_t amount) const {
+  auto it = m_amounts.find(amount);
+  return it == m_amounts.end() ? 0 : it->second.positions.size();
+}
+
+size_t OutputIndex::unlockedOutputCount(uint64_t amount) const {
+  auto it = m_amounts.find(amount);
+  return it == m_amounts.end() ? 0 : it->second.unlockedCount;
+}
+
+const OutputIndex::Entry& OutputIndex::get(uint64_t amount, size_t globalIndex) const {
+  auto it = m_amounts.find(amount);
+  assert(it != m_amounts.end() && globalIndex < it->second.positions.size());
+  return m_entries[it->second.positions[globalIndex]];
+}
+
+std::vector<uint64_t> OutputIndex::amounts() const {
+  std::vector<uint64_t> amounts;
+  amounts.reserve(m_amounts.size());
+  for (const auto& amountOutputs : m_amounts) {
+    amounts.push_back(amountOutputs.first);
+  }
+
+  return amounts;
+}
+
+}
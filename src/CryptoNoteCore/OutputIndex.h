@@ -0,0 +1,92 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "Common/FileMappedVector.h"
+#include "crypto/crypto.h"
+
+namespace CryptoNote {
+
+// Key outputs of the main chain by amount and global index, with everything a ring member lookup needs, so that
+// checking an input or picking mixins doesn't load the transactions that created the outputs.
+//
+// The entries are appended to a memory mapped file in chain order. For every amount a dense array maps the global
+// index to the position of the entry in the file; the arrays are not stored, load rebuilds them from the file.
+// The file is flushed by flush() only, a stored count tells load how many entries belong to the chain.
+//
+// Outputs of the first setUnlockedBlockCount() blocks are unlocked, each array keeps the length of its unlocked prefix
+// so that picking mixins doesn't have to search for it.
+class OutputIndex {
+public:
+  struct Entry {
+    Crypto::PublicKey key;
+    uint64_t amount;
+    uint64_t unlockTime;
+    uint32_t block;
+    uint16_t transaction;
+    uint16_t output;
+  };
+
+  OutputIndex();
+
+  // Opens the file, creating it anew if it is missing or unreadable. Throws if that fails too.
+  void open(const std::string& path);
+  void flush();
+  void clear();
+
+  // Keeps the first count entries and rebuilds the arrays. False if fewer entries are stored, the index is then empty.
+  bool load(uint64_t count);
+  uint64_t size() const;
+
+  // Appends the output and returns its global index for the amount.
+  uint32_t push(const Entry& entry);
+  // Removes the last entry, which must be the last output of its amount.
+  void pop();
+  // Last stored entry, null if the index is empty.
+  const Entry* back() const;
+
+  // Moves the unlocked boundary, the cost is the number of outputs crossing it.
+  void setUnlockedBlockCount(uint32_t blockCount);
+
+  size_t outputCount(uint64_t amount) const;
+  // Global indexes below it belong to outputs of unlocked blocks.
+  size_t unlockedOutputCount(uint64_t amount) const;
+  // globalIndex must be less than outputCount(amount).
+  const Entry& get(uint64_t amount, size_t globalIndex) const;
+  std::vector<uint64_t> amounts() const;
+
+private:
+  struct AmountOutputs {
+    std::vector<uint32_t> positions;
+    size_t unlockedCount = 0;
+  };
+
+  Common::FileMappedVector<Entry> m_entries;
+  phmap::parallel_flat_hash_map<uint64_t, AmountOutputs> m_amounts;
+  uint64_t m_unlockedEnd;
+  uint32_t m_unlockedBlockCount;
+};
+
+}
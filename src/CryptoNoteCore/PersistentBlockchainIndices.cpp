@@ -0,0 +1,455 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "PersistentBlockchainIndices.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <boost/filesystem.hpp>
+
+#include "BlockchainExplorer/BlockchainExplorerDataBuilder.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+
+namespace CryptoNote {
+
+namespace {
+
+// the log is merged into the run once it holds this many entries and an eighth of the run
+const uint64_t MIN_LOG_SIZE_TO_MERGE = 4096;
+const uint64_t RUN_TO_LOG_RATIO = 8;
+
+bool keyLess(uint64_t left, uint64_t right) {
+  return left < right;
+}
+
+bool keyLess(const Crypto::Hash& left, const Crypto::Hash& right) {
+  return memcmp(left.data, right.data, sizeof(left.data)) < 0;
+}
+
+}
+
+template<class Key> bool SortedRunIndex<Key>::KeyLess::operator()(const Key& left, const Key& right) const {
+  return keyLess(left, right);
+}
+
+template<class Key> void SortedRunIndex<Key>::open(const std::string& path) {
+  m_path = path;
+  openFile(m_run, path, sizeof(RunHeader));
+  openFile(m_log, path + ".log", sizeof(LogHeader));
+  m_log.setAutoFlush(false);
+
+  // entries written after the last flush and entries a merge was interrupted before clearing are not used
+  m_runHeight = std::min(runHeader().height, logHeader().blockCount);
+  while (!m_log.empty() && m_log.back().height >= logHeader().blockCount) {
+    m_log.pop_back();
+  }
+
+  if (!m_log.empty() && m_log.front().height < m_runHeight) {
+    m_log.clear();
+  }
+
+  m_logIndex.clear();
+  for (uint64_t i = 0; i < m_log.size(); ++i) {
+    m_logIndex.emplace(m_log[i].key, i);
+  }
+}
+
+template<class Key> void SortedRunIndex<Key>::flush(uint32_t blockCount, const Crypto::Hash& lastBlock) {
+  runHeader().height = m_runHeight;
+  m_run.flush();
+  logHeader().blockCount = blockCount;
+  logHeader().lastBlock = lastBlock;
+  m_log.flush();
+}
+
+template<class Key> void SortedRunIndex<Key>::clear() {
+  m_run.clear();
+  m_runHeight = 0;
+  runHeader().mergedHeight = 0;
+  runHeader().height = 0;
+  m_log.clear();
+  logHeader().blockCount = 0;
+  m_logIndex.clear();
+}
+
+template<class Key> uint32_t SortedRunIndex<Key>::storedBlockCount() const {
+  return logHeader().blockCount;
+}
+
+template<class Key> const Crypto::Hash& SortedRunIndex<Key>::storedLastBlock() const {
+  return logHeader().lastBlock;
+}
+
+template<class Key> void SortedRunIndex<Key>::add(const Key& key, uint32_t height, const Crypto::Hash& value) {
+  // merged when a new block starts, so that the run holds whole blocks
+  if (!m_log.empty() && m_log.back().height < height && m_log.size() >= MIN_LOG_SIZE_TO_MERGE &&
+    m_log.size() * RUN_TO_LOG_RATIO >= m_run.size()) {
+    merge(height);
+  }
+
+  Entry entry;
+  entry.key = key;
+  entry.value = value;
+  entry.height = height;
+  m_logIndex.emplace(key, m_log.size());
+  m_log.push_back(entry);
+}
+
+template<class Key> void SortedRunIndex<Key>::popBlock(uint32_t height) {
+  // the run entries of the block are ignored from now on, the log holds later blocks only
+  m_runHeight = std::min(m_runHeight, height);
+
+  while (!m_log.empty() && m_log.back().height >= height) {
+    auto range = m_logIndex.equal_range(m_log.back().key);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == m_log.size() - 1) {
+        m_logIndex.erase(it);
+        break;
+      }
+    }
+
+    m_log.pop_back();
+  }
+}
+
+template<class Key> void SortedRunIndex<Key>::find(const Key& first, const Key& last, uint64_t limit, std::vector<Crypto::Hash>& values, uint64_t& count) const {
+  KeyLess less;
+  auto runBegin = std::lower_bound(m_run.begin(), m_run.end(), first, [&](const Entry& entry, const Key& key) { return less(entry.key, key); });
+  auto runEnd = std::upper_bound(runBegin, m_run.end(), last, [&](const Key& key, const Entry& entry) { return less(key, entry.key); });
+  auto logBegin = m_logIndex.lower_bound(first);
+  auto logEnd = m_logIndex.upper_bound(last);
+
+  // run entries come first for equal keys, they belong to older blocks
+  count = 0;
+  auto runIter = runBegin;
+  auto logIter = logBegin;
+  for (;;) {
+    while (runIter != runEnd && runIter->height >= m_runHeight) {
+      ++runIter;
+    }
+
+    bool fromRun;
+    if (runIter != runEnd && logIter != logEnd) {
+      fromRun = !less(logIter->first, runIter->key);
+    } else if (runIter != runEnd) {
+      fromRun = true;
+    } else if (logIter != logEnd) {
+      fromRun = false;
+    } else {
+      break;
+    }
+
+    if (count < limit) {
+      values.push_back(fromRun ? runIter->value : m_log[logIter->second].value);
+    } else if (m_runHeight >= runHeader().mergedHeight) {
+      // no ignored entries in the run, the rest is counted without reading it
+      count += static_cast<uint64_t>(std::distance(runIter, runEnd) + std::distance(logIter, logEnd));
+      break;
+    }
+
+    ++count;
+    if (fromRun) {
+      ++runIter;
+    } else {
+      ++logIter;
+    }
+  }
+}
+
+template<class Key> typename SortedRunIndex<Key>::RunHeader& SortedRunIndex<Key>::runHeader() {
+  return *reinterpret_cast<RunHeader*>(m_run.prefix());
+}
+
+template<class Key> const typename SortedRunIndex<Key>::RunHeader& SortedRunIndex<Key>::runHeader() const {
+  return *reinterpret_cast<const RunHeader*>(m_run.prefix());
+}
+
+template<class Key> typename SortedRunIndex<Key>::LogHeader& SortedRunIndex<Key>::logHeader() {
+  return *reinterpret_cast<LogHeader*>(m_log.prefix());
+}
+
+template<class Key> const typename SortedRunIndex<Key>::LogHeader& SortedRunIndex<Key>::logHeader() const {
+  return *reinterpret_cast<const LogHeader*>(m_log.prefix());
+}
+
+template<class Key> void SortedRunIndex<Key>::openFile(Common::FileMappedVector<Entry>& file, const std::string& path, uint64_t prefixSize) {
+  try {
+    file.open(path, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, prefixSize);
+  } catch (std::exception&) {
+    boost::system::error_code ignore;
+    boost::filesystem::remove(path, ignore);
+    file.open(path, Common::FileMappedVectorOpenMode::CREATE, prefixSize);
+  }
+}
+
+template<class Key> void SortedRunIndex<Key>::merge(uint32_t height) {
+  std::string temporaryPath = m_path + ".tmp";
+  Common::FileMappedVector<Entry> run;
+  run.open(temporaryPath, Common::FileMappedVectorOpenMode::CREATE, sizeof(RunHeader));
+  run.setAutoFlush(false);
+  run.reserve(m_run.size() + m_log.size());
+
+  KeyLess less;
+  auto runIter = m_run.begin();
+  auto logIter = m_logIndex.begin();
+  for (;;) {
+    while (runIter != m_run.end() && runIter->height >= m_runHeight) {
+      ++runIter;
+    }
+
+    if (runIter != m_run.end() && (logIter == m_logIndex.end() || !less(logIter->first, runIter->key))) {
+      run.push_back(*runIter);
+      ++runIter;
+    } else if (logIter != m_logIndex.end()) {
+      run.push_back(m_log[logIter->second]);
+      ++logIter;
+    } else {
+      break;
+    }
+  }
+
+  RunHeader* header = reinterpret_cast<RunHeader*>(run.prefix());
+  header->mergedHeight = height;
+  header->height = height;
+  run.flush();
+  run.rename(m_path);
+  m_run.swap(run);
+  run.close();
+
+  m_runHeight = height;
+  m_log.clear();
+  m_logIndex.clear();
+}
+
+template class SortedRunIndex<uint64_t>;
+template class SortedRunIndex<Crypto::Hash>;
+
+void PersistentPaymentIdIndex::open(const std::string& path) {
+  m_index.open(path);
+}
+
+void PersistentPaymentIdIndex::flush(uint32_t blockCount, const Crypto::Hash& lastBlock) {
+  m_index.flush(blockCount, lastBlock);
+}
+
+void PersistentPaymentIdIndex::clear() {
+  m_index.clear();
+}
+
+uint32_t PersistentPaymentIdIndex::storedBlockCount() const {
+  return m_index.storedBlockCount();
+}
+
+const Crypto::Hash& PersistentPaymentIdIndex::storedLastBlock() const {
+  return m_index.storedLastBlock();
+}
+
+bool PersistentPaymentIdIndex::add(const Transaction& transaction, uint32_t height) {
+  Crypto::Hash paymentId;
+  if (!BlockchainExplorerDataBuilder::getPaymentId(transaction, paymentId)) {
+    return false;
+  }
+
+  m_index.add(paymentId, height, getObjectHash(transaction));
+  return true;
+}
+
+void PersistentPaymentIdIndex::popBlock(uint32_t height) {
+  m_index.popBlock(height);
+}
+
+bool PersistentPaymentIdIndex::find(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) const {
+  uint64_t count;
+  m_index.find(paymentId, paymentId, std::numeric_limits<uint64_t>::max(), transactionHashes, count);
+  return count > 0;
+}
+
+void PersistentTimestampBlocksIndex::open(const std::string& path) {
+  m_index.open(path);
+}
+
+void PersistentTimestampBlocksIndex::flush(uint32_t blockCount, const Crypto::Hash& lastBlock) {
+  m_index.flush(blockCount, lastBlock);
+}
+
+void PersistentTimestampBlocksIndex::clear() {
+  m_index.clear();
+}
+
+uint32_t PersistentTimestampBlocksIndex::storedBlockCount() const {
+  return m_index.storedBlockCount();
+}
+
+const Crypto::Hash& PersistentTimestampBlocksIndex::storedLastBlock() const {
+  return m_index.storedLastBlock();
+}
+
+bool PersistentTimestampBlocksIndex::add(uint64_t timestamp, const Crypto::Hash& hash, uint32_t height) {
+  m_index.add(timestamp, height, hash);
+  return true;
+}
+
+void PersistentTimestampBlocksIndex::popBlock(uint32_t height) {
+  m_index.popBlock(height);
+}
+
+bool PersistentTimestampBlocksIndex::find(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t hashesNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& hashesNumberWithinTimestamps) const {
+  if (timestampBegin > timestampEnd) {
+    return false;
+  }
+
+  size_t size = hashes.size();
+  uint64_t count;
+  m_index.find(timestampBegin, timestampEnd, hashesNumberLimit, hashes, count);
+  hashesNumberWithinTimestamps = static_cast<uint32_t>(count);
+  return hashes.size() > size;
+}
+
+void PersistentGeneratedTransactionsIndex::open(const std::string& path) {
+  try {
+    m_counts.open(path, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, sizeof(Header));
+  } catch (std::exception&) {
+    boost::system::error_code ignore;
+    boost::filesystem::remove(path, ignore);
+    m_counts.open(path, Common::FileMappedVectorOpenMode::CREATE, sizeof(Header));
+  }
+
+  m_counts.setAutoFlush(false);
+  uint32_t blockCount = reinterpret_cast<const Header*>(m_counts.prefix())->blockCount;
+  while (m_counts.size() > blockCount) {
+    m_counts.pop_back();
+  }
+}
+
+void PersistentGeneratedTransactionsIndex::flush(uint32_t blockCount, const Crypto::Hash& lastBlock) {
+  Header* header = reinterpret_cast<Header*>(m_counts.prefix());
+  header->blockCount = blockCount;
+  header->lastBlock = lastBlock;
+  m_counts.flush();
+}
+
+void PersistentGeneratedTransactionsIndex::clear() {
+  m_counts.clear();
+  reinterpret_cast<Header*>(m_counts.prefix())->blockCount = 0;
+}
+
+uint32_t PersistentGeneratedTransactionsIndex::storedBlockCount() const {
+  // fewer counts than recorded when the file lost its tail, the owner then finds the index doesn't match
+  uint32_t blockCount = reinterpret_cast<const Header*>(m_counts.prefix())->blockCount;
+  return m_counts.size() == blockCount ? blockCount : std::numeric_limits<uint32_t>::max();
+}
+
+const Crypto::Hash& PersistentGeneratedTransactionsIndex::storedLastBlock() const {
+  return reinterpret_cast<const Header*>(m_counts.prefix())->lastBlock;
+}
+
+bool PersistentGeneratedTransactionsIndex::add(const Block& block) {
+  uint32_t blockHeight = boost::get<BaseInput>(block.baseTransaction.inputs.front()).blockIndex;
+  if (m_counts.size() != blockHeight) {
+    return false;
+  }
+
+  uint64_t lastGeneratedTxNumber = m_counts.empty() ? 0 : m_counts.back();
+  m_counts.push_back(lastGeneratedTxNumber + block.transactionHashes.size() + 1); //Plus miner tx
+  return true;
+}
+
+bool PersistentGeneratedTransactionsIndex::remove(const Block& block) {
+  uint32_t blockHeight = boost::get<BaseInput>(block.baseTransaction.inputs.front()).blockIndex;
+  if (m_counts.empty() || blockHeight != m_counts.size() - 1) {
+    return false;
+  }
+
+  m_counts.pop_back();
+  return true;
+}
+
+bool PersistentGeneratedTransactionsIndex::find(uint32_t height, uint64_t& generatedTransactions) const {
+  if (height >= m_counts.size()) {
+    return false;
+  }
+
+  generatedTransactions = m_counts[height];
+  return true;
+}
+
+void PersistentBlockSummaries::open(const std::string& path) {
+  try {
+    m_summaries.open(path, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, sizeof(Header));
+  } catch (std::exception&) {
+    boost::system::error_code ignore;
+    boost::filesystem::remove(path, ignore);
+    m_summaries.open(path, Common::FileMappedVectorOpenMode::CREATE, sizeof(Header));
+  }
+
+  m_summaries.setAutoFlush(false);
+  uint32_t blockCount = reinterpret_cast<const Header*>(m_summaries.prefix())->blockCount;
+  while (m_summaries.size() > blockCount) {
+    m_summaries.pop_back();
+  }
+}
+
+void PersistentBlockSummaries::flush(uint32_t blockCount, const Crypto::Hash& lastBlock) {
+  Header* header = reinterpret_cast<Header*>(m_summaries.prefix());
+  header->blockCount = blockCount;
+  header->lastBlock = lastBlock;
+  m_summaries.flush();
+}
+
+void PersistentBlockSummaries::clear() {
+  m_summaries.clear();
+  reinterpret_cast<Header*>(m_summaries.prefix())->blockCount = 0;
+}
+
+uint32_t PersistentBlockSummaries::storedBlockCount() const {
+  uint32_t blockCount = reinterpret_cast<const Header*>(m_summaries.prefix())->blockCount;
+  return m_summaries.size() == blockCount ? blockCount : std::numeric_limits<uint32_t>::max();
+}
+
+const Crypto::Hash& PersistentBlockSummaries::storedLastBlock() const {
+  return reinterpret_cast<const Header*>(m_summaries.prefix())->lastBlock;
+}
+
+uint32_t PersistentBlockSummaries::size() const {
+  return static_cast<uint32_t>(m_summaries.size());
+}
+
+const BlockSummary& PersistentBlockSummaries::operator[](uint32_t height) const {
+  return m_summaries[height];
+}
+
+void PersistentBlockSummaries::push(const BlockSummary& summary) {
+  m_summaries.push_back(summary);
+}
+
+void PersistentBlockSummaries::pop() {
+  m_summaries.pop_back();
+}
+
+void PersistentBlockSummaries::get(uint32_t startHeight, uint32_t count, std::vector<BlockSummary>& summaries) const {
+  if (startHeight >= m_summaries.size()) {
+    return;
+  }
+
+  uint64_t endHeight = std::min<uint64_t>(m_summaries.size(), static_cast<uint64_t>(startHeight) + count);
+  const BlockSummary* first = &m_summaries[startHeight];
+  summaries.insert(summaries.end(), first, first + (endHeight - startHeight));
+}
+
+}
@@ -0,0 +1,200 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Common/FileMappedVector.h"
+#include "CryptoNote.h"
+#include "CryptoNoteCore/Difficulty.h"
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+// Explorer indices of the main chain that live in memory mapped files and are updated block by block, so that a node
+// doesn't load or rebuild them at startup.
+//
+// Every index records the block count and the last block it was flushed at. The owner checks them against the chain
+// after open() and adds the blocks that are missing; an index that doesn't match the chain is cleared.
+
+// Values of the main chain by key, for keys that don't follow the chain order.
+//
+// Entries of older blocks are in a run file sorted by key. Entries of the latest blocks are appended to a log file in
+// chain order and kept sorted in memory. Once the log grows past a fraction of the run, both are merged into a new run
+// file, so that the log and the time open() takes to sort it stay small.
+//
+// The run covers the blocks below its height, its entries of higher blocks are ignored. A block popped from the run
+// only lowers that height, the entries are dropped by the next merge. Blocks are popped as a whole, so that the height
+// is lowered for blocks without entries as well.
+template<class Key> class SortedRunIndex {
+public:
+  struct Entry {
+    Key key;
+    Crypto::Hash value;
+    uint32_t height;
+  };
+
+  SortedRunIndex() : m_runHeight(0) {
+  }
+
+  // Opens or creates the files, throws if that fails.
+  void open(const std::string& path);
+  void flush(uint32_t blockCount, const Crypto::Hash& lastBlock);
+  void clear();
+
+  uint32_t storedBlockCount() const;
+  const Crypto::Hash& storedLastBlock() const;
+
+  // Entries are added block by block, in chain order.
+  void add(const Key& key, uint32_t height, const Crypto::Hash& value);
+  // Removes the entries of the last block, height.
+  void popBlock(uint32_t height);
+
+  // Values with keys in [first, last] in key order, and blocks in chain order for equal keys.
+  void find(const Key& first, const Key& last, uint64_t limit, std::vector<Crypto::Hash>& values, uint64_t& count) const;
+
+private:
+  struct KeyLess {
+    bool operator()(const Key& left, const Key& right) const;
+  };
+
+  struct RunHeader {
+    // blocks of the run when it was written and blocks it still covers
+    uint32_t mergedHeight;
+    uint32_t height;
+  };
+
+  struct LogHeader {
+    uint32_t blockCount;
+    Crypto::Hash lastBlock;
+  };
+
+  std::string m_path;
+  Common::FileMappedVector<Entry> m_run;
+  Common::FileMappedVector<Entry> m_log;
+  // positions of the log entries
+  std::multimap<Key, uint64_t, KeyLess> m_logIndex;
+  uint32_t m_runHeight;
+
+  RunHeader& runHeader();
+  const RunHeader& runHeader() const;
+  LogHeader& logHeader();
+  const LogHeader& logHeader() const;
+  void openFile(Common::FileMappedVector<Entry>& file, const std::string& path, uint64_t prefixSize);
+  void merge(uint32_t height);
+};
+
+class PersistentPaymentIdIndex {
+public:
+  void open(const std::string& path);
+  void flush(uint32_t blockCount, const Crypto::Hash& lastBlock);
+  void clear();
+  uint32_t storedBlockCount() const;
+  const Crypto::Hash& storedLastBlock() const;
+
+  bool add(const Transaction& transaction, uint32_t height);
+  void popBlock(uint32_t height);
+  bool find(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) const;
+
+private:
+  SortedRunIndex<Crypto::Hash> m_index;
+};
+
+class PersistentTimestampBlocksIndex {
+public:
+  void open(const std::string& path);
+  void flush(uint32_t blockCount, const Crypto::Hash& lastBlock);
+  void clear();
+  uint32_t storedBlockCount() const;
+  const Crypto::Hash& storedLastBlock() const;
+
+  bool add(uint64_t timestamp, const Crypto::Hash& hash, uint32_t height);
+  void popBlock(uint32_t height);
+  bool find(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t hashesNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& hashesNumberWithinTimestamps) const;
+
+private:
+  SortedRunIndex<uint64_t> m_index;
+};
+
+// Generated transaction counts by height, which the chain order keeps sorted.
+class PersistentGeneratedTransactionsIndex {
+public:
+  void open(const std::string& path);
+  void flush(uint32_t blockCount, const Crypto::Hash& lastBlock);
+  void clear();
+  uint32_t storedBlockCount() const;
+  const Crypto::Hash& storedLastBlock() const;
+
+  bool add(const Block& block);
+  bool remove(const Block& block);
+  bool find(uint32_t height, uint64_t& generatedTransactions) const;
+
+private:
+  struct Header {
+    uint32_t blockCount;
+    Crypto::Hash lastBlock;
+  };
+
+  Common::FileMappedVector<uint64_t> m_counts;
+};
+
+// Header values of a main chain block, as listed by explorers.
+struct BlockSummary {
+  Crypto::Hash hash;
+  uint64_t timestamp;
+  difficulty_type difficulty;
+  difficulty_type cumulativeDifficulty;
+  // block blob plus the transactions, the miner transaction counted once
+  uint64_t size;
+  uint64_t reward;
+  uint64_t alreadyGeneratedCoins;
+  uint32_t transactionCount;
+  uint8_t majorVersion;
+  uint8_t minorVersion;
+};
+
+// Summaries of the main chain by height, so that a range of blocks is listed without deserializing them.
+class PersistentBlockSummaries {
+public:
+  void open(const std::string& path);
+  void flush(uint32_t blockCount, const Crypto::Hash& lastBlock);
+  void clear();
+  uint32_t storedBlockCount() const;
+  const Crypto::Hash& storedLastBlock() const;
+
+  uint32_t size() const;
+  const BlockSummary& operator[](uint32_t height) const;
+  void push(const BlockSummary& summary);
+  void pop();
+
+  // Summaries of blocks [startHeight, startHeight + count) that exist.
+  void get(uint32_t startHeight, uint32_t count, std::vector<BlockSummary>& summaries) const;
+
+private:
+  struct Header {
+    uint32_t blockCount;
+    Crypto::Hash lastBlock;
+  };
+
+  Common::FileMappedVector<BlockSummary> m_summaries;
+};
+
+}
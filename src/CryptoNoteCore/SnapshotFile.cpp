@@ -0,0 +1,201 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "SnapshotFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <System/MemoryMappedFile.h>
+
+#include "Common/ThreadPool.h"
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+namespace {
+
+const uint64_t SNAPSHOT_MAGIC = 0x50414e53475546ULL; // "FUGSNAP"
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct FileHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t chunkCount;
+};
+
+struct ChunkHeader {
+  uint64_t size;
+  uint64_t storedSize;
+  uint64_t compressed;
+  Crypto::Hash checksum;
+};
+
+BinaryArray compressChunk(const BinaryArray& chunk) {
+  BinaryArray result;
+#ifdef HAVE_ZLIB
+  uLongf size = compressBound(static_cast<uLong>(chunk.size()));
+  result.resize(size);
+  if (compress2(result.data(), &size, chunk.data(), static_cast<uLong>(chunk.size()), Z_BEST_SPEED) != Z_OK) {
+    throw std::runtime_error("failed to compress snapshot chunk");
+  }
+
+  result.resize(size);
+#endif
+  return result;
+}
+
+BinaryArray uncompressChunk(const uint8_t* data, const ChunkHeader& header) {
+#ifdef HAVE_ZLIB
+  BinaryArray result(header.size);
+  uLongf size = static_cast<uLongf>(header.size);
+  if (uncompress(result.data(), &size, data, static_cast<uLong>(header.storedSize)) != Z_OK || size != header.size) {
+    throw std::runtime_error("failed to uncompress snapshot chunk");
+  }
+
+  return result;
+#else
+  throw std::runtime_error("snapshot is compressed, but this build has no zlib support");
+#endif
+}
+
+}
+
+void storeSnapshot(const std::string& path, const std::vector<BinaryArray>& chunks, bool compress) {
+  compress = compress && snapshotCompressionSupported();
+
+  std::vector<BinaryArray> compressedChunks(chunks.size());
+  std::vector<ChunkHeader> headers(chunks.size());
+  uint64_t fileSize = sizeof(FileHeader) + sizeof(ChunkHeader) * chunks.size();
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (compress) {
+      compressedChunks[i] = compressChunk(chunks[i]);
+    }
+
+    // chunks that don't shrink are stored as they are
+    bool compressed = compress && compressedChunks[i].size() < chunks[i].size();
+    const BinaryArray& stored = compressed ? compressedChunks[i] : chunks[i];
+    headers[i].size = chunks[i].size();
+    headers[i].storedSize = stored.size();
+    headers[i].compressed = compressed ? 1 : 0;
+    Crypto::cn_fast_hash(stored.data(), stored.size(), headers[i].checksum);
+    fileSize += stored.size();
+  }
+
+  std::string temporaryPath = path + ".tmp";
+  System::MemoryMappedFile file;
+  try {
+    file.create(temporaryPath, fileSize, true);
+
+    uint8_t* data = file.data();
+    FileHeader fileHeader = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION, static_cast<uint32_t>(chunks.size()) };
+    memcpy(data, &fileHeader, sizeof(fileHeader));
+    data += sizeof(fileHeader);
+    if (!headers.empty()) {
+      memcpy(data, headers.data(), sizeof(ChunkHeader) * headers.size());
+      data += sizeof(ChunkHeader) * headers.size();
+    }
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      const BinaryArray& stored = headers[i].compressed != 0 ? compressedChunks[i] : chunks[i];
+      if (!stored.empty()) {
+        memcpy(data, stored.data(), stored.size());
+        data += stored.size();
+      }
+    }
+
+    file.flush(file.data(), file.size());
+    file.rename(path);
+    file.close();
+  } catch (std::exception&) {
+    std::error_code ignore;
+    file.close(ignore);
+    std::remove(temporaryPath.c_str());
+    throw;
+  }
+}
+
+std::vector<BinaryArray> loadSnapshot(const std::string& path) {
+  System::MemoryMappedFile file;
+  file.open(path);
+
+  FileHeader fileHeader;
+  if (file.size() < sizeof(fileHeader)) {
+    throw std::runtime_error("snapshot is truncated");
+  }
+
+  memcpy(&fileHeader, file.data(), sizeof(fileHeader));
+  if (fileHeader.magic != SNAPSHOT_MAGIC || fileHeader.version != SNAPSHOT_VERSION) {
+    throw std::runtime_error("not a snapshot or unsupported snapshot version");
+  }
+
+  uint64_t offset = sizeof(fileHeader) + sizeof(ChunkHeader) * static_cast<uint64_t>(fileHeader.chunkCount);
+  if (file.size() < offset) {
+    throw std::runtime_error("snapshot is truncated");
+  }
+
+  std::vector<ChunkHeader> headers(fileHeader.chunkCount);
+  std::vector<uint64_t> offsets(fileHeader.chunkCount);
+  if (!headers.empty()) {
+    memcpy(headers.data(), file.data() + sizeof(fileHeader), sizeof(ChunkHeader) * headers.size());
+  }
+
+  for (size_t i = 0; i < headers.size(); ++i) {
+    if (headers[i].storedSize > file.size() - offset) {
+      throw std::runtime_error("snapshot is truncated");
+    }
+
+    offsets[i] = offset;
+    offset += headers[i].storedSize;
+  }
+
+  std::vector<BinaryArray> chunks(headers.size());
+  Tools::ThreadPool pool(std::min<size_t>(headers.size(), std::max(1u, std::thread::hardware_concurrency())));
+  pool.parallelFor(headers.size(), [&](size_t i, size_t) {
+    const uint8_t* data = file.data() + offsets[i];
+    Crypto::Hash checksum;
+    Crypto::cn_fast_hash(data, headers[i].storedSize, checksum);
+    if (checksum != headers[i].checksum) {
+      throw std::runtime_error("snapshot checksum mismatch");
+    }
+
+    if (headers[i].compressed != 0) {
+      chunks[i] = uncompressChunk(data, headers[i]);
+    } else {
+      chunks[i].assign(data, data + headers[i].storedSize);
+    }
+  });
+
+  return chunks;
+}
+
+bool snapshotCompressionSupported() {
+#ifdef HAVE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+}
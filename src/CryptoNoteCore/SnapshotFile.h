@@ -0,0 +1,40 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "CryptoNote.h"
+
+namespace CryptoNote {
+
+// Snapshot files hold a list of chunks, each with its own checksum and, in builds with zlib, compressed on its own so
+// that they can be checked and unpacked in parallel.
+//
+// A snapshot is written to a temporary file that replaces the old one only once it is complete and synced, a crash
+// while saving leaves the previous snapshot in place.
+
+// Throws if the file can't be written.
+void storeSnapshot(const std::string& path, const std::vector<BinaryArray>& chunks, bool compress);
+// Throws if the file is missing or damaged, or uses compression this build doesn't support.
+std::vector<BinaryArray> loadSnapshot(const std::string& path);
+
+bool snapshotCompressionSupported();
+
+}
@@ -238,6 +238,31 @@ namespace CryptoNote
     return true;
   }
 
+  bool getExtraNonceOffset(const std::vector<uint8_t> &tx_extra, size_t &offset)
+  {
+    size_t pos = 0;
+    while (pos < tx_extra.size())
+    {
+      switch (tx_extra[pos])
+      {
+      case TX_EXTRA_TAG_PUBKEY:
+        pos += 1 + sizeof(PublicKey);
+        break;
+      case TX_EXTRA_NONCE:
+        if (pos + 2 > tx_extra.size() || pos + 2 + tx_extra[pos + 1] > tx_extra.size())
+        {
+          return false;
+        }
+        offset = pos + 2;
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    return false;
+  }
+
   bool appendMergeMiningTagToExtra(std::vector<uint8_t> &tx_extra, const TransactionExtraMergeMiningTag &mm_tag)
   {
     BinaryArray blob;
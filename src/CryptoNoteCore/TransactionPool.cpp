@@ -126,7 +126,9 @@ namespace CryptoNote
                                m_timeProvider(timeProvider),
                                m_txCheckInterval(60, timeProvider),
                                m_fee_index(boost::get<1>(m_transactions)),
-                               logger(log, "txpool")
+                               logger(log, "txpool"),
+                               m_version(0),
+                               m_chainVersion(1)
   {
   }
 
@@ -270,6 +272,11 @@ namespace CryptoNote
       }
       m_paymentIdIndex.add(txd.tx);
       m_timestampIndex.add(txd.receiveTime, txd.id);
+      ++m_version;
+      if (m_blockTemplate.valid)
+      {
+        m_blockTemplate.addedTransactions.push_back(id);
+      }
 
       if (ttl.ttl != 0)
       {
@@ -390,11 +397,13 @@ namespace CryptoNote
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash &top_block_id)
   {
+    ++m_chainVersion;
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash &top_block_id)
   {
+    ++m_chainVersion;
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -473,20 +482,49 @@ namespace CryptoNote
     return ss.str();
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::fill_block_template(
-      Block &bl,
-      size_t median_size,
-      size_t maxCumulativeSize,
-      uint64_t already_generated_coins,
-      size_t &total_size,
-      uint64_t &fee,
-      uint32_t &height)
+  bool tx_memory_pool::canIncludeInTemplate(const TransactionDetails &txd, uint64_t chainVersion, uint32_t height) const
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
-    total_size = 0;
-    fee = 0;
-    size_t max_total_size = (125 * median_size) / 100 - m_currency.minerTxBlobReservedSize();
-    max_total_size = std::min(max_total_size, maxCumulativeSize);
+    TemplateCheck &check = txd.templateCheck;
+    if (check.chainVersion == chainVersion && check.height == height)
+    {
+      return check.canInclude;
+    }
+
+    check.chainVersion = chainVersion;
+    check.height = height;
+    check.canInclude = false;
+
+    if (m_ttlIndex.count(txd.id) > 0)
+    {
+      return false;
+    }
+
+    uint64_t inputs_amount = m_currency.getTransactionAllInputsAmount(txd.tx, height);
+    uint64_t outputs_amount = get_outs_money_amount(txd.tx);
+
+    if (outputs_amount > inputs_amount)
+    {
+      logger(WARNING, BRIGHT_YELLOW) << "Transaction, with id " << txd.id << " uses more money than it has: uses " << m_currency.formatAmount(outputs_amount) << ", has " << m_currency.formatAmount(inputs_amount)
+                                     << " and will not be included in the block template";
+      return false;
+    }
+
+    TransactionCheckInfo checkInfo(txd);
+    check.canInclude = is_transaction_ready_to_go(txd.tx, checkInfo);
+    return check.canInclude;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::buildBlockTemplate(uint64_t chainVersion, uint32_t height, size_t medianSize, size_t maxTotalSize)
+  {
+    CachedBlockTemplate &cached = m_blockTemplate;
+    cached.valid = true;
+    cached.chainVersion = chainVersion;
+    cached.height = height;
+    cached.medianSize = medianSize;
+    cached.maxTotalSize = maxTotalSize;
+    cached.totalSize = 0;
+    cached.fee = 0;
+    cached.addedTransactions.clear();
 
     BlockTemplate blockTemplate;
 
@@ -494,43 +532,70 @@ namespace CryptoNote
     {
       const auto &txd = *it;
 
-      if (m_ttlIndex.count(txd.id) > 0)
+      size_t blockSizeLimit = (txd.fee == 0) ? medianSize : maxTotalSize;
+      if (blockSizeLimit < cached.totalSize + txd.blobSize)
       {
         continue;
       }
 
-      uint64_t inputs_amount = m_currency.getTransactionAllInputsAmount(txd.tx, height);
-      uint64_t outputs_amount = get_outs_money_amount(txd.tx);
-
-      if (outputs_amount > inputs_amount)
+      if (canIncludeInTemplate(txd, chainVersion, height) && blockTemplate.addTransaction(txd.id, txd.tx))
       {
-        logger(WARNING, BRIGHT_YELLOW) << "Transaction, with id " << txd.id << " uses more money than it has: uses " << m_currency.formatAmount(outputs_amount) << ", has " << m_currency.formatAmount(inputs_amount)
-                                       << " and will not be included in the block template";
-        continue;
+        cached.totalSize += txd.blobSize;
+        cached.fee += txd.fee;
       }
+    }
 
-      size_t blockSizeLimit = (txd.fee == 0) ? median_size : max_total_size;
-      if (blockSizeLimit < total_size + txd.blobSize)
-      {
-        continue;
-      }
+    cached.transactions = blockTemplate.getTransactions();
+    // one line per template, a message per transaction costs more than the selection on a large pool
+    logger(DEBUGGING) << "Block template built: " << cached.transactions.size() << " of " << m_transactions.size() << " transactions included";
+    cached.transactionSet.clear();
+    cached.transactionSet.insert(cached.transactions.begin(), cached.transactions.end());
+  }
+  //---------------------------------------------------------------------------------
+  bool tx_memory_pool::fill_block_template(
+      Block &bl,
+      size_t median_size,
+      size_t maxCumulativeSize,
+      uint64_t already_generated_coins,
+      size_t &total_size,
+      uint64_t &fee,
+      uint32_t &height)
+  {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    size_t max_total_size = (125 * median_size) / 100 - m_currency.minerTxBlobReservedSize();
+    max_total_size = std::min(max_total_size, maxCumulativeSize);
 
-      TransactionCheckInfo checkInfo(txd);
-      bool ready = is_transaction_ready_to_go(txd.tx, checkInfo);
+    uint64_t chainVersion = m_chainVersion;
+    CachedBlockTemplate &cached = m_blockTemplate;
+    bool reuse = cached.valid && cached.chainVersion == chainVersion && cached.height == height &&
+                 cached.medianSize == median_size && cached.maxTotalSize == max_total_size;
 
-      if (ready && blockTemplate.addTransaction(txd.id, txd.tx))
-      {
-        total_size += txd.blobSize;
-        fee += txd.fee;
-        logger(DEBUGGING) << "Transaction " << txd.id << " included in the block template";
-      }
-      else
+    // a new transaction that cannot be included leaves the greedy selection unchanged
+    if (reuse)
+    {
+      for (const auto &id : cached.addedTransactions)
       {
-        logger(DEBUGGING) << "Transaction " << txd.id << " was not included in the block template";
+        auto it = m_transactions.find(id);
+        if (it != m_transactions.end() && canIncludeInTemplate(*it, chainVersion, height))
+        {
+          reuse = false;
+          break;
+        }
       }
     }
 
-    bl.transactionHashes = blockTemplate.getTransactions();
+    if (reuse)
+    {
+      cached.addedTransactions.clear();
+    }
+    else
+    {
+      buildBlockTemplate(chainVersion, height, median_size, max_total_size);
+    }
+
+    total_size = cached.totalSize;
+    fee = cached.fee;
+    bl.transactionHashes = cached.transactions;
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -623,6 +688,8 @@ namespace CryptoNote
 
     if (s.type() == ISerializer::INPUT)
     {
+      m_blockTemplate.valid = false;
+      ++m_version;
       m_transactions.clear();
       readSequence<TransactionDetails>(std::inserter(m_transactions, m_transactions.end()), "transactions", s);
     }
@@ -704,10 +771,16 @@ namespace CryptoNote
 
   tx_memory_pool::tx_container_t::iterator tx_memory_pool::removeTransaction(tx_memory_pool::tx_container_t::iterator i)
   {
+    if (m_blockTemplate.valid && m_blockTemplate.transactionSet.count(i->id) > 0)
+    {
+      m_blockTemplate.valid = false;
+    }
+
     removeTransactionInputs(i->id, i->tx, i->keptByBlock);
     m_paymentIdIndex.remove(i->tx);
     m_timestampIndex.remove(i->receiveTime, i->id);
     m_ttlIndex.erase(i->id);
+    ++m_version;
     return m_transactions.erase(i);
   }
 
@@ -17,10 +17,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/utility.hpp>
 
@@ -115,6 +117,8 @@ namespace CryptoNote {
     void get_transactions(std::list<Transaction>& txs) const;
     void get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const;
     size_t get_transactions_count() const;
+    // changes whenever a transaction is added to or removed from the pool
+    uint64_t getVersion() const { return m_version; }
     std::string print_pool(bool short_format) const;
     void on_idle();
 
@@ -143,6 +147,13 @@ namespace CryptoNote {
       BlockInfo lastFailedBlock;
     };
 
+    // Whether a transaction may go into a block template, valid for one chain version and template height
+    struct TemplateCheck {
+      uint64_t chainVersion = 0;
+      uint32_t height = 0;
+      bool canInclude = false;
+    };
+
     struct TransactionDetails : public TransactionCheckInfo {
       Crypto::Hash id;
       Transaction tx;
@@ -150,6 +161,8 @@ namespace CryptoNote {
       uint64_t fee;
       bool keptByBlock;
       time_t receiveTime;
+      // not serialized, recomputed after the chain changes
+      mutable TemplateCheck templateCheck;
     };
 
   private:
@@ -195,8 +208,26 @@ namespace CryptoNote {
     tx_container_t::iterator removeTransaction(tx_container_t::iterator i);
     bool removeExpiredTransactions();
     bool is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const;
+    bool canIncludeInTemplate(const TransactionDetails& txd, uint64_t chainVersion, uint32_t height) const;
     void buildIndices();
 
+    // Last result of fill_block_template. Transactions added since are only checked on the next call,
+    // removing a transaction that is not in the template keeps it valid.
+    struct CachedBlockTemplate {
+      bool valid = false;
+      uint64_t chainVersion;
+      uint32_t height;
+      size_t medianSize;
+      size_t maxTotalSize;
+      std::vector<Crypto::Hash> transactions;
+      std::unordered_set<Crypto::Hash> transactionSet;
+      size_t totalSize;
+      uint64_t fee;
+      std::vector<Crypto::Hash> addedTransactions;
+    };
+
+    void buildBlockTemplate(uint64_t chainVersion, uint32_t height, size_t medianSize, size_t maxTotalSize);
+
     Tools::ObserverManager<ITxPoolObserver> m_observerManager;
     const CryptoNote::Currency& m_currency;
     OnceInTimeInterval m_txCheckInterval;
@@ -217,5 +248,10 @@ namespace CryptoNote {
     PaymentIdIndex m_paymentIdIndex;
     TimestampTransactionsIndex m_timestampIndex;
     std::unordered_map<Crypto::Hash, uint64_t> m_ttlIndex;
+
+    std::atomic<uint64_t> m_version;
+    // bumped by on_blockchain_inc/dec without taking m_transactions_lock, the blockchain calls them under its own lock
+    std::atomic<uint64_t> m_chainVersion;
+    CachedBlockTemplate m_blockTemplate;
   };
 }
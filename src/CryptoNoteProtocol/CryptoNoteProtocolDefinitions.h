@@ -14,6 +14,7 @@
 // ISerializer-based serialization
 #include "Serialization/ISerializer.h"
 #include "Serialization/SerializationOverloads.h"
+#include "Serialization/KVBinaryInputStreamSerializer.h"
 #include "CryptoNoteCore/CryptoNoteSerialization.h"
 
 namespace CryptoNote
@@ -30,6 +31,13 @@ namespace CryptoNote
     std::vector<std::string> txs;
 
     void serialize(ISerializer& s) {
+      // the blobs of a received message are read once, so they are taken out of it instead of being copied
+      if (auto kvSerializer = dynamic_cast<KVBinaryInputStreamSerializer*>(&s)) {
+        kvSerializer->takeString(block, "block");
+        kvSerializer->takeStrings(txs, "txs");
+        return;
+      }
+
       KV_MEMBER(block);
       KV_MEMBER(txs);
     }
@@ -431,15 +431,14 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
   for (const block_complete_entry& block_entry : arg.blocks) {
     ++count;
     Block b;
-    BinaryArray block_blob = asBinaryArray(block_entry.block);
-    if (block_blob.size() > m_currency.maxBlockBlobSize()) {
-      logger(Logging::ERROR) << context << "sent wrong block: too big size " << block_blob.size() << ", dropping connection";
+    if (block_entry.block.size() > m_currency.maxBlockBlobSize()) {
+      logger(Logging::ERROR) << context << "sent wrong block: too big size " << block_entry.block.size() << ", dropping connection";
       context.m_state = CryptoNoteConnectionContext::state_shutdown;
       return 1;
     }
-    if (!fromBinaryArray(b, block_blob)) {
+    if (!fromBinaryArray(b, block_entry.block.data(), block_entry.block.size())) {
       logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
-        << toHex(block_blob) << "\r\n dropping connection";
+        << toHex(block_entry.block.data(), block_entry.block.size()) << "\r\n dropping connection";
       context.m_state = CryptoNoteConnectionContext::state_shutdown;
       return 1;
     }
@@ -474,13 +473,14 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
 
     block_hashes.push_back(blockHash);
 
+    // the transactions are passed on as views of arg, which stays untouched until they are processed
     parsed_block_entry parsedBlock;
     parsedBlock.block = std::move(b);
-    for (auto& tx_blob : block_entry.txs) {
-      auto transactionBinary = asBinaryArray(tx_blob);
-      parsedBlock.txs.push_back(transactionBinary);
+    parsedBlock.txs.reserve(block_entry.txs.size());
+    for (const auto& tx_blob : block_entry.txs) {
+      parsedBlock.txs.emplace_back(tx_blob);
     }
-    parsed_blocks.push_back(parsedBlock);
+    parsed_blocks.push_back(std::move(parsedBlock));
   }
 
   if (context.m_requested_objects.size()) {
@@ -509,10 +509,7 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
       if (top == h) {
         logger(DEBUGGING) << "Found current top block in synced blocks, dismissing "
           << dismiss << "/" << arg.blocks.size() << " blocks";
-        while (dismiss--) {
-          arg.blocks.erase(arg.blocks.begin());
-          parsed_blocks.erase(parsed_blocks.begin());
-        }
+        parsed_blocks.erase(parsed_blocks.begin(), parsed_blocks.begin() + dismiss);
         break;
       }
       ++dismiss;
@@ -536,29 +533,34 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
   return 1;
 }
 
-int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& context, const std::vector<parsed_block_entry>& blocks) {
+int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& context, std::vector<parsed_block_entry>& blocks) {
 
-  for (const parsed_block_entry& block_entry : blocks) {
+  // parse and check the transactions of the whole batch on the sync threads, only the chain state
+  // dependent part of the verification is left for the sequential loop below
+  std::vector<PrevalidatedBlock> batch(blocks.size());
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    batch[i].block = std::move(blocks[i].block);
+    batch[i].transactionBlobs = std::move(blocks[i].txs);
+  }
+
+  if (!m_core.prevalidateBlocks(batch)) {
+    logger(DEBUGGING) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  for (const PrevalidatedBlock& block_entry : batch) {
     if (m_stop) {
       break;
     }
 
     //process transactions
-    for (size_t i = 0; i < block_entry.txs.size(); ++i) {
-      auto transactionBinary = block_entry.txs[i];
-      Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
+    for (size_t i = 0; i < block_entry.transactions.size(); ++i) {
+      const Crypto::Hash& transactionHash = block_entry.block.transactionHashes[i];
       logger(DEBUGGING) << "transaction " << transactionHash << " came in processObjects";
 
-      // check if tx hashes match
-      if (transactionHash != block_entry.block.transactionHashes[i]) {
-        logger(DEBUGGING) << context << "transaction mismatch on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-          << Common::podToHex(transactionHash) << ", dropping connection";
-        context.m_state = CryptoNoteConnectionContext::state_shutdown;
-        return 1;
-      }
-
       tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
-      m_core.handle_incoming_tx(transactionBinary, tvc, true);
+      m_core.handle_incoming_tx(block_entry.transactions[i], transactionHash, block_entry.transactionBlobs[i].getSize(), tvc, true);
       if (tvc.m_verification_failed) {
         logger(DEBUGGING) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
           << Common::podToHex(transactionHash) << ", dropping connection";
@@ -51,12 +51,7 @@ namespace CryptoNote
     struct parsed_block_entry
     {
       Block block;
-      std::vector<BinaryArray> txs;
-
-      void serialize(ISerializer& s) {
-        KV_MEMBER(block);
-        KV_MEMBER(txs);
-      }
+      std::vector<Common::StringView> txs; // blobs of the received block_complete_entry
     };
 
     CryptoNoteProtocolHandler(const Currency& currency, System::Dispatcher& dispatcher, ICore& rcore, IP2pEndpoint* p_net_layout, Logging::ILogger& log);
@@ -107,7 +102,7 @@ namespace CryptoNote
     bool on_connection_synchronized();
     void updateObservedHeight(uint32_t peerHeight, const CryptoNoteConnectionContext& context);
     void recalculateMaxObservedHeight(const CryptoNoteConnectionContext& context);
-    int processObjects(CryptoNoteConnectionContext& context, const std::vector<parsed_block_entry>& blocks);
+    int processObjects(CryptoNoteConnectionContext& context, std::vector<parsed_block_entry>& blocks);
     Logging::LoggerRef logger;
 
   private:
@@ -325,6 +325,8 @@ bool DaemonCommandsHandler::status(const std::vector<std::string>& args) {
   uint64_t totalCoinsInNetwork = m_core.coinsEmittedAtHeight(height);
   uint64_t totalCoinsOnDeposits = m_core.depositAmountAtHeight(height);
   uint64_t amountOfActiveCoins = totalCoinsInNetwork - totalCoinsOnDeposits;
+  BlobCacheStatistics blockCache = m_core.getBlockCacheStatistics();
+  uint64_t blockCacheRequests = blockCache.hits + blockCache.misses;
 
 
 std::cout << std::endl
@@ -334,6 +336,9 @@ std::cout << std::endl
 std::cout << "**************************************************"<< std::endl;
 std::cout << "Network Hashrate: " << get_mining_speed(hashrate) << ", Difficulty: " << difficulty << std::endl;
 std::cout << "Block Major version: " << (int)majorVersion << ", " << "Alt Blocks: " << alt_blocks_count << std::endl;
+std::cout << "Block cache: " << blockCache.cachedItems << " blocks, " << blockCache.hits << " hits, " << blockCache.misses << " misses ("
+         << (blockCacheRequests == 0 ? 0 : blockCache.hits * 100 / blockCacheRequests) << "% hit rate), "
+         << blockCache.storedBytes / (1024 * 1024) << " MB stored" << std::endl;
 const auto &currency = m_core.currency();
 std::cout << "Total active (unlocked) XFG :  " << currency.formatAmount(amountOfActiveCoins) << " (" << currency.formatAmount(calculatePercent(currency, amountOfActiveCoins, totalCoinsInNetwork)) << "%)" << std::endl;
 std::cout << "Total XFG locked in COLD : " << currency.formatAmount(totalCoinsOnDeposits) << " (" << currency.formatAmount(calculatePercent(currency, totalCoinsOnDeposits, totalCoinsInNetwork)) << "%)" << std::endl;
@@ -74,8 +74,8 @@ void HttpResponse::addHeader(const std::string& name, const std::string& value)
   headers[name] = value;
 }
 
-void HttpResponse::setBody(const std::string& b) {
-  body = b;
+void HttpResponse::setBody(std::string b) {
+  body = std::move(b);
   if (!body.empty()) {
     headers["Content-Length"] = std::to_string(body.size());
   } else {
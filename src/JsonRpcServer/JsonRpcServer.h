@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <string>
 #include <system_error>
 
 #include <System/Dispatcher.h>
@@ -52,11 +53,11 @@ protected:
   static void makeErrorResponse(const std::error_code& ec, Common::JsonValue& resp);
   static void makeMethodNotFoundResponse(Common::JsonValue& resp);
   static void makeGenericErrorReponse(Common::JsonValue& resp, const char* what, int errorCode = -32001);
-  static void fillJsonResponse(const Common::JsonValue& v, Common::JsonValue& resp);
   static void prepareJsonResponse(const Common::JsonValue& req, Common::JsonValue& resp);
   static void makeJsonParsingErrorResponse(Common::JsonValue& resp);
 
-  virtual void processJsonRpcRequest(const Common::JsonValue& req, Common::JsonValue& resp) = 0;
+  // The result is handed back as serialized JSON in result and added to resp when the response is written.
+  virtual void processJsonRpcRequest(const Common::JsonValue& req, Common::JsonValue& resp, std::string& result) = 0;
 
 private:
   // HttpServer
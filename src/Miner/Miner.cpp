@@ -20,6 +20,7 @@
 #include <functional>
 
 #include "crypto/crypto.h"
+#include "CryptoNoteCore/BlockHashingBatch.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 
 #include <System/InterruptedException.h>
@@ -100,29 +101,33 @@ void Miner::workerFunc(const Block& blockTemplate, difficulty_type difficulty, u
   try {
     Block block = blockTemplate;
     Crypto::cn_context cryptoContext;
+    BlockHashingBatch batch;
+    if (!batch.setBlock(block)) {
+      //error occured
+      m_logger(Logging::DEBUGGING) << "calculating long hash error occured";
+      m_state = MiningState::MINING_STOPPED;
+      return;
+    }
 
     while (m_state == MiningState::MINING_IN_PROGRESS) {
-      Crypto::Hash hash;
-      if (!get_block_longhash(cryptoContext, block, hash)) {
-        //error occured
-        m_logger(Logging::DEBUGGING) << "calculating long hash error occured";
-        m_state = MiningState::MINING_STOPPED;
-        return;
-      }
-
-      if (check_hash(hash, difficulty)) {
-        m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
-
-        if (!setStateBlockFound()) {
-          m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+      Crypto::Hash hashes[BlockHashingBatch::SIZE];
+      batch.hash(cryptoContext, block.nonce, nonceStep, hashes);
+      for (size_t i = 0; i < BlockHashingBatch::SIZE; ++i) {
+        if (check_hash(hashes[i], difficulty)) {
+          m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
+
+          if (!setStateBlockFound()) {
+            m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+            return;
+          }
+
+          block.nonce += static_cast<uint32_t>(i) * nonceStep;
+          m_block = block;
           return;
         }
-
-        m_block = block;
-        return;
       }
 
-      block.nonce += nonceStep;
+      block.nonce += nonceStep * BlockHashingBatch::SIZE;
     }
   } catch (std::exception& e) {
     m_logger(Logging::ERROR) << "Miner got error: " << e.what();
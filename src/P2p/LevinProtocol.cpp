@@ -16,6 +16,9 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
 #include "LevinProtocol.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
 #include <System/TcpConnection.h>
 
 using namespace CryptoNote;
@@ -28,6 +31,10 @@ const uint32_t LEVIN_PACKET_RESPONSE = 0x00000002;
 const uint32_t LEVIN_DEFAULT_MAX_PACKET_SIZE = 100000000;      //100MB by default
 const uint32_t LEVIN_PROTOCOL_VER_1 = 1;
 
+const size_t LEVIN_READ_BUFFER_SIZE = 16 * 1024;
+const size_t LEVIN_MAX_POOLED_FRAME_SIZE = 16 * 1024 * 1024;
+const size_t LEVIN_MAX_POOLED_BYTES = 64 * 1024 * 1024;
+
 #pragma pack(push)
 #pragma pack(1)
 struct bucket_head2
@@ -42,6 +49,55 @@ struct bucket_head2
 };
 #pragma pack(pop)
 
+// Bodies of handled frames, reused for the following ones instead of allocating and faulting in a new buffer
+// for every block batch. Shared by all connections and bounded by the number of bytes it keeps.
+class FrameBufferPool {
+public:
+  BinaryArray take(size_t size) {
+    BinaryArray buffer;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = std::find_if(m_buffers.begin(), m_buffers.end(), [size](const BinaryArray& candidate) {
+        return candidate.capacity() >= size;
+      });
+
+      if (it != m_buffers.end()) {
+        m_retained -= it->capacity();
+        buffer = std::move(*it);
+        m_buffers.erase(it);
+      }
+    }
+
+    buffer.resize(size);
+    return buffer;
+  }
+
+  void put(BinaryArray buffer) {
+    if (buffer.capacity() < LEVIN_READ_BUFFER_SIZE || buffer.capacity() > LEVIN_MAX_POOLED_FRAME_SIZE) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_retained + buffer.capacity() > LEVIN_MAX_POOLED_BYTES) {
+      return;
+    }
+
+    buffer.clear();
+    m_retained += buffer.capacity();
+    m_buffers.push_back(std::move(buffer));
+  }
+
+private:
+  std::mutex m_mutex;
+  std::vector<BinaryArray> m_buffers;
+  size_t m_retained = 0;
+};
+
+FrameBufferPool framePool;
+
+}
+
+LevinProtocol::ReadBuffer::ReadBuffer() : begin(0), end(0) {
 }
 
 bool LevinProtocol::Command::needReply() const {
@@ -49,7 +105,10 @@ bool LevinProtocol::Command::needReply() const {
 }
 
 LevinProtocol::LevinProtocol(System::TcpConnection& connection) 
-  : m_conn(connection) {}
+  : m_conn(connection), m_readBuffer(nullptr) {}
+
+LevinProtocol::LevinProtocol(System::TcpConnection& connection, ReadBuffer& readBuffer)
+  : m_conn(connection), m_readBuffer(&readBuffer) {}
 
 void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool needResponse) {
   bucket_head2 head = { 0 };
@@ -60,15 +119,7 @@ void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool n
   head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
   head.m_flags = LEVIN_PACKET_REQUEST;
 
-  // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
@@ -86,17 +137,17 @@ bool LevinProtocol::readCommand(Command& cmd) {
     throw std::runtime_error("Levin packet size is too big");
   }
 
-  BinaryArray buf;
+  // the body of the previous command is handled by now
+  framePool.put(std::move(cmd.buf));
 
   if (head.m_cb != 0) {
-    buf.resize(head.m_cb);
-    if (!readStrict(&buf[0], head.m_cb)) {
+    cmd.buf = framePool.take(head.m_cb);
+    if (!readStrict(&cmd.buf[0], head.m_cb)) {
       return false;
     }
   }
 
   cmd.command = head.m_command;
-  cmd.buf = std::move(buf);
   cmd.isNotify = !head.m_have_to_return_data;
   cmd.isResponse = (head.m_flags & LEVIN_PACKET_RESPONSE) == LEVIN_PACKET_RESPONSE;
 
@@ -113,24 +164,31 @@ void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t
   head.m_flags = LEVIN_PACKET_RESPONSE;
   head.m_return_code = returnCode;
 
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
 }
 
-void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
+// header and body go out together without being copied into one buffer first
+void LevinProtocol::writeStrict(const uint8_t* head, size_t headSize, const uint8_t* body, size_t bodySize) {
   size_t offset = 0;
-  while (offset < size) {
-    offset += m_conn.write(ptr + offset, size - offset);
+  while (offset < headSize + bodySize) {
+    System::TcpWriteBuffer buffers[2];
+    size_t count = 0;
+    if (offset < headSize) {
+      buffers[count++] = { head + offset, headSize - offset };
+      buffers[count++] = { body, bodySize };
+    } else {
+      buffers[count++] = { body + (offset - headSize), bodySize - (offset - headSize) };
+    }
+
+    offset += m_conn.writev(buffers, count);
   }
 }
 
 bool LevinProtocol::readStrict(uint8_t* ptr, size_t size) {
+  if (m_readBuffer != nullptr) {
+    return readBuffered(ptr, size);
+  }
+
   size_t offset = 0;
   while (offset < size) {
     size_t read = m_conn.read(ptr + offset, size - offset);
@@ -143,3 +201,40 @@ bool LevinProtocol::readStrict(uint8_t* ptr, size_t size) {
 
   return true;
 }
+
+// Headers and small frames are served from one read into the connection's buffer, bodies that don't fit it
+// are read straight into their destination once the buffered bytes are used up.
+bool LevinProtocol::readBuffered(uint8_t* ptr, size_t size) {
+  ReadBuffer& buffer = *m_readBuffer;
+  size_t offset = 0;
+  while (offset < size) {
+    if (buffer.begin == buffer.end) {
+      if (size - offset >= LEVIN_READ_BUFFER_SIZE) {
+        size_t read = m_conn.read(ptr + offset, size - offset);
+        if (read == 0) {
+          return false;
+        }
+
+        offset += read;
+        continue;
+      }
+
+      if (buffer.data.empty()) {
+        buffer.data.resize(LEVIN_READ_BUFFER_SIZE);
+      }
+
+      buffer.begin = 0;
+      buffer.end = m_conn.read(buffer.data.data(), buffer.data.size());
+      if (buffer.end == 0) {
+        return false;
+      }
+    }
+
+    size_t chunk = std::min(size - offset, buffer.end - buffer.begin);
+    std::memcpy(ptr + offset, buffer.data.data() + buffer.begin, chunk);
+    buffer.begin += chunk;
+    offset += chunk;
+  }
+
+  return true;
+}
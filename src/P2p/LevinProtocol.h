@@ -45,7 +45,22 @@ const int32_t LEVIN_PROTOCOL_RETCODE_SUCCESS = 1;
 class LevinProtocol {
 public:
 
+  // Data read from a connection ahead of the current frame. It is owned by the connection, so that every
+  // LevinProtocol reading from it continues where the previous one stopped.
+  class ReadBuffer {
+  public:
+    ReadBuffer();
+
+  private:
+    friend class LevinProtocol;
+
+    BinaryArray data;
+    size_t begin;
+    size_t end;
+  };
+
   LevinProtocol(System::TcpConnection& connection);
+  LevinProtocol(System::TcpConnection& connection, ReadBuffer& readBuffer);
 
   template <typename Request, typename Response>
   bool invoke(uint32_t command, const Request& request, Response& response) {
@@ -106,8 +121,10 @@ public:
 private:
 
   bool readStrict(uint8_t* ptr, size_t size);
-  void writeStrict(const uint8_t* ptr, size_t size);
+  bool readBuffered(uint8_t* ptr, size_t size);
+  void writeStrict(const uint8_t* head, size_t headSize, const uint8_t* body, size_t bodySize);
   System::TcpConnection& m_conn;
+  ReadBuffer* m_readBuffer;
 };
 
 }
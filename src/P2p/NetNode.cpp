@@ -347,21 +347,23 @@ namespace CryptoNote
   //-----------------------------------------------------------------------------------
   void NodeServer::externalRelayNotifyToAll(int command, const BinaryArray &data_buff, const net_connection_id *excludeConnection)
   {
-    m_dispatcher.remoteSpawn([this, command, data_buff, excludeConnection] {
-      relay_notify_to_all(command, data_buff, excludeConnection);
+    auto buffer = std::make_shared<const BinaryArray>(data_buff);
+    m_dispatcher.remoteSpawn([this, command, buffer, excludeConnection] {
+      relayNotifyToAll(command, buffer, excludeConnection);
     });
   }
 
   //-----------------------------------------------------------------------------------
   void NodeServer::externalRelayNotifyToList(int command, const BinaryArray &data_buff, const std::list<boost::uuids::uuid> relayList)
   {
-    m_dispatcher.remoteSpawn([this, command, data_buff, relayList] {
+    auto buffer = std::make_shared<const BinaryArray>(data_buff);
+    m_dispatcher.remoteSpawn([this, command, buffer, relayList] {
       forEachConnection([&](P2pConnectionContext &conn) {
         if (std::find(relayList.begin(), relayList.end(), conn.m_connection_id) != relayList.end())
         {
           if (conn.peerId && (conn.m_state == CryptoNoteConnectionContext::state_normal || conn.m_state == CryptoNoteConnectionContext::state_synchronizing))
           {
-            conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+            conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, buffer));
           }
         }
       });
@@ -766,7 +768,7 @@ namespace CryptoNote
   bool NodeServer::timedSync() {
     COMMAND_TIMED_SYNC::request arg = boost::value_initialized<COMMAND_TIMED_SYNC::request>();
     m_payload_handler.get_payload_sync_data(arg.payload_data);
-    auto cmdBuf = LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(arg);
+    auto cmdBuf = std::make_shared<const BinaryArray>(LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(arg));
 
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId &&
@@ -879,7 +881,7 @@ namespace CryptoNote
 
       try {
         System::Context<bool> handshakeContext(m_dispatcher, [&] {
-          CryptoNote::LevinProtocol proto(ctx.connection);
+          CryptoNote::LevinProtocol proto(ctx.connection, ctx.readBuffer);
           return handshake(proto, ctx, just_take_peerlist);
         });
 
@@ -1267,13 +1269,17 @@ namespace CryptoNote
   //-----------------------------------------------------------------------------------
 
   void NodeServer::relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
+    relayNotifyToAll(command, std::make_shared<const BinaryArray>(data_buff), excludeConnection);
+  }
+
+  void NodeServer::relayNotifyToAll(int command, const std::shared_ptr<const BinaryArray>& buffer, const net_connection_id* excludeConnection) {
     net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
 
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId && conn.m_connection_id != excludeId &&
           (conn.m_state == CryptoNoteConnectionContext::state_normal ||
            conn.m_state == CryptoNoteConnectionContext::state_synchronizing)) {
-        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, buffer));
       }
     });
   }
@@ -1621,7 +1627,7 @@ namespace CryptoNote
       try {
         on_connection_new(ctx);
 
-        LevinProtocol proto(ctx.connection);
+        LevinProtocol proto(ctx.connection, ctx.readBuffer);
         LevinProtocol::Command cmd;
 
         for (;;) {
@@ -1694,13 +1700,13 @@ namespace CryptoNote
           logger(DEBUGGING) << ctx << "msg " << msg.type << ':' << msg.command;
           switch (msg.type) {
           case P2pMessage::COMMAND:
-            proto.sendMessage(msg.command, msg.buffer, true);
+            proto.sendMessage(msg.command, *msg.buffer, true);
             break;
           case P2pMessage::NOTIFY:
-            proto.sendMessage(msg.command, msg.buffer, false);
+            proto.sendMessage(msg.command, *msg.buffer, false);
             break;
           case P2pMessage::REPLY:
-            proto.sendReply(msg.command, msg.buffer, msg.returnCode);
+            proto.sendReply(msg.command, *msg.buffer, msg.returnCode);
             break;
           default:
             assert(false);
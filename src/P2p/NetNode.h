@@ -9,6 +9,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 #include <boost/functional/hash.hpp>
@@ -53,20 +54,25 @@ namespace CryptoNote
     };
 
     P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
-      type(type), command(command), buffer(buffer), returnCode(returnCode) {
+      type(type), command(command), buffer(std::make_shared<const BinaryArray>(buffer)), returnCode(returnCode) {
     }
 
-    P2pMessage(P2pMessage&& msg) :
-      type(msg.type), command(msg.command), buffer(std::move(msg.buffer)), returnCode(msg.returnCode) {
+    P2pMessage(Type type, uint32_t command, BinaryArray&& buffer, int32_t returnCode = 0) :
+      type(type), command(command), buffer(std::make_shared<const BinaryArray>(std::move(buffer))), returnCode(returnCode) {
+    }
+
+    // the payload is shared, not copied, when one message goes to many connections
+    P2pMessage(Type type, uint32_t command, std::shared_ptr<const BinaryArray> buffer, int32_t returnCode = 0) :
+      type(type), command(command), buffer(std::move(buffer)), returnCode(returnCode) {
     }
 
     size_t size() {
-      return buffer.size();
+      return buffer->size();
     }
 
     Type type;
     uint32_t command;
-    const BinaryArray buffer;
+    std::shared_ptr<const BinaryArray> buffer;
     int32_t returnCode;
   };
 
@@ -78,6 +84,7 @@ namespace CryptoNote
     System::Context<void>* context;
     PeerIdType peerId;
     System::TcpConnection connection;
+    LevinProtocol::ReadBuffer readBuffer;
 
     P2pConnectionContext(System::Dispatcher& dispatcher, Logging::ILogger& log, System::TcpConnection&& conn) :
       context(nullptr),
@@ -93,6 +100,7 @@ namespace CryptoNote
       context(ctx.context),
       peerId(ctx.peerId),
       connection(std::move(ctx.connection)),
+      readBuffer(std::move(ctx.readBuffer)),
       logger(ctx.logger.getLogger(), "node_server"),
       queueEvent(std::move(ctx.queueEvent)),
       stopped(std::move(ctx.stopped)) {
@@ -172,6 +180,7 @@ namespace CryptoNote
     bool timedSync();
     bool handleTimedSyncResponse(const BinaryArray& in, P2pConnectionContext& context);
     void forEachConnection(std::function<void(P2pConnectionContext&)> action);
+    void relayNotifyToAll(int command, const std::shared_ptr<const BinaryArray>& buffer, const net_connection_id* excludeConnection);
 
     void on_connection_new(P2pConnectionContext& context);
     void on_connection_close(P2pConnectionContext& context);
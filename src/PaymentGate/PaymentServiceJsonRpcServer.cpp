@@ -81,7 +81,7 @@ PaymentServiceJsonRpcServer::PaymentServiceJsonRpcServer(System::Dispatcher& sys
   handlers.emplace("sendFusionTransaction", jsonHandler<SendFusionTransaction::Request, SendFusionTransaction::Response>(std::bind(&PaymentServiceJsonRpcServer::handleSendFusionTransaction, this, std::placeholders::_1, std::placeholders::_2)));
 }
 
-void PaymentServiceJsonRpcServer::processJsonRpcRequest(const Common::JsonValue& req, Common::JsonValue& resp) {
+void PaymentServiceJsonRpcServer::processJsonRpcRequest(const Common::JsonValue& req, Common::JsonValue& resp, std::string& result) {
   try {
     prepareJsonResponse(req, resp);
 
@@ -108,12 +108,11 @@ void PaymentServiceJsonRpcServer::processJsonRpcRequest(const Common::JsonValue&
 
     logger(Logging::DEBUGGING) << method << " request came";
 
-    Common::JsonValue params(Common::JsonValue::OBJECT);
     if (req.contains("params")) {
-      params = req("params");
+      it->second(req("params"), resp, result);
+    } else {
+      it->second(Common::JsonValue(Common::JsonValue::OBJECT), resp, result);
     }
-
-    it->second(params, resp);
   } catch (std::exception& e) {
     logger(Logging::WARNING) << "Error occurred while processing JsonRpc request: " << e.what();
     makeGenericErrorReponse(resp, e.what());
@@ -26,16 +26,17 @@
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 #include <sys/timerfd.h>
-#include <ucontext.h>
 #include <unistd.h>
 
+#include "MachineContext.h"
+
 namespace System {
 
 namespace {
 
 struct ContextMakingData {
   Dispatcher* dispatcher;
-  void* ucontext;
+  void* machineContext;
 };
 
 class MutextGuard {
@@ -57,57 +58,51 @@ private:
 
 static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "invalid pthread mutex size");
 
-//const size_t STACK_SIZE = 64 * 1024;
-const size_t STACK_SIZE = 512 * 1024;
-
 };
 
-Dispatcher::Dispatcher() {
+Dispatcher::Dispatcher(size_t stackSize) : stackSize(stackSize) {
   std::string message;
   epoll = ::epoll_create1(0);
   if (epoll == -1) {
     message = "epoll_create1 failed, " + lastErrorMessage();
   } else {
-    mainContext.ucontext = new ucontext_t;
-    if (getcontext(reinterpret_cast<ucontext_t*>(mainContext.ucontext)) == -1) {
-      message = "getcontext failed, " + lastErrorMessage();
+    mainContext.machineContext = new MachineContext;
+    remoteSpawnEvent = eventfd(0, O_NONBLOCK);
+    if(remoteSpawnEvent == -1) {
+      message = "eventfd failed, " + lastErrorMessage();
     } else {
-      remoteSpawnEvent = eventfd(0, O_NONBLOCK);
-      if(remoteSpawnEvent == -1) {
-        message = "eventfd failed, " + lastErrorMessage();
-      } else {
-        remoteSpawnEventContext.writeContext = nullptr;
-        remoteSpawnEventContext.readContext = nullptr;
+      remoteSpawnEventContext.writeContext = nullptr;
+      remoteSpawnEventContext.readContext = nullptr;
 
-        epoll_event remoteSpawnEventEpollEvent;
-        remoteSpawnEventEpollEvent.events = EPOLLIN;
-        remoteSpawnEventEpollEvent.data.ptr = &remoteSpawnEventContext;
+      epoll_event remoteSpawnEventEpollEvent;
+      remoteSpawnEventEpollEvent.events = EPOLLIN;
+      remoteSpawnEventEpollEvent.data.ptr = &remoteSpawnEventContext;
 
-        if (epoll_ctl(epoll, EPOLL_CTL_ADD, remoteSpawnEvent, &remoteSpawnEventEpollEvent) == -1) {
-          message = "epoll_ctl failed, " + lastErrorMessage();
-        } else {
-          *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
-
-          mainContext.interrupted = false;
-          mainContext.group = &contextGroup;
-          mainContext.groupPrev = nullptr;
-          mainContext.groupNext = nullptr;
-          contextGroup.firstContext = nullptr;
-          contextGroup.lastContext = nullptr;
-          contextGroup.firstWaiter = nullptr;
-          contextGroup.lastWaiter = nullptr;
-          currentContext = &mainContext;
-          firstResumingContext = nullptr;
-          firstReusableContext = nullptr;
-          runningContextCount = 0;
-          return;
-        }
-
-        auto result = close(remoteSpawnEvent);
-        assert(result == 0);
+      if (epoll_ctl(epoll, EPOLL_CTL_ADD, remoteSpawnEvent, &remoteSpawnEventEpollEvent) == -1) {
+        message = "epoll_ctl failed, " + lastErrorMessage();
+      } else {
+        *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
+
+        mainContext.interrupted = false;
+        mainContext.group = &contextGroup;
+        mainContext.groupPrev = nullptr;
+        mainContext.groupNext = nullptr;
+        contextGroup.firstContext = nullptr;
+        contextGroup.lastContext = nullptr;
+        contextGroup.firstWaiter = nullptr;
+        contextGroup.lastWaiter = nullptr;
+        currentContext = &mainContext;
+        firstResumingContext = nullptr;
+        firstReusableContext = nullptr;
+        runningContextCount = 0;
+        return;
       }
+
+      auto result = close(remoteSpawnEvent);
+      assert(result == 0);
     }
 
+    delete static_cast<MachineContext*>(mainContext.machineContext);
     auto result = close(epoll);
     assert(result == 0);
   }
@@ -126,11 +121,11 @@ Dispatcher::~Dispatcher() {
   assert(firstResumingContext == nullptr);
   assert(runningContextCount == 0);
   while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
+    auto machineContext = static_cast<MachineContext*>(firstReusableContext->machineContext);
+    auto stackPtr = firstReusableContext->stackPtr;
     firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
+    freeContextStack(stackPtr, stackSize);
+    delete machineContext;
   }
 
   while (!timers.empty()) {
@@ -145,15 +140,16 @@ Dispatcher::~Dispatcher() {
   assert(result == 0);
   result = pthread_mutex_destroy(reinterpret_cast<pthread_mutex_t*>(this->mutex));
   assert(result == 0);
+  delete static_cast<MachineContext*>(mainContext.machineContext);
 }
 
 void Dispatcher::clear() {
   while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
+    auto machineContext = static_cast<MachineContext*>(firstReusableContext->machineContext);
+    auto stackPtr = firstReusableContext->stackPtr;
     firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
+    freeContextStack(stackPtr, stackSize);
+    delete machineContext;
   }
 
   while (!timers.empty()) {
@@ -175,38 +171,19 @@ void Dispatcher::dispatch() {
       break;
     }
 
-    epoll_event event;
-    int count = epoll_wait(epoll, &event, 1, -1);
-    if (count == 1) {
-      ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
-      if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-        uint64_t buf;
-        auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-        if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-        }
-
-        MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-        while (!remoteSpawningProcedures.empty()) {
-          spawn(std::move(remoteSpawningProcedures.front()));
-          remoteSpawningProcedures.pop();
+    epoll_event events[16];
+    int count = epoll_wait(epoll, events, 16, -1);
+    if (count > 0) {
+      for (int i = 0; i < count; ++i) {
+        ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
+        if (contextPair == &remoteSpawnEventContext) {
+          runRemoteSpawningProcedures();
+        } else {
+          pushWaitingContexts(contextPair, events[i].events);
         }
-
-        continue;
-      }
-
-      if ((event.events & EPOLLOUT) != 0) {
-        context = contextPair->writeContext->context;
-        contextPair->writeContext->events = event.events;
-      } else if ((event.events & EPOLLIN) != 0) {
-        context = contextPair->readContext->context;
-        contextPair->readContext->events = event.events;
-      } else {
-        continue;
       }
 
-      assert(context != nullptr);
-      break;
+      continue;
     }
 
     if (errno != EINTR) {
@@ -215,11 +192,9 @@ void Dispatcher::dispatch() {
   }
 
   if (context != currentContext) {
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
+    MachineContext* oldContext = static_cast<MachineContext*>(currentContext->machineContext);
     currentContext = context;
-    if (swapcontext(oldContext, static_cast<ucontext_t *>(context->ucontext)) == -1) {
-      throw std::runtime_error("Dispatcher::dispatch, swapcontext failed, " + lastErrorMessage());
-    }
+    switchMachineContext(*oldContext, *static_cast<MachineContext*>(context->machineContext));
   }
 }
 
@@ -308,42 +283,10 @@ void Dispatcher::yield() {
     if(count > 0) {
       for(int i = 0; i < count; ++i) {
         ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
-        if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-          uint64_t buf;
-          auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-          if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-          }
-
-          MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-          while (!remoteSpawningProcedures.empty()) {
-            spawn(std::move(remoteSpawningProcedures.front()));
-            remoteSpawningProcedures.pop();
-          }
-
-          continue;
-        }
-
-        if ((events[i].events & EPOLLOUT) != 0) {
-          if(contextPair->writeContext != nullptr) {
-            if(contextPair->writeContext->context != nullptr) {
-              contextPair->writeContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->writeContext->context);
-          contextPair->writeContext->events = events[i].events;
-        } else if ((events[i].events & EPOLLIN) != 0) {
-          if(contextPair->readContext != nullptr) {
-            if(contextPair->readContext->context != nullptr) {
-              contextPair->readContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->readContext->context);
-          contextPair->readContext->events = events[i].events;
-        } else if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0) {
-          throw std::runtime_error("Dispatcher::dispatch, events & (EPOLLERR | EPOLLHUP) != 0");
+        if (contextPair == &remoteSpawnEventContext) {
+          runRemoteSpawningProcedures();
         } else {
-          continue;
+          pushWaitingContexts(contextPair, events[i].events);
         }
       }
     } else {
@@ -359,31 +302,66 @@ void Dispatcher::yield() {
   }
 }
 
+void Dispatcher::runRemoteSpawningProcedures() {
+  uint64_t buf;
+  auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
+  if(transferred == -1) {
+    throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
+  }
+
+  MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
+  while (!remoteSpawningProcedures.empty()) {
+    spawn(std::move(remoteSpawningProcedures.front()));
+    remoteSpawningProcedures.pop();
+  }
+}
+
+// An edge triggered descriptor reports events whether or not an operation waits for them, and both directions may
+// be ready at once. Every waiter the events concern is resumed, errors and hang ups concern both.
+void Dispatcher::pushWaitingContexts(ContextPair* contextPair, uint32_t events) {
+  if (contextPair == nullptr) {
+    return;
+  }
+
+  contextPair->readyEvents |= events;
+  auto resume = [&](OperationContext*& waiter) {
+    OperationContext* operationContext = waiter;
+    waiter = nullptr;
+    operationContext->events = events;
+    assert(operationContext->context != nullptr);
+    operationContext->context->interruptProcedure = nullptr;
+    pushContext(operationContext->context);
+  };
+
+  if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) != 0 && contextPair->readContext != nullptr) {
+    resume(contextPair->readContext);
+  }
+
+  if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0 && contextPair->writeContext != nullptr) {
+    resume(contextPair->writeContext);
+  }
+}
+
 int Dispatcher::getEpoll() const {
   return epoll;
 }
 
 NativeContext& Dispatcher::getReusableContext() {
   if(firstReusableContext == nullptr) {
-    ucontext_t* newlyCreatedContext = new ucontext_t;
-    if (getcontext(newlyCreatedContext) == -1) { //makecontext precondition
-      throw std::runtime_error("Dispatcher::getReusableContext, getcontext failed, " + lastErrorMessage());
-    }
-
-    auto stackPointer = new uint8_t[STACK_SIZE];
-    newlyCreatedContext->uc_stack.ss_sp = stackPointer;
-    newlyCreatedContext->uc_stack.ss_size = STACK_SIZE;
-
+    void* stackPointer = allocateContextStack(stackSize);
+    MachineContext* newlyCreatedContext = new MachineContext;
     ContextMakingData makingContextData {this, newlyCreatedContext};
-    makecontext(newlyCreatedContext, (void(*)())contextProcedureStatic, 1, reinterpret_cast<int*>(&makingContextData));
-
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
-    if (swapcontext(oldContext, newlyCreatedContext) == -1) {
-      throw std::runtime_error("Dispatcher::getReusableContext, swapcontext failed, " + lastErrorMessage());
+    try {
+      makeMachineContext(*newlyCreatedContext, stackPointer, stackSize, contextProcedureStatic, &makingContextData);
+      switchMachineContext(*static_cast<MachineContext*>(currentContext->machineContext), *newlyCreatedContext);
+    } catch (std::exception&) {
+      delete newlyCreatedContext;
+      freeContextStack(stackPointer, stackSize);
+      throw;
     }
 
     assert(firstReusableContext != nullptr);
-    assert(firstReusableContext->ucontext == newlyCreatedContext);
+    assert(firstReusableContext->machineContext == newlyCreatedContext);
     firstReusableContext->stackPtr = stackPointer;
   };
 
@@ -421,17 +399,14 @@ void Dispatcher::pushTimer(int timer) {
   timers.push(timer);
 }
 
-void Dispatcher::contextProcedure(void* ucontext) {
+void Dispatcher::contextProcedure(void* machineContext) {
   assert(firstReusableContext == nullptr);
   NativeContext context;
-  context.ucontext = ucontext;
+  context.machineContext = machineContext;
   context.interrupted = false;
   context.next = nullptr;
   firstReusableContext = &context;
-  ucontext_t* oldContext = static_cast<ucontext_t*>(context.ucontext);
-  if (swapcontext(oldContext, static_cast<ucontext_t*>(currentContext->ucontext)) == -1) {
-    throw std::runtime_error("Dispatcher::contextProcedure, swapcontext failed, " + lastErrorMessage());
-  }
+  switchMachineContext(*static_cast<MachineContext*>(context.machineContext), *static_cast<MachineContext*>(currentContext->machineContext));
 
   for (;;) {
     ++runningContextCount;
@@ -482,7 +457,7 @@ void Dispatcher::contextProcedure(void* ucontext) {
 
 void Dispatcher::contextProcedureStatic(void *context) {
   ContextMakingData* makingContextData = reinterpret_cast<ContextMakingData*>(context);
-  makingContextData->dispatcher->contextProcedure(makingContextData->ucontext);
+  makingContextData->dispatcher->contextProcedure(makingContextData->machineContext);
 }
 
 }
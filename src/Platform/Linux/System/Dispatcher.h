@@ -31,7 +31,7 @@ namespace System {
 struct NativeContextGroup;
 
 struct NativeContext {
-  void* ucontext;
+  void* machineContext;
   void* stackPtr;
   bool interrupted;
   bool inExecutionQueue;
@@ -56,14 +56,20 @@ struct OperationContext {
   uint32_t events;
 };
 
+// Operations waiting for events of a file descriptor. The dispatcher detaches a waiter when it resumes it.
 struct ContextPair {
   OperationContext *readContext;
   OperationContext *writeContext;
+  // Events reported for the descriptor, for owners that register it once edge triggered and clear the bits they consume
+  uint32_t readyEvents = 0;
 };
 
 class Dispatcher {
 public:
-  Dispatcher();
+  static const size_t DEFAULT_STACK_SIZE = 512 * 1024;
+
+  // Contexts run on stacks of stackSize bytes, which are kept for reuse until clear().
+  explicit Dispatcher(size_t stackSize = DEFAULT_STACK_SIZE);
   Dispatcher(const Dispatcher&) = delete;
   ~Dispatcher();
   Dispatcher& operator=(const Dispatcher&) = delete;
@@ -100,6 +106,8 @@ public:
 
 private:
   void spawn(std::function<void()>&& procedure);
+  void runRemoteSpawningProcedures();
+  void pushWaitingContexts(ContextPair* contextPair, uint32_t events);
   int epoll;
   alignas(void*) uint8_t mutex[SIZEOF_PTHREAD_MUTEX_T];
   int remoteSpawnEvent;
@@ -114,8 +122,9 @@ private:
   NativeContext* lastResumingContext;
   NativeContext* firstReusableContext;
   size_t runningContextCount;
+  size_t stackSize;
 
-  void contextProcedure(void* ucontext);
+  void contextProcedure(void* machineContext);
   static void contextProcedureStatic(void* context);
 };
 
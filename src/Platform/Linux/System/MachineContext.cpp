@@ -0,0 +1,156 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "MachineContext.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <System/ErrorMessage.h>
+
+#ifndef SYSTEM_UCONTEXT
+extern "C" {
+// Pushes the callee-saved registers and the SSE and x87 control words, stores the stack pointer to *from, then
+// restores the same from the stack at to.
+void systemSwitchMachineContext(void** from, void* to);
+// First return address of a new context, calls r13(r12).
+void systemMachineContextEntry();
+}
+
+asm(R"(
+  .pushsection .text
+  .globl systemSwitchMachineContext
+  .hidden systemSwitchMachineContext
+  .type systemSwitchMachineContext, @function
+  .p2align 4
+systemSwitchMachineContext:
+  pushq %rbp
+  pushq %rbx
+  pushq %r12
+  pushq %r13
+  pushq %r14
+  pushq %r15
+  subq $8, %rsp
+  stmxcsr (%rsp)
+  fnstcw 4(%rsp)
+  movq %rsp, (%rdi)
+  movq %rsi, %rsp
+  ldmxcsr (%rsp)
+  fldcw 4(%rsp)
+  addq $8, %rsp
+  popq %r15
+  popq %r14
+  popq %r13
+  popq %r12
+  popq %rbx
+  popq %rbp
+  ret
+  .size systemSwitchMachineContext, .-systemSwitchMachineContext
+
+  .globl systemMachineContextEntry
+  .hidden systemMachineContextEntry
+  .type systemMachineContextEntry, @function
+  .p2align 4
+systemMachineContextEntry:
+  .cfi_startproc
+  .cfi_undefined rip
+  movq %r12, %rdi
+  callq *%r13
+  ud2
+  .cfi_endproc
+  .size systemMachineContextEntry, .-systemMachineContextEntry
+  .popsection
+)");
+#endif
+
+namespace System {
+
+namespace {
+
+size_t pageSize() {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+size_t mappingSize(size_t size) {
+  return (size + pageSize() - 1) / pageSize() * pageSize() + pageSize();
+}
+
+}
+
+void* allocateContextStack(size_t size) {
+  void* stack = mmap(nullptr, mappingSize(size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (stack == MAP_FAILED) {
+    throw std::runtime_error("allocateContextStack, mmap failed, " + lastErrorMessage());
+  }
+
+  if (mprotect(stack, pageSize(), PROT_NONE) == -1) {
+    std::string message = "allocateContextStack, mprotect failed, " + lastErrorMessage();
+    munmap(stack, mappingSize(size));
+    throw std::runtime_error(message);
+  }
+
+  return stack;
+}
+
+void freeContextStack(void* stack, size_t size) {
+  munmap(stack, mappingSize(size));
+}
+
+void makeMachineContext(MachineContext& context, void* stack, size_t size, void (*entry)(void*), void* argument) {
+  uint8_t* stackBegin = static_cast<uint8_t*>(stack) + pageSize();
+  size_t stackSize = mappingSize(size) - pageSize();
+#ifdef SYSTEM_UCONTEXT
+  if (getcontext(&context.ucontext) == -1) {
+    throw std::runtime_error("makeMachineContext, getcontext failed, " + lastErrorMessage());
+  }
+
+  context.ucontext.uc_stack.ss_sp = stackBegin;
+  context.ucontext.uc_stack.ss_size = stackSize;
+  context.ucontext.uc_link = nullptr;
+  makecontext(&context.ucontext, reinterpret_cast<void(*)()>(entry), 1, argument);
+#else
+  // the frame systemSwitchMachineContext pops, returning to systemMachineContextEntry with a 16 byte aligned stack
+  uint64_t* top = reinterpret_cast<uint64_t*>(reinterpret_cast<uintptr_t>(stackBegin + stackSize) & ~uintptr_t(15));
+  top[-1] = 0;
+  top[-2] = 0;
+  top[-3] = reinterpret_cast<uint64_t>(&systemMachineContextEntry);
+  top[-4] = 0; // rbp
+  top[-5] = 0; // rbx
+  top[-6] = reinterpret_cast<uint64_t>(argument); // r12
+  top[-7] = reinterpret_cast<uint64_t>(entry); // r13
+  top[-8] = 0; // r14
+  top[-9] = 0; // r15
+  top[-10] = 0x1f80 | (uint64_t(0x37f) << 32); // default MXCSR and x87 control word
+  context.stackPointer = top - 10;
+#endif
+}
+
+void switchMachineContext(MachineContext& from, MachineContext& to) {
+#ifdef SYSTEM_UCONTEXT
+  if (swapcontext(&from.ucontext, &to.ucontext) == -1) {
+    throw std::runtime_error("switchMachineContext, swapcontext failed, " + lastErrorMessage());
+  }
+#else
+  systemSwitchMachineContext(&from.stackPointer, to.stackPointer);
+#endif
+}
+
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+
+// Coroutines of Dispatcher switch registers in user space on x86-64. SYSTEM_UCONTEXT selects the glibc ucontext
+// functions instead, which other architectures always use; their swapcontext makes a sigprocmask syscall per switch.
+#if !defined(SYSTEM_UCONTEXT) && !defined(__x86_64__)
+#define SYSTEM_UCONTEXT
+#endif
+
+#ifdef SYSTEM_UCONTEXT
+#include <ucontext.h>
+#endif
+
+namespace System {
+
+// Registers of a suspended coroutine.
+struct MachineContext {
+#ifdef SYSTEM_UCONTEXT
+  ucontext_t ucontext;
+#else
+  void* stackPointer;
+#endif
+};
+
+// Maps a coroutine stack of at least size bytes with an inaccessible guard page below it, so that an overflow faults
+// instead of overwriting other memory. Returns the start of the mapping, throws if that fails.
+void* allocateContextStack(size_t size);
+void freeContextStack(void* stack, size_t size);
+
+// Prepares context to run entry(argument) on the stack when it is first switched to. entry must not return.
+void makeMachineContext(MachineContext& context, void* stack, size_t size, void (*entry)(void*), void* argument);
+// Saves the running coroutine to from and resumes to.
+void switchMachineContext(MachineContext& from, MachineContext& to);
+
+}
@@ -21,30 +21,43 @@
 #include <System/InterruptedException.h>
 #include <System/Ipv4Address.h>
 #include <arpa/inet.h>
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace System {
 
+namespace {
+
+const std::size_t MAX_WRITE_BUFFERS = 16;
+
+// Events after which a transfer may not block. Errors and hang ups stay set, the transfer reports them.
+const uint32_t READ_EVENTS = EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP;
+const uint32_t WRITE_EVENTS = EPOLLOUT | EPOLLERR | EPOLLHUP;
+
+}
+
 TcpConnection::TcpConnection() : dispatcher(nullptr) {
 }
 
 TcpConnection::TcpConnection(TcpConnection&& other) : dispatcher(other.dispatcher) {
   if (other.dispatcher != nullptr) {
-    assert(other.contextPair.writeContext == nullptr);
-    assert(other.contextPair.readContext == nullptr);
+    assert(other.contextPair->writeContext == nullptr);
+    assert(other.contextPair->readContext == nullptr);
     connection = other.connection;
-    contextPair = other.contextPair;
+    contextPair = std::move(other.contextPair);
     other.dispatcher = nullptr;
   }
 }
 
 TcpConnection::~TcpConnection() {
   if (dispatcher != nullptr) {
-    assert(contextPair.readContext == nullptr);
-    assert(contextPair.writeContext == nullptr);
+    assert(contextPair->readContext == nullptr);
+    assert(contextPair->writeContext == nullptr);
     int result = close(connection);
     assert(result != -1);
   }
@@ -52,8 +65,8 @@ TcpConnection::~TcpConnection() {
 
 TcpConnection& TcpConnection::operator=(TcpConnection&& other) {
   if (dispatcher != nullptr) {
-    assert(contextPair.readContext == nullptr);
-    assert(contextPair.writeContext == nullptr);
+    assert(contextPair->readContext == nullptr);
+    assert(contextPair->writeContext == nullptr);
     if (close(connection) == -1) {
       throw std::runtime_error("TcpConnection::operator=, close failed, " + lastErrorMessage());
     }
@@ -61,10 +74,10 @@ TcpConnection& TcpConnection::operator=(TcpConnection&& other) {
 
   dispatcher = other.dispatcher;
   if (other.dispatcher != nullptr) {
-    assert(other.contextPair.readContext == nullptr);
-    assert(other.contextPair.writeContext == nullptr);
+    assert(other.contextPair->readContext == nullptr);
+    assert(other.contextPair->writeContext == nullptr);
     connection = other.connection;
-    contextPair = other.contextPair;
+    contextPair = std::move(other.contextPair);
     other.dispatcher = nullptr;
   }
 
@@ -73,100 +86,42 @@ TcpConnection& TcpConnection::operator=(TcpConnection&& other) {
 
 size_t TcpConnection::read(uint8_t* data, size_t size) {
   assert(dispatcher != nullptr);
-  assert(contextPair.readContext == nullptr);
+  assert(contextPair->readContext == nullptr);
   if (dispatcher->interrupted()) {
     throw InterruptedException();
   }
 
-  std::string message;
-  ssize_t transferred = ::recv(connection, (void *)data, size, 0);
-  if (transferred == -1) {
-    if (errno != EAGAIN) {
-      message = "recv failed, " + lastErrorMessage();
-    } else {
-      epoll_event connectionEvent;
-      OperationContext operationContext;
-      operationContext.interrupted = false;
-      operationContext.context = dispatcher->getCurrentContext();
-      contextPair.readContext = &operationContext;
-      connectionEvent.data.ptr = &contextPair;
-
-      if(contextPair.writeContext != nullptr) {
-        connectionEvent.events = EPOLLIN | EPOLLOUT | EPOLLONESHOT;
-      } else {
-        connectionEvent.events = EPOLLIN | EPOLLONESHOT;
-      }
-
-      if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-        message = "epoll_ctl failed, " + lastErrorMessage();
-      } else {
-        dispatcher->getCurrentContext()->interruptProcedure = [&]() {
-            assert(dispatcher != nullptr);
-            assert(contextPair.readContext != nullptr);
-            epoll_event connectionEvent;
-            connectionEvent.events = 0;
-            connectionEvent.data.ptr = nullptr;
-
-            if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-              throw std::runtime_error("TcpConnection::stop, epoll_ctl failed, " + lastErrorMessage());
-            }
-
-            contextPair.readContext->interrupted = true;
-            dispatcher->pushContext(contextPair.readContext->context);
-        };
-
-        dispatcher->dispatch();
-        dispatcher->getCurrentContext()->interruptProcedure = nullptr;
-        assert(dispatcher != nullptr);
-        assert(operationContext.context == dispatcher->getCurrentContext());
-        assert(contextPair.readContext == &operationContext);
-
-        if (operationContext.interrupted) {
-          contextPair.readContext = nullptr;
-          throw InterruptedException();
-        }
-
-        contextPair.readContext = nullptr;
-        if(contextPair.writeContext != nullptr) { //write is presented, rearm
-          epoll_event connectionEvent;
-          connectionEvent.events = EPOLLOUT | EPOLLONESHOT;
-          connectionEvent.data.ptr = &contextPair;
-
-          if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-            message = "epoll_ctl failed, " + lastErrorMessage();
-            throw std::runtime_error("TcpConnection::read");
-          }
+  for (;;) {
+    if ((contextPair->readyEvents & READ_EVENTS) != 0) {
+      ssize_t transferred = ::recv(connection, (void *)data, size, 0);
+      if (transferred != -1) {
+        assert(transferred <= static_cast<ssize_t>(size));
+        if (transferred != 0 && static_cast<size_t>(transferred) < size) {
+          // The receive queue is empty, more data raises a new edge. End of stream stays readable.
+          contextPair->readyEvents &= ~EPOLLIN;
         }
 
-        if((operationContext.events & (EPOLLERR | EPOLLHUP)) != 0) {
-          throw std::runtime_error("TcpConnection::read");
-        }
+        return transferred;
+      }
 
-        ssize_t transferred = ::recv(connection, (void *)data, size, 0);
-        if (transferred == -1) {
-          message = "recv failed, " + lastErrorMessage();
-        } else {
-          assert(transferred <= static_cast<ssize_t>(size));
-          return transferred;
-        }
+      if (errno != EAGAIN) {
+        throw std::runtime_error("TcpConnection::read, recv failed, " + lastErrorMessage());
       }
+
+      contextPair->readyEvents &= ~EPOLLIN;
     }
 
-    throw std::runtime_error("TcpConnection::read, "+ message);
+    wait(contextPair->readContext);
   }
-
-  assert(transferred <= static_cast<ssize_t>(size));
-  return transferred;
 }
 
 std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
   assert(dispatcher != nullptr);
-  assert(contextPair.writeContext == nullptr);
+  assert(contextPair->writeContext == nullptr);
   if (dispatcher->interrupted()) {
     throw InterruptedException();
   }
 
-  std::string message;
   if(size == 0) {
     if(shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
@@ -175,84 +130,54 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, MSG_NOSIGNAL);
-  if (transferred == -1) {
-    if (errno != EAGAIN) {
-      message = "send failed, " + lastErrorMessage();
-    } else {
-      epoll_event connectionEvent;
-      OperationContext operationContext;
-      operationContext.interrupted = false;
-      operationContext.context = dispatcher->getCurrentContext();
-      contextPair.writeContext = &operationContext;
-      connectionEvent.data.ptr = &contextPair;
-
-      if(contextPair.readContext != nullptr) {
-        connectionEvent.events = EPOLLIN | EPOLLOUT | EPOLLONESHOT;
-      } else {
-        connectionEvent.events = EPOLLOUT | EPOLLONESHOT;
-      }
+  TcpWriteBuffer buffer = { data, size };
+  return writev(&buffer, 1);
+}
 
-      if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-        message = "epoll_ctl failed, " + lastErrorMessage();
-      } else {
-        dispatcher->getCurrentContext()->interruptProcedure = [&]() {
-            assert(dispatcher != nullptr);
-            assert(contextPair.writeContext != nullptr);
-            epoll_event connectionEvent;
-            connectionEvent.events = 0;
-            connectionEvent.data.ptr = nullptr;
-
-            if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-              throw std::runtime_error("TcpConnection::stop, epoll_ctl failed, " + lastErrorMessage());
-            }
-
-            contextPair.writeContext->interrupted = true;
-            dispatcher->pushContext(contextPair.writeContext->context);
-        };
-
-        dispatcher->dispatch();
-        dispatcher->getCurrentContext()->interruptProcedure = nullptr;
-        assert(dispatcher != nullptr);
-        assert(operationContext.context == dispatcher->getCurrentContext());
-        assert(contextPair.writeContext == &operationContext);
-
-        if (operationContext.interrupted) {
-          contextPair.writeContext = nullptr;
-          throw InterruptedException();
-        }
+std::size_t TcpConnection::writev(const TcpWriteBuffer* buffers, std::size_t count) {
+  assert(dispatcher != nullptr);
+  assert(contextPair->writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
 
-        contextPair.writeContext = nullptr;
-        if(contextPair.readContext != nullptr) { //read is presented, rearm
-          epoll_event connectionEvent;
-          connectionEvent.events = EPOLLIN | EPOLLONESHOT;
-          connectionEvent.data.ptr = &contextPair;
+  iovec vectors[MAX_WRITE_BUFFERS];
+  msghdr header = {};
+  header.msg_iov = vectors;
+  header.msg_iovlen = std::min(count, MAX_WRITE_BUFFERS);
+  size_t size = 0;
+  for (size_t i = 0; i < header.msg_iovlen; ++i) {
+    vectors[i].iov_base = const_cast<uint8_t*>(buffers[i].data);
+    vectors[i].iov_len = buffers[i].size;
+    size += buffers[i].size;
+  }
 
-          if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-            message = "epoll_ctl failed, " + lastErrorMessage();
-            throw std::runtime_error("TcpConnection::write, " + message);
-          }
-        }
+  if (size == 0) {
+    return 0;
+  }
 
-        if((operationContext.events & (EPOLLERR | EPOLLHUP)) != 0) {
-          throw std::runtime_error("TcpConnection::write, events & (EPOLLERR | EPOLLHUP) != 0");
+  for (;;) {
+    if ((contextPair->readyEvents & WRITE_EVENTS) != 0) {
+      ssize_t transferred = ::sendmsg(connection, &header, MSG_NOSIGNAL);
+      if (transferred != -1) {
+        assert(transferred <= static_cast<ssize_t>(size));
+        if (static_cast<size_t>(transferred) < size) {
+          // The send buffer is full, freed space raises a new edge.
+          contextPair->readyEvents &= ~EPOLLOUT;
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
-        if (transferred == -1) {
-          message = "send failed, "  + lastErrorMessage();
-        } else {
-          assert(transferred <= static_cast<ssize_t>(size));
-          return transferred;
-        }
+        return transferred;
+      }
+
+      if (errno != EAGAIN) {
+        throw std::runtime_error("TcpConnection::write, send failed, " + lastErrorMessage());
       }
+
+      contextPair->readyEvents &= ~EPOLLOUT;
     }
 
-    throw std::runtime_error("TcpConnection::write, " + message);
+    wait(contextPair->writeContext);
   }
-
-  assert(transferred <= static_cast<ssize_t>(size));
-  return transferred;
 }
 
 std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
@@ -266,15 +191,42 @@ std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
   return std::make_pair(Ipv4Address(htonl(addr.sin_addr.s_addr)), htons(addr.sin_port));
 }
 
-TcpConnection::TcpConnection(Dispatcher& dispatcher, int socket) : dispatcher(&dispatcher), connection(socket) {
-  contextPair.readContext = nullptr;
-  contextPair.writeContext = nullptr;
+TcpConnection::TcpConnection(Dispatcher& dispatcher, int socket) : dispatcher(&dispatcher), connection(socket), contextPair(new ContextPair) {
+  contextPair->readContext = nullptr;
+  contextPair->writeContext = nullptr;
+  contextPair->readyEvents = EPOLLIN | EPOLLOUT;
   epoll_event connectionEvent;
-  connectionEvent.events = EPOLLONESHOT;
-  connectionEvent.data.ptr = nullptr;
+  connectionEvent.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  connectionEvent.data.ptr = contextPair.get();
 
   if (epoll_ctl(dispatcher.getEpoll(), EPOLL_CTL_ADD, socket, &connectionEvent) == -1) {
-    throw std::runtime_error("TcpConnection::TcpConnection, epoll_ctl failed, " + lastErrorMessage());
+    std::string message = "epoll_ctl failed, " + lastErrorMessage();
+    int result = close(socket);
+    assert(result != -1);
+    throw std::runtime_error("TcpConnection::TcpConnection, " + message);
+  }
+}
+
+// Suspends until the dispatcher reports an event the waiter is resumed for, throws if interrupted before.
+void TcpConnection::wait(OperationContext*& waiter) {
+  OperationContext operationContext;
+  operationContext.interrupted = false;
+  operationContext.context = dispatcher->getCurrentContext();
+  waiter = &operationContext;
+  dispatcher->getCurrentContext()->interruptProcedure = [&]() {
+    assert(waiter == &operationContext);
+    waiter = nullptr;
+    operationContext.interrupted = true;
+    dispatcher->pushContext(operationContext.context);
+  };
+
+  dispatcher->dispatch();
+  dispatcher->getCurrentContext()->interruptProcedure = nullptr;
+  assert(dispatcher != nullptr);
+  assert(operationContext.context == dispatcher->getCurrentContext());
+  assert(waiter == nullptr);
+  if (operationContext.interrupted) {
+    throw InterruptedException();
   }
 }
 
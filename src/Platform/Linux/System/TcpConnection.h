@@ -8,6 +8,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include "Dispatcher.h"
 
@@ -15,6 +16,11 @@ namespace System {
 
 class Ipv4Address;
 
+struct TcpWriteBuffer {
+  const uint8_t* data;
+  std::size_t size;
+};
+
 class TcpConnection {
 public:
   TcpConnection();
@@ -25,6 +31,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   std::size_t read(uint8_t* data, std::size_t size);
   std::size_t write(const uint8_t* data, std::size_t size);
+  // Sends the buffers in one call, returns the number of bytes written counting across them
+  std::size_t writev(const TcpWriteBuffer* buffers, std::size_t count);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -33,9 +41,12 @@ private:
   
   Dispatcher* dispatcher;
   int connection;
-  ContextPair contextPair;
+  // The socket is registered once, edge triggered for both directions, with the address of this pair, which moves
+  // keep. readyEvents tells whether the last read or write left data or buffer space to transfer without waiting.
+  std::unique_ptr<ContextPair> contextPair;
 
   TcpConnection(Dispatcher& dispatcher, int socket);
+  void wait(OperationContext*& waiter);
 };
 
 }
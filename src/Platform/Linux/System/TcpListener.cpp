@@ -11,6 +11,7 @@
 #include <fcntl.h>
 #include <netdb.h>
 #include <sys/epoll.h>
+#include <sys/socket.h>
 #include <unistd.h>
 #include <string.h>
 
@@ -25,7 +26,7 @@ namespace System {
 TcpListener::TcpListener() : dispatcher(nullptr) {
 }
 
-TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16_t port) : dispatcher(&dispatcher) {
+TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16_t port, bool reusePort) : dispatcher(&dispatcher) {
   std::string message;
   listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
   if (listener == -1) {
@@ -38,6 +39,8 @@ TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16
       int on = 1;
       if (setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on) == -1) {
         message = "setsockopt failed, " + lastErrorMessage();
+      } else if (reusePort && setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) == -1) {
+        message = "setsockopt failed, " + lastErrorMessage();
       } else {
         sockaddr_in address;
         address.sin_family = AF_INET;
@@ -48,14 +51,17 @@ TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16
         } else if (listen(listener, SOMAXCONN) != 0) {
           message = "listen failed, " + lastErrorMessage();
         } else {
+          contextPair.reset(new ContextPair);
+          contextPair->readContext = nullptr;
+          contextPair->writeContext = nullptr;
+          contextPair->readyEvents = EPOLLIN;
           epoll_event listenEvent;
-          listenEvent.events = 0;
-          listenEvent.data.ptr = nullptr;
+          listenEvent.events = EPOLLIN | EPOLLET;
+          listenEvent.data.ptr = contextPair.get();
 
           if (epoll_ctl(dispatcher.getEpoll(), EPOLL_CTL_ADD, listener, &listenEvent) == -1) {
             message = "epoll_ctl failed, " + lastErrorMessage();
           } else {
-            context = nullptr;
             return;
           }
         }
@@ -71,16 +77,16 @@ TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16
 
 TcpListener::TcpListener(TcpListener&& other) : dispatcher(other.dispatcher) {
   if (other.dispatcher != nullptr) {
-    assert(other.context == nullptr);
+    assert(other.contextPair->readContext == nullptr);
     listener = other.listener;
-    context = nullptr;
+    contextPair = std::move(other.contextPair);
     other.dispatcher = nullptr;
   }
 }
 
 TcpListener::~TcpListener() {
   if (dispatcher != nullptr) {
-    assert(context == nullptr);
+    assert(contextPair->readContext == nullptr);
     int result = close(listener);
     assert(result != -1);
   }
@@ -88,7 +94,7 @@ TcpListener::~TcpListener() {
 
 TcpListener& TcpListener::operator=(TcpListener&& other) {
   if (dispatcher != nullptr) {
-    assert(context == nullptr);
+    assert(contextPair->readContext == nullptr);
     if (close(listener) == -1) {
       throw std::runtime_error("TcpListener::operator=, close failed, " + lastErrorMessage());
     }
@@ -96,9 +102,9 @@ TcpListener& TcpListener::operator=(TcpListener&& other) {
 
   dispatcher = other.dispatcher;
   if (other.dispatcher != nullptr) {
-    assert(other.context == nullptr);
+    assert(other.contextPair->readContext == nullptr);
     listener = other.listener;
-    context = nullptr;
+    contextPair = std::move(other.contextPair);
     other.dispatcher = nullptr;
   }
 
@@ -107,80 +113,48 @@ TcpListener& TcpListener::operator=(TcpListener&& other) {
 
 TcpConnection TcpListener::accept() {
   assert(dispatcher != nullptr);
-  assert(context == nullptr);
+  assert(contextPair->readContext == nullptr);
   if (dispatcher->interrupted()) {
     throw InterruptedException();
   }
 
-  ContextPair contextPair;
-  OperationContext listenerContext;
-  listenerContext.interrupted = false;
-  listenerContext.context = dispatcher->getCurrentContext();
-
-  contextPair.writeContext = nullptr;
-  contextPair.readContext = &listenerContext;
+  for (;;) {
+    if ((contextPair->readyEvents & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0) {
+      sockaddr inAddr;
+      socklen_t inLen = sizeof(inAddr);
+      int connection = ::accept4(listener, &inAddr, &inLen, SOCK_NONBLOCK);
+      if (connection != -1) {
+        return TcpConnection(*dispatcher, connection);
+      }
 
-  epoll_event listenEvent;
-  listenEvent.events = EPOLLIN | EPOLLONESHOT;
-  listenEvent.data.ptr = &contextPair;
-  std::string message;
-  if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, listener, &listenEvent) == -1) {
-    message = "epoll_ctl failed, " + lastErrorMessage();
-  } else {
-    context = &listenerContext;
-    dispatcher->getCurrentContext()->interruptProcedure = [&]() {
-        assert(dispatcher != nullptr);
-        assert(context != nullptr);
-        OperationContext* listenerContext = static_cast<OperationContext*>(context);
-        if (!listenerContext->interrupted) {
-          epoll_event listenEvent;
-          listenEvent.events = 0;
-          listenEvent.data.ptr = nullptr;
+      if (errno != EAGAIN) {
+        throw std::runtime_error("TcpListener::accept, accept failed, " + lastErrorMessage());
+      }
 
-          if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, listener, &listenEvent) == -1) {
-            throw std::runtime_error("TcpListener::stop, epoll_ctl failed, " + lastErrorMessage() );
-          }
+      // The backlog is empty, the next connection raises a new edge.
+      contextPair->readyEvents &= ~EPOLLIN;
+    }
 
-          listenerContext->interrupted = true;
-          dispatcher->pushContext(listenerContext->context);
-        }
+    OperationContext listenerContext;
+    listenerContext.interrupted = false;
+    listenerContext.context = dispatcher->getCurrentContext();
+    contextPair->readContext = &listenerContext;
+    dispatcher->getCurrentContext()->interruptProcedure = [&]() {
+      assert(contextPair->readContext == &listenerContext);
+      contextPair->readContext = nullptr;
+      listenerContext.interrupted = true;
+      dispatcher->pushContext(listenerContext.context);
     };
 
     dispatcher->dispatch();
     dispatcher->getCurrentContext()->interruptProcedure = nullptr;
     assert(dispatcher != nullptr);
     assert(listenerContext.context == dispatcher->getCurrentContext());
-    assert(contextPair.writeContext == nullptr);
-    assert(context == &listenerContext);
-    context = nullptr;
-    listenerContext.context = nullptr;
+    assert(contextPair->readContext == nullptr);
     if (listenerContext.interrupted) {
       throw InterruptedException();
     }
-
-    if((listenerContext.events & (EPOLLERR | EPOLLHUP)) != 0) {
-      throw std::runtime_error("TcpListener::accept, accepting failed");
-    }
-
-    sockaddr inAddr;
-    socklen_t inLen = sizeof(inAddr);
-    int connection = ::accept(listener, &inAddr, &inLen);
-    if (connection == -1) {
-      message = "accept failed, " + lastErrorMessage();
-    } else {
-      int flags = fcntl(connection, F_GETFL, 0);
-      if (flags == -1 || fcntl(connection, F_SETFL, flags | O_NONBLOCK) == -1) {
-        message = "fcntl failed, " + lastErrorMessage();
-      } else {
-        return TcpConnection(*dispatcher, connection);
-      }
-
-      int result = close(connection);
-      assert(result != -1);
-    }
   }
-
-  throw std::runtime_error("TcpListener::accept, " + message);
 }
 
 }
@@ -7,10 +7,12 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 
 namespace System {
 
+struct ContextPair;
 class Dispatcher;
 class Ipv4Address;
 class TcpConnection;
@@ -18,7 +20,8 @@ class TcpConnection;
 class TcpListener {
 public:
   TcpListener();
-  TcpListener(Dispatcher& dispatcher, const Ipv4Address& address, uint16_t port);
+  // With reusePort several listeners may bind the same address and port, the kernel spreads incoming connections between them.
+  TcpListener(Dispatcher& dispatcher, const Ipv4Address& address, uint16_t port, bool reusePort = false);
   TcpListener(const TcpListener&) = delete;
   TcpListener(TcpListener&& other);
   ~TcpListener();
@@ -28,7 +31,8 @@ public:
 
 private:
   Dispatcher* dispatcher;
-  void* context;
+  // registered once, edge triggered, like the sockets of TcpConnection
+  std::unique_ptr<ContextPair> contextPair;
   int listener;
 };
 
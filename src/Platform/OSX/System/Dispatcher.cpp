@@ -54,14 +54,11 @@ public:
 private:
   pthread_mutex_t& mutex;
 };
-
-//const size_t STACK_SIZE = 64 * 1024;
-const size_t STACK_SIZE = 512 * 1024;
 }
 
 static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "invalid pthread mutex size");
 
-Dispatcher::Dispatcher() : lastCreatedTimer(0) {
+Dispatcher::Dispatcher(size_t stackSize) : lastCreatedTimer(0), stackSize(stackSize) {
   std::string message;
   kqueue = ::kqueue();
   if (kqueue == -1) {
@@ -343,9 +340,9 @@ int Dispatcher::getKqueue() const {
 NativeContext& Dispatcher::getReusableContext() {
   if(firstReusableContext == nullptr) {
    uctx* newlyCreatedContext = new uctx;
-   uint8_t* stackPointer = new uint8_t[STACK_SIZE];
+   uint8_t* stackPointer = new uint8_t[stackSize];
    static_cast<uctx*>(newlyCreatedContext)->uc_stack.ss_sp = stackPointer;
-   static_cast<uctx*>(newlyCreatedContext)->uc_stack.ss_size = STACK_SIZE;
+   static_cast<uctx*>(newlyCreatedContext)->uc_stack.ss_size = stackSize;
 
    ContextMakingData makingData{ newlyCreatedContext, this};
    makecontext(static_cast<uctx*>(newlyCreatedContext), reinterpret_cast<void(*)()>(contextProcedureStatic), reinterpret_cast<intptr_t>(&makingData));
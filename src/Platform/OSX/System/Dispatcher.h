@@ -54,7 +54,10 @@ struct OperationContext {
 
 class Dispatcher {
 public:
-  Dispatcher();
+  static const size_t DEFAULT_STACK_SIZE = 512 * 1024;
+
+  // Contexts run on stacks of stackSize bytes, which are kept for reuse until clear().
+  explicit Dispatcher(size_t stackSize = DEFAULT_STACK_SIZE);
   Dispatcher(const Dispatcher&) = delete;
   ~Dispatcher();
   Dispatcher& operator=(const Dispatcher&) = delete;
@@ -85,6 +88,7 @@ private:
 
   int kqueue;
   int lastCreatedTimer;
+  size_t stackSize;
   alignas(std::max_align_t) uint8_t mutex[SIZEOF_PTHREAD_MUTEX_T];
   std::atomic<bool> remoteSpawned;
   std::queue<std::function<void()>> remoteSpawningProcedures;
@@ -5,12 +5,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "TcpConnection.h"
+#include <algorithm>
 #include <cassert>
 
 #include <netinet/in.h>
 #include <sys/event.h>
 #include <sys/errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "Dispatcher.h"
@@ -20,6 +22,12 @@
 
 namespace System {
 
+namespace {
+
+const size_t MAX_WRITE_BUFFERS = 16;
+
+}
+
 TcpConnection::TcpConnection() : dispatcher(nullptr) {
 }
 
@@ -139,7 +147,6 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
-  std::string message;
   if (size == 0) {
     if (shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
@@ -148,7 +155,34 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, 0);
+  TcpWriteBuffer buffer = { data, size };
+  return writev(&buffer, 1);
+}
+
+size_t TcpConnection::writev(const TcpWriteBuffer* buffers, size_t count) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  iovec vectors[MAX_WRITE_BUFFERS];
+  msghdr header = {};
+  header.msg_iov = vectors;
+  header.msg_iovlen = static_cast<int>(std::min(count, MAX_WRITE_BUFFERS));
+  size_t size = 0;
+  for (int i = 0; i < header.msg_iovlen; ++i) {
+    vectors[i].iov_base = const_cast<uint8_t*>(buffers[i].data);
+    vectors[i].iov_len = buffers[i].size;
+    size += buffers[i].size;
+  }
+
+  if (size == 0) {
+    return 0;
+  }
+
+  std::string message;
+  ssize_t transferred = ::sendmsg(connection, &header, 0);
   if (transferred == -1) {
     if (errno != EAGAIN  && errno != EWOULDBLOCK) {
       message = "send failed, " + lastErrorMessage();
@@ -190,7 +224,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw InterruptedException();
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = ::sendmsg(connection, &header, 0);
         if (transferred == -1) {
           message = "send failed, " + lastErrorMessage();
         } else {
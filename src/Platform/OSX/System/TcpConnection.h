@@ -15,6 +15,11 @@ namespace System {
 class Dispatcher;
 class Ipv4Address;
 
+struct TcpWriteBuffer {
+  const uint8_t* data;
+  std::size_t size;
+};
+
 class TcpConnection {
 public:
   TcpConnection();
@@ -25,6 +30,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   std::size_t read(uint8_t* data, std::size_t size);
   std::size_t write(const uint8_t* data, std::size_t size);
+  // Sends the buffers in one call, returns the number of bytes written counting across them
+  std::size_t writev(const TcpWriteBuffer* buffers, std::size_t count);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
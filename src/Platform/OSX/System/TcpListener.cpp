@@ -27,7 +27,7 @@ namespace System {
 TcpListener::TcpListener() : dispatcher(nullptr) {
 }
 
-TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16_t port) : dispatcher(&dispatcher) {
+TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16_t port, bool reusePort) : dispatcher(&dispatcher) {
   std::string message;
   listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
   if (listener == -1) {
@@ -40,6 +40,8 @@ TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16
       int on = 1;
       if (setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on) == -1) {
         message = "setsockopt failed, " + lastErrorMessage();
+      } else if (reusePort && setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) == -1) {
+        message = "setsockopt failed, " + lastErrorMessage();
       } else {
         sockaddr_in address;
         address.sin_family = AF_INET;
@@ -18,7 +18,8 @@ class TcpConnection;
 class TcpListener {
 public:
   TcpListener();
-  TcpListener(Dispatcher& dispatcher, const Ipv4Address& address, uint16_t port);
+  // With reusePort several listeners may bind the same address and port, the kernel spreads incoming connections between them.
+  TcpListener(Dispatcher& dispatcher, const Ipv4Address& address, uint16_t port, bool reusePort = false);
   TcpListener(const TcpListener&) = delete;
   TcpListener(TcpListener&& other);
   ~TcpListener();
@@ -37,10 +37,9 @@ struct DispatcherContext : public OVERLAPPED {
 };
 
 const size_t STACK_SIZE = 16384;
-const size_t RESERVE_STACK_SIZE = 2097152;
 }
 
-Dispatcher::Dispatcher() {
+Dispatcher::Dispatcher(size_t stackSize) : stackSize(stackSize) {
   static_assert(sizeof(CRITICAL_SECTION) == sizeof(Dispatcher::criticalSection), "CRITICAL_SECTION size doesn't fit sizeof(Dispatcher::criticalSection)");
   BOOL result = InitializeCriticalSectionAndSpinCount(reinterpret_cast<LPCRITICAL_SECTION>(criticalSection), 4000);
   assert(result != FALSE);
@@ -338,7 +337,7 @@ void* Dispatcher::getCompletionPort() const {
 
 NativeContext& Dispatcher::getReusableContext() {
   if (firstReusableContext == nullptr) {
-    void* fiber = CreateFiberEx(STACK_SIZE, RESERVE_STACK_SIZE, 0, contextProcedureStatic, this);
+    void* fiber = CreateFiberEx(stackSize < STACK_SIZE ? stackSize : STACK_SIZE, stackSize, 0, contextProcedureStatic, this);
     if (fiber == NULL) {
       throw std::runtime_error("Dispatcher::getReusableContext, CreateFiberEx failed, " + lastErrorMessage());
     }
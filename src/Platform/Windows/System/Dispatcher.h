@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <map>
@@ -47,7 +48,10 @@ struct NativeContextGroup {
 
 class Dispatcher {
 public:
-  Dispatcher();
+  static const size_t DEFAULT_STACK_SIZE = 2097152;
+
+  // Context fibers reserve stackSize bytes of stack, they are kept for reuse until clear().
+  explicit Dispatcher(size_t stackSize = DEFAULT_STACK_SIZE);
   Dispatcher(const Dispatcher&) = delete;
   ~Dispatcher();
   Dispatcher& operator=(const Dispatcher&) = delete;
@@ -76,6 +80,7 @@ private:
   std::queue<std::function<void()>> remoteSpawningProcedures;
   uint8_t remoteSpawnOverlapped[4 * sizeof(void*)];
   uint32_t threadId;
+  size_t stackSize;
   std::multimap<uint64_t, NativeContext*> timers;
 
   NativeContext mainContext;
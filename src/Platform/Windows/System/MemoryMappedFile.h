@@ -44,6 +44,10 @@ public:
   void rename(const std::string& newPath, std::error_code& ec);
   void rename(const std::string& newPath);
 
+  // Changes the size of the file and maps it again, pointers returned by data() become invalid.
+  void resize(uint64_t newSize, std::error_code& ec);
+  void resize(uint64_t newSize);
+
   void flush(uint8_t* data, uint64_t size, std::error_code& ec);
   void flush(uint8_t* data, uint64_t size);
 
@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "TcpConnection.h"
+#include <algorithm>
 #include <cassert>
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
@@ -21,6 +22,8 @@ namespace System {
 
 namespace {
 
+const size_t MAX_WRITE_BUFFERS = 16;
+
 struct TcpConnectionContext : public OVERLAPPED {
   NativeContext* context;
   bool interrupted;
@@ -150,10 +153,33 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  WSABUF buf{static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))};
+  TcpWriteBuffer buffer = { data, size };
+  return writev(&buffer, 1);
+}
+
+size_t TcpConnection::writev(const TcpWriteBuffer* buffers, size_t count) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  WSABUF bufs[MAX_WRITE_BUFFERS];
+  DWORD bufCount = static_cast<DWORD>((std::min)(count, MAX_WRITE_BUFFERS));
+  size_t size = 0;
+  for (DWORD i = 0; i < bufCount; ++i) {
+    bufs[i].len = static_cast<ULONG>(buffers[i].size);
+    bufs[i].buf = reinterpret_cast<char*>(const_cast<uint8_t*>(buffers[i].data));
+    size += buffers[i].size;
+  }
+
+  if (size == 0) {
+    return 0;
+  }
+
   TcpConnectionContext context;
   context.hEvent = NULL;
-  if (WSASend(connection, &buf, 1, NULL, 0, &context, NULL) != 0) {
+  if (WSASend(connection, bufs, bufCount, NULL, 0, &context, NULL) != 0) {
     int lastError = WSAGetLastError();
     if (lastError != WSA_IO_PENDING) {
       throw std::runtime_error("TcpConnection::write, WSASend failed, " + errorMessage(lastError));
@@ -14,6 +14,11 @@ namespace System {
 class Dispatcher;
 class Ipv4Address;
 
+struct TcpWriteBuffer {
+  const uint8_t* data;
+  size_t size;
+};
+
 class TcpConnection {
 public:
   TcpConnection();
@@ -24,6 +29,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   size_t read(uint8_t* data, size_t size);
   size_t write(const uint8_t* data, size_t size);
+  // Sends the buffers in one call, returns the number of bytes written counting across them
+  size_t writev(const TcpWriteBuffer* buffers, size_t count);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
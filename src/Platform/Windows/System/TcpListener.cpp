@@ -34,7 +34,11 @@ LPFN_ACCEPTEX acceptEx = nullptr;
 TcpListener::TcpListener() : dispatcher(nullptr) {
 }
 
-TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& address, uint16_t port) : dispatcher(&dispatcher) {
+TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& address, uint16_t port, bool reusePort) : dispatcher(&dispatcher) {
+  if (reusePort) {
+    throw std::runtime_error("TcpListener::TcpListener, port sharing is not supported");
+  }
+
   std::string message;
   listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
   if (listener == INVALID_SOCKET) {
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <limits>
+
 #include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
 #include "CryptoNoteCore/CryptoNoteBasic.h"
 #include "CryptoNoteCore/Difficulty.h"
@@ -714,6 +716,60 @@ struct F_COMMAND_RPC_GET_BLOCKS_LIST {
   };
 };
 
+struct block_summary_response {
+  uint32_t height;
+  Crypto::Hash hash;
+  uint64_t timestamp;
+  uint8_t major_version;
+  uint8_t minor_version;
+  difficulty_type difficulty;
+  uint64_t cumul_size;
+  uint64_t tx_count;
+  uint64_t reward;
+  uint64_t already_generated_coins;
+
+  void serialize(ISerializer &s) {
+    KV_MEMBER(height)
+    KV_MEMBER(hash)
+    KV_MEMBER(timestamp)
+    KV_MEMBER(major_version)
+    KV_MEMBER(minor_version)
+    KV_MEMBER(difficulty)
+    KV_MEMBER(cumul_size)
+    KV_MEMBER(tx_count)
+    KV_MEMBER(reward)
+    KV_MEMBER(already_generated_coins)
+  }
+};
+
+// Blocks [start_height, end_height] in pages of up to page_size blocks, a page ends before next_height.
+struct COMMAND_RPC_GET_BLOCK_SUMMARIES {
+  struct request {
+    uint32_t start_height = 0;
+    uint32_t end_height = std::numeric_limits<uint32_t>::max();
+    // 0 or more than COMMAND_RPC_GET_BLOCK_SUMMARIES_MAX_COUNT means the maximum
+    uint32_t page_size = 0;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(start_height)
+      KV_MEMBER(end_height)
+      KV_MEMBER(page_size)
+    }
+  };
+
+  struct response {
+    std::vector<block_summary_response> blocks;
+    uint32_t next_height;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(blocks)
+      KV_MEMBER(next_height)
+      KV_MEMBER(status)
+    }
+  };
+};
+
 struct F_COMMAND_RPC_GET_BLOCK_DETAILS {
   struct request {
     std::string hash;
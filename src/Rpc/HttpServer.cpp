@@ -16,11 +16,14 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
 #include "HttpServer.h"
+#include <cassert>
+#include <future>
 #include <boost/scope_exit.hpp>
 
 #include <Common/Base64.h>
 #include <HTTP/HttpParser.h>
 #include <System/InterruptedException.h>
+#include <System/RemoteContext.h>
 #include <System/TcpStream.h>
 #include <System/Ipv4Address.h>
 
@@ -38,32 +41,122 @@ namespace {
 namespace CryptoNote {
 
 HttpServer::HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log)
-  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer") {
+  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer"), m_connectionCount(0), m_workerThreadCount(0) {
 
 }
 
+void HttpServer::setWorkerThreads(size_t threadCount) {
+  assert(m_pool == nullptr);
+  m_workerThreadCount = threadCount;
+}
+
 void HttpServer::start(const std::string& address, uint16_t port, const std::string& user, const std::string& password) {
-  m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
-  workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
-  
-  		if (!user.empty() || !password.empty()) {
-			m_credentials = Tools::Base64::encode(user + ":" + password);
-		}
+  if (!user.empty() || !password.empty()) {
+    m_credentials = Tools::Base64::encode(user + ":" + password);
+  }
+
+  if (m_workerThreadCount == 0) {
+    m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
+    spawnAcceptLoop();
+    return;
+  }
+
+  try {
+    m_pool.reset(new System::DispatcherPool(m_workerThreadCount));
+    m_workerListeners.resize(m_workerThreadCount);
+    for (size_t i = 0; i < m_workerThreadCount; ++i) {
+      std::shared_ptr<std::promise<void>> listening = std::make_shared<std::promise<void>>();
+      std::future<void> listenResult = listening->get_future();
+      m_pool->spawn(i, [this, i, address, port, listening](System::Dispatcher& dispatcher) {
+        try {
+          m_workerListeners[i].reset(new System::TcpListener(dispatcher, System::Ipv4Address(address), port, true));
+        } catch (std::exception&) {
+          listening->set_exception(std::current_exception());
+          return;
+        }
+
+        listening->set_value();
+        acceptLoop(*m_workerListeners[i], [this, i] { spawnWorkerAcceptLoop(i); });
+      });
+
+      listenResult.get();
+    }
+  } catch (std::exception&) {
+    stop();
+    throw;
+  }
+
+  logger(DEBUGGING) << "Serving connections on " << m_workerThreadCount << " threads";
 }
 
 void HttpServer::stop() {
   workingContextGroup.interrupt();
   workingContextGroup.wait();
+
+  if (m_pool != nullptr) {
+    // worker requests may still be waiting for m_dispatcher, keep it running until the threads exit
+    System::RemoteContext<>(m_dispatcher, [this] { m_pool->stop(); }).get();
+    m_pool.reset();
+    m_workerListeners.clear();
+  }
+}
+
+void HttpServer::runInServerDispatcher(const std::function<void()>& procedure) {
+  System::Dispatcher* dispatcher = System::DispatcherPool::getCurrentDispatcher();
+  if (dispatcher == nullptr) {
+    procedure();
+    return;
+  }
+
+  System::Event done(*dispatcher);
+  std::exception_ptr exception;
+  m_dispatcher.remoteSpawn([&] {
+    try {
+      procedure();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    System::Event* doneEvent = &done;
+    dispatcher->remoteSpawn([doneEvent] { doneEvent->set(); });
+  });
+
+  // the procedure refers to this stack frame, wait for it even when interrupted
+  bool interrupted = false;
+  while (!done.get()) {
+    try {
+      done.wait();
+    } catch (System::InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  if (interrupted) {
+    dispatcher->interrupt();
+  }
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void HttpServer::spawnAcceptLoop() {
+  workingContextGroup.spawn([this] { acceptLoop(m_listener, [this] { spawnAcceptLoop(); }); });
+}
+
+// Accepted connections belong to the dispatcher of the listener, so the accept loops stay pinned to their thread
+void HttpServer::spawnWorkerAcceptLoop(size_t index) {
+  m_pool->spawn(index, [this, index](System::Dispatcher&) { acceptLoop(*m_workerListeners[index], [this, index] { spawnWorkerAcceptLoop(index); }); });
 }
 
-void HttpServer::acceptLoop() {
+void HttpServer::acceptLoop(System::TcpListener& listener, const std::function<void()>& spawnNext) {
   try {
     System::TcpConnection connection; 
     bool accepted = false;
 
     while (!accepted) {
       try {
-        connection = m_listener.accept();
+        connection = listener.accept();
         accepted = true;
       } catch (System::InterruptedException&) {
         throw;
@@ -72,11 +165,11 @@ void HttpServer::acceptLoop() {
       }
     }
 
-    m_connections.insert(&connection);
-    BOOST_SCOPE_EXIT_ALL(this, &connection) { 
-      m_connections.erase(&connection); };
+    ++m_connectionCount;
+    BOOST_SCOPE_EXIT_ALL(this) { 
+      --m_connectionCount; };
 
-	workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
+	spawnNext();
 
 	//auto addr = connection.getPeerAddressAndPort();
 	auto addr = std::pair<System::Ipv4Address, uint16_t>(static_cast<System::Ipv4Address>(0), 0);
@@ -115,7 +208,7 @@ void HttpServer::acceptLoop() {
       }
     }
 
-    logger(DEBUGGING) << "Closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " total=" << m_connections.size();
+    logger(DEBUGGING) << "Closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " total=" << m_connectionCount;
 
   } catch (System::InterruptedException&) {
   } catch (std::exception& e) {
@@ -143,7 +236,7 @@ bool HttpServer::authenticate(const HttpRequest& request) const {
 }
 
 size_t HttpServer::get_connections_count() const {
-	return m_connections.size();
+	return m_connectionCount;
 }
 
 }
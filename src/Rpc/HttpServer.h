@@ -17,16 +17,21 @@
 
 #pragma once 
 
-#include <unordered_set>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include <HTTP/HttpRequest.h>
 #include <HTTP/HttpResponse.h>
 
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
+#include <System/DispatcherPool.h>
 #include <System/TcpListener.h>
 #include <System/TcpConnection.h>
 #include <System/Event.h>
+#include <System/Ipv4Address.h>
 
 #include <Logging/LoggerRef.h>
 
@@ -38,6 +43,9 @@ public:
 
   HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log);
 
+  // With threadCount > 0 connections are served by a pool of threadCount dispatcher threads, each accepting from a
+  // listener bound to the same port. Requests are then processed in those threads. Call before start.
+  void setWorkerThreads(size_t threadCount);
   void start(const std::string& address, uint16_t port, const std::string& user = "", const std::string& password = "");
   void stop();
 
@@ -48,17 +56,27 @@ protected:
 
   System::Dispatcher& m_dispatcher;
 
+  // Runs procedure in m_dispatcher and rethrows its exception. Called from a worker thread the calling context
+  // waits while the worker dispatcher keeps serving its other connections.
+  void runInServerDispatcher(const std::function<void()>& procedure);
+
 private:
 
-  void acceptLoop();
+  void acceptLoop(System::TcpListener& listener, const std::function<void()>& spawnNext);
+  void spawnAcceptLoop();
+  void spawnWorkerAcceptLoop(size_t index);
   void connectionHandler(System::TcpConnection&& conn);
   bool authenticate(const HttpRequest& request) const;
 
   System::ContextGroup workingContextGroup;
   Logging::LoggerRef logger;
   System::TcpListener m_listener;
-  std::unordered_set<System::TcpConnection*> m_connections;
+  std::atomic<size_t> m_connectionCount;
   std::string m_credentials;
+  size_t m_workerThreadCount;
+  std::unique_ptr<System::DispatcherPool> m_pool;
+  // listener of each pool thread, created in that thread
+  std::vector<std::unique_ptr<System::TcpListener>> m_workerListeners;
 };
 
 }
@@ -161,12 +161,18 @@ public:
 
   std::string getBody() {
     psResp.set("jsonrpc", std::string("2.0"));
-    return psResp.toString();
+    std::string body = psResp.toString();
+    if (!result.empty()) {
+      appendJsonMember(body, "result", result);
+    }
+
+    return body;
   }
 
+  // the result is serialized to text right away, results like block lists are too big to go through a JsonValue
   template <typename T>
   bool setResult(const T& v) {
-    psResp.set("result", storeToJsonValue(v));
+    result = storeToJson(v);
     return true;
   }
 
@@ -182,6 +188,7 @@ public:
 
 private:
   Common::JsonValue psResp;
+  std::string result;
 };
 
 
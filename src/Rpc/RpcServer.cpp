@@ -90,31 +90,31 @@ RpcServer::HandlerFunction jsonMethod(bool (RpcServer::*handler)(typename Comman
 std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction>> RpcServer::s_handlers = {
 
   // binary handlers
-  { "/getblocks.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), false } },
-  { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false } },
-  { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false } },
-  { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false } },
-  { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false } },
-  { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false } },
-  { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false } },
+  { "/getblocks.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), false, true } },
+  { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false, true } },
+  { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false, true } },
+  { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false, true } },
+  { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false, true } },
+  { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false, true } },
+  { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false, true } },
 
   // json handlers
-  { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true } },
-  { "/getheight", { jsonMethod<COMMAND_RPC_GET_HEIGHT>(&RpcServer::on_get_height), true } },
-  { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false } },
-  { "/sendrawtransaction", { jsonMethod<COMMAND_RPC_SEND_RAW_TX>(&RpcServer::on_send_raw_tx), false } },
-  { "/feeaddress", { jsonMethod<COMMAND_RPC_GET_FEE_ADDRESS>(&RpcServer::on_get_fee_address), true } },
-  { "/peers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } },
-  { "/getpeers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } },
-  { "/paymentid", { jsonMethod<COMMAND_RPC_GEN_PAYMENT_ID>(&RpcServer::on_get_payment_id), true } },
+  { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true, false } },
+  { "/getheight", { jsonMethod<COMMAND_RPC_GET_HEIGHT>(&RpcServer::on_get_height), true, true } },
+  { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false, true } },
+  { "/sendrawtransaction", { jsonMethod<COMMAND_RPC_SEND_RAW_TX>(&RpcServer::on_send_raw_tx), false, false } },
+  { "/feeaddress", { jsonMethod<COMMAND_RPC_GET_FEE_ADDRESS>(&RpcServer::on_get_fee_address), true, true } },
+  { "/peers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true, false } },
+  { "/getpeers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true, false } },
+  { "/paymentid", { jsonMethod<COMMAND_RPC_GEN_PAYMENT_ID>(&RpcServer::on_get_payment_id), true, true } },
 
   // disabled in restricted rpc mode
-  { "/start_mining", { jsonMethod<COMMAND_RPC_START_MINING>(&RpcServer::on_start_mining), false } },
-  { "/stop_mining", { jsonMethod<COMMAND_RPC_STOP_MINING>(&RpcServer::on_stop_mining), false } },
-  { "/stop_daemon", { jsonMethod<COMMAND_RPC_STOP_DAEMON>(&RpcServer::on_stop_daemon), true } },
+  { "/start_mining", { jsonMethod<COMMAND_RPC_START_MINING>(&RpcServer::on_start_mining), false, false } },
+  { "/stop_mining", { jsonMethod<COMMAND_RPC_STOP_MINING>(&RpcServer::on_stop_mining), false, false } },
+  { "/stop_daemon", { jsonMethod<COMMAND_RPC_STOP_DAEMON>(&RpcServer::on_stop_daemon), true, false } },
 
   // json rpc
-  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true } }
+  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true, true } }
 };
 
 RpcServer::RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, const ICryptoNoteProtocolQuery& protocolQuery) :
@@ -136,7 +136,11 @@ void RpcServer::processRequest(const HttpRequest& request, HttpResponse& respons
     return;
   }
 
-  it->second.handler(this, request, response);
+  if (it->second.parallel) {
+    it->second.handler(this, request, response);
+  } else {
+    runInServerDispatcher([&] { it->second.handler(this, request, response); });
+  }
 }
 
 bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse& response) {
@@ -157,21 +161,22 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
     jsonResponse.setId(jsonRequest.getId()); // copy id
 
     static std::unordered_map<std::string, RpcServer::RpcHandler<JsonMemberMethod>> jsonRpcHandlers = {
-        {"getaltblockslist", {makeMemberMethod(&RpcServer::on_alt_blocks_list_json), true}},
-        {"f_blocks_list_json", {makeMemberMethod(&RpcServer::f_on_blocks_list_json), false}},
-        {"f_block_json", {makeMemberMethod(&RpcServer::f_on_block_json), false}},
-        {"f_transaction_json", {makeMemberMethod(&RpcServer::f_on_transaction_json), false}},
-        {"f_on_transactions_pool_json", {makeMemberMethod(&RpcServer::f_on_transactions_pool_json), false}},
-        {"check_tx_proof", {makeMemberMethod(&RpcServer::k_on_check_tx_proof), false}},
-        {"check_reserve_proof", {makeMemberMethod(&RpcServer::k_on_check_reserve_proof), false}},
-        {"getblockcount", {makeMemberMethod(&RpcServer::on_getblockcount), true}},
-        {"on_getblockhash", {makeMemberMethod(&RpcServer::on_getblockhash), false}},
-        {"getblocktemplate", {makeMemberMethod(&RpcServer::on_getblocktemplate), false}},
-        {"getcurrencyid", {makeMemberMethod(&RpcServer::on_get_currency_id), true}},
-        {"submitblock", {makeMemberMethod(&RpcServer::on_submitblock), false}},
-        {"getlastblockheader", {makeMemberMethod(&RpcServer::on_get_last_block_header), false}},
-        {"getblockheaderbyhash", {makeMemberMethod(&RpcServer::on_get_block_header_by_hash), false}},
-        {"getblockheaderbyheight", {makeMemberMethod(&RpcServer::on_get_block_header_by_height), false}}};
+        {"getaltblockslist", {makeMemberMethod(&RpcServer::on_alt_blocks_list_json), true, true}},
+        {"f_blocks_list_json", {makeMemberMethod(&RpcServer::f_on_blocks_list_json), false, true}},
+        {"f_block_json", {makeMemberMethod(&RpcServer::f_on_block_json), false, true}},
+        {"f_transaction_json", {makeMemberMethod(&RpcServer::f_on_transaction_json), false, true}},
+        {"f_on_transactions_pool_json", {makeMemberMethod(&RpcServer::f_on_transactions_pool_json), false, true}},
+        {"check_tx_proof", {makeMemberMethod(&RpcServer::k_on_check_tx_proof), false, true}},
+        {"check_reserve_proof", {makeMemberMethod(&RpcServer::k_on_check_reserve_proof), false, true}},
+        {"getblockcount", {makeMemberMethod(&RpcServer::on_getblockcount), true, true}},
+        {"on_getblockhash", {makeMemberMethod(&RpcServer::on_getblockhash), false, true}},
+        {"getblocktemplate", {makeMemberMethod(&RpcServer::on_getblocktemplate), false, false}},
+        {"getcurrencyid", {makeMemberMethod(&RpcServer::on_get_currency_id), true, true}},
+        {"submitblock", {makeMemberMethod(&RpcServer::on_submitblock), false, false}},
+        {"getlastblockheader", {makeMemberMethod(&RpcServer::on_get_last_block_header), false, true}},
+        {"getblockheaderbyhash", {makeMemberMethod(&RpcServer::on_get_block_header_by_hash), false, true}},
+        {"getblockheaderbyheight", {makeMemberMethod(&RpcServer::on_get_block_header_by_height), false, true}},
+        {"getblocksummaries", {makeMemberMethod(&RpcServer::on_get_block_summaries), false, true}}};
 
     auto it = jsonRpcHandlers.find(jsonRequest.getMethod());
     if (it == jsonRpcHandlers.end()) {
@@ -182,7 +187,11 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
       throw JsonRpcError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Core is busy");
     }
 
-    it->second.handler(this, jsonRequest, jsonResponse);
+    if (it->second.parallel) {
+      it->second.handler(this, jsonRequest, jsonResponse);
+    } else {
+      runInServerDispatcher([&] { it->second.handler(this, jsonRequest, jsonResponse); });
+    }
 
   } catch (const JsonRpcError& err) {
     jsonResponse.setError(err);
@@ -190,8 +199,9 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
     jsonResponse.setError(JsonRpcError(JsonRpc::errInternalError, e.what()));
   }
 
-  response.setBody(jsonResponse.getBody());
-  logger(TRACE) << "JSON-RPC response: " << jsonResponse.getBody();
+  std::string body = jsonResponse.getBody();
+  logger(TRACE) << "JSON-RPC response: " << body;
+  response.setBody(std::move(body));
   return true;
 }
 
@@ -232,18 +242,17 @@ bool RpcServer::on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, C
   res.current_height = totalBlockCount;
   res.start_height = startBlockIndex;
 
+  res.blocks.reserve(supplement.size());
   for (const auto& blockId : supplement) {
-    assert(m_core.have_block(blockId));
-    auto completeBlock = m_core.getBlock(blockId);
-    assert(completeBlock != nullptr);
+    auto serializedBlock = m_core.getSerializedBlock(blockId);
+    if (!serializedBlock) {
+      // switched to another chain meanwhile
+      break;
+    }
 
     res.blocks.resize(res.blocks.size() + 1);
-    res.blocks.back().block = asString(toBinaryArray(completeBlock->getBlock()));
-
-    res.blocks.back().txs.reserve(completeBlock->getTransactionCount());
-    for (size_t i = 0; i < completeBlock->getTransactionCount(); ++i) {
-      res.blocks.back().txs.push_back(asString(toBinaryArray(completeBlock->getTransaction(i))));
-    }
+    res.blocks.back().block = serializedBlock->block;
+    res.blocks.back().txs = serializedBlock->transactions;
   }
 
   res.status = CORE_RPC_STATUS_OK;
@@ -868,33 +877,65 @@ bool RpcServer::f_on_blocks_list_json(const F_COMMAND_RPC_GET_BLOCKS_LIST::reque
     last_height = 0;
   }
 
-  for (uint32_t i = req.height; i >= last_height; i--) {
-    Hash block_hash = m_core.getBlockIdByHeight(static_cast<uint32_t>(i));
-    Block blk;
-    if (!m_core.getBlockByHash(block_hash, blk)) {
-      throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
-        "Internal error: can't get block by height. Height = " + std::to_string(i) + '.' };
-    }
-
-    size_t tx_cumulative_block_size;
-    m_core.getBlockSize(block_hash, tx_cumulative_block_size);
-    size_t blokBlobSize = getObjectBinarySize(blk);
-    size_t minerTxBlobSize = getObjectBinarySize(blk.baseTransaction);
+  std::vector<BlockSummary> summaries;
+  if (!m_core.getBlockSummaries(last_height, static_cast<uint32_t>(req.height) - last_height + 1, summaries)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
+      "Internal error: can't get blocks from height " + std::to_string(last_height) + '.' };
+  }
 
+  res.blocks.reserve(summaries.size());
+  for (size_t i = summaries.size(); i-- > 0;) {
+    const BlockSummary& summary = summaries[i];
     f_block_short_response block_short;
-    block_short.cumul_size = blokBlobSize + tx_cumulative_block_size - minerTxBlobSize;
-    block_short.timestamp = blk.timestamp;
-    block_short.height = i;
-    m_core.getBlockDifficulty(static_cast<uint32_t>(block_short.height), block_short.difficulty);
-    block_short.hash = Common::podToHex(block_hash);
-    block_short.tx_count = blk.transactionHashes.size() + 1;
-
+    block_short.cumul_size = summary.size;
+    block_short.timestamp = summary.timestamp;
+    block_short.height = last_height + static_cast<uint32_t>(i);
+    block_short.difficulty = summary.difficulty;
+    block_short.hash = Common::podToHex(summary.hash);
+    block_short.tx_count = summary.transactionCount;
     res.blocks.push_back(block_short);
+  }
 
-    if (i == 0)
-      break;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool RpcServer::on_get_block_summaries(const COMMAND_RPC_GET_BLOCK_SUMMARIES::request& req, COMMAND_RPC_GET_BLOCK_SUMMARIES::response& res) {
+  if (req.start_height > req.end_height) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM,
+      "Start height " + std::to_string(req.start_height) + " is above end height " + std::to_string(req.end_height) + '.' };
+  }
+
+  uint32_t pageSize = req.page_size;
+  if (pageSize == 0 || pageSize > COMMAND_RPC_GET_BLOCK_SUMMARIES_MAX_COUNT) {
+    pageSize = static_cast<uint32_t>(COMMAND_RPC_GET_BLOCK_SUMMARIES_MAX_COUNT);
   }
 
+  // one pass over the stored summaries, under one lock
+  uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(pageSize, static_cast<uint64_t>(req.end_height) - req.start_height + 1));
+  std::vector<BlockSummary> summaries;
+  if (!m_core.getBlockSummaries(req.start_height, count, summaries)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_TOO_BIG_HEIGHT,
+      std::string("To big height: ") + std::to_string(req.start_height) + ", current blockchain height = " + std::to_string(m_core.get_current_blockchain_height()) };
+  }
+
+  res.blocks.resize(summaries.size());
+  for (size_t i = 0; i < summaries.size(); ++i) {
+    const BlockSummary& summary = summaries[i];
+    block_summary_response& block = res.blocks[i];
+    block.height = req.start_height + static_cast<uint32_t>(i);
+    block.hash = summary.hash;
+    block.timestamp = summary.timestamp;
+    block.major_version = summary.majorVersion;
+    block.minor_version = summary.minorVersion;
+    block.difficulty = summary.difficulty;
+    block.cumul_size = summary.size;
+    block.tx_count = summary.transactionCount;
+    block.reward = summary.reward;
+    block.already_generated_coins = summary.alreadyGeneratedCoins;
+  }
+
+  res.next_height = req.start_height + static_cast<uint32_t>(summaries.size());
   res.status = CORE_RPC_STATUS_OK;
   return true;
 }
@@ -1186,23 +1227,6 @@ bool RpcServer::on_getblockhash(const COMMAND_RPC_GETBLOCKHASH::request& req, CO
   return true;
 }
 
-namespace {
-  uint64_t slow_memmem(void* start_buff, size_t buflen, void* pat, size_t patlen)
-  {
-    void* buf = start_buff;
-    void* end = (char*)buf + buflen - patlen;
-    while ((buf = memchr(buf, ((char*)pat)[0], buflen)))
-    {
-      if (buf>end)
-        return 0;
-      if (memcmp(buf, pat, patlen) == 0)
-        return (char*)buf - (char*)start_buff;
-      buf = (char*)buf + 1;
-    }
-    return 0;
-  }
-}
-
 bool RpcServer::on_getblocktemplate(const COMMAND_RPC_GETBLOCKTEMPLATE::request& req, COMMAND_RPC_GETBLOCKTEMPLATE::response& res) {
   if (req.reserve_size > TX_EXTRA_NONCE_MAX_COUNT) {
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_TOO_BIG_RESERVE_SIZE, "To big reserved size, maximum 255" };
@@ -1214,36 +1238,12 @@ bool RpcServer::on_getblocktemplate(const COMMAND_RPC_GETBLOCKTEMPLATE::request&
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_WALLET_ADDRESS, "Failed to parse wallet address" };
   }
 
-  Block b = boost::value_initialized<Block>();
-  CryptoNote::BinaryArray blob_reserve;
-  blob_reserve.resize(req.reserve_size, 0);
-  if (!m_core.get_block_template(b, acc, res.difficulty, res.height, blob_reserve)) {
+  BinaryArray block_blob;
+  if (!m_core.getBlockTemplateBlob(acc, req.reserve_size, res.difficulty, res.height, block_blob, res.reserved_offset)) {
     logger(ERROR) << "Failed to create block template";
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: failed to create block template" };
   }
 
-  BinaryArray block_blob = toBinaryArray(b);
-  PublicKey tx_pub_key = CryptoNote::getTransactionPublicKeyFromExtra(b.baseTransaction.extra);
-  if (tx_pub_key == NULL_PUBLIC_KEY) {
-    logger(ERROR) << "Failed to find tx pub key in coinbase extra";
-    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: failed to find tx pub key in coinbase extra" };
-  }
-
-  if (0 < req.reserve_size) {
-    res.reserved_offset = slow_memmem((void*)block_blob.data(), block_blob.size(), &tx_pub_key, sizeof(tx_pub_key));
-    if (!res.reserved_offset) {
-      logger(ERROR) << "Failed to find tx pub key in blockblob";
-      throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: failed to create block template" };
-    }
-    res.reserved_offset += sizeof(tx_pub_key) + 3; //3 bytes: tag for TX_EXTRA_TAG_PUBKEY(1 byte), tag for TX_EXTRA_NONCE(1 byte), counter in TX_EXTRA_NONCE(1 byte)
-    if (res.reserved_offset + req.reserve_size > block_blob.size()) {
-      logger(ERROR) << "Failed to calculate offset for reserved bytes";
-      throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: failed to create block template" };
-    }
-  } else {
-    res.reserved_offset = 0;
-  }
-
   res.blocktemplate_blob = toHex(block_blob);
   res.status = CORE_RPC_STATUS_OK;
 
@@ -44,10 +44,13 @@ public:
 
 private:
 
+  // parallel handlers only read the core, which locks on its own, so with worker threads they run in the thread
+  // serving the connection. Others run in the server dispatcher together with the p2p node.
   template <class Handler>
   struct RpcHandler {
     const Handler handler;
     const bool allowBusyCore;
+    const bool parallel;
   };
 
   typedef void (RpcServer::*HandlerPtr)(const HttpRequest& request, HttpResponse& response);
@@ -88,6 +91,7 @@ private:
   bool on_get_last_block_header(const COMMAND_RPC_GET_LAST_BLOCK_HEADER::request& req, COMMAND_RPC_GET_LAST_BLOCK_HEADER::response& res);
   bool on_get_block_header_by_hash(const COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::request& req, COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::response& res);
   bool on_get_block_header_by_height(const COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::request& req, COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::response& res);
+  bool on_get_block_summaries(const COMMAND_RPC_GET_BLOCK_SUMMARIES::request& req, COMMAND_RPC_GET_BLOCK_SUMMARIES::response& res);
 
   void fill_block_header_response(const Block& blk, bool orphan_status, uint64_t height, const Crypto::Hash& hash, block_header_response& responce);
 
@@ -55,13 +55,14 @@ public:
     return ISerializer::operator()(value, name);
   }
 
+protected:
+  const Common::JsonValue* getValue(Common::StringView name);
+
 private:
   Common::JsonValue value;
   std::vector<const Common::JsonValue*> chain;
   std::vector<size_t> idxs;
 
-  const Common::JsonValue* getValue(Common::StringView name);
-
   template <typename T>
   bool getNumber(Common::StringView name, T& v) {
     auto ptr = getValue(name);
@@ -0,0 +1,412 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "JsonStringInputSerializer.h"
+
+#include <cassert>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+
+#include "Common/StringTools.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+[[noreturn]] void throwParseError() {
+  throw std::runtime_error("Unable to parse");
+}
+
+// Same result as reading the text into an int64_t with std::istream, out of range values are clamped.
+int64_t parseInteger(const char* text, size_t size) {
+  bool negative = size > 0 && text[0] == '-';
+  uint64_t limit = negative ? static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1 : std::numeric_limits<int64_t>::max();
+  uint64_t value = 0;
+  for (size_t i = negative ? 1 : 0; i < size; ++i) {
+    uint64_t digit = text[i] - '0';
+    if (value > (limit - digit) / 10) {
+      value = limit;
+      break;
+    }
+
+    value = value * 10 + digit;
+  }
+
+  return negative ? static_cast<int64_t>(0 - value) : static_cast<int64_t>(value);
+}
+
+}
+
+JsonStringInputSerializer::JsonStringInputSerializer(Common::StringView text) : json(text) {
+  tokens.reserve(json.getSize() / 16 + 1);
+  parseValue(0);
+  if (tokens.front().type != OBJECT) {
+    throw std::runtime_error("Serializer doesn't support this type of serialization: Object expected.");
+  }
+
+  chain.push_back({ 0, 1, tokens.front().count });
+}
+
+JsonStringInputSerializer::~JsonStringInputSerializer() {
+}
+
+ISerializer::SerializerType JsonStringInputSerializer::type() const {
+  return ISerializer::INPUT;
+}
+
+bool JsonStringInputSerializer::beginObject(Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  size_t index = token - tokens.data();
+  chain.push_back({ index, index + 1, token->count });
+  return true;
+}
+
+void JsonStringInputSerializer::endObject() {
+  assert(!chain.empty());
+  chain.pop_back();
+}
+
+bool JsonStringInputSerializer::beginArray(size_t& size, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    size = 0;
+    return false;
+  }
+
+  if (token->type != ARRAY) {
+    throw std::runtime_error("JsonValue type is not ARRAY");
+  }
+
+  size_t index = token - tokens.data();
+  size = token->count;
+  chain.push_back({ index, index + 1, token->count });
+  return true;
+}
+
+void JsonStringInputSerializer::endArray() {
+  assert(!chain.empty());
+  chain.pop_back();
+}
+
+bool JsonStringInputSerializer::operator()(uint8_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonStringInputSerializer::operator()(int16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonStringInputSerializer::operator()(uint16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonStringInputSerializer::operator()(int32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonStringInputSerializer::operator()(uint32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonStringInputSerializer::operator()(int64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonStringInputSerializer::operator()(uint64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+// read as an integer, like JsonInputValueSerializer does
+bool JsonStringInputSerializer::operator()(double& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonStringInputSerializer::operator()(bool& value, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  if (token->type != BOOL) {
+    throw std::runtime_error("JsonValue type is not BOOL");
+  }
+
+  value = token->boolValue;
+  return true;
+}
+
+bool JsonStringInputSerializer::operator()(std::string& value, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  value = getString(*token);
+  return true;
+}
+
+bool JsonStringInputSerializer::binary(void* value, size_t size, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  Common::fromHex(getString(*token), value, size);
+  return true;
+}
+
+bool JsonStringInputSerializer::binary(std::string& value, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  value = Common::asString(Common::fromHex(getString(*token)));
+  return true;
+}
+
+size_t JsonStringInputSerializer::parseValue(size_t offset) {
+  offset = skipWhitespace(offset);
+  if (offset == json.getSize()) {
+    throw std::runtime_error("Unable to parse: unexpected end of stream");
+  }
+
+  size_t token = tokens.size();
+  tokens.push_back({ NIL, false, offset, offset, 0, 0 });
+
+  char c = json[offset];
+  if (c == '{') {
+    tokens[token].type = OBJECT;
+    offset = skipWhitespace(offset + 1);
+    if (offset == json.getSize() || json[offset] != '}') {
+      for (;;) {
+        if (offset == json.getSize() || json[offset] != '"') {
+          throwParseError();
+        }
+
+        size_t key = tokens.size();
+        tokens.push_back({ STRING, false, offset + 1, 0, 0, key + 1 });
+        offset = parseString(offset, key);
+        offset = skipWhitespace(offset);
+        if (offset == json.getSize() || json[offset] != ':') {
+          throwParseError();
+        }
+
+        offset = skipWhitespace(parseValue(offset + 1));
+        ++tokens[token].count;
+        if (offset == json.getSize()) {
+          throwParseError();
+        }
+
+        if (json[offset] == '}') {
+          break;
+        }
+
+        if (json[offset] != ',') {
+          throwParseError();
+        }
+
+        offset = skipWhitespace(offset + 1);
+      }
+    }
+
+    ++offset;
+  } else if (c == '[') {
+    tokens[token].type = ARRAY;
+    offset = skipWhitespace(offset + 1);
+    if (offset == json.getSize() || json[offset] != ']') {
+      for (;;) {
+        offset = skipWhitespace(parseValue(offset));
+        ++tokens[token].count;
+        if (offset == json.getSize()) {
+          throwParseError();
+        }
+
+        if (json[offset] == ']') {
+          break;
+        }
+
+        if (json[offset] != ',') {
+          throwParseError();
+        }
+
+        ++offset;
+      }
+    }
+
+    ++offset;
+  } else if (c == '"') {
+    tokens[token].type = STRING;
+    tokens[token].begin = offset + 1;
+    offset = parseString(offset, token);
+  } else if (c == '-' || (c >= '0' && c <= '9')) {
+    offset = parseNumber(offset, token);
+  } else if (c == 't') {
+    tokens[token].type = BOOL;
+    tokens[token].boolValue = true;
+    offset = parseLiteral(offset, "true");
+  } else if (c == 'f') {
+    tokens[token].type = BOOL;
+    offset = parseLiteral(offset, "false");
+  } else if (c == 'n') {
+    offset = parseLiteral(offset, "null");
+  } else {
+    throwParseError();
+  }
+
+  tokens[token].next = tokens.size();
+  return offset;
+}
+
+// Escape sequences are kept as they are, like JsonValue does.
+size_t JsonStringInputSerializer::parseString(size_t offset, size_t token) {
+  for (++offset; offset < json.getSize(); ++offset) {
+    if (json[offset] == '"') {
+      tokens[token].end = offset;
+      return offset + 1;
+    }
+
+    if (json[offset] == '\\') {
+      ++offset;
+    }
+  }
+
+  throw std::runtime_error("Unable to parse: unexpected end of stream");
+}
+
+size_t JsonStringInputSerializer::parseNumber(size_t offset, size_t token) {
+  size_t begin = offset;
+  size_t dots = 0;
+  for (++offset; offset < json.getSize(); ++offset) {
+    if (json[offset] == '.') {
+      ++dots;
+    } else if (json[offset] < '0' || json[offset] > '9') {
+      break;
+    }
+  }
+
+  if (dots > 0) {
+    if (dots > 1) {
+      throwParseError();
+    }
+
+    if (offset < json.getSize() && json[offset] == 'e') {
+      ++offset;
+      if (offset < json.getSize() && (json[offset] == '+' || json[offset] == '-')) {
+        ++offset;
+      }
+
+      if (offset == json.getSize() || json[offset] < '0' || json[offset] > '9') {
+        throwParseError();
+      }
+
+      while (offset < json.getSize() && json[offset] >= '0' && json[offset] <= '9') {
+        ++offset;
+      }
+    }
+
+    tokens[token].type = REAL;
+  } else {
+    if (offset - begin > 1 && (json[begin] == '0' || (json[begin] == '-' && json[begin + 1] == '0'))) {
+      throwParseError();
+    }
+
+    tokens[token].type = INTEGER;
+  }
+
+  tokens[token].begin = begin;
+  tokens[token].end = offset;
+  return offset;
+}
+
+size_t JsonStringInputSerializer::parseLiteral(size_t offset, const char* literal) {
+  for (; *literal != '\0'; ++literal, ++offset) {
+    if (offset == json.getSize() || json[offset] != *literal) {
+      throwParseError();
+    }
+  }
+
+  return offset;
+}
+
+size_t JsonStringInputSerializer::skipWhitespace(size_t offset) const {
+  while (offset < json.getSize() && std::isspace(static_cast<unsigned char>(json[offset]))) {
+    ++offset;
+  }
+
+  return offset;
+}
+
+const JsonStringInputSerializer::Token* JsonStringInputSerializer::getValue(Common::StringView name) {
+  Scope& scope = chain.back();
+  const Token& parent = tokens[scope.token];
+  if (parent.type == ARRAY) {
+    if (scope.elementsLeft == 0) {
+      throw std::out_of_range("JsonValue array index is out of range");
+    }
+
+    const Token* element = &tokens[scope.nextElement];
+    scope.nextElement = element->next;
+    --scope.elementsLeft;
+    return element;
+  }
+
+  if (parent.type != OBJECT) {
+    throw std::runtime_error("JsonValue type is not OBJECT");
+  }
+
+  // the last of duplicate keys wins, as in JsonValue
+  const Token* value = nullptr;
+  size_t key = scope.token + 1;
+  for (size_t i = 0; i < parent.count; ++i) {
+    const Token& keyToken = tokens[key];
+    if (keyToken.end - keyToken.begin == name.getSize() && Common::StringView(json.getData() + keyToken.begin, name.getSize()) == name) {
+      value = &tokens[key + 1];
+    }
+
+    key = tokens[key + 1].next;
+  }
+
+  return value;
+}
+
+std::string JsonStringInputSerializer::getString(const Token& token) const {
+  if (token.type != STRING) {
+    throw std::runtime_error("JsonValue type is not STRING");
+  }
+
+  return std::string(json.getData() + token.begin, token.end - token.begin);
+}
+
+int64_t JsonStringInputSerializer::getInteger(Common::StringView name, bool& found) {
+  const Token* token = getValue(name);
+  found = token != nullptr;
+  if (token == nullptr) {
+    return 0;
+  }
+
+  if (token->type != INTEGER) {
+    throw std::runtime_error("JsonValue type is not INTEGER");
+  }
+
+  return parseInteger(json.getData() + token->begin, token->end - token->begin);
+}
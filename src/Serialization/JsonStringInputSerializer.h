@@ -0,0 +1,113 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ISerializer.h"
+
+namespace CryptoNote {
+
+// Deserializes from JSON text without building a JsonValue. The text is scanned once into a flat list of tokens
+// that point into it, members are looked up by skipping over the values in between. The text has to outlive
+// the serializer. Accepts the same input as JsonValue::fromString followed by JsonInputValueSerializer.
+class JsonStringInputSerializer : public ISerializer {
+public:
+  JsonStringInputSerializer(Common::StringView text);
+  virtual ~JsonStringInputSerializer();
+
+  SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
+  virtual bool binary(void* value, size_t size, Common::StringView name) override;
+  virtual bool binary(std::string& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+private:
+  enum TokenType : uint8_t {
+    OBJECT,
+    ARRAY,
+    STRING,
+    INTEGER,
+    REAL,
+    BOOL,
+    NIL
+  };
+
+  // Objects are followed by their members as key and value, arrays by their elements.
+  struct Token {
+    TokenType type;
+    bool boolValue;
+    size_t begin;
+    size_t end;
+    size_t count;
+    size_t next;
+  };
+
+  struct Scope {
+    size_t token;
+    size_t nextElement;
+    size_t elementsLeft;
+  };
+
+  Common::StringView json;
+  std::vector<Token> tokens;
+  std::vector<Scope> chain;
+
+  size_t parseValue(size_t offset);
+  size_t parseString(size_t offset, size_t token);
+  size_t parseNumber(size_t offset, size_t token);
+  size_t parseLiteral(size_t offset, const char* literal);
+  size_t skipWhitespace(size_t offset) const;
+
+  const Token* getValue(Common::StringView name);
+  std::string getString(const Token& token) const;
+  int64_t getInteger(Common::StringView name, bool& found);
+
+  template <typename T>
+  bool getNumber(Common::StringView name, T& v) {
+    bool found;
+    int64_t value = getInteger(name, found);
+    if (found) {
+      v = static_cast<T>(value);
+    }
+
+    return found;
+  }
+};
+
+}
@@ -0,0 +1,173 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "JsonStringOutputSerializer.h"
+#include <cassert>
+#include <charconv>
+#include <cstdio>
+#include "Common/StringTools.h"
+
+using namespace CryptoNote;
+
+JsonStringOutputSerializer::JsonStringOutputSerializer() {
+  json.reserve(4096);
+  json += '{';
+  chain.push_back({ false, true });
+}
+
+JsonStringOutputSerializer::~JsonStringOutputSerializer() {
+}
+
+ISerializer::SerializerType JsonStringOutputSerializer::type() const {
+  return ISerializer::OUTPUT;
+}
+
+bool JsonStringOutputSerializer::beginObject(Common::StringView name) {
+  beginValue(name);
+  json += '{';
+  chain.push_back({ false, true });
+  return true;
+}
+
+void JsonStringOutputSerializer::endObject() {
+  assert(chain.size() > 1 && !chain.back().isArray);
+  chain.pop_back();
+  json += '}';
+}
+
+bool JsonStringOutputSerializer::beginArray(size_t& size, Common::StringView name) {
+  beginValue(name);
+  json += '[';
+  chain.push_back({ true, true });
+  return true;
+}
+
+void JsonStringOutputSerializer::endArray() {
+  assert(chain.size() > 1 && chain.back().isArray);
+  chain.pop_back();
+  json += ']';
+}
+
+bool JsonStringOutputSerializer::operator()(uint8_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonStringOutputSerializer::operator()(int16_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonStringOutputSerializer::operator()(uint16_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonStringOutputSerializer::operator()(int32_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonStringOutputSerializer::operator()(uint32_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonStringOutputSerializer::operator()(int64_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+// written as signed, the way JsonOutputStreamSerializer does it
+bool JsonStringOutputSerializer::operator()(uint64_t& value, Common::StringView name) {
+  writeInteger(static_cast<int64_t>(value), name);
+  return true;
+}
+
+bool JsonStringOutputSerializer::operator()(double& value, Common::StringView name) {
+  beginValue(name);
+
+  // same format as JsonValue: fixed with 11 digits, trailing zeros removed up to the first decimal
+  char buffer[400];
+  int length = snprintf(buffer, sizeof(buffer), "%.11f", value);
+  if (length < 0 || static_cast<size_t>(length) >= sizeof(buffer)) {
+    length = 0;
+  }
+
+  while (length > 1 && buffer[length - 2] != '.' && buffer[length - 1] == '0') {
+    --length;
+  }
+
+  json.append(buffer, length);
+  return true;
+}
+
+bool JsonStringOutputSerializer::operator()(bool& value, Common::StringView name) {
+  beginValue(name);
+  json += value ? "true" : "false";
+  return true;
+}
+
+// strings are written as they are, JsonValue neither escapes them on output nor unescapes them on input
+bool JsonStringOutputSerializer::operator()(std::string& value, Common::StringView name) {
+  beginValue(name);
+  json += '"';
+  json += value;
+  json += '"';
+  return true;
+}
+
+bool JsonStringOutputSerializer::binary(void* value, size_t size, Common::StringView name) {
+  beginValue(name);
+  json += '"';
+  Common::toHex(value, size, json);
+  json += '"';
+  return true;
+}
+
+bool JsonStringOutputSerializer::binary(std::string& value, Common::StringView name) {
+  return binary(const_cast<char*>(value.data()), value.size(), name);
+}
+
+std::string JsonStringOutputSerializer::getJson() {
+  assert(chain.size() == 1);
+  json += '}';
+  chain.clear();
+  return std::move(json);
+}
+
+void JsonStringOutputSerializer::beginValue(Common::StringView name) {
+  assert(!chain.empty());
+  Scope& scope = chain.back();
+  if (!scope.empty) {
+    json += ',';
+  }
+
+  scope.empty = false;
+  if (!scope.isArray) {
+    json += '"';
+    json.append(name.getData(), name.getSize());
+    json += "\":";
+  }
+}
+
+void JsonStringOutputSerializer::writeInteger(int64_t value, Common::StringView name) {
+  beginValue(name);
+  char buffer[24];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  json.append(buffer, result.ptr);
+}
@@ -189,6 +189,32 @@ JsonValue parseBinary(Common::IInputStream& stream) {
 KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) : JsonInputValueSerializer(parseBinary(strm)) {
 }
 
+bool KVBinaryInputStreamSerializer::takeString(std::string& value, Common::StringView name) {
+  auto ptr = getValue(name);
+  if (ptr == nullptr) {
+    return false;
+  }
+
+  value = std::move(const_cast<JsonValue*>(ptr)->getString());
+  return true;
+}
+
+bool KVBinaryInputStreamSerializer::takeStrings(std::vector<std::string>& values, Common::StringView name) {
+  size_t size;
+  if (!beginArray(size, name)) {
+    values.clear();
+    return false;
+  }
+
+  values.resize(size);
+  for (auto& value : values) {
+    takeString(value, "");
+  }
+
+  endArray();
+  return true;
+}
+
 bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
   std::string str;
 
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
 #include <Common/IInputStream.h>
 #include "ISerializer.h"
 #include "JsonInputValueSerializer.h"
@@ -27,8 +29,15 @@ class KVBinaryInputStreamSerializer : public JsonInputValueSerializer {
 public:
   KVBinaryInputStreamSerializer(Common::IInputStream& strm);
 
+  using JsonInputValueSerializer::operator();
+
   virtual bool binary(void* value, size_t size, Common::StringView name) override;
   virtual bool binary(std::string& value, Common::StringView name) override;
+
+  // Move strings out of the parsed section instead of copying them. A value that was taken reads as an empty
+  // string afterwards, so these are only for large blobs that the caller reads once.
+  bool takeString(std::string& value, Common::StringView name);
+  bool takeStrings(std::vector<std::string>& values, Common::StringView name);
 };
 
 }
@@ -17,12 +17,15 @@
 
 #pragma once
 
+#include <cassert>
 #include <list>
 #include <vector>
 #include <Common/MemoryInputStream.h>
 #include <Common/StringOutputStream.h>
 #include "JsonInputStreamSerializer.h"
 #include "JsonOutputStreamSerializer.h"
+#include "JsonStringInputSerializer.h"
+#include "JsonStringOutputSerializer.h"
 #include "KVBinaryInputStreamSerializer.h"
 #include "KVBinaryOutputStreamSerializer.h"
 
@@ -89,13 +92,24 @@ void loadFromJsonValue(std::list<T>& v, const Common::JsonValue& js) {
   }
 }
 
+// Objects are written and read as text directly, without a JsonValue in between.
 template <typename T>
 std::string storeToJson(const T& v) {
-  return storeToJsonValue(v).toString();
+  JsonStringOutputSerializer s;
+  serialize(const_cast<T&>(v), s);
+  return s.getJson();
 }
 
 template <typename T>
-bool loadFromJson(T& v, const std::string& buf) {
+std::string storeToJson(const std::vector<T>& v) { return storeToJsonValue(v).toString(); }
+
+template <typename T>
+std::string storeToJson(const std::list<T>& v) { return storeToJsonValue(v).toString(); }
+
+inline std::string storeToJson(const std::string& v) { return storeToJsonValue(v).toString(); }
+
+template <typename T>
+bool loadContainerFromJson(T& v, const std::string& buf) {
   try {
     if (buf.empty()) {
       return true;
@@ -108,6 +122,41 @@ bool loadFromJson(T& v, const std::string& buf) {
   return true;
 }
 
+template <typename T>
+bool loadFromJson(T& v, const std::string& buf) {
+  try {
+    if (buf.empty()) {
+      return true;
+    }
+    JsonStringInputSerializer s(buf);
+    serialize(v, s);
+  } catch (std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+template <typename T>
+bool loadFromJson(std::vector<T>& v, const std::string& buf) { return loadContainerFromJson(v, buf); }
+
+template <typename T>
+bool loadFromJson(std::list<T>& v, const std::string& buf) { return loadContainerFromJson(v, buf); }
+
+// Adds a member with an already serialized value to the serialized object json.
+inline void appendJsonMember(std::string& json, const std::string& name, const std::string& value) {
+  assert(!json.empty() && json.back() == '}');
+  json.pop_back();
+  if (json.size() > 1) {
+    json += ',';
+  }
+
+  json += '"';
+  json += name;
+  json += "\":";
+  json += value;
+  json += '}';
+}
+
 template <typename T>
 std::string storeToBinaryKeyValue(const T& v) {
   KVBinaryOutputStreamSerializer s;
@@ -0,0 +1,301 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "DispatcherPool.h"
+#include <cassert>
+#include <System/ContextGroup.h>
+#include <System/Event.h>
+#include <System/InterruptedException.h>
+
+namespace System {
+
+thread_local DispatcherPool::Worker* DispatcherPool::currentWorker = nullptr;
+
+DispatcherPool::DispatcherPool(size_t threadCount, size_t stackSize) : nextWorker(0), activeProcedures(0), stopping(false), finishing(false), joined(false) {
+  assert(threadCount > 0);
+  for (size_t i = 0; i < threadCount; ++i) {
+    std::unique_ptr<Worker> worker(new Worker());
+    worker->index = i;
+    worker->dispatcher = nullptr;
+    worker->contextGroup = nullptr;
+    worker->workAvailable = nullptr;
+    worker->sleeping = false;
+    workers.push_back(std::move(worker));
+  }
+
+  try {
+    for (auto& worker : workers) {
+      std::promise<void> started;
+      std::future<void> startResult = started.get_future();
+      worker->thread = std::thread(&DispatcherPool::workerProcedure, this, std::ref(*worker), stackSize, std::move(started));
+      startResult.get();
+    }
+  } catch (std::exception&) {
+    stop();
+    throw;
+  }
+}
+
+DispatcherPool::~DispatcherPool() {
+  stop();
+}
+
+size_t DispatcherPool::getThreadCount() const {
+  return workers.size();
+}
+
+void DispatcherPool::spawn(std::function<void(Dispatcher&)>&& procedure) {
+  assert(!joined);
+  Worker* worker = currentWorker;
+  if (worker == nullptr || worker->index >= workers.size() || workers[worker->index].get() != worker) {
+    worker = workers[nextWorker++ % workers.size()].get();
+  }
+
+  push(*worker, false, std::move(procedure));
+}
+
+void DispatcherPool::spawn(size_t index, std::function<void(Dispatcher&)>&& procedure) {
+  assert(!joined);
+  assert(index < workers.size());
+  push(*workers[index], true, std::move(procedure));
+}
+
+void DispatcherPool::stop() {
+  if (joined) {
+    return;
+  }
+
+  stopping = true;
+  for (auto& worker : workers) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (worker->dispatcher != nullptr) {
+      Worker* interruptedWorker = worker.get();
+      worker->dispatcher->remoteSpawn([interruptedWorker] {
+        if (interruptedWorker->contextGroup != nullptr) {
+          interruptedWorker->contextGroup->interrupt();
+        }
+      });
+    }
+  }
+
+  join();
+}
+
+void DispatcherPool::wait() {
+  if (joined) {
+    return;
+  }
+
+  finishing = true;
+  wakeAll();
+  join();
+}
+
+Dispatcher* DispatcherPool::getCurrentDispatcher() {
+  return currentWorker != nullptr ? currentWorker->dispatcher : nullptr;
+}
+
+void DispatcherPool::workerProcedure(Worker& worker, size_t stackSize, std::promise<void> started) {
+  std::unique_ptr<Dispatcher> dispatcher;
+  try {
+    dispatcher.reset(new Dispatcher(stackSize));
+  } catch (std::exception&) {
+    started.set_exception(std::current_exception());
+    return;
+  }
+
+  {
+    Event workAvailable(*dispatcher);
+    ContextGroup contextGroup(*dispatcher);
+    {
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      worker.dispatcher = dispatcher.get();
+      worker.contextGroup = &contextGroup;
+      worker.workAvailable = &workAvailable;
+    }
+
+    currentWorker = &worker;
+    started.set_value();
+    contextGroup.spawn([this, &worker] { schedule(worker); });
+    contextGroup.wait();
+
+    // remote procedures still queued run when the dispatcher is destroyed and find these cleared
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.dispatcher = nullptr;
+    worker.contextGroup = nullptr;
+    worker.workAvailable = nullptr;
+    worker.sleeping = false;
+  }
+
+  currentWorker = nullptr;
+}
+
+void DispatcherPool::schedule(Worker& worker) {
+  while (!stopping) {
+    std::function<void(Dispatcher&)> procedure;
+    if (takeProcedure(worker, procedure)) {
+      run(worker, std::move(procedure));
+      continue;
+    }
+
+    if (completed()) {
+      break;
+    }
+
+    // A procedure queued before sleeping is set doesn't wake this thread, look for one again after setting it
+    worker.workAvailable->clear();
+    setSleeping(worker, true);
+    bool taken = takeProcedure(worker, procedure);
+    bool interrupted = false;
+    if (!taken && !stopping && !completed()) {
+      try {
+        worker.workAvailable->wait();
+      } catch (InterruptedException&) {
+        interrupted = true;
+      }
+    }
+
+    setSleeping(worker, false);
+    if (interrupted) {
+      break;
+    }
+
+    if (taken && !stopping) {
+      run(worker, std::move(procedure));
+    }
+  }
+}
+
+void DispatcherPool::run(Worker& worker, std::function<void(Dispatcher&)>&& procedure) {
+  Dispatcher& dispatcher = *worker.dispatcher;
+  worker.contextGroup->spawn([this, &dispatcher, procedure] {
+    try {
+      procedure(dispatcher);
+    } catch (std::exception&) {
+    }
+
+    onProcedureFinished();
+  });
+
+  // let the procedure start before taking the next one, so that queued procedures are left to idle threads
+  dispatcher.yield();
+}
+
+bool DispatcherPool::takeProcedure(Worker& worker, std::function<void(Dispatcher&)>& procedure) {
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    auto& procedures = !worker.pinnedProcedures.empty() ? worker.pinnedProcedures : worker.procedures;
+    if (!procedures.empty()) {
+      procedure = std::move(procedures.front());
+      procedures.pop_front();
+      return true;
+    }
+  }
+
+  // the owner takes from the front, other threads steal the most recently queued procedures from the back
+  for (size_t i = 1; i < workers.size(); ++i) {
+    Worker& other = *workers[(worker.index + i) % workers.size()];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.procedures.empty()) {
+      procedure = std::move(other.procedures.back());
+      other.procedures.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void DispatcherPool::setSleeping(Worker& worker, bool sleeping) {
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  worker.sleeping = sleeping;
+}
+
+void DispatcherPool::push(Worker& worker, bool pinned, std::function<void(Dispatcher&)>&& procedure) {
+  ++activeProcedures;
+  bool woken = false;
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    (pinned ? worker.pinnedProcedures : worker.procedures).push_back(std::move(procedure));
+    if (worker.sleeping) {
+      wake(worker);
+      woken = true;
+    }
+  }
+
+  // the thread is busy, an idle one can take the procedure
+  if (!woken && !pinned) {
+    wakeIdle();
+  }
+}
+
+// Called with worker.mutex locked
+void DispatcherPool::wake(Worker& worker) {
+  assert(worker.sleeping);
+  assert(worker.dispatcher != nullptr);
+  worker.sleeping = false;
+  Worker* wokenWorker = &worker;
+  worker.dispatcher->remoteSpawn([wokenWorker] {
+    if (wokenWorker->workAvailable != nullptr) {
+      wokenWorker->workAvailable->set();
+    }
+  });
+}
+
+void DispatcherPool::wakeIdle() {
+  for (auto& worker : workers) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (worker->sleeping) {
+      wake(*worker);
+      return;
+    }
+  }
+}
+
+void DispatcherPool::wakeAll() {
+  for (auto& worker : workers) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (worker->sleeping) {
+      wake(*worker);
+    }
+  }
+}
+
+void DispatcherPool::onProcedureFinished() {
+  if (--activeProcedures == 0 && finishing) {
+    wakeAll();
+  }
+}
+
+bool DispatcherPool::completed() const {
+  return finishing && activeProcedures == 0;
+}
+
+void DispatcherPool::join() {
+  for (auto& worker : workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+
+    worker->pinnedProcedures.clear();
+    worker->procedures.clear();
+  }
+
+  joined = true;
+}
+
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <System/Dispatcher.h>
+
+namespace System {
+
+class ContextGroup;
+class Event;
+
+// Runs procedures on threadCount threads, each with its own dispatcher. Every thread has a run queue of procedures
+// that haven't started yet, a thread that runs out of work takes queued procedures of the others. A started procedure
+// stays in its thread, the connections and timers it creates belong to that dispatcher. The procedures of a thread run
+// in one ContextGroup, so they are interrupted and waited for as contexts of a ContextGroup are.
+class DispatcherPool {
+public:
+  explicit DispatcherPool(size_t threadCount, size_t stackSize = Dispatcher::DEFAULT_STACK_SIZE);
+  DispatcherPool(const DispatcherPool&) = delete;
+  ~DispatcherPool();
+  DispatcherPool& operator=(const DispatcherPool&) = delete;
+  size_t getThreadCount() const;
+
+  // Queues procedure in the calling pool thread, or in the threads in turn when called from another thread.
+  void spawn(std::function<void(Dispatcher&)>&& procedure);
+  // Queues procedure in thread index, other threads don't take it.
+  void spawn(size_t index, std::function<void(Dispatcher&)>&& procedure);
+
+  // Interrupts the running procedures, drops the queued ones and joins the threads.
+  void stop();
+  // Joins the threads once all spawned procedures, including the ones spawned by them, have finished.
+  void wait();
+
+  // Dispatcher of the calling thread if it is a thread of any pool, otherwise nullptr.
+  static Dispatcher* getCurrentDispatcher();
+
+private:
+  struct Worker {
+    size_t index;
+    std::thread thread;
+    std::mutex mutex;
+    // set while the thread runs, guarded by mutex
+    Dispatcher* dispatcher;
+    ContextGroup* contextGroup;
+    Event* workAvailable;
+    bool sleeping;
+    std::deque<std::function<void(Dispatcher&)>> pinnedProcedures;
+    std::deque<std::function<void(Dispatcher&)>> procedures;
+  };
+
+  void workerProcedure(Worker& worker, size_t stackSize, std::promise<void> started);
+  void schedule(Worker& worker);
+  bool takeProcedure(Worker& worker, std::function<void(Dispatcher&)>& procedure);
+  void run(Worker& worker, std::function<void(Dispatcher&)>&& procedure);
+  void setSleeping(Worker& worker, bool sleeping);
+  void push(Worker& worker, bool pinned, std::function<void(Dispatcher&)>&& procedure);
+  void wake(Worker& worker);
+  void wakeIdle();
+  void wakeAll();
+  void onProcedureFinished();
+  bool completed() const;
+  void join();
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<size_t> nextWorker;
+  std::atomic<size_t> activeProcedures;
+  std::atomic<bool> stopping;
+  std::atomic<bool> finishing;
+  bool joined;
+
+  static thread_local Worker* currentWorker;
+};
+
+}
@@ -18,12 +18,13 @@
 
 #include "TransfersConsumer.h"
 
+#include <atomic>
 #include <numeric>
 #include <future>
 
 #include "CommonTypes.h"
 #include "Common/StringTools.h"
-#include "Common/BlockingQueue.h"
+#include "Common/ThreadPool.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/TransactionApi.h"
 #include "CryptoNoteCore/TransactionExtra.h"
@@ -44,39 +45,31 @@ namespace {
 
 using namespace CryptoNote;
 
-void checkOutputKey(
-  const KeyDerivation& derivation,
-  const PublicKey& key,
-  size_t keyIndex,
-  size_t outputIndex,
-  const std::unordered_set<PublicKey>& spendKeys,
-  std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
-
-  PublicKey spendKey;
-  underive_public_key(derivation, keyIndex, key, spendKey);
-
-  if (spendKeys.find(spendKey) != spendKeys.end()) {
-    outputs[spendKey].push_back(static_cast<uint32_t>(outputIndex));
-  }
-
-}
-
-void findMyOutputs(
+// Finds the outputs of tx that belong to one of spendKeys. The derivation is computed once per transaction
+// and view key and is returned for the key images of the found outputs.
+bool findMyOutputs(
   const ITransactionReader& tx,
   const SecretKey& viewSecretKey,
   const std::unordered_set<PublicKey>& spendKeys,
+  KeyDerivation& derivation,
   std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
 
   auto txPublicKey = tx.getTransactionPublicKey();
-  KeyDerivation derivation;
 
   if (!generate_key_derivation( txPublicKey, viewSecretKey, derivation)) {
-    return;
+    return false;
   }
 
   size_t keyIndex = 0;
   size_t outputCount = tx.getOutputCount();
 
+  std::vector<PublicKey> keys;
+  std::vector<size_t> keyIndexes;
+  std::vector<uint32_t> outputIndexes;
+  keys.reserve(outputCount);
+  keyIndexes.reserve(outputCount);
+  outputIndexes.reserve(outputCount);
+
   for (size_t idx = 0; idx < outputCount; ++idx) {
 
     auto outType = tx.getOutputType(size_t(idx));
@@ -86,7 +79,9 @@ void findMyOutputs(
       uint64_t amount;
       KeyOutput out;
       tx.getOutput(idx, out, amount);
-      checkOutputKey(derivation, out.key, keyIndex, idx, spendKeys, outputs);
+      keys.push_back(out.key);
+      keyIndexes.push_back(keyIndex);
+      outputIndexes.push_back(static_cast<uint32_t>(idx));
       ++keyIndex;
 
     } else if (outType == TransactionTypes::OutputType::Multisignature) {
@@ -95,11 +90,24 @@ void findMyOutputs(
       MultisignatureOutput out;
       tx.getOutput(idx, out, amount);
       for (const auto& key : out.keys) {
-        checkOutputKey(derivation, key, idx, idx, spendKeys, outputs);
+        keys.push_back(key);
+        keyIndexes.push_back(idx);
+        outputIndexes.push_back(static_cast<uint32_t>(idx));
         ++keyIndex;
      }
     }
   }
+
+  std::vector<PublicKey> spendKeysOfOutputs(keys.size());
+  underive_public_keys(derivation, keyIndexes.data(), keys.data(), keys.size(), spendKeysOfOutputs.data());
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (spendKeys.find(spendKeysOfOutputs[i]) != spendKeys.end()) {
+      outputs[spendKeysOfOutputs[i]].push_back(outputIndexes[i]);
+    }
+  }
+
+  return true;
 }
 
 std::vector<Crypto::Hash> getBlockHashes(const CryptoNote::CompleteBlock* blocks, size_t count) {
@@ -118,10 +126,14 @@ std::vector<Crypto::Hash> getBlockHashes(const CryptoNote::CompleteBlock* blocks
 namespace CryptoNote {
 
 TransfersConsumer::TransfersConsumer(const CryptoNote::Currency& currency, INode& node, Logging::ILogger& logger, const SecretKey& viewSecret) :
-  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer") {
+  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer"), m_threadPool(nullptr) {
   updateSyncStart();
 }
 
+void TransfersConsumer::setThreadPool(Tools::ThreadPool* pool) {
+  m_threadPool = pool;
+}
+
 ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscription& subscription) {
   if (subscription.keys.viewSecretKey != m_viewSecret) {
     throw std::runtime_error("TransfersConsumer: view secret key mismatch");
@@ -205,101 +217,83 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
     const ITransactionReader* tx;
   };
 
-  struct PreprocessedTx : Tx, PreprocessInfo {};
+  struct PreprocessedTx : Tx, PreprocessInfo {
+    std::error_code ec;
+  };
 
+  // collected in block height and transaction index order, every slot is written by a single task
   std::vector<PreprocessedTx> preprocessedTransactions;
-  std::mutex preprocessedTransactionsMutex;
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& block = blocks[i].block;
 
-  size_t workers = std::thread::hardware_concurrency();
-  if (workers == 0) {
-    workers = 2;
-  }
-
-  BlockingQueue<Tx> inputQueue(workers * 2);
-
-  std::atomic<bool> stopProcessing(false);
+    if (!block.is_initialized()) {
+      continue;
+    }
 
-  auto pushingThread = std::async(std::launch::async, [&] {
-    for( uint32_t i = 0; i < count && !stopProcessing; ++i) {
-      const auto& block = blocks[i].block;
+    // filter by syncStartTimestamp
+    if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
+      continue;
+    }
 
-      if (!block.is_initialized()) {
-        continue;
-      }
+    TransactionBlockInfo blockInfo;
+    blockInfo.height = startHeight + i;
+    blockInfo.timestamp = block->timestamp;
+    blockInfo.transactionIndex = 0; // position in block
 
-      // filter by syncStartTimestamp
-      if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
+    for (const auto& tx : blocks[i].transactions) {
+      auto pubKey = tx->getTransactionPublicKey();
+      if (pubKey == NULL_PUBLIC_KEY) {
+        ++blockInfo.transactionIndex;
         continue;
       }
 
-      TransactionBlockInfo blockInfo;
-      blockInfo.height = startHeight + i;
-      blockInfo.timestamp = block->timestamp;
-      blockInfo.transactionIndex = 0; // position in block
-
-      for (const auto& tx : blocks[i].transactions) {
-        auto pubKey = tx->getTransactionPublicKey();
-        if (pubKey == NULL_PUBLIC_KEY) {
-          ++blockInfo.transactionIndex;
-          continue;
-        }
-
-        Tx item = { blockInfo, tx.get() };
-        inputQueue.push(item);
-        ++blockInfo.transactionIndex;
-      }
+      PreprocessedTx item;
+      item.blockInfo = blockInfo;
+      item.tx = tx.get();
+      preprocessedTransactions.push_back(std::move(item));
+      ++blockInfo.transactionIndex;
     }
+  }
 
-    inputQueue.close();
-  });
-
-  auto processingFunction = [&] {
-    Tx item;
-    std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
-
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
-      if (ec) {
-        stopProcessing = true;
-        break;
-      }
+  std::atomic<bool> stopProcessing(false);
+  auto processingFunction = [&](size_t index, size_t) {
+    if (stopProcessing) {
+      return;
+    }
 
-      std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
+    PreprocessedTx& item = preprocessedTransactions[index];
+    item.ec = preprocessOutputs(item.blockInfo, *item.tx, item);
+    if (item.ec) {
+      stopProcessing = true;
     }
-    return ec;
   };
 
-  std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
-  }
-
   std::error_code processingError;
-  for (auto& f : processingThreads) {
-    try {
-      std::error_code ec = f.get();
-      if (!processingError && ec) {
-        processingError = ec;
+  try {
+    if (m_threadPool != nullptr) {
+      m_threadPool->parallelFor(preprocessedTransactions.size(), processingFunction);
+    } else {
+      for (size_t i = 0; i < preprocessedTransactions.size(); ++i) {
+        processingFunction(i, 0);
+      }
+    }
+
+    for (const auto& tx : preprocessedTransactions) {
+      if (tx.ec) {
+        processingError = tx.ec;
+        break;
       }
-    } catch (const std::system_error& e) {
-      processingError = e.code();
-    } catch (const std::exception&) {
-      processingError = std::make_error_code(std::errc::operation_canceled);
     }
+  } catch (const std::system_error& e) {
+    processingError = e.code();
+  } catch (const std::exception&) {
+    processingError = std::make_error_code(std::errc::operation_canceled);
   }
 
   std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
   if (!processingError) {
     m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
 
-    // sort by block height and transaction index in block
-    std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
-      return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-    });
-
     for (const auto& tx : preprocessedTransactions) {
       processTransaction(tx.blockInfo, *tx.tx, tx);
     }
@@ -382,6 +376,7 @@ std::error_code createTransfers(
   const AccountKeys& account,
   const TransactionBlockInfo& blockInfo,
   const ITransactionReader& tx,
+  const KeyDerivation& derivation,
   const std::vector<uint32_t>& outputs,
   const std::vector<uint32_t>& globalIdxs,
   std::vector<TransactionOutputInformationIn>& transfers) {
@@ -389,7 +384,6 @@ std::error_code createTransfers(
   auto txPubKey = tx.getTransactionPublicKey();
   auto txHash = tx.getTransactionHash();
   std::vector<PublicKey> temp_keys;	
-  std::lock_guard<std::mutex> lk(seen_mutex);
 
   if (account.spendSecretKey == NULL_SECRET_KEY)
   {
@@ -402,7 +396,27 @@ std::error_code createTransfers(
     }
   }
 
-  for (auto idx : outputs) {
+  // key images reuse the derivation of the scan and are computed before taking the lock of the seen sets
+  std::vector<KeyImage> keyImages(outputs.size());
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    auto idx = outputs[i];
+    if (idx >= tx.getOutputCount() || tx.getOutputType(size_t(idx)) != TransactionTypes::OutputType::Key) {
+      continue;
+    }
+
+    uint64_t amount;
+    KeyOutput out;
+    tx.getOutput(idx, out, amount);
+
+    SecretKey ephemeralSecretKey;
+    derive_secret_key(derivation, idx, account.spendSecretKey, ephemeralSecretKey);
+    generate_key_image(out.key, ephemeralSecretKey, keyImages[i]);
+  }
+
+  std::lock_guard<std::mutex> lk(seen_mutex);
+
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    auto idx = outputs[i];
 
     if (idx >= tx.getOutputCount()) {
       return std::make_error_code(std::errc::argument_out_of_domain);
@@ -429,15 +443,7 @@ std::error_code createTransfers(
       KeyOutput out;
       tx.getOutput(idx, out, amount);
 
-      CryptoNote::KeyPair in_ephemeral;
-      CryptoNote::generate_key_image_helper(
-        account,
-        txPubKey,
-        idx,
-        in_ephemeral,
-        info.keyImage);
-
-      assert(out.key == reinterpret_cast<const PublicKey&>(in_ephemeral.publicKey));
+      info.keyImage = keyImages[i];
 
       std::unordered_set<Crypto::Hash>::iterator it = transactions_hash_seen.find(tx.getTransactionHash());
 	  if (it == transactions_hash_seen.end()) {
@@ -491,8 +497,11 @@ std::error_code createTransfers(
 
 std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
   std::unordered_map<PublicKey, std::vector<uint32_t>> outputs;
+  KeyDerivation derivation;
    try {
-    findMyOutputs(tx, m_viewSecret, m_spendKeys, outputs);
+    if (!findMyOutputs(tx, m_viewSecret, m_spendKeys, derivation, outputs)) {
+      return std::error_code();
+    }
   }
   catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction: " << e.what() << ", transaction hash " << Common::podToHex(tx.getTransactionHash());
@@ -517,7 +526,7 @@ std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo&
     if (it != m_subscriptions.end()) {
       auto& transfers = info.outputs[kv.first];
        try {
-		  errorCode = createTransfers(it->second->getKeys(), blockInfo, tx, kv.second, info.globalIdxs, transfers);
+		  errorCode = createTransfers(it->second->getKeys(), blockInfo, tx, derivation, kv.second, info.globalIdxs, transfers);
 		  if (errorCode) {
 			  return errorCode;
 		  }
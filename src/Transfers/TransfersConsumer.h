@@ -29,6 +29,10 @@
 
 #include <unordered_set>
 
+namespace Tools {
+class ThreadPool;
+}
+
 namespace CryptoNote {
 
 class INode;
@@ -46,7 +50,9 @@ public:
 
   void initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions);
   void addPublicKeysSeen(const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey);
-  
+  // Outputs of new blocks are scanned on the pool, or on the calling thread without one.
+  void setThreadPool(Tools::ThreadPool* pool);
+
   // IBlockchainConsumer
   virtual SynchronizationStart getSyncStart() override;
   virtual void onBlockchainDetach(uint32_t height) override;
@@ -91,6 +97,7 @@ private:
   INode& m_node;
   const CryptoNote::Currency& m_currency;
   Logging::LoggerRef m_logger;
+  Tools::ThreadPool* m_threadPool;
 };
 
 }
@@ -18,6 +18,9 @@
 #include "TransfersSynchronizer.h"
 #include "TransfersConsumer.h"
 
+#include <algorithm>
+#include <thread>
+
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "Serialization/BinaryInputStreamSerializer.h"
@@ -31,7 +34,8 @@ namespace CryptoNote {
 const uint32_t TRANSFERS_STORAGE_ARCHIVE_VERSION = 0;
 
 TransfersSyncronizer::TransfersSyncronizer(const CryptoNote::Currency& currency, Logging::ILogger& logger, IBlockchainSynchronizer& sync, INode& node) :
-  m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_sync(sync), m_node(node) {
+  m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_sync(sync), m_node(node),
+  m_threadPool(std::max(std::thread::hardware_concurrency(), 2u)) {
 }
 
 TransfersSyncronizer::~TransfersSyncronizer() {
@@ -54,6 +58,7 @@ ITransfersSubscription& TransfersSyncronizer::addSubscription(const AccountSubsc
     std::unique_ptr<TransfersConsumer> consumer(
       new TransfersConsumer(m_currency, m_node, m_logger.getLogger(), acc.keys.viewSecretKey));
 
+    consumer->setThreadPool(&m_threadPool);
     m_sync.addConsumer(consumer.get());
     consumer->addObserver(this);
     it = m_consumers.insert(std::make_pair(acc.keys.address.viewPublicKey, std::move(consumer))).first;
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "Common/ObserverManager.h"
+#include "Common/ThreadPool.h"
 #include "ITransfersSynchronizer.h"
 #include "IBlockchainSynchronizer.h"
 #include "TypeHelpers.h"
@@ -74,6 +75,8 @@ private:
   IBlockchainSynchronizer& m_sync;
   INode& m_node;
   const CryptoNote::Currency& m_currency;
+  // shared by all consumers, they are called one at a time by the blockchain synchronizer
+  Tools::ThreadPool m_threadPool;
 
   virtual void onBlocksAdded(IBlockchainConsumer* consumer, const std::vector<Crypto::Hash>& blockHashes) override;
   virtual void onBlockchainDetach(IBlockchainConsumer* consumer, uint32_t blockIndex) override;
@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "crypto-ops.h"
@@ -1168,16 +1169,23 @@ B is the Ed25519 base point (x,4/5) with x positive.
 */
 
 void ge_double_scalarmult_base_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b) {
+  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
+
+  ge_dsm_precomp(Ai, A);
+  ge_double_scalarmult_base_precomp_vartime(r, a, Ai, b);
+}
+
+/* Same as above, with the table of A computed by the caller */
+
+void ge_double_scalarmult_base_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_dsmp Ai, const unsigned char *b) {
   signed char aslide[256];
   signed char bslide[256];
-  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
   ge_p1p1 t;
   ge_p3 u;
   int i;
 
   slide(aslide, a);
   slide(bslide, b);
-  ge_dsm_precomp(Ai, A);
 
   ge_p2_0(r);
 
@@ -1593,6 +1601,46 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h) {
   s[31] ^= fe_isnegative(x) << 7;
 }
 
+/* Same as ge_tobytes for count points, sharing one field inversion per group (Montgomery's trick) */
+
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, size_t count) {
+  fe acc[32];
+  fe recip;
+  fe zinv;
+  fe x;
+  fe y;
+  size_t group;
+  size_t i;
+
+  while (count > 0) {
+    group = count < 32 ? count : 32;
+
+    fe_copy(acc[0], h[0].Z);
+    for (i = 1; i < group; ++i) {
+      fe_mul(acc[i], acc[i - 1], h[i].Z);
+    }
+
+    fe_invert(recip, acc[group - 1]);
+    for (i = group; i-- > 0;) {
+      if (i > 0) {
+        fe_mul(zinv, recip, acc[i - 1]);
+        fe_mul(recip, recip, h[i].Z);
+      } else {
+        fe_copy(zinv, recip);
+      }
+
+      fe_mul(x, h[i].X, zinv);
+      fe_mul(y, h[i].Y, zinv);
+      fe_tobytes(s + 32 * i, y);
+      s[32 * i + 31] ^= fe_isnegative(x) << 7;
+    }
+
+    s += 32 * group;
+    h += group;
+    count -= group;
+  }
+}
+
 /* From sc_reduce.c */
 
 /*
@@ -1976,16 +2024,21 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
 }
 
 void ge_double_scalarmult_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b, const ge_dsmp Bi) {
+  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
+
+  ge_dsm_precomp(Ai, A);
+  ge_double_scalarmult_precomp_vartime2(r, a, Ai, b, Bi);
+}
+
+void ge_double_scalarmult_precomp_vartime2(ge_p2 *r, const unsigned char *a, const ge_dsmp Ai, const unsigned char *b, const ge_dsmp Bi) {
   signed char aslide[256];
   signed char bslide[256];
-  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
   ge_p1p1 t;
   ge_p3 u;
   int i;
 
   slide(aslide, a);
   slide(bslide, b);
-  ge_dsm_precomp(Ai, A);
 
   ge_p2_0(r);
 
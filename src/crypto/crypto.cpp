@@ -263,6 +263,42 @@ namespace Crypto {
   }
 
 
+  void crypto_ops::underive_public_keys(const KeyDerivation &derivation, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases) {
+    std::vector<ge_p2> points;
+    std::vector<size_t> pointIndexes;
+    points.reserve(count);
+    pointIndexes.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+      EllipticCurveScalar scalar;
+      ge_p3 point1;
+      ge_p3 point2;
+      ge_cached point3;
+      ge_p1p1 point4;
+      if (ge_frombytes_vartime(&point1, reinterpret_cast<const unsigned char*>(&derived_keys[i])) != 0) {
+        memset(&bases[i], 0, sizeof(PublicKey));
+        continue;
+      }
+
+      derivation_to_scalar(derivation, output_indexes[i], scalar);
+      ge_scalarmult_base(&point2, reinterpret_cast<unsigned char*>(&scalar));
+      ge_p3_to_cached(&point3, &point2);
+      ge_sub(&point4, &point1, &point3);
+      points.emplace_back();
+      ge_p1p1_to_p2(&points.back(), &point4);
+      pointIndexes.push_back(i);
+    }
+
+    // encoding a point takes a field inversion, the batch shares one between up to 32 points
+    std::vector<PublicKey> encoded(points.size());
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      bases[pointIndexes[i]] = encoded[i];
+    }
+  }
+
+
   struct s_comm {
     Hash h;
     EllipticCurvePoint key;
@@ -436,7 +472,7 @@ void crypto_ops::generate_tx_proof(const Hash &prefix_hash, const PublicKey &R,
     return sc_isnonzero(&c2) == 0;
   }
 
-  static void hash_to_ec(const PublicKey &key, ge_p3 &res) {
+  void hash_to_ec(const PublicKey &key, ge_p3 &res) {
     Hash h;
     ge_p2 point;
     ge_p1p1 point2;
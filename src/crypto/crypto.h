@@ -70,6 +70,8 @@ namespace Crypto {
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     static bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
+    static void underive_public_keys(const KeyDerivation &, const size_t *, const PublicKey *, size_t, PublicKey *);
+    friend void underive_public_keys(const KeyDerivation &, const size_t *, const PublicKey *, size_t, PublicKey *);
     static void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     friend void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     static bool check_signature(const Hash &, const PublicKey &, const Signature &);
@@ -211,6 +213,14 @@ namespace Crypto {
     return crypto_ops::underive_public_key(derivation, output_index, derived_key, base);
   }
 
+  /* underive_public_key for count keys of one derivation at once, cheaper per key than separate calls.
+   * A derived key that is not a valid point gives an all-zero base.
+   */
+  inline void underive_public_keys(const KeyDerivation &derivation, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases) {
+    crypto_ops::underive_public_keys(derivation, output_indexes, derived_keys, count, bases);
+  }
+
   /* Generation and checking of a standard signature.
    */
   inline void generate_signature(const Hash &prefix_hash, const PublicKey &pub, const SecretKey &sec, Signature &sig) {
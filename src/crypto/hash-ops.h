@@ -60,12 +60,16 @@ void hash_process(union hash_state *state, const uint8_t *buf, size_t count);
 enum {
   HASH_SIZE = 32,
   HASH_DATA_AREA = 136,
-  SLOW_HASH_CONTEXT_SIZE = 2097552
+  SLOW_HASH_CONTEXT_SIZE = 2097552,
+  SLOW_HASH_MAX_WAYS = 4
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
 
 void cn_slow_hash(const void *data, size_t length, char *hash, int light, int variant, int prehashed); 
+void cn_slow_hash_batch(const void *data, size_t length, size_t count, char *hashes, int light, int variant);
+void cn_slow_hash_multi(const void *const *data, const size_t *lengths, size_t count, char *hashes, int light, int variant, size_t ways);
+size_t cn_slow_hash_ways(int light, int variant);
 
 void hash_extra_blake(const void *data, size_t length, char *hash);
 void hash_extra_groestl(const void *data, size_t length, char *hash);
@@ -70,6 +70,16 @@ namespace Crypto {
     cn_slow_hash(data, length, reinterpret_cast<char *>(&hash), light, variant, 0); 
   }
   
+  // Hashes count inputs of length bytes stored one after another in data
+  inline void cn_slow_hash_batch(cn_context &context, const void *data, size_t length, size_t count, Hash *hashes, int light = 0, int variant = 0) {
+    cn_slow_hash_batch(data, length, count, reinterpret_cast<char *>(hashes), light, variant);
+  }
+
+  // Hashes count inputs of lengths[i] bytes at data[i], ways of them at once, 0 for cn_slow_hash_ways(light, variant)
+  inline void cn_slow_hash_multi(cn_context &context, const void *const *data, const size_t *lengths, size_t count, Hash *hashes, int light = 0, int variant = 0, size_t ways = 0) {
+    cn_slow_hash_multi(data, lengths, count, reinterpret_cast<char *>(hashes), light, variant, ways);
+  }
+
   inline void cn_slow_hash_prehashed(const void *data, std::size_t length, Hash &hash, int light = 0, int variant = 0, int prehashed = 0) {
      cn_slow_hash(data, length, reinterpret_cast<char *>(&hash), light, variant, 1);
   }
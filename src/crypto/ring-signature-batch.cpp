@@ -0,0 +1,180 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// it will be useful, but WITHOUT ANY WARRANTY; without even an
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "ring-signature-batch.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Crypto {
+
+  extern "C" {
+#include "crypto-ops.h"
+  }
+
+  // crypto.cpp
+  void hash_to_ec(const PublicKey &key, ge_p3 &res);
+
+  namespace {
+
+  struct RingMemberTables {
+    ge_dsmp key;
+    ge_dsmp hashedKey;
+    bool valid;
+  };
+
+  void precomputeRingMember(const PublicKey &pub, RingMemberTables &tables) {
+    ge_p3 point;
+    if (ge_frombytes_vartime(&point, reinterpret_cast<const unsigned char *>(&pub)) != 0) {
+      tables.valid = false;
+      return;
+    }
+
+    ge_dsm_precomp(tables.key, &point);
+    hash_to_ec(pub, point);
+    ge_dsm_precomp(tables.hashedKey, &point);
+    tables.valid = true;
+  }
+
+  // Same computation as crypto_ops::check_ring_signature, with the ring member tables computed beforehand.
+  bool checkRingSignature(const Hash &prefix_hash, const KeyImage &image, const std::vector<const RingMemberTables *> &ring,
+    const Signature *sig) {
+    ge_p3 image_unp;
+    ge_dsmp image_pre;
+    EllipticCurveScalar sum, h;
+    // rs_comm: prefix hash followed by the (a, b) pair of every ring member
+    std::vector<unsigned char> buf(sizeof(Hash) + ring.size() * 2 * sizeof(EllipticCurvePoint));
+    if (ge_frombytes_vartime(&image_unp, reinterpret_cast<const unsigned char *>(&image)) != 0) {
+      return false;
+    }
+    ge_dsm_precomp(image_pre, &image_unp);
+    sc_0(reinterpret_cast<unsigned char *>(&sum));
+    memcpy(buf.data(), &prefix_hash, sizeof(Hash));
+    for (size_t i = 0; i < ring.size(); i++) {
+      ge_p2 tmp2;
+      const unsigned char *c = reinterpret_cast<const unsigned char *>(&sig[i]);
+      const unsigned char *r = c + 32;
+      unsigned char *ab = buf.data() + sizeof(Hash) + i * 2 * sizeof(EllipticCurvePoint);
+      if (sc_check(c) != 0 || sc_check(r) != 0 || !ring[i]->valid) {
+        return false;
+      }
+      ge_double_scalarmult_base_precomp_vartime(&tmp2, c, ring[i]->key, r);
+      ge_tobytes(ab, &tmp2);
+      ge_double_scalarmult_precomp_vartime2(&tmp2, r, ring[i]->hashedKey, c, image_pre);
+      ge_tobytes(ab + sizeof(EllipticCurvePoint), &tmp2);
+      sc_add(reinterpret_cast<unsigned char *>(&sum), reinterpret_cast<unsigned char *>(&sum), c);
+    }
+    hash_to_scalar(buf.data(), buf.size(), h);
+    sc_sub(reinterpret_cast<unsigned char *>(&h), reinterpret_cast<unsigned char *>(&h), reinterpret_cast<unsigned char *>(&sum));
+    return sc_isnonzero(reinterpret_cast<unsigned char *>(&h)) == 0;
+  }
+
+  }
+
+  size_t RingSignatureBatch::add(const Hash &prefix_hash, const KeyImage &image, const PublicKey *const *pubs, size_t pubs_count,
+    const Signature *sig) {
+    std::vector<size_t> &candidates = m_entriesByImage[image];
+    for (size_t index : candidates) {
+      const Entry &entry = m_entries[index];
+      if (entry.prefixHash == prefix_hash && entry.pubs.size() == pubs_count &&
+        std::equal(entry.sigs.begin(), entry.sigs.end(), sig) &&
+        std::equal(entry.pubs.begin(), entry.pubs.end(), pubs, [](const PublicKey &a, const PublicKey *b) { return a == *b; })) {
+        m_ids.push_back(index);
+        return m_ids.size() - 1;
+      }
+    }
+
+    Entry entry;
+    entry.prefixHash = prefix_hash;
+    entry.image = image;
+    for (size_t i = 0; i < pubs_count; i++) {
+      entry.pubs.push_back(*pubs[i]);
+    }
+    entry.sigs.assign(sig, sig + pubs_count);
+    entry.verified = false;
+    entry.valid = false;
+    m_entries.push_back(std::move(entry));
+
+    candidates.push_back(m_entries.size() - 1);
+    m_ids.push_back(m_entries.size() - 1);
+    return m_ids.size() - 1;
+  }
+
+  size_t RingSignatureBatch::size() const {
+    return m_ids.size();
+  }
+
+  void RingSignatureBatch::clear() {
+    m_entries.clear();
+    m_ids.clear();
+    m_entriesByImage.clear();
+  }
+
+  bool RingSignatureBatch::verify(const ParallelFor &parallelFor) {
+    auto run = [&parallelFor](size_t count, const std::function<void(size_t)> &task) {
+      if (parallelFor) {
+        parallelFor(count, task);
+      } else {
+        for (size_t i = 0; i < count; i++) {
+          task(i);
+        }
+      }
+    };
+
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < m_entries.size(); i++) {
+      if (!m_entries[i].verified) {
+        pending.push_back(i);
+      }
+    }
+
+    std::unordered_map<PublicKey, size_t> memberIndexes;
+    std::vector<const PublicKey *> members;
+    std::vector<std::vector<size_t>> rings(pending.size());
+    for (size_t i = 0; i < pending.size(); i++) {
+      for (const PublicKey &pub : m_entries[pending[i]].pubs) {
+        auto inserted = memberIndexes.emplace(pub, members.size());
+        if (inserted.second) {
+          members.push_back(&pub);
+        }
+        rings[i].push_back(inserted.first->second);
+      }
+    }
+
+    std::vector<RingMemberTables> tables(members.size());
+    run(members.size(), [&](size_t i) {
+      precomputeRingMember(*members[i], tables[i]);
+    });
+
+    run(pending.size(), [&](size_t i) {
+      Entry &entry = m_entries[pending[i]];
+      std::vector<const RingMemberTables *> ring;
+      for (size_t member : rings[i]) {
+        ring.push_back(&tables[member]);
+      }
+      entry.valid = checkRingSignature(entry.prefixHash, entry.image, ring, entry.sigs.data());
+      entry.verified = true;
+    });
+
+    return std::all_of(m_entries.begin(), m_entries.end(), [](const Entry &entry) { return entry.valid; });
+  }
+
+  bool RingSignatureBatch::isValid(size_t id) const {
+    const Entry &entry = m_entries[m_ids[id]];
+    return entry.verified && entry.valid;
+  }
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// it will be useful, but WITHOUT ANY WARRANTY; without even an
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto.h"
+
+namespace Crypto {
+
+  /* Verifies a set of ring signatures, e.g. all inputs of a block, at once.
+   * A signature added more than once is checked once, and every ring member is decoded and
+   * expanded into its precomputed tables once per batch however many rings it appears in.
+   */
+  class RingSignatureBatch {
+  public:
+    // Runs task(index) for every index in [0, count), possibly in parallel, and returns when all are done.
+    typedef std::function<void(size_t count, const std::function<void(size_t index)>& task)> ParallelFor;
+
+    // Returns the id to query the result with, pubs and sigs are copied.
+    size_t add(const Hash &prefix_hash, const KeyImage &image, const PublicKey *const *pubs, size_t pubs_count,
+      const Signature *sig);
+    size_t add(const Hash &prefix_hash, const KeyImage &image, const std::vector<const PublicKey *> &pubs,
+      const Signature *sig) {
+      return add(prefix_hash, image, pubs.data(), pubs.size(), sig);
+    }
+
+    // Count of signatures added, with duplicates.
+    size_t size() const;
+    void clear();
+
+    // Checks the signatures added since the last call, returns true if all of them are valid.
+    // Without parallelFor everything runs on the calling thread.
+    bool verify(const ParallelFor &parallelFor = ParallelFor());
+    bool isValid(size_t id) const;
+
+  private:
+    struct Entry {
+      Hash prefixHash;
+      KeyImage image;
+      std::vector<PublicKey> pubs;
+      std::vector<Signature> sigs;
+      bool verified;
+      bool valid;
+    };
+
+    std::vector<Entry> m_entries;
+    std::vector<size_t> m_ids;
+    std::unordered_map<KeyImage, std::vector<size_t>> m_entriesByImage;
+  };
+}
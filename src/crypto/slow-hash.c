@@ -208,13 +208,13 @@ extern int aesb_pseudo_round(const uint8_t *in, uint8_t *out, const uint8_t *exp
       xor_blocks(d, long_state + (j ^ 0x20)); \
     }
 
-#define VARIANT2_2() \
+#define VARIANT2_2(base_ptr) \
   do if (variant >= 2) \
   { \
-    *U64(hp_state + (j ^ 0x10)) ^= hi; \
-    *(U64(hp_state + (j ^ 0x10)) + 1) ^= lo; \
-    hi ^= *U64(hp_state + (j ^ 0x20)); \
-    lo ^= *(U64(hp_state + (j ^ 0x20)) + 1); \
+    *U64((base_ptr) + (j ^ 0x10)) ^= hi; \
+    *(U64((base_ptr) + (j ^ 0x10)) + 1) ^= lo; \
+    hi ^= *U64((base_ptr) + (j ^ 0x20)); \
+    lo ^= *(U64((base_ptr) + (j ^ 0x20)) + 1); \
   } while (0)
 
 
@@ -302,7 +302,7 @@ extern int aesb_pseudo_round(const uint8_t *in, uint8_t *out, const uint8_t *exp
   b[0] = p[0]; b[1] = p[1]; \
   VARIANT2_INTEGER_MATH_SSE2(b, c); \
   __mul(); \
-  VARIANT2_2(); \
+  VARIANT2_2(hp_state); \
   VARIANT2_SHUFFLE_ADD_SSE2(hp_state, j); \
   a[0] += hi; a[1] += lo; \
   p = U64(&hp_state[j]); \
@@ -332,6 +332,8 @@ union cn_slow_hash_state
 
 THREADV uint8_t *hp_state = NULL;
 THREADV int hp_allocated = 0;
+THREADV uint8_t *hp_lanes_state = NULL;
+THREADV int hp_lanes_allocated = 0;
 
 #if defined(_MSC_VER)
 #define cpuid(info,x)    __cpuidex(info,x,0)
@@ -603,68 +605,126 @@ BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
 #endif
 
 /**
- * @brief allocate the 2MB scratch buffer using OS support for huge pages, if available
+ * @brief allocates size bytes using OS support for huge pages, if available
  *
- * This function tries to allocate the 2MB scratch buffer using a single
- * 2MB "huge page" (instead of the usual 4KB page sizes) to reduce TLB misses
- * during the random accesses to the scratch buffer.  This is one of the
- * important speed optimizations needed to make CryptoNight faster.
+ * Falls back to ordinary pages, advised to be backed by transparent huge pages
+ * where the OS supports it, and then to malloc.
  *
- * No parameters.  Updates a thread-local pointer, hp_state, to point to
- * the allocated buffer.
+ * @param size the number of bytes to allocate, a multiple of 2MB
+ * @param mapped set to 1 when the buffer must be released with free_huge_pages, 0 when with free
+ * @return the allocated buffer, NULL if no memory is left
  */
 
-void slow_hash_allocate_state(void)
+STATIC uint8_t *allocate_huge_pages(size_t size, int *mapped)
 {
-    if(hp_state != NULL)
-        return;
+    uint8_t *buffer = NULL;
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
     SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
-    hp_state = (uint8_t *) VirtualAlloc(hp_state, MEMORY, MEM_LARGE_PAGES |
-                                        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    buffer = (uint8_t *) VirtualAlloc(NULL, size, MEM_LARGE_PAGES |
+                                      MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 #else
 #if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
   defined(__DragonFly__) || defined(__NetBSD__)
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANON, 0, 0);
+    buffer = mmap(0, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANON, 0, 0);
 #else
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
+    buffer = mmap(0, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
+#if defined(MADV_HUGEPAGE)
+    if(buffer == MAP_FAILED)
+    {
+        // no huge pages reserved, transparent ones may still back the buffer
+        buffer = mmap(0, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, 0, 0);
+        if(buffer != MAP_FAILED)
+            madvise(buffer, size, MADV_HUGEPAGE);
+    }
 #endif
-    if(hp_state == MAP_FAILED)
-        hp_state = NULL;
 #endif
-    hp_allocated = 1;
-    if(hp_state == NULL)
+    if(buffer == MAP_FAILED)
+        buffer = NULL;
+#endif
+    *mapped = 1;
+    if(buffer == NULL)
     {
-        hp_allocated = 0;
-        hp_state = (uint8_t *) malloc(MEMORY);
+        *mapped = 0;
+        buffer = (uint8_t *) malloc(size);
     }
+
+    return buffer;
 }
 
 /**
- *@brief frees the state allocated by slow_hash_allocate_state
+ * @brief frees a buffer allocated by allocate_huge_pages
  */
 
-void slow_hash_free_state(void)
+STATIC void free_huge_pages(uint8_t *buffer, size_t size, int mapped)
 {
-    if(hp_state == NULL)
-        return;
-
-    if(!hp_allocated)
-        free(hp_state);
+    if(!mapped)
+        free(buffer);
     else
     {
 #if defined(_MSC_VER) || defined(__MINGW32__)
-        VirtualFree(hp_state, 0, MEM_RELEASE);
+        VirtualFree(buffer, 0, MEM_RELEASE);
 #else
-        munmap(hp_state, MEMORY);
+        munmap(buffer, size);
 #endif
     }
+}
+
+/**
+ * @brief allocate the 2MB scratch buffer using OS support for huge pages, if available
+ *
+ * This function tries to allocate the 2MB scratch buffer using a single
+ * 2MB "huge page" (instead of the usual 4KB page sizes) to reduce TLB misses
+ * during the random accesses to the scratch buffer.  This is one of the
+ * important speed optimizations needed to make CryptoNight faster.
+ *
+ * No parameters.  Updates a thread-local pointer, hp_state, to point to
+ * the allocated buffer.
+ */
+
+void slow_hash_allocate_state(void)
+{
+    if(hp_state != NULL)
+        return;
+
+    hp_state = allocate_huge_pages(MEMORY, &hp_allocated);
+}
+
+/**
+ * @brief allocates the scratch buffers of the multi-way kernel, SLOW_HASH_MAX_WAYS * 2MB
+ * in one huge page backed block, the same way as slow_hash_allocate_state
+ */
+
+STATIC void slow_hash_allocate_lanes_state(void)
+{
+    if(hp_lanes_state != NULL)
+        return;
+
+    hp_lanes_state = allocate_huge_pages(MEMORY * SLOW_HASH_MAX_WAYS, &hp_lanes_allocated);
+}
+
+/**
+ *@brief frees the state allocated by slow_hash_allocate_state and by the multi-way kernel
+ */
+
+void slow_hash_free_state(void)
+{
+    if(hp_state != NULL)
+    {
+        free_huge_pages(hp_state, MEMORY, hp_allocated);
+        hp_state = NULL;
+        hp_allocated = 0;
+    }
 
-    hp_state = NULL;
-    hp_allocated = 0;
+    if(hp_lanes_state != NULL)
+    {
+        free_huge_pages(hp_lanes_state, MEMORY * SLOW_HASH_MAX_WAYS, hp_lanes_allocated);
+        hp_lanes_state = NULL;
+        hp_lanes_allocated = 0;
+    }
 }
 
 /**
@@ -833,6 +893,217 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
     extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
 }
 
+#if defined(_MSC_VER)
+#define FORCE_INLINE __forceinline
+#else
+#define FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+#if defined(__clang__)
+#define UNROLL_WAYS _Pragma("unroll")
+#elif defined(__GNUC__) && __GNUC__ >= 8
+#define UNROLL_WAYS _Pragma("GCC unroll 4")
+#else
+#define UNROLL_WAYS
+#endif
+
+/**
+ * @brief state of one of the hashes computed together by cn_slow_hash_ways_kernel
+ */
+
+struct cn_slow_hash_lane
+{
+    RDATA_ALIGN16 uint64_t a[2];
+    __m128i b;
+    __m128i b1;
+    uint64_t division_result;
+    uint64_t sqrt_result;
+    uint8_t *long_state;
+    union cn_slow_hash_state state;
+};
+
+/**
+ * @brief one iteration of CryptoNight step 3 for variant 2, pre_aes and post_aes applied to a lane
+ */
+
+STATIC FORCE_INLINE void cn_slow_hash_lane_round(struct cn_slow_hash_lane *lane, int light)
+{
+    const int variant = 2;
+    uint8_t *long_state = lane->long_state;
+    uint64_t *a = lane->a;
+    RDATA_ALIGN16 uint64_t b[2];
+    RDATA_ALIGN16 uint64_t c[2];
+    uint64_t division_result = lane->division_result;
+    uint64_t sqrt_result = lane->sqrt_result;
+    __m128i _a, _b, _b1, _c;
+    uint64_t hi, lo;
+    uint64_t *p;
+    size_t j;
+
+    _b = lane->b;
+    _b1 = lane->b1;
+    j = state_index(a,(light?16:1));
+    _c = _mm_load_si128(R128(&long_state[j]));
+    _a = _mm_load_si128(R128(a));
+    _c = _mm_aesenc_si128(_c, _a);
+    VARIANT2_SHUFFLE_ADD_SSE2(long_state, j);
+    _mm_store_si128(R128(c), _c);
+    _mm_store_si128(R128(&long_state[j]), _mm_xor_si128(_b, _c));
+    j = state_index(c,(light?16:1));
+    p = U64(&long_state[j]);
+    b[0] = p[0]; b[1] = p[1];
+    VARIANT2_INTEGER_MATH_SSE2(b, c);
+    __mul();
+    VARIANT2_2(long_state);
+    VARIANT2_SHUFFLE_ADD_SSE2(long_state, j);
+    a[0] += hi; a[1] += lo;
+    p = U64(&long_state[j]);
+    p[0] = a[0];  p[1] = a[1];
+    a[0] ^= b[0]; a[1] ^= b[1];
+    lane->b1 = _b;
+    lane->b = _c;
+    lane->division_result = division_result;
+    lane->sqrt_result = sqrt_result;
+}
+
+/**
+ * @brief computes ways variant 2 hashes at once, interleaving their step 3 iterations
+ *
+ * A step 3 iteration is a chain of dependent scratchpad reads, AES, division,
+ * square root and multiplication, so a single hash leaves most of the core idle.
+ * The iterations of independent hashes don't depend on each other and the CPU
+ * overlaps them.  Steps 2 and 4 are done a hash at a time, their 8 AES blocks
+ * are independent already.  The scratchpads are laid out one after another in
+ * hp_lanes_state, so the light variant ones share a single huge page.
+ *
+ * @param ways the number of hashes, from 2 to SLOW_HASH_MAX_WAYS, a constant
+ *   in the callers so that the loop over the lanes is unrolled
+ */
+
+STATIC FORCE_INLINE void cn_slow_hash_ways_kernel(const void *const *data, const size_t *lengths, char *hashes, int light, size_t ways)
+{
+    RDATA_ALIGN16 uint8_t expandedKey[240];
+    uint8_t text[INIT_SIZE_BYTE];
+    struct cn_slow_hash_lane lanes[SLOW_HASH_MAX_WAYS];
+    size_t i, k;
+
+    static void (*const extra_hashes[4])(const void *, size_t, char *) =
+    {
+        hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
+    };
+
+    if(hp_lanes_state == NULL)
+        slow_hash_allocate_lanes_state();
+
+    for(k = 0; k < ways; k++)
+    {
+        struct cn_slow_hash_lane *lane = &lanes[k];
+        lane->long_state = &hp_lanes_state[k * (MEMORY / (light?16:1))];
+
+        /* CryptoNight Step 1 */
+        hash_process(&lane->state.hs, data[k], lengths[k]);
+
+        /* CryptoNight Step 2 */
+        memcpy(text, lane->state.init, INIT_SIZE_BYTE);
+        aes_expand_key(lane->state.hs.b, expandedKey);
+        for(i = 0; i < MEMORY / (light?16:1) / INIT_SIZE_BYTE; i++)
+        {
+            aes_pseudo_round(text, text, expandedKey, INIT_SIZE_BLK);
+            memcpy(&lane->long_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+        }
+
+        lane->a[0] = U64(&lane->state.k[0])[0] ^ U64(&lane->state.k[32])[0];
+        lane->a[1] = U64(&lane->state.k[0])[1] ^ U64(&lane->state.k[32])[1];
+        lane->b = _mm_set_epi64x(U64(&lane->state.k[16])[1] ^ U64(&lane->state.k[48])[1],
+                                 U64(&lane->state.k[16])[0] ^ U64(&lane->state.k[48])[0]);
+        lane->b1 = _mm_set_epi64x(lane->state.hs.w[9] ^ lane->state.hs.w[11],
+                                  lane->state.hs.w[8] ^ lane->state.hs.w[10]);
+        lane->division_result = lane->state.hs.w[12];
+        lane->sqrt_result = lane->state.hs.w[13];
+    }
+
+    /* CryptoNight Step 3 */
+    for(i = 0; i < ITER() / 2; i++)
+    {
+        UNROLL_WAYS
+        for(k = 0; k < ways; k++)
+            cn_slow_hash_lane_round(&lanes[k], light);
+    }
+
+    for(k = 0; k < ways; k++)
+    {
+        struct cn_slow_hash_lane *lane = &lanes[k];
+
+        /* CryptoNight Step 4 */
+        memcpy(text, lane->state.init, INIT_SIZE_BYTE);
+        aes_expand_key(&lane->state.hs.b[32], expandedKey);
+        for(i = 0; i < MEMORY / (light?16:1) / INIT_SIZE_BYTE; i++)
+            aes_pseudo_round_xor(text, text, expandedKey, &lane->long_state[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
+
+        /* CryptoNight Step 5 */
+        memcpy(lane->state.init, text, INIT_SIZE_BYTE);
+        hash_permutation(&lane->state.hs);
+        extra_hashes[lane->state.hs.b[0] & 3](&lane->state, 200, hashes + k * HASH_SIZE);
+    }
+}
+
+STATIC void cn_slow_hash_2_ways(const void *const *data, const size_t *lengths, char *hashes, int light)
+{
+    cn_slow_hash_ways_kernel(data, lengths, hashes, light, 2);
+}
+
+STATIC void cn_slow_hash_3_ways(const void *const *data, const size_t *lengths, char *hashes, int light)
+{
+    cn_slow_hash_ways_kernel(data, lengths, hashes, light, 3);
+}
+
+STATIC void cn_slow_hash_4_ways(const void *const *data, const size_t *lengths, char *hashes, int light)
+{
+    cn_slow_hash_ways_kernel(data, lengths, hashes, light, 4);
+}
+
+STATIC INLINE int multi_way_supported(int variant)
+{
+    return variant == 2 && !force_software_aes() && check_aes_hw();
+}
+
+/**
+ * @brief the number of hashes cn_slow_hash_multi computes at once by default
+ *
+ * The multi-way kernel needs AES-NI and implements variant 2 only, the one of
+ * block major versions 6 and up, light or not.  Four light scratchpads take
+ * 512KB and stay in the L2 cache, so the light variant goes by four.  A full
+ * scratchpad alone fills a 2MB L2 cache, with two of them every access goes
+ * further out and that eats the gain, so the full variant defaults to one at a
+ * time.  Callers that know the cache is large enough pass ways explicitly.
+ */
+
+size_t cn_slow_hash_ways(int light, int variant)
+{
+    if(!multi_way_supported(variant) || !light)
+        return 1;
+
+    return SLOW_HASH_MAX_WAYS;
+}
+
+STATIC void cn_slow_hash_multi_way(const void *const *data, const size_t *lengths, char *hashes, int light, size_t ways)
+{
+    switch(ways)
+    {
+    case 2:
+        cn_slow_hash_2_ways(data, lengths, hashes, light);
+        break;
+    case 3:
+        cn_slow_hash_3_ways(data, lengths, hashes, light);
+        break;
+    default:
+        cn_slow_hash_4_ways(data, lengths, hashes, light);
+        break;
+    }
+}
+
+#define HAVE_SLOW_HASH_MULTI_WAY
+
 #elif !defined NO_AES && (defined(__arm__) || defined(__aarch64__))
 void slow_hash_allocate_state(void)
 {
@@ -905,7 +1176,7 @@ union cn_slow_hash_state
   b[0] = p[0]; b[1] = p[1]; \
   VARIANT2_PORTABLE_INTEGER_MATH(b, c); \
   __mul(); \
-  VARIANT2_2(); \
+  VARIANT2_2(hp_state); \
   VARIANT2_SHUFFLE_ADD_NEON(hp_state, j); \
   a[0] += hi; a[1] += lo; \
   p = U64(&hp_state[j]); \
@@ -1582,3 +1853,67 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
 
 #endif
 
+
+#ifndef HAVE_SLOW_HASH_MULTI_WAY
+size_t cn_slow_hash_ways(int light, int variant)
+{
+    return 1;
+}
+#endif
+
+/**
+ * @brief hashes count inputs of lengths[i] bytes at data[i] into count consecutive hashes
+ *
+ * Up to ways inputs are hashed at once by the multi-way kernel when the CPU
+ * and the variant allow it, the others one at a time by cn_slow_hash.
+ *
+ * @param ways the number of hashes computed at once, 0 for cn_slow_hash_ways(light, variant)
+ */
+void cn_slow_hash_multi(const void *const *data, const size_t *lengths, size_t count, char *hashes, int light, int variant, size_t ways)
+{
+    size_t i = 0;
+
+#ifdef HAVE_SLOW_HASH_MULTI_WAY
+    if(!multi_way_supported(variant))
+        ways = 1;
+    else if(ways == 0)
+        ways = cn_slow_hash_ways(light, variant);
+    if(ways > SLOW_HASH_MAX_WAYS)
+        ways = SLOW_HASH_MAX_WAYS;
+
+    while(ways >= 2 && count - i >= 2)
+    {
+        size_t n = count - i < ways ? count - i : ways;
+        cn_slow_hash_multi_way(data + i, lengths + i, hashes + i * HASH_SIZE, light, n);
+        i += n;
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        cn_slow_hash(data[i], lengths[i], hashes + i * HASH_SIZE, light, variant, 0);
+    }
+}
+
+/**
+ * @brief hashes count inputs of length bytes each, laid out one after another in data, into count consecutive
+ * hashes. Miners use it to hash several nonces of a block per call.
+ */
+void cn_slow_hash_batch(const void *data, size_t length, size_t count, char *hashes, int light, int variant)
+{
+    const void *inputs[SLOW_HASH_MAX_WAYS];
+    size_t lengths[SLOW_HASH_MAX_WAYS];
+    size_t i, j;
+
+    for(i = 0; i < count; i += SLOW_HASH_MAX_WAYS)
+    {
+        size_t n = count - i < SLOW_HASH_MAX_WAYS ? count - i : SLOW_HASH_MAX_WAYS;
+        for(j = 0; j < n; j++)
+        {
+            inputs[j] = (const uint8_t *) data + (i + j) * length;
+            lengths[j] = length;
+        }
+
+        cn_slow_hash_multi(inputs, lengths, n, hashes + i * HASH_SIZE, light, variant, 0);
+    }
+}
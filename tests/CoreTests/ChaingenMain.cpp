@@ -213,6 +213,8 @@ int main(int argc, char* argv[])
     GENERATE_AND_PLAY_EX(MultiSigTx_DoubleSpendAltChainSameBlock(true));
     GENERATE_AND_PLAY_EX(MultiSigTx_DoubleSpendAltChainDifferentBlocks(false));
     GENERATE_AND_PLAY_EX(MultiSigTx_DoubleSpendAltChainDifferentBlocks(true));
+    GENERATE_AND_PLAY(MultiSigTx_SpendOutputOfSameBlock);
+    GENERATE_AND_PLAY(KeyTx_RingMemberOfSameBlock);
 
     GENERATE_AND_PLAY(gen_uint_overflow_1);
     GENERATE_AND_PLAY(gen_uint_overflow_2);
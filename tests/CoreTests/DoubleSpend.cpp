@@ -372,3 +372,125 @@ bool MultiSigTx_DoubleSpendAltChainDifferentBlocks::generate(std::vector<test_ev
 
   return true;
 }
+
+//======================================================================================================================
+// SameBlockOutputsBase
+//======================================================================================================================
+
+SameBlockOutputsBase::SameBlockOutputsBase() {
+  REGISTER_CALLBACK_METHOD(SameBlockOutputsBase, check_block_took_transactions);
+}
+
+bool SameBlockOutputsBase::check_block_took_transactions(CryptoNote::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& /*events*/)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("SameBlockOutputsBase::check_block_took_transactions");
+  CHECK_EQ(0, c.get_pool_transactions_count());
+  return true;
+}
+
+//======================================================================================================================
+// MultiSigTx_SpendOutputOfSameBlock
+//======================================================================================================================
+
+bool MultiSigTx_SpendOutputOfSameBlock::generate(std::vector<test_event_entry>& events) const {
+  TestGenerator generator(prepare(events));
+
+  // the pool can't check the spend before the block is in, so both are taken as kept by the block
+  SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_keeped_by_block, true);
+
+  // prepare() created the output of send_amount with global index 0, this one gets index 1
+  KeyPair outputTxKey = generateKeyPair();
+  auto builder = generator.createTxBuilder(generator.minerAccount, m_bob_account, send_amount, m_currency.minimumFee());
+  builder.setTxKeys(outputTxKey);
+  builder.m_destinations.clear();
+
+  TransactionBuilder::KeysVector kv;
+  kv.push_back(m_bob_account.getAccountKeys());
+  builder.addMultisignatureOut(send_amount, kv, 1);
+
+  auto tx1 = builder.build();
+
+  auto source = createSource();
+  source.input.outputIndex = 1;
+  source.srcTxPubKey = outputTxKey.publicKey;
+
+  auto tx2 = TransactionBuilder(m_currency).
+    addMultisignatureInput(source).
+    addOutput(TransactionDestinationEntry(send_amount - m_currency.minimumFee(), m_alice_account.getAccountKeys().address)).
+    build();
+
+  std::list<Transaction> txs;
+  txs.push_back(tx1);
+  txs.push_back(tx2);
+
+  generator.addEvent(tx1);
+  generator.addEvent(tx2);
+  generator.makeNextBlock(txs);
+  generator.addCallback("check_block_took_transactions");
+
+  return true;
+}
+
+//======================================================================================================================
+// KeyTx_RingMemberOfSameBlock
+//======================================================================================================================
+
+bool KeyTx_RingMemberOfSameBlock::generate(std::vector<test_event_entry>& events) const {
+  TestGenerator generator(m_currency, events);
+  generator.generator.defaultMajorVersion = BLOCK_MAJOR_VERSION_2;
+
+  // unlock
+  generator.generateBlocks(m_currency.minedMoneyUnlockWindow(), BLOCK_MAJOR_VERSION_2);
+
+  // send_amount is no miner transaction amount, so this output gets global index 0
+  auto builder = generator.createTxBuilder(generator.minerAccount, m_bob_account, send_amount, m_currency.minimumFee());
+  builder.setTxKeys(m_outputTxKey);
+  builder.m_destinations.clear();
+  builder.addOutput(TransactionDestinationEntry(send_amount, m_bob_account.getAccountKeys().address));
+
+  auto tx0 = builder.build();
+
+  generator.addEvent(tx0);
+  generator.makeNextBlock(tx0);
+
+  // unlock
+  generator.generateBlocks(m_currency.minedMoneyUnlockWindow(), BLOCK_MAJOR_VERSION_2);
+
+  // the pool can't check the ring before the block is in, so both are taken as kept by the block
+  SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_keeped_by_block, true);
+
+  // the output with global index 1
+  auto memberBuilder = generator.createTxBuilder(generator.minerAccount, m_alice_account, send_amount, m_currency.minimumFee());
+  memberBuilder.m_destinations.clear();
+  memberBuilder.addOutput(TransactionDestinationEntry(send_amount, m_alice_account.getAccountKeys().address));
+
+  auto tx1 = memberBuilder.build();
+
+  // spends output 0 with output 1 of the same block as the other ring member
+  TransactionSourceEntry source;
+  source.outputs.push_back(TransactionSourceEntry::OutputEntry(0, boost::get<KeyOutput>(tx0.outputs[0].target).key));
+  source.outputs.push_back(TransactionSourceEntry::OutputEntry(1, boost::get<KeyOutput>(tx1.outputs[0].target).key));
+  source.realOutput = 0;
+  source.realTransactionPublicKey = m_outputTxKey.publicKey;
+  source.realOutputIndexInTransaction = 0;
+  source.amount = send_amount;
+
+  std::vector<TransactionSourceEntry> sources;
+  sources.push_back(source);
+
+  auto tx2 = TransactionBuilder(m_currency).
+    setInput(sources, m_bob_account.getAccountKeys()).
+    addOutput(TransactionDestinationEntry(send_amount - m_currency.minimumFee(), m_alice_account.getAccountKeys().address)).
+    build();
+
+  std::list<Transaction> txs;
+  txs.push_back(tx1);
+  txs.push_back(tx2);
+
+  generator.addEvent(tx1);
+  generator.addEvent(tx2);
+  generator.makeNextBlock(txs);
+  generator.addCallback("check_block_took_transactions");
+
+  return true;
+}
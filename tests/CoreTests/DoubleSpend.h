@@ -210,6 +210,25 @@ struct MultiSigTx_DoubleSpendAltChainDifferentBlocks : public DoubleSpendBase
   bool generate(std::vector<test_event_entry>& events) const;
 };
 
+// Transactions that use outputs of earlier transactions of their block, the block must take them all.
+class SameBlockOutputsBase : public DoubleSpendBase
+{
+public:
+  SameBlockOutputsBase();
+
+  bool check_block_took_transactions(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+};
+
+struct MultiSigTx_SpendOutputOfSameBlock : public SameBlockOutputsBase
+{
+  bool generate(std::vector<test_event_entry>& events) const;
+};
+
+struct KeyTx_RingMemberOfSameBlock : public SameBlockOutputsBase
+{
+  bool generate(std::vector<test_event_entry>& events) const;
+};
+
 
 #define INIT_DOUBLE_SPEND_TEST()                                           \
   uint64_t ts_start = 1338224400;                                          \
@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <vector>
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "Logging/ConsoleLogger.h"
+
+#include "TestChain.h"
+
+// page_count pages of f_blocks_list_json, page_size blocks at scattered heights of a block_count blocks chain. Either
+// block by block, as the handler used to (hash, block, size and difficulty lookups), or with one getBlockSummaries call.
+template<bool summaries>
+class test_block_summaries
+{
+public:
+  static const size_t loop_count = 10;
+  static const size_t block_count = 3000;
+  static const size_t page_count = 100;
+  static const uint32_t page_size = 31;
+
+  test_block_summaries() :
+    m_logger(Logging::ERROR),
+    m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()),
+    m_folder("block_summaries"),
+    m_chain(m_currency, m_logger),
+    m_blockchain(m_chain.blockchain()),
+    m_pages(0) {
+  }
+
+  bool init()
+  {
+    m_miner.generate();
+    return m_chain.init(m_folder.path(), false) && m_chain.addBlocks(m_miner, block_count);
+  }
+
+  bool test()
+  {
+    uint64_t sizes = 0;
+    for (size_t i = 0; i < page_count; ++i)
+    {
+      uint32_t startHeight = static_cast<uint32_t>(m_pages++ * 7919 % (block_count - page_size));
+      if (summaries)
+      {
+        std::vector<CryptoNote::BlockSummary> page;
+        if (!m_blockchain.getBlockSummaries(startHeight, page_size, page) || page.size() != page_size)
+          return false;
+
+        for (const CryptoNote::BlockSummary& summary : page)
+          sizes += summary.size + summary.difficulty + summary.transactionCount;
+      }
+      else
+      {
+        for (uint32_t height = startHeight; height < startHeight + page_size; ++height)
+        {
+          Crypto::Hash hash = m_blockchain.getBlockIdByHeight(height);
+          CryptoNote::Block block;
+          size_t size;
+          if (!m_blockchain.getBlockByHash(hash, block) || !m_blockchain.getBlockSize(hash, size))
+            return false;
+
+          size += CryptoNote::getObjectBinarySize(block) - CryptoNote::getObjectBinarySize(block.baseTransaction);
+          sizes += size + m_blockchain.blockDifficulty(height) + block.transactionHashes.size() + 1;
+        }
+      }
+    }
+
+    return sizes != 0;
+  }
+
+private:
+  Logging::ConsoleLogger m_logger;
+  CryptoNote::Currency m_currency;
+  CryptoNote::AccountBase m_miner;
+  test_folder m_folder;
+  test_blockchain m_chain;
+  CryptoNote::Blockchain& m_blockchain;
+  size_t m_pages;
+};
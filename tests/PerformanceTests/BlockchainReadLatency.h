@@ -0,0 +1,105 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/utility/value_init.hpp>
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/VerificationContext.h"
+#include "Logging/ConsoleLogger.h"
+
+#include "TestChain.h"
+
+// Measures the latency of blockchain queries (the RPC/P2P read path) while another thread imports blocks.
+class test_blockchain_read_latency
+{
+public:
+  static const size_t loop_count = 10;
+  static const size_t block_count = 1500;
+
+  test_blockchain_read_latency() :
+    m_logger(Logging::ERROR),
+    m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()) {
+  }
+
+  ~test_blockchain_read_latency()
+  {
+    if (m_latencies.empty())
+      return;
+
+    std::sort(m_latencies.begin(), m_latencies.end());
+    std::cout << "  reads under import: " << m_latencies.size()
+      << ", p50 " << m_latencies[m_latencies.size() / 2]
+      << " us, p99 " << m_latencies[m_latencies.size() * 99 / 100]
+      << " us, max " << m_latencies.back() << " us" << std::endl;
+  }
+
+  bool init()
+  {
+    m_miner.generate();
+
+    test_folder folder("read_latency");
+    test_blockchain chain(m_currency, m_logger);
+    return chain.init(folder.path(), false) && chain.addBlocks(m_miner, block_count, &m_blocks);
+  }
+
+  bool test()
+  {
+    test_folder folder("read_latency");
+    test_blockchain chain(m_currency, m_logger);
+    if (!chain.init(folder.path(), false))
+      return false;
+
+    CryptoNote::Blockchain& blockchain = chain.blockchain();
+
+    std::atomic<bool> importFailed(false);
+    std::atomic<bool> importDone(false);
+    std::thread importer([&] {
+      for (const auto& block : m_blocks)
+      {
+        CryptoNote::block_verification_context bvc = boost::value_initialized<CryptoNote::block_verification_context>();
+        if (!blockchain.addNewBlock(block, bvc))
+        {
+          importFailed = true;
+          break;
+        }
+      }
+
+      importDone = true;
+    });
+
+    std::list<CryptoNote::Block> blocks;
+    for (uint32_t i = 0; !importDone; ++i)
+    {
+      auto start = std::chrono::steady_clock::now();
+      uint32_t height = blockchain.getCurrentBlockchainHeight();
+      Crypto::Hash id = blockchain.getBlockIdByHeight(i % height);
+      blockchain.haveBlock(id);
+      blocks.clear();
+      blockchain.getBlocks(i % height, 10, blocks);
+      m_latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    importer.join();
+    return !importFailed && blockchain.getCurrentBlockchainHeight() == block_count + 1;
+  }
+
+private:
+  Logging::ConsoleLogger m_logger;
+  CryptoNote::Currency m_currency;
+  CryptoNote::AccountBase m_miner;
+  std::vector<CryptoNote::Block> m_blocks;
+  std::vector<uint64_t> m_latencies;
+};
@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Currency.h"
+#include "Logging/ConsoleLogger.h"
+
+#include "TestChain.h"
+
+// Loads the blockchain cache and explorer indices of a stored chain, then saves them again: reports the load time, how
+// long storeCache holds the blockchain lock and how long deinit waits for the snapshots to reach the disk.
+class test_cache_snapshot
+{
+public:
+  static const size_t loop_count = 20;
+  // stays below the first checkpoint, which a reloaded chain is checked against
+  static const size_t block_count = 750;
+
+  test_cache_snapshot() :
+    m_logger(Logging::ERROR),
+    m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()),
+    m_folder("cache_snapshot"),
+    m_loadTime(0),
+    m_pauseTime(0),
+    m_writeTime(0),
+    m_runs(0) {
+  }
+
+  ~test_cache_snapshot()
+  {
+    if (m_runs == 0)
+      return;
+
+    std::cout << "  load " << m_loadTime / m_runs << " us, save pause " << m_pauseTime / m_runs
+      << " us, save until synced " << m_writeTime / m_runs << " us" << std::endl;
+  }
+
+  bool init()
+  {
+    m_miner.generate();
+
+    test_blockchain chain(m_currency, m_logger, true);
+    return chain.init(m_folder.path(), false) && chain.addBlocks(m_miner, block_count) && chain.deinit();
+  }
+
+  bool test()
+  {
+    test_blockchain chain(m_currency, m_logger, true);
+
+    auto start = std::chrono::steady_clock::now();
+    if (!chain.init(m_folder.path(), true) || chain.blockchain().getCurrentBlockchainHeight() != block_count + 1)
+      return false;
+
+    auto loaded = std::chrono::steady_clock::now();
+    if (!chain.blockchain().storeCache())
+      return false;
+
+    auto stored = std::chrono::steady_clock::now();
+    chain.deinit();
+    auto written = std::chrono::steady_clock::now();
+
+    m_loadTime += std::chrono::duration_cast<std::chrono::microseconds>(loaded - start).count();
+    m_pauseTime += std::chrono::duration_cast<std::chrono::microseconds>(stored - loaded).count();
+    m_writeTime += std::chrono::duration_cast<std::chrono::microseconds>(written - stored).count();
+    ++m_runs;
+    return true;
+  }
+
+private:
+  Logging::ConsoleLogger m_logger;
+  CryptoNote::Currency m_currency;
+  CryptoNote::AccountBase m_miner;
+  test_folder m_folder;
+  uint64_t m_loadTime;
+  uint64_t m_pauseTime;
+  uint64_t m_writeTime;
+  uint64_t m_runs;
+};
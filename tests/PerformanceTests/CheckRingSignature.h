@@ -12,16 +12,19 @@
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "crypto/crypto.h"
+#include "crypto/ring-signature-batch.h"
 
 #include "MultiTransactionTestBase.h"
 
-template<size_t a_ring_size>
+// With batch_size > 1 checks batch_size signatures over the same ring through Crypto::RingSignatureBatch.
+template<size_t a_ring_size, size_t batch_size = 1>
 class test_check_ring_signature : private multi_tx_test_base<a_ring_size>
 {
   static_assert(0 < a_ring_size, "ring_size must be greater than 0");
+  static_assert(0 < batch_size, "batch_size must be greater than 0");
 
 public:
-  static const size_t loop_count = a_ring_size < 100 ? 100 : 10;
+  static const size_t loop_count = a_ring_size * batch_size < 100 ? 100 : 10;
   static const size_t ring_size = a_ring_size;
 
   typedef multi_tx_test_base<a_ring_size> base_class;
@@ -37,23 +40,40 @@ public:
 
     std::vector<TransactionDestinationEntry> destinations;
     destinations.push_back(TransactionDestinationEntry(this->m_source_amount, m_alice.getAccountKeys().address));
-    Crypto::SecretKey txSK;
-    if (!constructTransaction(this->m_miners[this->real_source_idx].getAccountKeys(), this->m_sources, destinations, std::vector<uint8_t>(), m_tx, 0, this->m_logger, txSK))
-      return false;
 
-    getObjectHash(*static_cast<TransactionPrefix*>(&m_tx), m_tx_prefix_hash);
+    // every transaction gets its own key, so the prefixes and signatures differ
+    for (size_t i = 0; i < batch_size; ++i)
+    {
+      Crypto::SecretKey txSK;
+      if (!constructTransaction(this->m_miners[this->real_source_idx].getAccountKeys(), this->m_sources, destinations, std::vector<uint8_t>(), m_txs[i], 0, this->m_logger, txSK))
+        return false;
+
+      getObjectHash(*static_cast<TransactionPrefix*>(&m_txs[i]), m_tx_prefix_hashes[i]);
+    }
 
     return true;
   }
 
   bool test()
   {
-    const CryptoNote::KeyInput& txin = boost::get<CryptoNote::KeyInput>(m_tx.inputs[0]);
-    return Crypto::check_ring_signature(m_tx_prefix_hash, txin.keyImage, this->m_public_key_ptrs, ring_size, m_tx.signatures[0].data());
+    if (batch_size == 1)
+    {
+      const CryptoNote::KeyInput& txin = boost::get<CryptoNote::KeyInput>(m_txs[0].inputs[0]);
+      return Crypto::check_ring_signature(m_tx_prefix_hashes[0], txin.keyImage, this->m_public_key_ptrs, ring_size, m_txs[0].signatures[0].data());
+    }
+
+    Crypto::RingSignatureBatch batch;
+    for (size_t i = 0; i < batch_size; ++i)
+    {
+      const CryptoNote::KeyInput& txin = boost::get<CryptoNote::KeyInput>(m_txs[i].inputs[0]);
+      batch.add(m_tx_prefix_hashes[i], txin.keyImage, this->m_public_key_ptrs, ring_size, m_txs[i].signatures[0].data());
+    }
+
+    return batch.verify();
   }
 
 private:
   CryptoNote::AccountBase m_alice;
-  CryptoNote::Transaction m_tx;
-  Crypto::Hash m_tx_prefix_hash;
+  CryptoNote::Transaction m_txs[batch_size];
+  Crypto::Hash m_tx_prefix_hashes[batch_size];
 };
@@ -0,0 +1,70 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+#include <System/Context.h>
+#include <System/Dispatcher.h>
+
+// Ping-pongs the main context and a spawned one through pushContext/dispatch, switch_count switches per call.
+template<size_t switch_count>
+class test_context_switch
+{
+public:
+  static const size_t loop_count = 10;
+
+  test_context_switch() :
+    m_switches(0),
+    m_time(0) {
+  }
+
+  ~test_context_switch()
+  {
+    if (m_switches == 0)
+      return;
+
+    std::cout << "  " << m_time / m_switches << " ns per context switch" << std::endl;
+  }
+
+  bool init()
+  {
+    return true;
+  }
+
+  bool test()
+  {
+    size_t contextSwitches = 0;
+    bool stop = false;
+    System::Context<> context(m_dispatcher, [&] {
+      while (!stop)
+      {
+        ++contextSwitches;
+        m_dispatcher.pushContext(m_dispatcher.getCurrentContext());
+        m_dispatcher.dispatch();
+      }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < switch_count / 2; ++i)
+    {
+      m_dispatcher.pushContext(m_dispatcher.getCurrentContext());
+      m_dispatcher.dispatch();
+    }
+
+    m_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    m_switches += switch_count;
+    stop = true;
+    context.get();
+
+    return contextSwitches >= switch_count / 2;
+  }
+
+private:
+  System::Dispatcher m_dispatcher;
+  uint64_t m_switches;
+  uint64_t m_time;
+};
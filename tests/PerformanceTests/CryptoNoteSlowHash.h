@@ -5,10 +5,15 @@
 
 #pragma once
 
+#include <chrono>
+#include <iostream>
+
 #include "Common/StringTools.h"
 #include "crypto/crypto.h"
 #include "CryptoNoteCore/CryptoNoteBasic.h"
 
+// Hashes ways inputs per call through cn_slow_hash_multi, ways 1 being the single hash kernel.
+template<int light, int variant, size_t ways>
 class test_cn_slow_hash {
 public:
   static const size_t loop_count = 10;
@@ -20,28 +25,71 @@ public:
 #pragma pack(pop)
 
   static_assert(13 == sizeof(data_t), "Invalid structure size");
+  static_assert(0 < ways && ways <= Crypto::SLOW_HASH_MAX_WAYS, "Invalid ways");
+
+  test_cn_slow_hash() : m_time(0), m_hashes(0) {
+  }
+
+  ~test_cn_slow_hash() {
+    if (m_time == 0) {
+      return;
+    }
+
+    double seconds = static_cast<double>(m_time) / 1000000;
+    std::cout << "  variant " << variant << (light ? " light" : "") << ", " << ways << (ways == 1 ? " way" : " ways") <<
+      ": " << static_cast<uint64_t>(m_hashes / seconds) << " hashes/sec" << std::endl;
+  }
 
   bool init() {
     size_t size;
-    if (!Common::fromHex("63617665617420656d70746f72", &m_data, sizeof(m_data), size) || size != sizeof(m_data)) {
+    if (!Common::fromHex("63617665617420656d70746f72", &m_data[0], sizeof(m_data[0]), size) || size != sizeof(m_data[0])) {
       return false;
     }
 
-    if (!Common::fromHex("bbec2cacf69866a8e740380fe7b818fc78f8571221742d729d9d02d7f8989b87", &m_expected_hash, sizeof(m_expected_hash), size) || size != sizeof(m_expected_hash)) {
-      return false;
+    if (light == 0 && variant == 0) {
+      if (!Common::fromHex("bbec2cacf69866a8e740380fe7b818fc78f8571221742d729d9d02d7f8989b87", &m_expected_hashes[0], sizeof(m_expected_hashes[0]), size) || size != sizeof(m_expected_hashes[0])) {
+        return false;
+      }
+    } else {
+      Crypto::cn_slow_hash(m_context, &m_data[0], sizeof(m_data[0]), m_expected_hashes[0], light, variant);
+    }
+
+    // the other inputs differ in the last byte, their expected hashes come from the single hash kernel
+    for (size_t i = 1; i < ways; ++i) {
+      m_data[i] = m_data[0];
+      m_data[i].data[sizeof(m_data[i].data) - 1] += static_cast<char>(i);
+      Crypto::cn_slow_hash(m_context, &m_data[i], sizeof(m_data[i]), m_expected_hashes[i], light, variant);
+    }
+
+    for (size_t i = 0; i < ways; ++i) {
+      m_inputs[i] = &m_data[i];
+      m_lengths[i] = sizeof(m_data[i]);
     }
 
     return true;
   }
 
   bool test() {
-    Crypto::Hash hash;
-    Crypto::cn_slow_hash_v0(m_context, &m_data, sizeof(m_data), hash);
-    return hash == m_expected_hash;
+    Crypto::Hash hashes[ways];
+    auto start = std::chrono::steady_clock::now();
+    Crypto::cn_slow_hash_multi(m_context, m_inputs, m_lengths, ways, hashes, light, variant, ways);
+    m_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    m_hashes += ways;
+    for (size_t i = 0; i < ways; ++i) {
+      if (hashes[i] != m_expected_hashes[i]) {
+        return false;
+      }
+    }
+
+    return true;
   }
 
 private:
-  data_t m_data;
-  Crypto::Hash m_expected_hash;
+  data_t m_data[ways];
+  const void* m_inputs[ways];
+  size_t m_lengths[ways];
+  Crypto::Hash m_expected_hashes[ways];
   Crypto::cn_context m_context;
+  uint64_t m_time;
+  uint64_t m_hashes;
 };
@@ -0,0 +1,87 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+
+#include <boost/filesystem.hpp>
+
+#include "CryptoNoteCore/PersistentBlockchainIndices.h"
+#include "crypto/crypto.h"
+
+// query_count day long getBlockIdsByTimestamp lookups on the timestamp index of a block_count blocks chain, after
+// reopening the index the way a restarting node does. Reports how long the reopen took.
+template<size_t block_count>
+class test_explorer_index_range
+{
+public:
+  static const size_t loop_count = 100;
+  static const size_t query_count = 1000;
+  static const uint64_t block_time = 480;
+  static const uint64_t range = 24 * 60 * 60;
+
+  test_explorer_index_range() :
+    m_path(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+    m_openTime(0) {
+  }
+
+  ~test_explorer_index_range()
+  {
+    m_index.reset();
+    boost::system::error_code ignore;
+    boost::filesystem::remove(m_path.string() + ".log", ignore);
+    boost::filesystem::remove(m_path, ignore);
+    if (m_openTime != 0)
+      std::cout << "  open of " << block_count << " blocks: " << m_openTime << " us" << std::endl;
+  }
+
+  bool init()
+  {
+    {
+      // timestamps run a few blocks ahead of or behind the chain order, as miners' clocks do
+      std::minstd_rand random(1);
+      CryptoNote::PersistentTimestampBlocksIndex index;
+      index.open(m_path.string());
+      Crypto::Hash hash;
+      for (uint32_t height = 0; height < block_count; ++height)
+      {
+        hash = Crypto::rand<Crypto::Hash>();
+        index.add(height * block_time + random() % (block_time * 8), hash, height);
+      }
+
+      index.flush(block_count, hash);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    m_index.reset(new CryptoNote::PersistentTimestampBlocksIndex());
+    m_index->open(m_path.string());
+    m_openTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return m_index->storedBlockCount() == block_count;
+  }
+
+  bool test()
+  {
+    std::vector<Crypto::Hash> hashes;
+    for (size_t i = 0; i < query_count; ++i)
+    {
+      uint64_t begin = (m_queries++ * 7919 % (block_count - range / block_time - 16)) * block_time;
+      uint32_t count;
+      hashes.clear();
+      if (!m_index->find(begin, begin + range, 100, hashes, count) || count < range / block_time - 16)
+        return false;
+    }
+
+    return true;
+  }
+
+private:
+  boost::filesystem::path m_path;
+  std::unique_ptr<CryptoNote::PersistentTimestampBlocksIndex> m_index;
+  uint64_t m_openTime;
+  uint64_t m_queries = 0;
+};
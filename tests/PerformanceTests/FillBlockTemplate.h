@@ -0,0 +1,119 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+#include <boost/utility/value_init.hpp>
+
+#include "crypto/crypto.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/ITimeProvider.h"
+#include "CryptoNoteCore/ITransactionValidator.h"
+#include "CryptoNoteCore/TransactionPool.h"
+#include "CryptoNoteCore/VerificationContext.h"
+#include "Logging/ConsoleLogger.h"
+
+// Measures getblocktemplate's fill_block_template on a pool of pool_size transactions.
+// With new_transaction every call is preceded by the arrival of a low fee transaction.
+template<size_t pool_size, bool new_transaction>
+class test_fill_block_template
+{
+public:
+  static const size_t loop_count = 100;
+
+  test_fill_block_template() :
+    m_logger(Logging::ERROR),
+    m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()),
+    m_pool(m_currency, m_validator, m_timeProvider, m_logger),
+    m_calls(0),
+    m_time(0) {
+  }
+
+  ~test_fill_block_template()
+  {
+    if (m_calls == 0)
+      return;
+
+    double seconds = static_cast<double>(m_time) / 1000000;
+    std::cout << "  fill_block_template: " << static_cast<uint64_t>(m_calls / seconds) << " calls/sec, "
+      << m_validator.calls / m_calls << " input checks/call" << std::endl;
+  }
+
+  bool init()
+  {
+    for (size_t i = 0; i < pool_size; ++i)
+    {
+      if (!addTransaction(1000 + i))
+        return false;
+    }
+
+    m_validator.calls = 0;
+    return true;
+  }
+
+  bool test()
+  {
+    if (new_transaction && !addTransaction(1))
+      return false;
+
+    CryptoNote::Block block;
+    size_t totalSize;
+    uint64_t fee;
+    uint32_t height = 1000;
+
+    auto start = std::chrono::steady_clock::now();
+    bool result = m_pool.fill_block_template(block, 1000000, 1000000, 0, totalSize, fee, height);
+    m_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    ++m_calls;
+
+    return result && !block.transactionHashes.empty();
+  }
+
+private:
+  struct Validator : public CryptoNote::ITransactionValidator
+  {
+    size_t calls = 0;
+
+    virtual bool checkTransactionInputs(const CryptoNote::Transaction& tx, CryptoNote::BlockInfo& maxUsedBlock) override { ++calls; return true; }
+    virtual bool checkTransactionInputs(const CryptoNote::Transaction& tx, CryptoNote::BlockInfo& maxUsedBlock, CryptoNote::BlockInfo& lastFailed) override { ++calls; return true; }
+    virtual bool haveSpentKeyImages(const CryptoNote::Transaction& tx) override { return false; }
+    virtual bool checkTransactionSize(size_t blobSize) override { return true; }
+  };
+
+  bool addTransaction(uint64_t fee)
+  {
+    CryptoNote::Transaction tx;
+    tx.version = CryptoNote::TRANSACTION_VERSION_1;
+    tx.unlockTime = 0;
+
+    CryptoNote::KeyInput input;
+    input.amount = 1000000 + fee;
+    input.outputIndexes.push_back(0);
+    Crypto::PublicKey keyImage;
+    Crypto::SecretKey secretKey;
+    Crypto::generate_keys(keyImage, secretKey);
+    input.keyImage = reinterpret_cast<const Crypto::KeyImage&>(keyImage);
+    tx.inputs.push_back(input);
+
+    CryptoNote::KeyOutput output;
+    Crypto::generate_keys(output.key, secretKey);
+    tx.outputs.push_back(CryptoNote::TransactionOutput{1000000, output});
+    tx.signatures.push_back(std::vector<Crypto::Signature>(1));
+
+    CryptoNote::tx_verification_context tvc = boost::value_initialized<CryptoNote::tx_verification_context>();
+    return m_pool.add_tx(tx, tvc, false, 1000) && tvc.m_added_to_pool;
+  }
+
+  Logging::ConsoleLogger m_logger;
+  CryptoNote::Currency m_currency;
+  Validator m_validator;
+  CryptoNote::RealTimeProvider m_timeProvider;
+  CryptoNote::tx_memory_pool m_pool;
+  size_t m_calls;
+  uint64_t m_time;
+};
@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <boost/utility/value_init.hpp>
+
+#include "Common/StringTools.h"
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Core.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "Logging/ConsoleLogger.h"
+
+#include "TestChain.h"
+
+// Measures getblocktemplate as polled by mining pools, with transactions waiting in the pool.
+// Without cached every request builds and serializes a new template, the way the handler did before the template cache.
+template<bool cached>
+class test_get_block_template
+{
+public:
+  static const size_t loop_count = 10;
+  static const size_t coinbase_block_count = 200;
+  static const size_t pool_transaction_count = 100;
+  static const size_t requests_per_call = 100;
+  static const size_t reserve_size = 8;
+
+  test_get_block_template() :
+    m_logger(Logging::ERROR),
+    m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()),
+    m_folder("get_block_template"),
+    m_node(m_currency, m_logger),
+    m_core(m_node.core()),
+    m_requests(0),
+    m_requestTime(0) {
+  }
+
+  ~test_get_block_template()
+  {
+    if (m_requestTime == 0)
+      return;
+
+    double seconds = static_cast<double>(m_requestTime) / 1000000;
+    std::cout << "  getblocktemplate" << (cached ? "" : " (uncached)") << ": " << static_cast<uint64_t>(m_requests / seconds)
+      << " requests/sec" << std::endl;
+  }
+
+  bool init()
+  {
+    m_miner.generate();
+
+    std::vector<CryptoNote::Block> blocks;
+    if (!m_node.init(m_folder.path()) || !m_node.addBlocks(m_miner, coinbase_block_count, &blocks))
+      return false;
+
+    for (size_t i = 0; i < pool_transaction_count; ++i)
+    {
+      if (!m_node.addTransaction(m_miner, blocks[i]))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < requests_per_call; ++i)
+    {
+      CryptoNote::difficulty_type difficulty;
+      uint32_t height;
+      uint64_t reservedOffset;
+      CryptoNote::BinaryArray blob;
+      if (cached)
+      {
+        if (!m_core.getBlockTemplateBlob(m_miner.getAccountKeys().address, reserve_size, difficulty, height, blob, reservedOffset))
+          return false;
+      }
+      else
+      {
+        CryptoNote::Block block = boost::value_initialized<CryptoNote::Block>();
+        if (!m_core.get_block_template(block, m_miner.getAccountKeys().address, difficulty, height, CryptoNote::BinaryArray(reserve_size, 0)))
+          return false;
+
+        blob = CryptoNote::toBinaryArray(block);
+      }
+
+      if (Common::toHex(blob).empty())
+        return false;
+    }
+
+    m_requestTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    m_requests += requests_per_call;
+    return true;
+  }
+
+private:
+  Logging::ConsoleLogger m_logger;
+  CryptoNote::Currency m_currency;
+  test_folder m_folder;
+  test_core m_node;
+  CryptoNote::core& m_core;
+  CryptoNote::AccountBase m_miner;
+  uint64_t m_requests;
+  uint64_t m_requestTime;
+};
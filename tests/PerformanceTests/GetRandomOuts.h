@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Currency.h"
+#include "Logging/ConsoleLogger.h"
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+
+#include "TestChain.h"
+
+// getrandom_outs as a wallet sending a transaction with amount_count inputs calls it: mixin outputs for every amount.
+template<size_t amount_count, size_t mixin>
+class test_get_random_outs
+{
+public:
+  static const size_t loop_count = 10000;
+  static const size_t block_count = 1500;
+
+  test_get_random_outs() :
+    m_logger(Logging::ERROR),
+    m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()),
+    m_folder("random_outs"),
+    m_chain(m_currency, m_logger),
+    m_blockchain(m_chain.blockchain()) {
+  }
+
+  bool init()
+  {
+    m_miner.generate();
+    std::vector<CryptoNote::Block> blocks;
+    if (!m_chain.init(m_folder.path(), false) || !m_chain.addBlocks(m_miner, block_count, &blocks))
+      return false;
+
+    std::set<uint64_t> amounts;
+    for (const auto& block : blocks)
+    {
+      for (const auto& output : block.baseTransaction.outputs)
+        amounts.insert(output.amount);
+    }
+
+    // the most frequent amounts come first, they are the ones wallets spend
+    std::vector<std::pair<size_t, uint64_t>> counts;
+    for (uint64_t amount : amounts)
+    {
+      CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request req;
+      CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response res;
+      req.amounts.push_back(amount);
+      req.outs_count = block_count;
+      m_blockchain.getRandomOutsByAmount(req, res);
+      counts.emplace_back(res.outs.front().outs.size(), amount);
+    }
+
+    std::sort(counts.rbegin(), counts.rend());
+    for (size_t i = 0; i < amount_count; ++i)
+      m_request.amounts.push_back(counts[i % counts.size()].second);
+
+    m_request.outs_count = mixin + 1;
+    return true;
+  }
+
+  bool test()
+  {
+    CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response res;
+    return m_blockchain.getRandomOutsByAmount(m_request, res) && res.outs.size() == amount_count;
+  }
+
+private:
+  Logging::ConsoleLogger m_logger;
+  CryptoNote::Currency m_currency;
+  CryptoNote::AccountBase m_miner;
+  test_folder m_folder;
+  test_blockchain m_chain;
+  CryptoNote::Blockchain& m_blockchain;
+  CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request m_request;
+};
@@ -0,0 +1,89 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "Common/JsonValue.h"
+#include "Common/StringTools.h"
+#include "crypto/hash.h"
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "Serialization/SerializationTools.h"
+
+// Writes and reads back an f_blocks_list_json response of block_count blocks, the way the RPC handlers do.
+// Without streaming the text goes through a JsonValue in both directions, as it did before the string serializers.
+template<size_t block_count, bool streaming>
+class test_json_serialization
+{
+public:
+  static const size_t loop_count = 100;
+
+  test_json_serialization() :
+    m_bytes(0),
+    m_storeTime(0),
+    m_loadTime(0) {
+  }
+
+  ~test_json_serialization()
+  {
+    if (m_storeTime == 0 || m_loadTime == 0)
+      return;
+
+    std::cout << "  " << block_count << " blocks" << (streaming ? "" : " (JsonValue)") << ": store "
+      << static_cast<uint64_t>(m_bytes / static_cast<double>(m_storeTime)) << " MB/sec, load "
+      << static_cast<uint64_t>(m_bytes / static_cast<double>(m_loadTime)) << " MB/sec" << std::endl;
+  }
+
+  bool init()
+  {
+    for (size_t i = 0; i < block_count; ++i)
+    {
+      CryptoNote::f_block_short_response block;
+      block.timestamp = 1500000000 + i * 120;
+      block.height = static_cast<uint32_t>(i);
+      block.difficulty = 1000000 + i;
+      block.hash = Common::podToHex(Crypto::cn_fast_hash(&i, sizeof(i)));
+      block.tx_count = i % 7;
+      block.cumul_size = 300 + i % 5000;
+      m_response.blocks.push_back(block);
+    }
+
+    m_response.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+
+  bool test()
+  {
+    auto start = std::chrono::steady_clock::now();
+    std::string json = streaming ? CryptoNote::storeToJson(m_response) : CryptoNote::storeToJsonValue(m_response).toString();
+    auto stored = std::chrono::steady_clock::now();
+
+    CryptoNote::F_COMMAND_RPC_GET_BLOCKS_LIST::response response;
+    if (streaming)
+    {
+      if (!CryptoNote::loadFromJson(response, json))
+        return false;
+    }
+    else
+    {
+      CryptoNote::loadFromJsonValue(response, Common::JsonValue::fromString(json));
+    }
+
+    auto loaded = std::chrono::steady_clock::now();
+    m_storeTime += std::chrono::duration_cast<std::chrono::microseconds>(stored - start).count();
+    m_loadTime += std::chrono::duration_cast<std::chrono::microseconds>(loaded - stored).count();
+    m_bytes += json.size();
+
+    return response.blocks.size() == block_count && response.blocks.back().hash == m_response.blocks.back().hash;
+  }
+
+private:
+  CryptoNote::F_COMMAND_RPC_GET_BLOCKS_LIST::response m_response;
+  uint64_t m_bytes;
+  uint64_t m_storeTime;
+  uint64_t m_loadTime;
+};
@@ -0,0 +1,105 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+#include "CryptoNoteConfig.h"
+#include "crypto/crypto.h"
+#include "CryptoNoteCore/BlockHashingBatch.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+
+// Hashes consecutive nonces of a block with transaction_count transactions, as a mining thread does. Without batched
+// every nonce goes through get_block_longhash, which builds the hashing blob of the block again.
+template<uint8_t major_version, size_t transaction_count, bool batched>
+class test_miner_hashing
+{
+public:
+  static const size_t loop_count = 10;
+  static const size_t hashes_per_call = 4 * CryptoNote::BlockHashingBatch::SIZE;
+
+  test_miner_hashing() : m_time(0), m_hashes(0) {
+  }
+
+  ~test_miner_hashing()
+  {
+    if (m_time == 0)
+      return;
+
+    double seconds = static_cast<double>(m_time) / 1000000;
+    std::cout << "  block v" << static_cast<int>(major_version) << ", " << transaction_count << " transactions" <<
+      (batched ? "" : " (per nonce)") << ": " << static_cast<uint64_t>(m_hashes / seconds) << " hashes/sec" << std::endl;
+  }
+
+  bool init()
+  {
+    m_block = CryptoNote::Block();
+    m_block.majorVersion = major_version;
+    m_block.minorVersion = 0;
+    m_block.timestamp = 1500000000;
+    m_block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+    m_block.nonce = 0;
+    m_block.parentBlock.majorVersion = CryptoNote::BLOCK_MAJOR_VERSION_1;
+    m_block.parentBlock.minorVersion = 0;
+    m_block.parentBlock.previousBlockHash = Crypto::rand<Crypto::Hash>();
+    m_block.parentBlock.transactionCount = 1;
+    for (size_t i = 0; i < transaction_count; ++i)
+      m_block.transactionHashes.push_back(Crypto::rand<Crypto::Hash>());
+
+    if (!m_batch.setBlock(m_block))
+      return false;
+
+    // both ways give the same hashes
+    Crypto::Hash hashes[CryptoNote::BlockHashingBatch::SIZE];
+    m_batch.hash(m_context, m_block.nonce, 1, hashes);
+    for (size_t i = 0; i < CryptoNote::BlockHashingBatch::SIZE; ++i)
+    {
+      CryptoNote::Block block = m_block;
+      block.nonce += static_cast<uint32_t>(i);
+      Crypto::Hash hash;
+      if (!CryptoNote::get_block_longhash(m_context, block, hash) || hash != hashes[i])
+        return false;
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < hashes_per_call; i += CryptoNote::BlockHashingBatch::SIZE)
+    {
+      Crypto::Hash hashes[CryptoNote::BlockHashingBatch::SIZE];
+      if (batched)
+      {
+        m_batch.hash(m_context, m_block.nonce, 1, hashes);
+      }
+      else
+      {
+        CryptoNote::Block block = m_block;
+        for (size_t j = 0; j < CryptoNote::BlockHashingBatch::SIZE; ++j)
+        {
+          block.nonce = m_block.nonce + static_cast<uint32_t>(j);
+          if (!CryptoNote::get_block_longhash(m_context, block, hashes[j]))
+            return false;
+        }
+      }
+
+      m_block.nonce += CryptoNote::BlockHashingBatch::SIZE;
+    }
+
+    m_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    m_hashes += hashes_per_call;
+    return true;
+  }
+
+private:
+  CryptoNote::Block m_block;
+  CryptoNote::BlockHashingBatch m_batch;
+  Crypto::cn_context m_context;
+  uint64_t m_time;
+  uint64_t m_hashes;
+};
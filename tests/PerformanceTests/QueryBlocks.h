@@ -0,0 +1,123 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Core.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/Currency.h"
+#include "Logging/ConsoleLogger.h"
+
+#include "TestChain.h"
+
+// Measures queryblocks / queryblockslite as served to many wallets synchronizing the same recent blocks.
+template<bool lite>
+class test_query_blocks
+{
+public:
+  static const size_t loop_count = 10;
+  static const size_t coinbase_block_count = 200;
+  static const size_t transaction_block_count = 100;
+  static const size_t transactions_per_block = 2;
+  static const size_t requests_per_call = 100;
+
+  test_query_blocks() :
+    m_logger(Logging::ERROR),
+    m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()),
+    m_folder("query_blocks"),
+    m_node(m_currency, m_logger),
+    m_core(m_node.core()),
+    m_requests(0),
+    m_requestTime(0) {
+  }
+
+  ~test_query_blocks()
+  {
+    if (m_requestTime == 0)
+      return;
+
+    double seconds = static_cast<double>(m_requestTime) / 1000000;
+    std::cout << "  " << (lite ? "queryblockslite" : "queryblocks") << ": " << static_cast<uint64_t>(m_requests / seconds)
+      << " requests/sec" << std::endl;
+  }
+
+  bool init()
+  {
+    m_miner.generate();
+
+    std::vector<CryptoNote::Block> blocks;
+    if (!m_node.init(m_folder.path()) || !m_node.addBlocks(m_miner, coinbase_block_count, &blocks))
+      return false;
+
+    for (size_t i = 0; i < transaction_block_count; ++i)
+    {
+      for (size_t j = 0; j < transactions_per_block; ++j)
+      {
+        if (!m_node.addTransaction(m_miner, blocks[i * transactions_per_block + j]))
+          return false;
+      }
+
+      if (!m_node.addBlocks(m_miner, 1, &blocks))
+        return false;
+    }
+
+    // a wallet that knows the chain up to the first block with transactions
+    m_knownBlockIds.push_back(CryptoNote::get_block_hash(blocks[coinbase_block_count - 1]));
+    m_knownBlockIds.push_back(m_currency.genesisBlockHash());
+    return true;
+  }
+
+  bool test()
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < requests_per_call; ++i)
+    {
+      uint32_t startHeight;
+      uint32_t currentHeight;
+      uint32_t fullOffset;
+      size_t transactionCount = 0;
+      if (lite)
+      {
+        std::vector<CryptoNote::BlockShortInfo> entries;
+        if (!m_core.queryBlocksLite(m_knownBlockIds, 0, startHeight, currentHeight, fullOffset, entries))
+          return false;
+
+        for (const auto& entry : entries)
+          transactionCount += entry.txPrefixes.size();
+      }
+      else
+      {
+        std::vector<CryptoNote::BlockFullInfo> entries;
+        if (!m_core.queryBlocks(m_knownBlockIds, 0, startHeight, currentHeight, fullOffset, entries))
+          return false;
+
+        for (const auto& entry : entries)
+          transactionCount += entry.txs.size();
+      }
+
+      if (transactionCount != transaction_block_count * transactions_per_block)
+        return false;
+    }
+
+    m_requestTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    m_requests += requests_per_call;
+    return true;
+  }
+
+private:
+  Logging::ConsoleLogger m_logger;
+  CryptoNote::Currency m_currency;
+  test_folder m_folder;
+  test_core m_node;
+  CryptoNote::core& m_core;
+  CryptoNote::AccountBase m_miner;
+  std::vector<Crypto::Hash> m_knownBlockIds;
+  uint64_t m_requests;
+  uint64_t m_requestTime;
+};
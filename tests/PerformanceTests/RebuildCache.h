@@ -0,0 +1,59 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <vector>
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "Logging/ConsoleLogger.h"
+
+#include "TestChain.h"
+
+// Rebuilds the block index, transaction map and output index of a block_count blocks chain, as init does when the
+// blockchain cache is missing.
+template<size_t block_count>
+class test_rebuild_cache
+{
+public:
+  static const size_t loop_count = 10;
+
+  test_rebuild_cache() :
+    m_logger(Logging::ERROR),
+    m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()),
+    m_folder("rebuild_cache"),
+    m_chain(m_currency, m_logger),
+    m_blockchain(m_chain.blockchain()) {
+  }
+
+  bool init()
+  {
+    m_miner.generate();
+    std::vector<CryptoNote::Block> blocks;
+    if (!m_chain.init(m_folder.path(), false) || !m_chain.addBlocks(m_miner, block_count, &blocks))
+      return false;
+
+    m_lastTransaction = CryptoNote::getObjectHash(blocks.back().baseTransaction);
+    m_lastBlock = m_blockchain.getTailId();
+    return true;
+  }
+
+  bool test()
+  {
+    m_blockchain.rebuildCache();
+    return m_blockchain.getBlockIdByHeight(block_count) == m_lastBlock && m_blockchain.haveTransaction(m_lastTransaction);
+  }
+
+private:
+  Logging::ConsoleLogger m_logger;
+  CryptoNote::Currency m_currency;
+  CryptoNote::AccountBase m_miner;
+  test_folder m_folder;
+  test_blockchain m_chain;
+  CryptoNote::Blockchain& m_blockchain;
+  Crypto::Hash m_lastBlock;
+  Crypto::Hash m_lastTransaction;
+};
@@ -0,0 +1,124 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnection.h>
+#include <System/TcpConnector.h>
+#include <System/TcpListener.h>
+
+#include "P2p/LevinProtocol.h"
+#include "P2p/NetNode.h"
+
+// Relays one large notification to peer_count loopback connections the way NodeServer::relay_notify_to_all does,
+// every connection writing its message from its own context. Without shared every peer gets its own copy of the payload.
+template<size_t peer_count, bool shared>
+class test_relay_fan_out
+{
+public:
+  static const size_t loop_count = 10;
+  static const size_t payload_size = 1024 * 1024;
+  static const uint16_t port = 38211;
+
+  test_relay_fan_out() :
+    m_payload(payload_size, 0x5a),
+    m_relays(0),
+    m_time(0) {
+  }
+
+  ~test_relay_fan_out()
+  {
+    m_senders.clear();
+    m_receivers.clear();
+
+    if (m_time == 0)
+      return;
+
+    double seconds = static_cast<double>(m_time) / 1000000;
+    std::cout << "  relay of " << payload_size / 1024 << " KiB to " << peer_count << " peers: "
+      << static_cast<uint64_t>(m_relays / seconds) << " relays/sec" << std::endl;
+  }
+
+  bool init()
+  {
+    try
+    {
+      System::TcpListener listener(m_dispatcher, System::Ipv4Address("127.0.0.1"), port);
+      System::ContextGroup acceptor(m_dispatcher);
+      acceptor.spawn([&] {
+        for (size_t i = 0; i < peer_count; ++i)
+          m_receivers.push_back(listener.accept());
+      });
+
+      System::TcpConnector connector(m_dispatcher);
+      for (size_t i = 0; i < peer_count; ++i)
+        m_senders.push_back(connector.connect(System::Ipv4Address("127.0.0.1"), port));
+
+      acceptor.wait();
+    }
+    catch (std::exception& e)
+    {
+      std::cerr << "relay fan-out setup failed: " << e.what() << std::endl;
+      return false;
+    }
+
+    return m_receivers.size() == peer_count;
+  }
+
+  bool test()
+  {
+    size_t received = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    uint32_t command = CryptoNote::NOTIFY_NEW_BLOCK::ID;
+    std::vector<CryptoNote::P2pMessage> messages;
+    if (shared)
+    {
+      auto buffer = std::make_shared<const CryptoNote::BinaryArray>(m_payload);
+      for (size_t i = 0; i < peer_count; ++i)
+        messages.emplace_back(CryptoNote::P2pMessage::NOTIFY, command, buffer);
+    }
+    else
+    {
+      for (size_t i = 0; i < peer_count; ++i)
+        messages.emplace_back(CryptoNote::P2pMessage::NOTIFY, command, m_payload);
+    }
+
+    System::ContextGroup group(m_dispatcher);
+    for (size_t i = 0; i < peer_count; ++i)
+    {
+      group.spawn([&, i] {
+        CryptoNote::LevinProtocol(m_senders[i]).sendMessage(messages[i].command, *messages[i].buffer, false);
+      });
+
+      group.spawn([&, i] {
+        CryptoNote::LevinProtocol::Command cmd;
+        if (CryptoNote::LevinProtocol(m_receivers[i]).readCommand(cmd) && cmd.buf.size() == payload_size)
+          ++received;
+      });
+    }
+
+    group.wait();
+    m_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    ++m_relays;
+
+    return received == peer_count;
+  }
+
+private:
+  System::Dispatcher m_dispatcher;
+  std::vector<System::TcpConnection> m_senders;
+  std::vector<System::TcpConnection> m_receivers;
+  CryptoNote::BinaryArray m_payload;
+  size_t m_relays;
+  uint64_t m_time;
+};
@@ -0,0 +1,88 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include <boost/filesystem.hpp>
+
+#include "CryptoNoteCore/OutputIndex.h"
+#include "crypto/crypto.h"
+
+// Resolves the ring members of inputs through the output index, the way check_tx_input does, and measures how long
+// reopening the index takes for output_count stored outputs.
+template<size_t output_count>
+class test_ring_member_lookup
+{
+public:
+  static const size_t loop_count = 100;
+  static const size_t amount_count = 20;
+  static const size_t input_count = 10000;
+  static const size_t ring_size = 11;
+
+  test_ring_member_lookup() :
+    m_path(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+    m_loadTime(0) {
+  }
+
+  ~test_ring_member_lookup()
+  {
+    boost::system::error_code ignore;
+    boost::filesystem::remove(m_path, ignore);
+    if (m_loadTime != 0)
+      std::cout << "  load of " << output_count << " outputs: " << m_loadTime << " us" << std::endl;
+  }
+
+  bool init()
+  {
+    {
+      CryptoNote::OutputIndex index;
+      index.open(m_path.string());
+      for (size_t i = 0; i < output_count; ++i)
+      {
+        CryptoNote::OutputIndex::Entry entry = {};
+        entry.key = Crypto::rand<Crypto::PublicKey>();
+        entry.amount = i % amount_count;
+        entry.block = static_cast<uint32_t>(i / 100);
+        index.push(entry);
+      }
+
+      index.flush();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    m_index.open(m_path.string());
+    if (!m_index.load(output_count))
+      return false;
+
+    m_loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return true;
+  }
+
+  bool test()
+  {
+    std::minstd_rand random(static_cast<uint32_t>(m_loadTime));
+    uint64_t sum = 0;
+    for (size_t i = 0; i < input_count; ++i)
+    {
+      uint64_t amount = i % amount_count;
+      size_t count = m_index.outputCount(amount);
+      for (size_t j = 0; j < ring_size; ++j)
+      {
+        const CryptoNote::OutputIndex::Entry& entry = m_index.get(amount, random() % count);
+        sum += entry.key.data[0] + entry.block;
+      }
+    }
+
+    return sum != 0;
+  }
+
+private:
+  boost::filesystem::path m_path;
+  CryptoNote::OutputIndex m_index;
+  uint64_t m_loadTime;
+};
@@ -0,0 +1,146 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/RemoteContext.h>
+
+#include "Common/StringTools.h"
+#include "crypto/hash.h"
+#include "Logging/ConsoleLogger.h"
+#include "Rpc/HttpClient.h"
+#include "Rpc/HttpServer.h"
+
+#include "PerformanceUtils.h"
+
+// Load generator for HttpServer: client_count keep-alive connections send requests back to back to a handler that
+// hashes for a while, like a read-only RPC call against the core. thread_count 0 serves everything in the dispatcher
+// of the test thread, otherwise the server runs thread_count worker threads.
+template<size_t thread_count>
+class test_rpc_throughput
+{
+public:
+  static const size_t loop_count = 10;
+  static const size_t client_count = 32;
+  static const size_t requests_per_client = 50;
+  static const size_t hashes_per_request = 200;
+  static const uint16_t port = 38212;
+
+  test_rpc_throughput() :
+    m_logger(Logging::ERROR),
+    m_server(m_dispatcher, m_logger),
+    m_time(0) {
+    // the server threads inherit the affinity of the thread creating them
+    reset_thread_affinity();
+  }
+
+  ~test_rpc_throughput()
+  {
+    m_server.stop();
+    set_process_affinity(1);
+    if (m_time == 0)
+      return;
+
+    std::sort(m_latencies.begin(), m_latencies.end());
+    double seconds = static_cast<double>(m_time) / 1000000;
+    std::cout << "  " << thread_count << " rpc threads, " << client_count << " clients: "
+      << static_cast<uint64_t>(m_latencies.size() / seconds) << " requests/sec, p99 latency "
+      << m_latencies[m_latencies.size() * 99 / 100] << " us" << std::endl;
+  }
+
+  bool init()
+  {
+    try
+    {
+      m_server.setWorkerThreads(thread_count);
+      m_server.start("127.0.0.1", port);
+    }
+    catch (std::exception& e)
+    {
+      std::cerr << "rpc server start failed: " << e.what() << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    bool result = false;
+    std::vector<uint64_t> latencies;
+    auto start = std::chrono::steady_clock::now();
+
+    // the clients run in a thread of their own so that the test thread dispatcher is free to serve them
+    System::RemoteContext<>(m_dispatcher, [&] { result = runClients(latencies); }).get();
+
+    m_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    m_latencies.insert(m_latencies.end(), latencies.begin(), latencies.end());
+    return result;
+  }
+
+private:
+  class Server : public CryptoNote::HttpServer
+  {
+  public:
+    Server(System::Dispatcher& dispatcher, Logging::ILogger& log) : HttpServer(dispatcher, log) {
+    }
+
+    virtual void processRequest(const CryptoNote::HttpRequest& request, CryptoNote::HttpResponse& response) override
+    {
+      Crypto::Hash hash;
+      Crypto::cn_fast_hash(request.getBody().data(), request.getBody().size(), hash);
+      for (size_t i = 1; i < hashes_per_request; ++i)
+        Crypto::cn_fast_hash(&hash, sizeof(hash), hash);
+
+      response.setBody(Common::podToHex(hash));
+    }
+  };
+
+  bool runClients(std::vector<uint64_t>& latencies)
+  {
+    System::Dispatcher dispatcher;
+    System::ContextGroup clients(dispatcher);
+    size_t failed = 0;
+    for (size_t i = 0; i < client_count; ++i)
+    {
+      clients.spawn([&, i] {
+        try
+        {
+          CryptoNote::HttpClient client(dispatcher, "127.0.0.1", port);
+          for (size_t j = 0; j < requests_per_client; ++j)
+          {
+            CryptoNote::HttpRequest request;
+            CryptoNote::HttpResponse response;
+            request.setUrl("/hash");
+            request.setBody(std::to_string(i * requests_per_client + j));
+
+            auto start = std::chrono::steady_clock::now();
+            client.request(request, response);
+            latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+          }
+        }
+        catch (std::exception&)
+        {
+          ++failed;
+        }
+      });
+    }
+
+    clients.wait();
+    return failed == 0;
+  }
+
+  System::Dispatcher m_dispatcher;
+  Logging::ConsoleLogger m_logger;
+  Server m_server;
+  uint64_t m_time;
+  std::vector<uint64_t> m_latencies;
+};
@@ -0,0 +1,75 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Copyright (c) 2014-2016 SDN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <unordered_set>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+
+#include "SingleTransactionTestBase.h"
+
+// Scans a transaction with output_count outputs for the spend keys of one view key, the way TransfersConsumer does.
+// With batched the outputs go through one underive_public_keys call, otherwise through underive_public_key each.
+template<size_t output_count, bool batched>
+class test_scan_outputs : public single_tx_test_base
+{
+  static_assert(0 < output_count, "output_count must be greater than 0");
+
+public:
+  static const size_t loop_count = 1000;
+
+  bool init()
+  {
+    if (!single_tx_test_base::init())
+      return false;
+
+    Crypto::KeyDerivation derivation;
+    if (!Crypto::generate_key_derivation(m_tx_pub_key, m_bob.getAccountKeys().viewSecretKey, derivation))
+      return false;
+
+    m_spend_keys.insert(m_bob.getAccountKeys().address.spendPublicKey);
+    for (size_t i = 0; i < output_count; ++i) {
+      Crypto::PublicKey key;
+      if (!Crypto::derive_public_key(derivation, i, m_bob.getAccountKeys().address.spendPublicKey, key))
+        return false;
+
+      m_output_keys.push_back(key);
+      m_output_indexes.push_back(i);
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    Crypto::KeyDerivation derivation;
+    if (!Crypto::generate_key_derivation(m_tx_pub_key, m_bob.getAccountKeys().viewSecretKey, derivation))
+      return false;
+
+    std::vector<Crypto::PublicKey> spend_keys(output_count);
+    if (batched) {
+      Crypto::underive_public_keys(derivation, m_output_indexes.data(), m_output_keys.data(), output_count, spend_keys.data());
+    } else {
+      for (size_t i = 0; i < output_count; ++i) {
+        Crypto::underive_public_key(derivation, m_output_indexes[i], m_output_keys[i], spend_keys[i]);
+      }
+    }
+
+    size_t found = 0;
+    for (const auto& key : spend_keys) {
+      found += m_spend_keys.count(key);
+    }
+
+    return found == output_count;
+  }
+
+private:
+  std::unordered_set<Crypto::PublicKey> m_spend_keys;
+  std::vector<Crypto::PublicKey> m_output_keys;
+  std::vector<size_t> m_output_indexes;
+};
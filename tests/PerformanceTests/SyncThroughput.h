@@ -0,0 +1,150 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/utility/value_init.hpp>
+
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Core.h"
+#include "CryptoNoteCore/CoreConfig.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/VerificationContext.h"
+#include "Logging/ConsoleLogger.h"
+
+#include "PerformanceUtils.h"
+#include "TestChain.h"
+
+// Measures how fast a node adds downloaded blocks: the same path as CryptoNoteProtocolHandler::processObjects,
+// batches of BLOCKS_SYNCHRONIZING_DEFAULT_COUNT blocks prevalidated on thread_count threads and then committed in order.
+template<size_t thread_count>
+class test_sync_throughput
+{
+public:
+  static const size_t loop_count = 3;
+  static const size_t coinbase_block_count = 400;
+  static const size_t transaction_block_count = 100;
+  static const size_t transactions_per_block = 4;
+
+  test_sync_throughput() :
+    m_logger(Logging::ERROR),
+    m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()),
+    m_transactionCount(0),
+    m_syncedBlocks(0),
+    m_syncTime(0) {
+    // the sync threads inherit the affinity of the thread creating them
+    reset_thread_affinity();
+  }
+
+  ~test_sync_throughput()
+  {
+    set_process_affinity(1);
+    if (m_syncTime == 0)
+      return;
+
+    double seconds = static_cast<double>(m_syncTime) / 1000000;
+    std::cout << "  " << thread_count << " sync threads: " << m_blocks.size() << " blocks with " << m_transactionCount
+      << " transactions, " << static_cast<uint64_t>(m_syncedBlocks / seconds) << " blocks/sec" << std::endl;
+  }
+
+  bool init()
+  {
+    m_miner.generate();
+
+    test_folder folder("sync_throughput");
+    test_core node(m_currency, m_logger);
+    if (!node.init(folder.path(), config()) || !node.addBlocks(m_miner, coinbase_block_count, &m_blocks))
+      return false;
+
+    for (size_t i = 0; i < transaction_block_count; ++i)
+    {
+      for (size_t j = 0; j < transactions_per_block; ++j)
+      {
+        CryptoNote::BinaryArray transactionBlob;
+        if (!node.addTransaction(m_miner, m_blocks[m_transactionCount], transactionBlob))
+          return false;
+
+        m_transactionBlobs[CryptoNote::getBinaryArrayHash(transactionBlob)] = transactionBlob;
+        ++m_transactionCount;
+      }
+
+      if (!node.addBlocks(m_miner, 1, &m_blocks))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    test_folder folder("sync_throughput");
+    test_core node(m_currency, m_logger);
+    if (!node.init(folder.path(), config()))
+      return false;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < m_blocks.size(); offset += CryptoNote::BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)
+    {
+      size_t count = std::min(m_blocks.size() - offset, CryptoNote::BLOCKS_SYNCHRONIZING_DEFAULT_COUNT);
+      std::vector<CryptoNote::PrevalidatedBlock> batch(count);
+      for (size_t i = 0; i < count; ++i)
+      {
+        batch[i].block = m_blocks[offset + i];
+        for (const auto& transactionHash : batch[i].block.transactionHashes)
+        {
+          const CryptoNote::BinaryArray& blob = m_transactionBlobs[transactionHash];
+          batch[i].transactionBlobs.emplace_back(reinterpret_cast<const char*>(blob.data()), blob.size());
+        }
+      }
+
+      if (!node.core().prevalidateBlocks(batch))
+        return false;
+
+      for (const auto& entry : batch)
+      {
+        for (size_t i = 0; i < entry.transactions.size(); ++i)
+        {
+          CryptoNote::tx_verification_context tvc = boost::value_initialized<CryptoNote::tx_verification_context>();
+          node.core().handle_incoming_tx(entry.transactions[i], entry.block.transactionHashes[i], entry.transactionBlobs[i].getSize(), tvc, true);
+          if (tvc.m_verification_failed)
+            return false;
+        }
+
+        CryptoNote::block_verification_context bvc = boost::value_initialized<CryptoNote::block_verification_context>();
+        node.protocolCore().handle_incoming_block(entry.block, bvc, false, false);
+        if (!bvc.m_added_to_main_chain)
+          return false;
+      }
+    }
+
+    m_syncTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    m_syncedBlocks += m_blocks.size();
+    return true;
+  }
+
+private:
+  CryptoNote::CoreConfig config()
+  {
+    CryptoNote::CoreConfig config;
+    config.syncThreads = thread_count;
+    return config;
+  }
+
+  Logging::ConsoleLogger m_logger;
+  CryptoNote::Currency m_currency;
+  CryptoNote::AccountBase m_miner;
+  std::vector<CryptoNote::Block> m_blocks;
+  std::unordered_map<Crypto::Hash, CryptoNote::BinaryArray> m_transactionBlobs;
+  size_t m_transactionCount;
+  uint64_t m_syncedBlocks;
+  uint64_t m_syncTime;
+};
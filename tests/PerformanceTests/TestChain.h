@@ -0,0 +1,248 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/utility/value_init.hpp>
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Blockchain.h"
+#include "CryptoNoteCore/Core.h"
+#include "CryptoNoteCore/CoreConfig.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/ITimeProvider.h"
+#include "CryptoNoteCore/MinerConfig.h"
+#include "CryptoNoteCore/TransactionExtra.h"
+#include "CryptoNoteCore/TransactionPool.h"
+#include "CryptoNoteCore/UpgradeDetector.h"
+#include "CryptoNoteCore/VerificationContext.h"
+#include "Logging/ILogger.h"
+
+// Chains the blockchain and node benchmarks are run on. Blocks are v1 blocks a couple of seconds apart, so that the
+// difficulty stays low, and their miner transactions pay the miner account given.
+
+// A folder in the temporary directory, removed with its content on destruction.
+class test_folder
+{
+public:
+  explicit test_folder(const std::string& prefix) :
+    m_path(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path(prefix + "_%%%%%%%%")) {
+  }
+
+  ~test_folder()
+  {
+    boost::system::error_code ignore;
+    boost::filesystem::remove_all(m_path, ignore);
+  }
+
+  std::string path() const
+  {
+    return m_path.string();
+  }
+
+private:
+  boost::filesystem::path m_path;
+};
+
+// A Blockchain and its transaction pool, grown one miner transaction only block at a time.
+class test_blockchain
+{
+public:
+  test_blockchain(const CryptoNote::Currency& currency, Logging::ILogger& logger, bool blockchainIndexesEnabled = false) :
+    m_currency(currency),
+    m_pool(currency, m_blockchain, m_timeProvider, logger),
+    m_blockchain(currency, m_pool, logger, blockchainIndexesEnabled, false),
+    m_initialized(false) {
+  }
+
+  ~test_blockchain()
+  {
+    deinit();
+  }
+
+  bool init(const std::string& folder, bool load)
+  {
+    m_initialized = m_blockchain.init(folder, load);
+    return m_initialized;
+  }
+
+  bool deinit()
+  {
+    if (!m_initialized)
+      return false;
+
+    m_initialized = false;
+    return m_blockchain.deinit();
+  }
+
+  CryptoNote::Blockchain& blockchain()
+  {
+    return m_blockchain;
+  }
+
+  bool addBlocks(const CryptoNote::AccountBase& miner, size_t count, std::vector<CryptoNote::Block>* blocks = nullptr)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      CryptoNote::Block block;
+      if (!constructBlock(miner, block))
+        return false;
+
+      CryptoNote::block_verification_context bvc = boost::value_initialized<CryptoNote::block_verification_context>();
+      if (!m_blockchain.addNewBlock(block, bvc) || !bvc.m_added_to_main_chain)
+        return false;
+
+      if (blocks != nullptr)
+        blocks->push_back(block);
+    }
+
+    return true;
+  }
+
+  bool constructBlock(const CryptoNote::AccountBase& miner, CryptoNote::Block& block)
+  {
+    uint32_t height = m_blockchain.getCurrentBlockchainHeight();
+
+    block = boost::value_initialized<CryptoNote::Block>();
+    block.majorVersion = m_blockchain.getBlockMajorVersionForHeight(height);
+    if (block.majorVersion != CryptoNote::BLOCK_MAJOR_VERSION_1)
+      return false;
+
+    block.minorVersion = m_currency.upgradeHeight(CryptoNote::BLOCK_MAJOR_VERSION_2) == CryptoNote::UpgradeDetectorBase::UNDEF_HEIGHT ?
+      CryptoNote::BLOCK_MINOR_VERSION_1 : CryptoNote::BLOCK_MINOR_VERSION_0;
+    block.previousBlockHash = m_blockchain.getTailId();
+    block.timestamp = m_currency.genesisBlock().timestamp + height * m_currency.difficultyTarget();
+
+    // the reward is split into digit outputs like 5000, 200, 30 that repeat from block to block
+    return m_currency.constructMinerTx(block.majorVersion, height, 0, m_blockchain.getCoinsInCirculation(), 0, 0,
+      miner.getAccountKeys().address, block.baseTransaction, CryptoNote::BinaryArray(), 16);
+  }
+
+private:
+  const CryptoNote::Currency& m_currency;
+  CryptoNote::RealTimeProvider m_timeProvider;
+  CryptoNote::tx_memory_pool m_pool;
+  CryptoNote::Blockchain m_blockchain;
+  bool m_initialized;
+};
+
+// A node core, grown with its own block templates the way a miner grows it.
+class test_core
+{
+public:
+  test_core(const CryptoNote::Currency& currency, Logging::ILogger& logger) :
+    m_currency(currency),
+    m_logger(logger),
+    m_core(currency, nullptr, logger, false, false),
+    m_initialized(false) {
+  }
+
+  ~test_core()
+  {
+    if (m_initialized)
+      m_core.deinit();
+  }
+
+  bool init(const std::string& folder, CryptoNote::CoreConfig config = CryptoNote::CoreConfig())
+  {
+    config.configFolder = folder;
+    m_initialized = m_core.init(config, CryptoNote::MinerConfig(), false);
+    return m_initialized;
+  }
+
+  CryptoNote::core& core()
+  {
+    return m_core;
+  }
+
+  // the entry points used by the protocol handler
+  CryptoNote::ICore& protocolCore()
+  {
+    return m_core;
+  }
+
+  // Mines the current block template with the transactions of the pool.
+  bool addBlock(const CryptoNote::AccountBase& miner, CryptoNote::Block& block)
+  {
+    CryptoNote::difficulty_type difficulty;
+    uint32_t height;
+    if (!m_core.get_block_template(block, miner.getAccountKeys().address, difficulty, height, CryptoNote::BinaryArray()))
+      return false;
+
+    // keep the difficulty low, the template takes the current time
+    block.timestamp = m_currency.genesisBlock().timestamp + height * m_currency.difficultyTarget();
+
+    CryptoNote::block_verification_context bvc = boost::value_initialized<CryptoNote::block_verification_context>();
+    protocolCore().handle_incoming_block(block, bvc, false, false);
+    return bvc.m_added_to_main_chain;
+  }
+
+  bool addBlocks(const CryptoNote::AccountBase& miner, size_t count, std::vector<CryptoNote::Block>* blocks = nullptr)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      CryptoNote::Block block;
+      if (!addBlock(miner, block))
+        return false;
+
+      if (blocks != nullptr)
+        blocks->push_back(block);
+    }
+
+    return true;
+  }
+
+  // Adds a transaction to the pool that sends all outputs of the miner transaction of the given block back to the miner.
+  bool addTransaction(const CryptoNote::AccountBase& miner, const CryptoNote::Block& block, CryptoNote::BinaryArray& transactionBlob)
+  {
+    const CryptoNote::Transaction& coinbase = block.baseTransaction;
+    std::vector<uint32_t> globalIndexes;
+    if (!m_core.get_tx_outputs_gindexs(CryptoNote::getObjectHash(coinbase), globalIndexes))
+      return false;
+
+    std::vector<CryptoNote::TransactionSourceEntry> sources;
+    uint64_t amount = 0;
+    for (size_t i = 0; i < coinbase.outputs.size(); ++i)
+    {
+      CryptoNote::TransactionSourceEntry source;
+      source.outputs.push_back({globalIndexes[i], boost::get<CryptoNote::KeyOutput>(coinbase.outputs[i].target).key});
+      source.realOutput = 0;
+      source.realTransactionPublicKey = CryptoNote::getTransactionPublicKeyFromExtra(coinbase.extra);
+      source.realOutputIndexInTransaction = i;
+      source.amount = coinbase.outputs[i].amount;
+      sources.push_back(source);
+      amount += source.amount;
+    }
+
+    std::vector<CryptoNote::TransactionDestinationEntry> destinations;
+    destinations.push_back(CryptoNote::TransactionDestinationEntry(amount - m_currency.minimumFee(), miner.getAccountKeys().address));
+
+    CryptoNote::Transaction tx;
+    Crypto::SecretKey txKey;
+    if (!CryptoNote::constructTransaction(miner.getAccountKeys(), sources, destinations, std::vector<uint8_t>(), tx, 0, m_logger, txKey))
+      return false;
+
+    transactionBlob = CryptoNote::toBinaryArray(tx);
+    CryptoNote::tx_verification_context tvc = boost::value_initialized<CryptoNote::tx_verification_context>();
+    return m_core.handle_incoming_tx(transactionBlob, tvc, false) && tvc.m_added_to_pool;
+  }
+
+  bool addTransaction(const CryptoNote::AccountBase& miner, const CryptoNote::Block& block)
+  {
+    CryptoNote::BinaryArray transactionBlob;
+    return addTransaction(miner, block, transactionBlob);
+  }
+
+private:
+  const CryptoNote::Currency& m_currency;
+  Logging::ILogger& m_logger;
+  CryptoNote::core m_core;
+  bool m_initialized;
+};
@@ -7,15 +7,32 @@
 #include "PerformanceUtils.h"
 
 // tests
+#include "BlockchainReadLatency.h"
+#include "BlockSummaries.h"
+#include "CacheSnapshot.h"
 #include "ConstructTransaction.h"
+#include "ContextSwitch.h"
 #include "CheckRingSignature.h"
 #include "CryptoNoteSlowHash.h"
 #include "DerivePublicKey.h"
 #include "DeriveSecretKey.h"
+#include "ExplorerIndexRange.h"
+#include "FillBlockTemplate.h"
 #include "GenerateKeyDerivation.h"
+#include "GetBlockTemplate.h"
+#include "GetRandomOuts.h"
 #include "GenerateKeyImage.h"
 #include "GenerateKeyImageHelper.h"
 #include "IsOutToAccount.h"
+#include "JsonSerialization.h"
+#include "MinerHashing.h"
+#include "QueryBlocks.h"
+#include "RebuildCache.h"
+#include "RelayFanOut.h"
+#include "RingMemberLookup.h"
+#include "RpcThroughput.h"
+#include "ScanOutputs.h"
+#include "SyncThroughput.h"
 
 int main(int argc, char** argv)
 {
@@ -51,6 +68,11 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(test_check_ring_signature, 10);
   TEST_PERFORMANCE1(test_check_ring_signature, 100);
 
+  TEST_PERFORMANCE2(test_check_ring_signature, 1, 10);
+  TEST_PERFORMANCE2(test_check_ring_signature, 1, 100);
+  TEST_PERFORMANCE2(test_check_ring_signature, 10, 10);
+  TEST_PERFORMANCE2(test_check_ring_signature, 10, 100);
+
   TEST_PERFORMANCE0(test_is_out_to_acc);
   TEST_PERFORMANCE0(test_generate_key_image_helper);
   TEST_PERFORMANCE0(test_generate_key_derivation);
@@ -58,7 +80,51 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE0(test_derive_public_key);
   TEST_PERFORMANCE0(test_derive_secret_key);
 
-  TEST_PERFORMANCE0(test_cn_slow_hash);
+  TEST_PERFORMANCE2(test_scan_outputs, 2, false);
+  TEST_PERFORMANCE2(test_scan_outputs, 2, true);
+  TEST_PERFORMANCE2(test_scan_outputs, 16, false);
+  TEST_PERFORMANCE2(test_scan_outputs, 16, true);
+
+  TEST_PERFORMANCE3(test_cn_slow_hash, 0, 0, 1);
+  TEST_PERFORMANCE3(test_cn_slow_hash, 0, 2, 1);
+  TEST_PERFORMANCE3(test_cn_slow_hash, 0, 2, 2);
+  TEST_PERFORMANCE3(test_cn_slow_hash, 1, 2, 1);
+  TEST_PERFORMANCE3(test_cn_slow_hash, 1, 2, 2);
+  TEST_PERFORMANCE3(test_cn_slow_hash, 1, 2, 4);
+
+  TEST_PERFORMANCE0(test_blockchain_read_latency);
+
+  TEST_PERFORMANCE1(test_sync_throughput, 1);
+  TEST_PERFORMANCE1(test_sync_throughput, 2);
+  TEST_PERFORMANCE1(test_sync_throughput, 4);
+
+  TEST_PERFORMANCE1(test_query_blocks, false);
+  TEST_PERFORMANCE1(test_query_blocks, true);
+
+  TEST_PERFORMANCE2(test_fill_block_template, 10000, false);
+  TEST_PERFORMANCE2(test_fill_block_template, 10000, true);
+  TEST_PERFORMANCE1(test_get_block_template, false);
+  TEST_PERFORMANCE1(test_get_block_template, true);
+  TEST_PERFORMANCE2(test_relay_fan_out, 100, false);
+  TEST_PERFORMANCE2(test_relay_fan_out, 100, true);
+  TEST_PERFORMANCE2(test_json_serialization, 10000, false);
+  TEST_PERFORMANCE2(test_json_serialization, 10000, true);
+  TEST_PERFORMANCE1(test_rpc_throughput, 0);
+  TEST_PERFORMANCE1(test_rpc_throughput, 4);
+  TEST_PERFORMANCE1(test_ring_member_lookup, 1000000);
+  TEST_PERFORMANCE2(test_get_random_outs, 20, 2);
+  TEST_PERFORMANCE2(test_get_random_outs, 20, 10);
+  TEST_PERFORMANCE2(test_get_random_outs, 200, 10);
+  TEST_PERFORMANCE0(test_cache_snapshot);
+  TEST_PERFORMANCE1(test_rebuild_cache, 3000);
+  TEST_PERFORMANCE1(test_explorer_index_range, 1000000);
+  TEST_PERFORMANCE1(test_block_summaries, false);
+  TEST_PERFORMANCE1(test_block_summaries, true);
+  TEST_PERFORMANCE3(test_miner_hashing, CryptoNote::BLOCK_MAJOR_VERSION_1, 1000, false);
+  TEST_PERFORMANCE3(test_miner_hashing, CryptoNote::BLOCK_MAJOR_VERSION_1, 1000, true);
+  TEST_PERFORMANCE3(test_miner_hashing, CryptoNote::BLOCK_MAJOR_VERSION_9, 1000, false);
+  TEST_PERFORMANCE3(test_miner_hashing, CryptoNote::BLOCK_MAJOR_VERSION_9, 1000, true);
+  TEST_PERFORMANCE1(test_context_switch, 1000000);
 
   std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
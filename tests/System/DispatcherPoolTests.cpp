@@ -0,0 +1,132 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <System/DispatcherPool.h>
+#include <System/Event.h>
+#include <System/InterruptedException.h>
+#include <System/Timer.h>
+#include <gtest/gtest.h>
+
+using namespace System;
+
+TEST(DispatcherPoolTests, waitRunsAllSpawnedProcedures) {
+  std::atomic<size_t> done(0);
+  DispatcherPool pool(4);
+  for (size_t i = 0; i < 100; ++i) {
+    pool.spawn([&](Dispatcher&) {
+      ++done;
+    });
+  }
+
+  pool.wait();
+  ASSERT_EQ(100, done);
+}
+
+TEST(DispatcherPoolTests, waitIncludesProceduresSpawnedByProcedures) {
+  std::atomic<size_t> done(0);
+  DispatcherPool pool(2);
+  pool.spawn([&](Dispatcher& dispatcher) {
+    Timer(dispatcher).sleep(std::chrono::milliseconds(10));
+    pool.spawn([&](Dispatcher&) {
+      ++done;
+    });
+
+    ++done;
+  });
+
+  pool.wait();
+  ASSERT_EQ(2, done);
+}
+
+TEST(DispatcherPoolTests, procedureRunsWithDispatcherOfItsThread) {
+  Dispatcher* procedureDispatcher = nullptr;
+  Dispatcher* currentDispatcher = nullptr;
+  DispatcherPool pool(2);
+  pool.spawn(0, [&](Dispatcher& dispatcher) {
+    procedureDispatcher = &dispatcher;
+    currentDispatcher = DispatcherPool::getCurrentDispatcher();
+  });
+
+  pool.wait();
+  ASSERT_NE(nullptr, procedureDispatcher);
+  ASSERT_EQ(procedureDispatcher, currentDispatcher);
+  ASSERT_EQ(nullptr, DispatcherPool::getCurrentDispatcher());
+}
+
+TEST(DispatcherPoolTests, pinnedProceduresStayInTheirThread) {
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  DispatcherPool pool(4);
+  for (size_t i = 0; i < 20; ++i) {
+    pool.spawn(1, [&](Dispatcher&) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.insert(std::this_thread::get_id());
+    });
+  }
+
+  pool.wait();
+  ASSERT_EQ(1, threads.size());
+}
+
+TEST(DispatcherPoolTests, idleThreadStealsQueuedProcedures) {
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  DispatcherPool pool(2);
+  pool.spawn(0, [&](Dispatcher&) {
+    // queued in this thread, which is kept busy by each of them
+    for (size_t i = 0; i < 8; ++i) {
+      pool.spawn([&](Dispatcher&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+      });
+    }
+  });
+
+  pool.wait();
+  ASSERT_EQ(2, threads.size());
+}
+
+TEST(DispatcherPoolTests, stopInterruptsWaitingProcedures) {
+  std::atomic<size_t> started(0);
+  std::atomic<size_t> interrupted(0);
+  DispatcherPool pool(2);
+  for (size_t i = 0; i < 10; ++i) {
+    pool.spawn([&](Dispatcher& dispatcher) {
+      Event event(dispatcher);
+      ++started;
+      try {
+        event.wait();
+      } catch (InterruptedException&) {
+        ++interrupted;
+      }
+    });
+  }
+
+  while (started != 10) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  pool.stop();
+  ASSERT_EQ(10, interrupted);
+}
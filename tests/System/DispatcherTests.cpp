@@ -3,7 +3,9 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chrono>
 #include <future>
+#include <thread>
 #include <System/Context.h>
 #include <System/Dispatcher.h>
 #include <System/Event.h>
@@ -374,3 +376,39 @@ TEST_F(DispatcherTests, yieldExecutesIoOnItsFront) {
   dispatcher.yield();
   ASSERT_TRUE(spawnDone);
 }
+
+#ifdef __linux__
+namespace {
+
+// Writes size bytes of the stack from the top down, so that an overrun reaches the guard page below the stack first.
+template<size_t size> uint8_t touchStack() {
+  volatile uint8_t buffer[size];
+  for (size_t i = size; i > 0; i -= 4096) {
+    buffer[i - 1] = 1;
+  }
+
+  return buffer[size - 1];
+}
+
+}
+
+TEST(DispatcherStackDeathTest, overrunOfConfiguredStackSizeFaultsOnGuardPage) {
+  {
+    Dispatcher dispatcher(64 * 1024);
+    Context<uint8_t> context(dispatcher, [] { return touchStack<48 * 1024>(); });
+    ASSERT_EQ(1, context.get());
+  }
+
+  {
+    Dispatcher dispatcher;
+    Context<uint8_t> context(dispatcher, [] { return touchStack<96 * 1024>(); });
+    ASSERT_EQ(1, context.get());
+  }
+
+  ASSERT_DEATH({
+    Dispatcher dispatcher(64 * 1024);
+    Context<uint8_t> context(dispatcher, [] { return touchStack<96 * 1024>(); });
+    context.get();
+  }, "");
+}
+#endif
@@ -14,6 +14,56 @@
 #include <System/TcpStream.h>
 #include <System/Timer.h>
 #include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+// Socket and epoll calls of the test binary, counted on the way to libc.
+namespace {
+
+std::atomic<size_t> socketCalls(0);
+std::atomic<size_t> epollControlCalls(0);
+
+template<class Function> Function nextFunction(const char* name) {
+  return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+}
+
+}
+
+extern "C" {
+
+ssize_t recv(int socket, void* buffer, size_t size, int flags) {
+  static auto next = nextFunction<ssize_t (*)(int, void*, size_t, int)>("recv");
+  ++socketCalls;
+  return next(socket, buffer, size, flags);
+}
+
+ssize_t sendmsg(int socket, const msghdr* message, int flags) {
+  static auto next = nextFunction<ssize_t (*)(int, const msghdr*, int)>("sendmsg");
+  ++socketCalls;
+  return next(socket, message, flags);
+}
+
+int epoll_wait(int epoll, epoll_event* events, int maxEvents, int timeout) {
+  static auto next = nextFunction<int (*)(int, epoll_event*, int, int)>("epoll_wait");
+  ++socketCalls;
+  return next(epoll, events, maxEvents, timeout);
+}
+
+int epoll_ctl(int epoll, int operation, int descriptor, epoll_event* event) __THROW {
+  static auto next = nextFunction<int (*)(int, int, int, epoll_event*)>("epoll_ctl");
+  ++socketCalls;
+  ++epollControlCalls;
+  return next(epoll, operation, descriptor, event);
+}
+
+}
+#endif
 
 using namespace System;
 
@@ -352,3 +402,76 @@ TEST_F(TcpConnectionTests, sendBigChunkThruTcpStream) {
     ASSERT_EQ(buf[i], incoming[i]); //for better output.
   }
 }
+
+#ifdef __linux__
+TEST_F(TcpConnectionTests, systemCallsPerMegabyte) {
+  const size_t connectionCount = 64;
+  const size_t bytesPerConnection = 1024 * 1024;
+  const size_t messageSize = 4096;
+
+  std::vector<TcpConnection> clients;
+  std::vector<TcpConnection> servers;
+  for (size_t i = 0; i < connectionCount; ++i) {
+    clients.push_back(TcpConnector(dispatcher).connect(LISTEN_ADDRESS, LISTEN_PORT));
+    servers.push_back(listener.accept());
+  }
+
+  auto readMessage = [&](TcpConnection& connection, uint8_t* buffer) {
+    for (size_t size = 0; size < messageSize;) {
+      size_t transferred = connection.read(buffer + size, messageSize - size);
+      if (transferred == 0) {
+        return false;
+      }
+
+      size += transferred;
+    }
+
+    return true;
+  };
+
+  auto writeMessage = [&](TcpConnection& connection, const uint8_t* buffer) {
+    for (size_t size = 0; size < messageSize;) {
+      size += connection.write(buffer + size, messageSize - size);
+    }
+  };
+
+  std::vector<uint8_t> message(messageSize);
+  fillRandomBuf(message);
+  size_t received = 0;
+  size_t socketCallsBefore = socketCalls;
+  size_t epollControlCallsBefore = epollControlCalls;
+  auto start = std::chrono::steady_clock::now();
+  // Requests and echoed replies, so that every read waits for the peer, as peers and RPC clients do.
+  for (size_t i = 0; i < connectionCount; ++i) {
+    contextGroup.spawn([&, i] {
+      std::vector<uint8_t> reply(messageSize);
+      for (size_t sent = 0; sent < bytesPerConnection; sent += messageSize) {
+        writeMessage(clients[i], message.data());
+        if (!readMessage(clients[i], reply.data()) || reply != message) {
+          break;
+        }
+
+        received += messageSize;
+      }
+
+      clients[i] = TcpConnection();
+    });
+
+    contextGroup.spawn([&, i] {
+      std::vector<uint8_t> request(messageSize);
+      while (readMessage(servers[i], request.data())) {
+        writeMessage(servers[i], request.data());
+      }
+    });
+  }
+
+  contextGroup.wait();
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  size_t megabytes = connectionCount * bytesPerConnection / (1024 * 1024);
+  ASSERT_EQ(connectionCount * bytesPerConnection, received);
+  // Sockets are registered once, waiting for data or buffer space doesn't touch the registration.
+  ASSERT_EQ(epollControlCallsBefore, epollControlCalls);
+  std::cout << "  " << (socketCalls - socketCallsBefore) / megabytes << " socket and epoll calls, " <<
+    duration.count() / megabytes << " us per MB over " << connectionCount << " connections" << std::endl;
+}
+#endif
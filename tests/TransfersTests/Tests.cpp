@@ -16,6 +16,7 @@
 #include <condition_variable>
 #include <future>
 #include <atomic>
+#include <chrono>
 
 #include "../IntegrationTestLib/TestWalletLegacy.h"
 
@@ -346,6 +347,75 @@ TEST_F(TransfersTest, base) {
 }
 
 
+class SynchronizationWaiter : public IBlockchainSynchronizerObserver {
+public:
+  virtual void synchronizationProgressUpdated(uint32_t processedBlockCount, uint32_t totalBlockCount) override {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_processedBlockCount = processedBlockCount;
+  }
+
+  virtual void synchronizationCompleted(std::error_code result) override {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_completed = true;
+    m_result = result;
+    m_cv.notify_all();
+  }
+
+  bool waitForBlockCount(uint32_t blockCount) {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (!m_completed || (!m_result && m_processedBlockCount < blockCount)) {
+      if (m_cv.wait_for(lk, std::chrono::seconds(60)) == std::cv_status::timeout) {
+        return false;
+      }
+    }
+
+    return !m_result;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  uint32_t m_processedBlockCount = 0;
+  bool m_completed = false;
+  std::error_code m_result;
+};
+
+TEST_F(TransfersTest, scanSpeed) {
+  const size_t ACCOUNT_COUNT = 8;
+  const size_t BLOCK_COUNT = 500;
+
+  launchTestnet(1);
+
+  std::unique_ptr<CryptoNote::INode> node;
+  nodeDaemons[0]->makeINode(node);
+  Logging::ConsoleLogger m_logger;
+
+  BlockchainSynchronizer blockSync(*node.get(), currency.genesisBlockHash());
+  TransfersSyncronizer transferSync(currency, m_logger, blockSync, *node.get());
+  SynchronizationWaiter waiter;
+  blockSync.addObserver(&waiter);
+
+  // every account has its own view key, so the blocks are scanned by ACCOUNT_COUNT consumers
+  AccountGroup accounts(transferSync);
+  accounts.generateAccounts(ACCOUNT_COUNT);
+  accounts.subscribeAll();
+
+  ASSERT_TRUE(mineBlocks(*nodeDaemons[0], accounts.m_accounts[0].keys.address, BLOCK_COUNT));
+
+  auto start = std::chrono::steady_clock::now();
+  blockSync.start();
+  ASSERT_TRUE(waiter.waitForBlockCount(static_cast<uint32_t>(BLOCK_COUNT)));
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  blockSync.stop();
+  blockSync.removeObserver(&waiter);
+
+  std::cout << "Scanned " << BLOCK_COUNT << " blocks for " << ACCOUNT_COUNT << " accounts in " << duration << " ms, "
+    << BLOCK_COUNT * 1000 / std::max<int64_t>(duration, 1) << " blocks/sec" << std::endl;
+
+  ASSERT_GT(accounts.getTransfers(0).balance(ITransfersContainer::IncludeAll), 0);
+}
+
+
 std::unique_ptr<ITransaction> createTransferToMultisignature(
   ITransfersContainer& tc, // money source
   uint64_t amount,
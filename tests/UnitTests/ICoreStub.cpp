@@ -81,6 +81,15 @@ bool ICoreStub::handle_incoming_tx(CryptoNote::BinaryArray const& tx_blob, Crypt
   return true;
 }
 
+bool ICoreStub::handle_incoming_tx(const CryptoNote::Transaction& tx, const Crypto::Hash& txHash, size_t blobSize,
+    CryptoNote::tx_verification_context& tvc, bool keeped_by_block) {
+  return true;
+}
+
+bool ICoreStub::prevalidateBlocks(std::vector<CryptoNote::PrevalidatedBlock>& blocks) {
+  return true;
+}
+
 void ICoreStub::set_blockchain_top(uint32_t height, const Crypto::Hash& top_id) {
   topHeight = height;
   topId = top_id;
@@ -33,6 +33,9 @@ public:
   virtual bool get_tx_outputs_gindexs(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) override;
   virtual CryptoNote::i_cryptonote_protocol* get_protocol() override;
   virtual bool handle_incoming_tx(CryptoNote::BinaryArray const& tx_blob, CryptoNote::tx_verification_context& tvc, bool keeped_by_block) override;
+  virtual bool handle_incoming_tx(const CryptoNote::Transaction& tx, const Crypto::Hash& txHash, size_t blobSize,
+      CryptoNote::tx_verification_context& tvc, bool keeped_by_block) override;
+  virtual bool prevalidateBlocks(std::vector<CryptoNote::PrevalidatedBlock>& blocks) override;
   virtual std::vector<CryptoNote::Transaction> getPoolTransactions() override;
   virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
                               std::vector<CryptoNote::Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) override;
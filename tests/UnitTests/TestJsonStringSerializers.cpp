@@ -0,0 +1,351 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <limits>
+
+#include "Common/JsonValue.h"
+#include "Serialization/JsonInputValueSerializer.h"
+#include "Serialization/JsonOutputStreamSerializer.h"
+#include "Serialization/JsonStringInputSerializer.h"
+#include "Serialization/JsonStringOutputSerializer.h"
+#include "Serialization/SerializationOverloads.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+// members are serialized in key order, so that the text of the JsonValue based serializer, which sorts them,
+// matches the text written in serialization order
+struct Values {
+  std::string a;
+  std::vector<uint8_t> blob;
+  bool flag = false;
+  int16_t i16 = 0;
+  int32_t i32 = 0;
+  int64_t i64 = 0;
+  std::vector<std::string> list;
+  uint16_t u16 = 0;
+  uint32_t u32 = 0;
+  uint64_t u64 = 0;
+  uint8_t u8 = 0;
+
+  bool operator==(const Values& other) const {
+    return a == other.a && blob == other.blob && flag == other.flag && i16 == other.i16 && i32 == other.i32 && i64 == other.i64 &&
+      list == other.list && u16 == other.u16 && u32 == other.u32 && u64 == other.u64 && u8 == other.u8;
+  }
+
+  void serialize(ISerializer& s) {
+    s(a, "a");
+    serializeAsBinary(blob, "blob", s);
+    s(flag, "flag");
+    s(i16, "i16");
+    s(i32, "i32");
+    s(i64, "i64");
+    s(list, "list");
+    s(u16, "u16");
+    s(u32, "u32");
+    s(u64, "u64");
+    s(u8, "u8");
+  }
+};
+
+// Reals are written with JsonValue's format. Like JsonInputValueSerializer, the reader takes integers only.
+struct Real {
+  double real = 0;
+
+  bool operator==(const Real& other) const {
+    return real == other.real;
+  }
+
+  void serialize(ISerializer& s) {
+    s(real, "real");
+  }
+};
+
+struct Nested {
+  Values values;
+  std::vector<Values> items;
+
+  bool operator==(const Nested& other) const {
+    return values == other.values && items == other.items;
+  }
+
+  void serialize(ISerializer& s) {
+    s(items, "items");
+    s(values, "values");
+  }
+};
+
+// Object depth of members named "n" nested in each other.
+struct Depth {
+  size_t depth = 0;
+
+  void serialize(ISerializer& s) {
+    depth = 0;
+    while (s.beginObject("n")) {
+      ++depth;
+    }
+
+    for (size_t i = 0; i < depth; ++i) {
+      s.endObject();
+    }
+  }
+};
+
+template<typename T> std::string writeWithJsonValue(T& value) {
+  JsonOutputStreamSerializer s;
+  serialize(value, s);
+  return s.getValue().toString();
+}
+
+template<typename T> std::string writeWithString(T& value) {
+  JsonStringOutputSerializer s;
+  serialize(value, s);
+  return s.getJson();
+}
+
+template<typename T> bool readWithJsonValue(T& value, const std::string& json) {
+  try {
+    JsonInputValueSerializer s(Common::JsonValue::fromString(json));
+    serialize(value, s);
+  } catch (std::exception&) {
+    return false;
+  }
+
+  return true;
+}
+
+template<typename T> bool readWithString(T& value, const std::string& json) {
+  try {
+    JsonStringInputSerializer s(json);
+    serialize(value, s);
+  } catch (std::exception&) {
+    return false;
+  }
+
+  return true;
+}
+
+template<typename T> void expectSameRead(const std::string& json) {
+  T fromJsonValue;
+  T fromString;
+  bool jsonValueRead = readWithJsonValue(fromJsonValue, json);
+  bool stringRead = readWithString(fromString, json);
+  EXPECT_EQ(jsonValueRead, stringRead) << json;
+  if (jsonValueRead && stringRead) {
+    EXPECT_TRUE(fromJsonValue == fromString) << json;
+  }
+}
+
+Values sampleValues() {
+  Values values;
+  values.a = "text";
+  values.blob = { 0x00, 0x7f, 0x80, 0xff };
+  values.flag = true;
+  values.i16 = -12345;
+  values.i32 = -1234567890;
+  values.i64 = -1234567890123456789;
+  values.list = { "one", "", "three" };
+  values.u16 = 54321;
+  values.u32 = 4000000000;
+  values.u64 = 1234567890123456789;
+  values.u8 = 200;
+  return values;
+}
+
+}
+
+TEST(JsonStringSerializers, writesSameTextAsJsonValue) {
+  Nested nested;
+  nested.values = sampleValues();
+  nested.items.push_back(sampleValues());
+  nested.items.push_back(Values());
+
+  ASSERT_EQ(writeWithJsonValue(nested), writeWithString(nested));
+}
+
+TEST(JsonStringSerializers, writesIntegerLimitsAsJsonValue) {
+  Values values;
+  values.i16 = std::numeric_limits<int16_t>::min();
+  values.i32 = std::numeric_limits<int32_t>::min();
+  values.i64 = std::numeric_limits<int64_t>::min();
+  values.u16 = std::numeric_limits<uint16_t>::max();
+  values.u32 = std::numeric_limits<uint32_t>::max();
+  values.u64 = std::numeric_limits<uint64_t>::max();
+  values.u8 = std::numeric_limits<uint8_t>::max();
+  ASSERT_EQ(writeWithJsonValue(values), writeWithString(values));
+
+  values.i16 = std::numeric_limits<int16_t>::max();
+  values.i32 = std::numeric_limits<int32_t>::max();
+  values.i64 = std::numeric_limits<int64_t>::max();
+  values.u64 = static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1;
+  ASSERT_EQ(writeWithJsonValue(values), writeWithString(values));
+}
+
+TEST(JsonStringSerializers, writesRealsAsJsonValue) {
+  const double reals[] = { 0.0, -0.0, 1.0, -2.5, 0.1, 1.0 / 3, 123456789.123456789, 1e-12, 5e-12, 1e20, -1e300,
+    std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(), std::numeric_limits<double>::min() };
+  for (double real : reals) {
+    Real value;
+    value.real = real;
+    ASSERT_EQ(writeWithJsonValue(value), writeWithString(value)) << real;
+  }
+}
+
+TEST(JsonStringSerializers, writesStringsWithoutEscapingAsJsonValue) {
+  Values values;
+  values.a = "quote \" backslash \\ newline \n tab \t unicode \xc3\xa9";
+  values.list = { "\\u0041", "\\\"" };
+  ASSERT_EQ(writeWithJsonValue(values), writeWithString(values));
+}
+
+TEST(JsonStringSerializers, readsSameValuesAsJsonValue) {
+  Nested nested;
+  nested.values = sampleValues();
+  nested.items.push_back(sampleValues());
+  nested.items.push_back(Values());
+  std::string json = writeWithJsonValue(nested);
+
+  expectSameRead<Nested>(json);
+  Nested fromString;
+  ASSERT_TRUE(readWithString(fromString, json));
+  ASSERT_TRUE(nested == fromString);
+}
+
+TEST(JsonStringSerializers, readsEscapesAsJsonValue) {
+  expectSameRead<Values>("{\"a\": \"quote \\\" backslash \\\\ slash \\/ controls \\b\\f\\n\\r\\t\"}");
+  expectSameRead<Values>("{\"a\": \"\\u0041\\u00e9\\u20ac\"}");
+  expectSameRead<Values>("{\"a\": \"surrogate pair \\ud83d\\ude00, lone \\ud83d and \\ude00\"}");
+  expectSameRead<Values>("{\"a\": \"\\u00\"}");
+  expectSameRead<Values>("{\"list\": [\"\\\"\", \"\\\\\", \"\\u005c\"]}");
+  expectSameRead<Values>("{\"a\": \"raw \xc3\xa9 \xf0\x9f\x98\x80\"}");
+}
+
+TEST(JsonStringSerializers, readsLastOfDuplicateKeysAsJsonValue) {
+  expectSameRead<Values>("{\"u32\": 1, \"u32\": 2}");
+  expectSameRead<Values>("{\"a\": \"first\", \"u8\": 1, \"a\": \"second\"}");
+  expectSameRead<Nested>("{\"values\": {\"u8\": 1}, \"values\": {\"u16\": 2}}");
+  expectSameRead<Nested>("{\"items\": [{\"u8\": 1}], \"items\": [{\"u8\": 2}, {\"u8\": 3}]}");
+
+  Values values;
+  ASSERT_TRUE(readWithString(values, "{\"u32\": 1, \"u32\": 2}"));
+  ASSERT_EQ(2, values.u32);
+}
+
+TEST(JsonStringSerializers, readsIntegerLimitsAsJsonValue) {
+  expectSameRead<Values>("{\"i64\": 9223372036854775807, \"u64\": -9223372036854775808}");
+  expectSameRead<Values>("{\"i64\": -9223372036854775808, \"u64\": 9223372036854775807}");
+  expectSameRead<Values>("{\"u64\": -1, \"u32\": 4294967295, \"u16\": 65535, \"u8\": 255}");
+  expectSameRead<Values>("{\"u32\": 4294967296, \"u16\": 65536, \"u8\": 256, \"i16\": -32769}");
+  expectSameRead<Values>("{\"i64\": 9223372036854775808}");
+  expectSameRead<Values>("{\"i64\": -9223372036854775809}");
+  expectSameRead<Values>("{\"u64\": 18446744073709551615}");
+  expectSameRead<Values>("{\"u64\": 99999999999999999999999999}");
+  expectSameRead<Values>("{\"i32\": 0, \"i16\": -0}");
+}
+
+TEST(JsonStringSerializers, readsRealsAsJsonValue) {
+  expectSameRead<Real>("{\"real\": 3}");
+  expectSameRead<Real>("{\"real\": -9223372036854775808}");
+  expectSameRead<Real>("{\"real\": 0.5}");
+  expectSameRead<Real>("{\"real\": -12.625}");
+  expectSameRead<Real>("{\"real\": 1.5e3}");
+  expectSameRead<Real>("{\"real\": 1.5e+3}");
+  expectSameRead<Real>("{\"real\": 1.5e-3}");
+  expectSameRead<Real>("{\"real\": 1.7976931348623157e308}");
+
+  Real value;
+  ASSERT_TRUE(readWithString(value, "{\"real\": -7}"));
+  ASSERT_EQ(-7.0, value.real);
+  ASSERT_FALSE(readWithString(value, "{\"real\": 0.5}"));
+}
+
+TEST(JsonStringSerializers, readsDeepNestingAsJsonValue) {
+  for (size_t depth : { 1, 10, 100, 1000 }) {
+    std::string json;
+    for (size_t i = 0; i < depth; ++i) {
+      json += "{\"n\": ";
+    }
+
+    json += "{}";
+    json.append(depth, '}');
+
+    Depth fromJsonValue;
+    Depth fromString;
+    ASSERT_TRUE(readWithJsonValue(fromJsonValue, json));
+    ASSERT_TRUE(readWithString(fromString, json));
+    ASSERT_EQ(depth, fromJsonValue.depth);
+    ASSERT_EQ(depth, fromString.depth);
+  }
+
+  std::string arrays(1000, '[');
+  arrays.append(1000, ']');
+  expectSameRead<Values>("{\"x\": " + arrays + ", \"u8\": 7}");
+}
+
+TEST(JsonStringSerializers, rejectsMalformedInputAsJsonValue) {
+  const char* malformed[] = {
+    "",
+    "   ",
+    "{",
+    "}",
+    "[",
+    "{\"a\"}",
+    "{\"a\" \"b\"}",
+    "{\"a\": }",
+    "{\"a\": \"b\",}",
+    "{\"a\": \"b\" \"u8\": 1}",
+    "{a: \"b\"}",
+    "{'a': 'b'}",
+    "{\"a\": \"b}",
+    "{\"u8\": 1..2}",
+    "{\"u8\": 01}",
+    "{\"u8\": -01}",
+    "{\"u8\": 1.5e}",
+    "{\"flag\": tru}",
+    "{\"flag\": nul}",
+    "{\"list\": [\"a\", ]}",
+    "{\"list\": [\"a\" \"b\"]}",
+    "{\"list\": [\"a\"}",
+    "{\"u8\": +1}",
+  };
+
+  for (const char* json : malformed) {
+    Values fromJsonValue;
+    Values fromString;
+    EXPECT_FALSE(readWithJsonValue(fromJsonValue, json)) << json;
+    EXPECT_FALSE(readWithString(fromString, json)) << json;
+  }
+}
+
+TEST(JsonStringSerializers, rejectsTruncatedInput) {
+  Nested nested;
+  nested.values = sampleValues();
+  nested.items.push_back(sampleValues());
+  std::string json = writeWithString(nested);
+
+  for (size_t size = 0; size < json.size(); ++size) {
+    std::string truncated = json.substr(0, size);
+    Nested fromJsonValue;
+    Nested fromString;
+    EXPECT_FALSE(readWithJsonValue(fromJsonValue, truncated)) << truncated;
+    EXPECT_FALSE(readWithString(fromString, truncated)) << truncated;
+  }
+}
+
+TEST(JsonStringSerializers, rejectsWrongTypesAsJsonValue) {
+  expectSameRead<Values>("{\"a\": 1}");
+  expectSameRead<Values>("{\"u8\": \"1\"}");
+  expectSameRead<Values>("{\"flag\": 1}");
+  expectSameRead<Values>("{\"list\": \"a\"}");
+  expectSameRead<Real>("{\"real\": \"1.5\"}");
+  expectSameRead<Values>("[]");
+  expectSameRead<Values>("\"text\"");
+
+  // JsonInputValueSerializer reads members of an array opened as an object out of bounds
+  Nested nested;
+  ASSERT_FALSE(readWithString(nested, "{\"values\": []}"));
+}
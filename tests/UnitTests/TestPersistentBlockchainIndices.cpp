@@ -0,0 +1,201 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <limits>
+
+#include <boost/filesystem.hpp>
+
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/PersistentBlockchainIndices.h"
+#include "CryptoNoteCore/TransactionExtra.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+// enough blocks of one entry each for the log to be merged into the run
+const uint32_t MERGED_BLOCKS = 4096;
+
+Crypto::Hash blockHash(uint32_t height, uint8_t branch) {
+  Crypto::Hash hash = {};
+  memcpy(hash.data, &height, sizeof(height));
+  hash.data[sizeof(height)] = branch;
+  return hash;
+}
+
+uint64_t blockTimestamp(uint32_t height) {
+  return 1500000000 + static_cast<uint64_t>(height) * 120;
+}
+
+Transaction createTransaction(uint32_t height, const Crypto::Hash& paymentId) {
+  Transaction transaction;
+  transaction.version = 1;
+  transaction.unlockTime = height;
+  BinaryArray nonce;
+  setPaymentIdToTransactionExtraNonce(nonce, paymentId);
+  addExtraNonceToTransactionExtra(transaction.extra, nonce);
+  return transaction;
+}
+
+}
+
+class PersistentTimestampBlocksIndexTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    m_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("test_indices_%%%%%%%%%%%%");
+    boost::filesystem::create_directories(m_dir);
+    m_path = (m_dir / "timestamps").string();
+  }
+
+  virtual void TearDown() override {
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove_all(m_dir, ignoredErrorCode);
+  }
+
+  void addBlocks(PersistentTimestampBlocksIndex& index, uint32_t begin, uint32_t end, uint8_t branch) {
+    for (uint32_t height = begin; height < end; ++height) {
+      ASSERT_TRUE(index.add(blockTimestamp(height), blockHash(height, branch), height));
+    }
+  }
+
+  void popBlocks(PersistentTimestampBlocksIndex& index, uint32_t begin, uint32_t end) {
+    for (uint32_t height = end; height > begin; --height) {
+      index.popBlock(height - 1);
+    }
+  }
+
+  std::vector<Crypto::Hash> findAll(const PersistentTimestampBlocksIndex& index) {
+    std::vector<Crypto::Hash> hashes;
+    uint32_t count = 0;
+    index.find(0, std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint32_t>::max(), hashes, count);
+    EXPECT_EQ(hashes.size(), count);
+    return hashes;
+  }
+
+  boost::filesystem::path m_dir;
+  std::string m_path;
+};
+
+TEST_F(PersistentTimestampBlocksIndexTest, blocksAddedAfterPopBelowRunAreKeptAcrossReopen) {
+  const uint32_t blockCount = MERGED_BLOCKS + 900;
+  const uint32_t forkHeight = MERGED_BLOCKS - 100;
+
+  {
+    PersistentTimestampBlocksIndex index;
+    index.open(m_path);
+    addBlocks(index, 0, blockCount, 0);
+    popBlocks(index, forkHeight, blockCount);
+    addBlocks(index, forkHeight, forkHeight + 50, 1);
+    index.flush(forkHeight + 50, blockHash(forkHeight + 49, 1));
+  }
+
+  PersistentTimestampBlocksIndex index;
+  index.open(m_path);
+  ASSERT_EQ(forkHeight + 50, index.storedBlockCount());
+  ASSERT_EQ(blockHash(forkHeight + 49, 1), index.storedLastBlock());
+
+  std::vector<Crypto::Hash> hashes = findAll(index);
+  ASSERT_EQ(forkHeight + 50, hashes.size());
+  for (uint32_t height = 0; height < forkHeight + 50; ++height) {
+    ASSERT_EQ(blockHash(height, height < forkHeight ? 0 : 1), hashes[height]);
+  }
+}
+
+TEST_F(PersistentTimestampBlocksIndexTest, popBlockDropsEntriesOfTheLog) {
+  PersistentTimestampBlocksIndex index;
+  index.open(m_path);
+  addBlocks(index, 0, 10, 0);
+  popBlocks(index, 5, 10);
+  addBlocks(index, 5, 8, 1);
+
+  std::vector<Crypto::Hash> hashes = findAll(index);
+  ASSERT_EQ(8, hashes.size());
+  ASSERT_EQ(blockHash(4, 0), hashes[4]);
+  ASSERT_EQ(blockHash(5, 1), hashes[5]);
+  ASSERT_EQ(blockHash(7, 1), hashes[7]);
+}
+
+TEST_F(PersistentTimestampBlocksIndexTest, reopenAfterInterruptedMergeUsesFlushedBlocksOnly) {
+  const uint32_t flushedCount = MERGED_BLOCKS - 96;
+
+  {
+    PersistentTimestampBlocksIndex index;
+    index.open(m_path);
+    addBlocks(index, 0, flushedCount, 0);
+    index.flush(flushedCount, blockHash(flushedCount - 1, 0));
+    boost::filesystem::copy_file(m_path + ".log", (m_dir / "flushed.log").string());
+
+    // the block after MERGED_BLOCKS merges the log into a new run
+    addBlocks(index, flushedCount, MERGED_BLOCKS + 1, 0);
+  }
+
+  // the node stopped after the new run was written and before the log was flushed
+  boost::filesystem::remove(m_path + ".log");
+  boost::filesystem::copy_file((m_dir / "flushed.log").string(), m_path + ".log");
+
+  PersistentTimestampBlocksIndex index;
+  index.open(m_path);
+  ASSERT_EQ(flushedCount, index.storedBlockCount());
+  ASSERT_EQ(flushedCount, findAll(index).size());
+
+  addBlocks(index, flushedCount, flushedCount + 10, 1);
+  std::vector<Crypto::Hash> hashes = findAll(index);
+  ASSERT_EQ(flushedCount + 10, hashes.size());
+  for (uint32_t height = 0; height < flushedCount + 10; ++height) {
+    ASSERT_EQ(blockHash(height, height < flushedCount ? 0 : 1), hashes[height]);
+  }
+}
+
+class PersistentPaymentIdIndexTest : public PersistentTimestampBlocksIndexTest {
+};
+
+TEST_F(PersistentPaymentIdIndexTest, blocksWithoutPaymentIdsPoppedBelowRunKeepLaterBlocksAcrossReopen) {
+  const uint32_t blockCount = MERGED_BLOCKS + 200;
+  const uint32_t forkHeight = MERGED_BLOCKS - 100;
+  const Crypto::Hash oldPaymentId = blockHash(0, 0);
+  const Crypto::Hash newPaymentId = blockHash(0, 1);
+  std::vector<Crypto::Hash> newTransactions;
+
+  {
+    PersistentPaymentIdIndex index;
+    index.open(m_path);
+    for (uint32_t height = 0; height < forkHeight; ++height) {
+      ASSERT_TRUE(index.add(createTransaction(height, oldPaymentId), height));
+    }
+
+    // blocks [forkHeight, MERGED_BLOCKS) have no payment ids, the run is merged during the blocks after them
+    Transaction withoutPaymentId;
+    ASSERT_FALSE(index.add(withoutPaymentId, forkHeight));
+    for (uint32_t height = MERGED_BLOCKS; height < blockCount; ++height) {
+      ASSERT_TRUE(index.add(createTransaction(height, oldPaymentId), height));
+    }
+
+    for (uint32_t height = blockCount; height > forkHeight; --height) {
+      index.popBlock(height - 1);
+    }
+
+    for (uint32_t height = forkHeight; height < forkHeight + 10; ++height) {
+      Transaction transaction = createTransaction(height, newPaymentId);
+      ASSERT_TRUE(index.add(transaction, height));
+      newTransactions.push_back(getObjectHash(transaction));
+    }
+
+    index.flush(forkHeight + 10, blockHash(forkHeight + 9, 1));
+  }
+
+  PersistentPaymentIdIndex index;
+  index.open(m_path);
+  ASSERT_EQ(forkHeight + 10, index.storedBlockCount());
+
+  std::vector<Crypto::Hash> transactions;
+  ASSERT_TRUE(index.find(oldPaymentId, transactions));
+  ASSERT_EQ(forkHeight, transactions.size());
+
+  transactions.clear();
+  ASSERT_TRUE(index.find(newPaymentId, transactions));
+  ASSERT_EQ(newTransactions, transactions);
+}